@@ -11,6 +11,8 @@
 #include <osg/Texture3D>
 #include <osg/BlendFunc>
 #include <osg/Timer>
+#include <osg/PagedLOD>
+#include <osg/OperationThread>
 
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
@@ -18,6 +20,8 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReaderWriter>
 #include <osgDB/PluginQuery>
+#include <osgDB/FileUtils>
+#include <osgDB/fstream>
 
 #include <osgUtil/Optimizer>
 #include <osgUtil/Simplifier>
@@ -26,7 +30,15 @@
 #include <osgViewer/GraphicsWindow>
 #include <osgViewer/Version>
 
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+
 #include <iostream>
+#include <sstream>
+#include <set>
+#include <map>
+#include <algorithm>
 
 #include "OrientationConverter.h"
 
@@ -107,6 +119,10 @@ public:
 
 };
 
+static OpenThreads::Mutex s_compressTexturesMutex;
+static OpenThreads::Mutex s_writtenTextureFilesMutex;
+static std::set<std::string> s_writtenTextureFiles;
+
 class CompressTexturesVisitor : public osg::NodeVisitor
 {
 public:
@@ -149,6 +165,17 @@ public:
 
     void compress()
     {
+        // block compressed formats can be done in software by an ImageProcessor, which doesn't need a graphics context.
+        osgDB::ImageProcessor* imageProcessor = (_internalFormatMode!=osg::Texture::USE_ARB_COMPRESSION) ? osgDB::Registry::instance()->getImageProcessor() : 0;
+        if (imageProcessor)
+        {
+            compress(*imageProcessor);
+            return;
+        }
+
+        // tiles may be converted in parallel, but only one thread at a time compresses through a graphics context.
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_compressTexturesMutex);
+
         MyGraphicsContext context;
         if (!context.valid())
         {
@@ -191,6 +218,38 @@ public:
         }
     }
 
+    void compress(osgDB::ImageProcessor& imageProcessor)
+    {
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        unsigned int numPixels = 0;
+
+        for(TextureSet::iterator itr=_textureSet.begin();
+            itr!=_textureSet.end();
+            ++itr)
+        {
+            osg::Texture* texture = const_cast<osg::Texture*>(itr->get());
+
+            osg::Texture2D* texture2D = dynamic_cast<osg::Texture2D*>(texture);
+
+            osg::ref_ptr<osg::Image> image = texture2D ? texture2D->getImage() : 0;
+            if (image.valid() &&
+                !image->isCompressed() &&
+                (image->s()>=32 && image->t()>=32))
+            {
+                osg::Texture::FilterMode minFilter = texture->getFilter(osg::Texture::MIN_FILTER);
+                bool mipmaps = minFilter!=osg::Texture::LINEAR && minFilter!=osg::Texture::NEAREST;
+
+                numPixels += image->s()*image->t();
+                imageProcessor.compress(*image, _internalFormatMode, mipmaps, false, osgDB::ImageProcessor::USE_CPU, osgDB::ImageProcessor::PRODUCTION);
+            }
+        }
+
+        double duration = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+        osg::notify(osg::NOTICE)<<"Compressed "<<_textureSet.size()<<" textures in "<<duration*1000.0<<"ms";
+        if (duration>0.0) osg::notify(osg::NOTICE)<<", "<<double(numPixels)/(duration*1000000.0)<<" megapixels per second";
+        osg::notify(osg::NOTICE)<<std::endl;
+    }
+
     void write(const std::string &dir)
     {
         for(TextureSet::iterator itr=_textureSet.begin();
@@ -209,6 +268,13 @@ public:
                 name += ".dds";
                 image->setFileName(name);
                 std::string path = dir.empty() ? name : osgDB::concatPaths(dir, name);
+
+                // tiles sharing a texture all reference the one file.
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_writtenTextureFilesMutex);
+                    if (!s_writtenTextureFiles.insert(path).second) continue;
+                }
+
                 osgDB::writeImageFile(*image, path);
                 osg::notify(osg::NOTICE) << "Image written to '" << path << "'." << std::endl;
             }
@@ -418,6 +484,492 @@ public:
 };
 
 
+/** The processing applied to each loaded scene, or tile of a scene, before it's written.*/
+struct ConversionOptions
+{
+    ConversionOptions():
+        pruneStateSet(false),
+        fixTransparencyMode(FixTransparencyVisitor::NO_TRANSPARANCY_FIXING),
+        smooth(false),
+        addMissingColours(false),
+        orientationConverter(0),
+        internalFormatMode(osg::Texture::USE_IMAGE_DATA_FORMAT),
+        overallNormal(false),
+        simplify(false),
+        simplifyPercent(1.0f) {}
+
+    /** Process the scene, which may replace root. fileNameOut is the file the scene will be written to.*/
+    void process(osg::ref_ptr<osg::Node>& root, const std::string& fileNameOut) const
+    {
+        if (pruneStateSet)
+        {
+            PruneStateSetVisitor pssv;
+            root->accept(pssv);
+        }
+
+        if (fixTransparencyMode != FixTransparencyVisitor::NO_TRANSPARANCY_FIXING)
+        {
+            FixTransparencyVisitor atv(fixTransparencyMode);
+            root->accept(atv);
+        }
+
+        if (smooth)
+        {
+            osgUtil::SmoothingVisitor sv;
+            root->accept(sv);
+        }
+
+        if (addMissingColours)
+        {
+            AddMissingColoursToGeometryVisitor av;
+            root->accept(av);
+        }
+
+        // optimize the scene graph, remove rendundent nodes and state etc.
+        osgUtil::Optimizer optimizer;
+        optimizer.optimize(root.get());
+
+        if (orientationConverter)
+            root = orientationConverter->convert( root.get() );
+
+        if (internalFormatMode != osg::Texture::USE_IMAGE_DATA_FORMAT)
+        {
+            std::string ext = osgDB::getFileExtension(fileNameOut);
+            CompressTexturesVisitor ctv(internalFormatMode);
+            root->accept(ctv);
+            ctv.compress();
+
+            osgDB::ReaderWriter::Options *options = osgDB::Registry::instance()->getOptions();
+            if (ext!="ive" || (options && options->getOptionString().find("noTexturesInIVEFile")!=std::string::npos))
+            {
+                ctv.write(osgDB::getFilePath(fileNameOut));
+            }
+        }
+
+        // scrub normals
+        if ( overallNormal )
+        {
+            DefaultNormalsGeometryVisitor dngv;
+            root->accept( dngv );
+        }
+
+        // apply any user-specified simplification
+        if ( simplify )
+        {
+            osgUtil::Simplifier simple;
+            simple.setSmoothing( smooth );
+            osg::notify( osg::ALWAYS ) << " smoothing: " << smooth << std::endl;
+            simple.setSampleRatio( simplifyPercent );
+            root->accept( simple );
+        }
+    }
+
+    bool                                        pruneStateSet;
+    FixTransparencyVisitor::FixTransparencyMode fixTransparencyMode;
+    bool                                        smooth;
+    bool                                        addMissingColours;
+    OrientationConverter*                       orientationConverter;
+    osg::Texture::InternalFormatMode            internalFormatMode;
+    bool                                        overallNormal;
+    bool                                        simplify;
+    float                                       simplifyPercent;
+};
+
+/** Converts datasets too large to hold in memory by converting each input file, or each top-level child of an
+  * input file, as a separate tile. Tiles are processed by a pool of threads and written to their own files, and
+  * loading of further input files waits on the tiles in progress so only a bounded number are held in memory.
+  * Each tile written is recorded in a checkpoint file, so running the same conversion again after an interruption
+  * resumes where it stopped. The master file written once all tiles are done references the tiles through
+  * ProxyNodes, so it loads as the whole scene, or through PagedLODs when a visible range is set so the tiles are
+  * paged in on demand.*/
+class TiledConverter
+{
+public:
+
+    TiledConverter(const ConversionOptions& options, const FileNameList& fileNames, const std::string& fileNameOut):
+        _options(options),
+        _fileNames(fileNames),
+        _fileNameOut(fileNameOut),
+        _tileExtension("osgb"),
+        _numThreads(OpenThreads::GetNumberOfProcessors()),
+        _pagedLODRangeScale(0.0f),
+        _numPendingTiles(0),
+        _numFailedTiles(0)
+    {
+        _tileDirectory = osgDB::getNameLessExtension(fileNameOut) + "_tiles";
+        _checkpointFileName = fileNameOut + ".checkpoint";
+    }
+
+    void setTileExtension(const std::string& ext) { _tileExtension = ext; }
+
+    void setNumThreads(unsigned int numThreads) { _numThreads = osg::maximum(numThreads, 1u); }
+
+    /** Set the visible range of each tile as a multiple of its radius, a range of 0 uses ProxyNodes rather than PagedLODs.*/
+    void setPagedLODRangeScale(float scale) { _pagedLODRangeScale = scale; }
+
+    bool convert()
+    {
+        if (!osgDB::makeDirectory(_tileDirectory))
+        {
+            osg::notify(osg::NOTICE)<<"Error: unable to create tile directory '"<<_tileDirectory<<"'."<< std::endl;
+            return false;
+        }
+
+        if (readCheckpoint())
+        {
+            osg::notify(osg::NOTICE)<<"Resuming conversion from '"<<_checkpointFileName<<"', "<<_tiles.size()<<" tiles already written."<< std::endl;
+        }
+        else if (!writeCheckpointHeader())
+        {
+            osg::notify(osg::NOTICE)<<"Error: unable to write checkpoint file '"<<_checkpointFileName<<"'."<< std::endl;
+            return false;
+        }
+
+        osg::ref_ptr<osg::OperationQueue> operationQueue = new osg::OperationQueue;
+        typedef std::vector< osg::ref_ptr<osg::OperationThread> > OperationThreads;
+        OperationThreads threads;
+        for(unsigned int i=0; i<_numThreads; ++i)
+        {
+            osg::ref_ptr<osg::OperationThread> thread = new osg::OperationThread;
+            thread->setOperationQueue(operationQueue.get());
+            thread->startThread();
+            threads.push_back(thread);
+        }
+
+        bool allFilesRead = true;
+        for(unsigned int fileIndex=0; fileIndex<_fileNames.size(); ++fileIndex)
+        {
+            if (_completedFiles.count(fileIndex)!=0) continue;
+
+            // bound the memory used by waiting for tiles to complete before loading another file.
+            waitForPendingTiles(_numThreads);
+
+            osg::Timer_t startTick = osg::Timer::instance()->tick();
+            osg::ref_ptr<osg::Node> root = osgDB::readNodeFile(_fileNames[fileIndex]);
+            if (!root)
+            {
+                osg::notify(osg::NOTICE)<<"Error: unable to load '"<<_fileNames[fileIndex]<<"'."<< std::endl;
+                allFilesRead = false;
+                continue;
+            }
+            osg::notify(osg::INFO)<<"Time to load "<<_fileNames[fileIndex]<<" "<<osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick())<<" ms"<<std::endl;
+
+            scheduleTiles(*operationQueue, fileIndex, root.get());
+        }
+
+        waitForPendingTiles(0);
+
+        for(OperationThreads::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+        {
+            (*itr)->cancel();
+        }
+
+        if (!allFilesRead || _numFailedTiles>0)
+        {
+            osg::notify(osg::NOTICE)<<"Error: conversion incomplete, run again to retry the remaining files and tiles."<< std::endl;
+            return false;
+        }
+
+        if (!writeMasterFile()) return false;
+
+        // the conversion is complete so a further run starts afresh.
+        _checkpoint.close();
+        remove(_checkpointFileName.c_str());
+        return true;
+    }
+
+protected:
+
+    struct Tile
+    {
+        Tile(): fileIndex(0), childIndex(0) {}
+
+        bool operator < (const Tile& rhs) const
+        {
+            if (fileIndex<rhs.fileIndex) return true;
+            if (rhs.fileIndex<fileIndex) return false;
+            return childIndex<rhs.childIndex;
+        }
+
+        unsigned int            fileIndex;
+        unsigned int            childIndex;
+        std::string             fileName;   // relative to the master file
+        osg::BoundingSphere     bound;
+    };
+
+    typedef std::set<Tile> Tiles;
+
+    class TileOperation : public osg::Operation
+    {
+    public:
+        TileOperation(TiledConverter* converter, const Tile& tile, osg::Node* node):
+            osg::Operation("TileOperation", false),
+            _converter(converter),
+            _tile(tile),
+            _node(node) {}
+
+        virtual void operator () (osg::Object*)
+        {
+            _converter->convertTile(_tile, _node);
+        }
+
+        TiledConverter*         _converter;
+        Tile                    _tile;
+        osg::ref_ptr<osg::Node> _node;
+    };
+
+    // a plain group adds nothing to its children, so they can be written as separate tiles.
+    static bool isPlainGroup(osg::Node& node)
+    {
+        return node.asGroup() && strcmp(node.className(), "Group")==0 &&
+               node.getStateSet()==0 && node.getNodeMask()==0xffffffff &&
+               node.getUpdateCallback()==0 && node.getEventCallback()==0 && node.getCullCallback()==0;
+    }
+
+    void scheduleTiles(osg::OperationQueue& operationQueue, unsigned int fileIndex, osg::Node* root)
+    {
+        // descend through plain groups with a single child, the children of a plain group are each a tile.
+        osg::Node* node = root;
+        while (isPlainGroup(*node) && node->asGroup()->getNumChildren()==1)
+        {
+            node = node->asGroup()->getChild(0);
+        }
+
+        std::vector< osg::ref_ptr<osg::Node> > children;
+        if (isPlainGroup(*node) && node->asGroup()->getNumChildren()>1)
+        {
+            osg::Group* group = node->asGroup();
+            for(unsigned int i=0; i<group->getNumChildren(); ++i) children.push_back(group->getChild(i));
+        }
+        else
+        {
+            children.push_back(node);
+        }
+
+        // tiles of one file may share state or geometry, so each is given its own copy to process in parallel.
+        osg::CopyOp::CopyFlags copyFlags = osg::CopyOp::DEEP_COPY_ALL;
+        if (_options.internalFormatMode == osg::Texture::USE_IMAGE_DATA_FORMAT) copyFlags &= ~osg::CopyOp::DEEP_COPY_IMAGES;
+
+        std::vector<Tile> tiles;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+            for(unsigned int i=0; i<children.size(); ++i)
+            {
+                Tile tile;
+                tile.fileIndex = fileIndex;
+                tile.childIndex = i;
+                if (_tiles.count(tile)!=0) continue;
+
+                std::ostringstream name;
+                name<<osgDB::getSimpleFileName(_tileDirectory)<<"/tile_"<<fileIndex<<"_"<<i<<"."<<_tileExtension;
+                tile.fileName = name.str();
+                tiles.push_back(tile);
+            }
+
+            _numFileTiles[fileIndex] = children.size();
+            _numRemainingTiles[fileIndex] = tiles.size();
+            _numPendingTiles += tiles.size();
+
+            // all the tiles may have been written by a previous run that stopped before recording the file as done.
+            if (tiles.empty()) recordFileDone(fileIndex, children.size());
+        }
+
+        for(std::vector<Tile>::iterator itr = tiles.begin(); itr != tiles.end(); ++itr)
+        {
+            osg::Node* tileNode = children[itr->childIndex].get();
+            if (children.size()>1) tileNode = osg::clone(tileNode, osg::CopyOp(copyFlags));
+
+            operationQueue.add(new TileOperation(this, *itr, tileNode));
+        }
+    }
+
+    void convertTile(Tile tile, osg::ref_ptr<osg::Node>& node)
+    {
+        std::string fileName = osgDB::concatPaths(osgDB::getFilePath(_fileNameOut), tile.fileName);
+
+        _options.process(node, fileName);
+        tile.bound = node->getBound();
+
+        osgDB::ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeNode(*node, fileName, osgDB::Registry::instance()->getOptions());
+
+        // release the tile's memory before another file is loaded.
+        node = 0;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        if (result.success())
+        {
+            _tiles.insert(tile);
+            recordTile(tile);
+            osg::notify(osg::NOTICE)<<"Tile written to '"<<fileName<<"'."<< std::endl;
+
+            if (--_numRemainingTiles[tile.fileIndex]==0) recordFileDone(tile.fileIndex, _numFileTiles[tile.fileIndex]);
+        }
+        else
+        {
+            osg::notify(osg::NOTICE)<<"Error: unable to write tile '"<<fileName<<"' "<<result.message()<< std::endl;
+            ++_numFailedTiles;
+        }
+
+        --_numPendingTiles;
+        _pendingTilesCondition.broadcast();
+    }
+
+    void waitForPendingTiles(unsigned int maxNumPendingTiles)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        while (_numPendingTiles>maxNumPendingTiles)
+        {
+            _pendingTilesCondition.wait(&_mutex);
+        }
+    }
+
+    /** Read the tiles and files completed by a previous run, returns false if there's no checkpoint for these input files.*/
+    bool readCheckpoint()
+    {
+        osgDB::ifstream fin(_checkpointFileName.c_str());
+        if (!fin) return false;
+
+        std::string line;
+        if (!std::getline(fin, line) || line!="osgconv checkpoint 1") return false;
+
+        for(unsigned int i=0; i<_fileNames.size(); ++i)
+        {
+            if (!std::getline(fin, line) || line!="input "+_fileNames[i]) return false;
+        }
+
+        while (std::getline(fin, line))
+        {
+            std::istringstream iss(line);
+            std::string keyword;
+            iss >> keyword;
+
+            if (keyword=="tile")
+            {
+                Tile tile;
+                iss >> tile.fileIndex >> tile.childIndex >> tile.bound._center.x() >> tile.bound._center.y() >> tile.bound._center.z() >> tile.bound._radius;
+                std::getline(iss >> std::ws, tile.fileName);
+
+                // a tile is only recorded once completely written, but check it wasn't removed since.
+                if (iss && !tile.fileName.empty() && osgDB::fileExists(osgDB::concatPaths(osgDB::getFilePath(_fileNameOut), tile.fileName)))
+                {
+                    _tiles.insert(tile);
+                }
+            }
+            else if (keyword=="done")
+            {
+                unsigned int fileIndex = 0, numTiles = 0;
+                iss >> fileIndex >> numTiles;
+                if (iss) _completedFiles[fileIndex] = numTiles;
+            }
+        }
+
+        // files missing any of their tiles are loaded again.
+        for(std::map<unsigned int, unsigned int>::iterator itr = _completedFiles.begin(); itr != _completedFiles.end();)
+        {
+            unsigned int numTiles = 0;
+            for(Tiles::iterator titr = _tiles.begin(); titr != _tiles.end(); ++titr)
+            {
+                if (titr->fileIndex==itr->first) ++numTiles;
+            }
+
+            if (numTiles!=itr->second) _completedFiles.erase(itr++);
+            else ++itr;
+        }
+
+        _checkpoint.open(_checkpointFileName.c_str(), std::ios::out | std::ios::app);
+        return _checkpoint.good();
+    }
+
+    bool writeCheckpointHeader()
+    {
+        _checkpoint.open(_checkpointFileName.c_str(), std::ios::out | std::ios::trunc);
+        _checkpoint<<"osgconv checkpoint 1"<<std::endl;
+        for(unsigned int i=0; i<_fileNames.size(); ++i)
+        {
+            _checkpoint<<"input "<<_fileNames[i]<<std::endl;
+        }
+        return _checkpoint.good();
+    }
+
+    // must be called with the mutex held, each line is flushed so it survives the process being killed.
+    void recordTile(const Tile& tile)
+    {
+        _checkpoint.precision(17);
+        _checkpoint<<"tile "<<tile.fileIndex<<" "<<tile.childIndex<<" "
+                   <<tile.bound.center().x()<<" "<<tile.bound.center().y()<<" "<<tile.bound.center().z()<<" "<<tile.bound.radius()<<" "
+                   <<tile.fileName<<std::endl;
+    }
+
+    // must be called with the mutex held
+    void recordFileDone(unsigned int fileIndex, unsigned int numTiles)
+    {
+        _checkpoint<<"done "<<fileIndex<<" "<<numTiles<<std::endl;
+        _completedFiles[fileIndex] = numTiles;
+    }
+
+    bool writeMasterFile()
+    {
+        osg::ref_ptr<osg::Group> root = new osg::Group;
+        for(Tiles::iterator itr = _tiles.begin(); itr != _tiles.end(); ++itr)
+        {
+            const Tile& tile = *itr;
+            if (!tile.bound.valid()) continue;
+
+            if (_pagedLODRangeScale>0.0f)
+            {
+                osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
+                plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+                plod->setCenter(tile.bound.center());
+                plod->setRadius(tile.bound.radius());
+                plod->setFileName(0, tile.fileName);
+                plod->setRange(0, 0.0f, tile.bound.radius()*_pagedLODRangeScale);
+                root->addChild(plod.get());
+            }
+            else
+            {
+                osg::ref_ptr<osg::ProxyNode> proxy = new osg::ProxyNode;
+                proxy->setCenterMode(osg::ProxyNode::USER_DEFINED_CENTER);
+                proxy->setCenter(tile.bound.center());
+                proxy->setRadius(tile.bound.radius());
+                proxy->setFileName(0, tile.fileName);
+                root->addChild(proxy.get());
+            }
+        }
+
+        osgDB::ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeNode(*root,_fileNameOut,osgDB::Registry::instance()->getOptions());
+        if (result.success())
+        {
+            osg::notify(osg::NOTICE)<<"Master file referencing "<<root->getNumChildren()<<" tiles written to '"<<_fileNameOut<<"'."<< std::endl;
+            return true;
+        }
+
+        osg::notify(osg::NOTICE)<<"Error: unable to write master file '"<<_fileNameOut<<"' "<<result.message()<< std::endl;
+        return false;
+    }
+
+    const ConversionOptions&            _options;
+    FileNameList                        _fileNames;
+    std::string                         _fileNameOut;
+    std::string                         _tileDirectory;
+    std::string                         _checkpointFileName;
+    std::string                         _tileExtension;
+    unsigned int                        _numThreads;
+    float                               _pagedLODRangeScale;
+
+    OpenThreads::Mutex                  _mutex;
+    OpenThreads::Condition              _pendingTilesCondition;
+    unsigned int                        _numPendingTiles;
+    unsigned int                        _numFailedTiles;
+    Tiles                               _tiles;
+    std::map<unsigned int, unsigned int> _completedFiles;      // file index to number of tiles
+    std::map<unsigned int, unsigned int> _numFileTiles;
+    std::map<unsigned int, unsigned int> _numRemainingTiles;
+    osgDB::ofstream                     _checkpoint;
+};
+
+
 static void usage( const char *prog, const char *msg )
 {
     if (msg)
@@ -449,6 +1001,9 @@ static void usage( const char *prog, const char *msg )
     osg::notify(osg::NOTICE)<<"    --compressed-dxt1  - Enable the usage of S3TC DXT1 compressed textures"<< std::endl;
     osg::notify(osg::NOTICE)<<"    --compressed-dxt3  - Enable the usage of S3TC DXT3 compressed textures"<< std::endl;
     osg::notify(osg::NOTICE)<<"    --compressed-dxt5  - Enable the usage of S3TC DXT5 compressed textures"<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --compressed-rgtc1 - Enable the usage of RGTC1 (BC4) single channel compressed textures"<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --compressed-rgtc2 - Enable the usage of RGTC2 (BC5) two channel compressed textures"<< std::endl;
+    osg::notify(osg::NOTICE)<<"                         S3TC and RGTC compression is done in software, without a graphics context."<< std::endl;
     osg::notify(osg::NOTICE)<< std::endl;
     osg::notify(osg::NOTICE)<<"    --fix-transparency - fix statesets which are currently"<< std::endl;
     osg::notify(osg::NOTICE)<<"                         declared as transparent, but should be opaque."<< std::endl;
@@ -524,6 +1079,19 @@ static void usage( const char *prog, const char *msg )
                               "                         (--addMissingColours also accepted)."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --overallNormal    - Replace normals with a single overall normal."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --enable-object-cache - Enable caching of objects, images, etc."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --tiled            - Convert each input file, or each child of an input file's\n"
+                              "                         top level group, as a separate tile written to the\n"
+                              "                         outfile_tiles directory, with outfile referencing the\n"
+                              "                         tiles. Tiles are converted in parallel and only a few\n"
+                              "                         are held in memory at once. Progress is recorded in\n"
+                              "                         outfile.checkpoint, running the same conversion again\n"
+                              "                         after an interruption resumes where it stopped.\n"
+                              "                         Transformations are relative to the world origin."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --tile-threads n   - Number of threads converting tiles, defaults to the\n"
+                              "                         number of processors."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --tile-extension ext - File extension of the tiles, defaults to osgb."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --paged-lod scale  - Reference the tiles through PagedLODs visible within\n"
+                              "                         scale times the tile radius, rather than ProxyNodes."<< std::endl;
 
     osg::notify( osg::NOTICE ) << std::endl;
     osg::notify( osg::NOTICE ) <<
@@ -617,9 +1185,11 @@ int main( int argc, char **argv )
     OrientationConverter oc;
     bool do_convert = false;
 
+    bool useWorldFrame = false;
     if (arguments.read("--use-world-frame"))
     {
         oc.useWorldFrame(true);
+        useWorldFrame = true;
     }
 
     std::string str;
@@ -734,6 +1304,8 @@ int main( int argc, char **argv )
     while(arguments.read("--compressed-dxt1")) { internalFormatMode = osg::Texture::USE_S3TC_DXT1_COMPRESSION; }
     while(arguments.read("--compressed-dxt3")) { internalFormatMode = osg::Texture::USE_S3TC_DXT3_COMPRESSION; }
     while(arguments.read("--compressed-dxt5")) { internalFormatMode = osg::Texture::USE_S3TC_DXT5_COMPRESSION; }
+    while(arguments.read("--compressed-rgtc1")) { internalFormatMode = osg::Texture::USE_RGTC1_COMPRESSION; }
+    while(arguments.read("--compressed-rgtc2")) { internalFormatMode = osg::Texture::USE_RGTC2_COMPRESSION; }
 
     bool smooth = false;
     while(arguments.read("--smooth")) { smooth = true; }
@@ -747,6 +1319,18 @@ int main( int argc, char **argv )
     bool enableObjectCache = false;
     while(arguments.read("--enable-object-cache")) { enableObjectCache = true; }
 
+    bool tiled = false;
+    while(arguments.read("--tiled")) { tiled = true; }
+
+    unsigned int numTileThreads = OpenThreads::GetNumberOfProcessors();
+    while(arguments.read("--tile-threads", numTileThreads)) {}
+
+    std::string tileExtension("osgb");
+    while(arguments.read("--tile-extension", tileExtension)) {}
+
+    float pagedLODRangeScale = 0.0f;
+    while(arguments.read("--paged-lod", pagedLODRangeScale)) {}
+
     // any option left unread are converted into errors to write out later.
     arguments.reportRemainingOptionsAsUnrecognized();
 
@@ -778,81 +1362,43 @@ int main( int argc, char **argv )
         fileNames.pop_back();
     }
 
-    osg::Timer_t startTick = osg::Timer::instance()->tick();
-
-    osg::ref_ptr<osg::Node> root = osgDB::readNodeFiles(fileNames);
-
-    if (root.valid())
-    {
-        osg::Timer_t endTick = osg::Timer::instance()->tick();
-        osg::notify(osg::INFO)<<"Time to load files "<<osg::Timer::instance()->delta_m(startTick, endTick)<<" ms"<<std::endl;
-    }
-
-
-    if (pruneStateSet)
-    {
-        PruneStateSetVisitor pssv;
-        root->accept(pssv);
-    }
-
-    if (fixTransparencyMode != FixTransparencyVisitor::NO_TRANSPARANCY_FIXING)
-    {
-        FixTransparencyVisitor atv(fixTransparencyMode);
-        root->accept(atv);
-    }
-
-    if ( root.valid() )
+    ConversionOptions conversionOptions;
+    conversionOptions.pruneStateSet = pruneStateSet;
+    conversionOptions.fixTransparencyMode = fixTransparencyMode;
+    conversionOptions.smooth = smooth;
+    conversionOptions.addMissingColours = addMissingColours;
+    conversionOptions.orientationConverter = do_convert ? &oc : 0;
+    conversionOptions.internalFormatMode = internalFormatMode;
+    conversionOptions.overallNormal = do_overallNormal;
+    conversionOptions.simplify = do_simplify;
+    conversionOptions.simplifyPercent = simplifyPercent;
+
+    if (tiled)
     {
-
-        if (smooth)
+        // the bound of the whole dataset isn't known until all the tiles are converted.
+        if (do_convert && !useWorldFrame)
         {
-            osgUtil::SmoothingVisitor sv;
-            root->accept(sv);
+            osg::notify(osg::NOTICE)<<"Tiled conversion transforms relative to the world origin, as with --use-world-frame."<< std::endl;
+            oc.useWorldFrame(true);
         }
 
-        if (addMissingColours)
-        {
-            AddMissingColoursToGeometryVisitor av;
-            root->accept(av);
-        }
-
-        // optimize the scene graph, remove rendundent nodes and state etc.
-        osgUtil::Optimizer optimizer;
-        optimizer.optimize(root.get());
-
-        if( do_convert )
-            root = oc.convert( root.get() );
+        TiledConverter tiledConverter(conversionOptions, fileNames, fileNameOut);
+        tiledConverter.setNumThreads(numTileThreads);
+        tiledConverter.setTileExtension(tileExtension);
+        tiledConverter.setPagedLODRangeScale(pagedLODRangeScale);
+        return tiledConverter.convert() ? 0 : 1;
+    }
 
-        if (internalFormatMode != osg::Texture::USE_IMAGE_DATA_FORMAT)
-        {
-            std::string ext = osgDB::getFileExtension(fileNameOut);
-            CompressTexturesVisitor ctv(internalFormatMode);
-            root->accept(ctv);
-            ctv.compress();
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
 
-            osgDB::ReaderWriter::Options *options = osgDB::Registry::instance()->getOptions();
-            if (ext!="ive" || (options && options->getOptionString().find("noTexturesInIVEFile")!=std::string::npos))
-            {
-                ctv.write(osgDB::getFilePath(fileNameOut));
-            }
-        }
+    osg::ref_ptr<osg::Node> root = osgDB::readNodeFiles(fileNames);
 
-        // scrub normals
-        if ( do_overallNormal )
-        {
-            DefaultNormalsGeometryVisitor dngv;
-            root->accept( dngv );
-        }
+    if ( root.valid() )
+    {
+        osg::Timer_t endTick = osg::Timer::instance()->tick();
+        osg::notify(osg::INFO)<<"Time to load files "<<osg::Timer::instance()->delta_m(startTick, endTick)<<" ms"<<std::endl;
 
-        // apply any user-specified simplification
-        if ( do_simplify )
-        {
-            osgUtil::Simplifier simple;
-            simple.setSmoothing( smooth );
-            osg::notify( osg::ALWAYS ) << " smoothing: " << smooth << std::endl;
-            simple.setSampleRatio( simplifyPercent );
-            root->accept( simple );
-        }
+        conversionOptions.process(root, fileNameOut);
 
         osgDB::ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeNode(*root,fileNameOut,osgDB::Registry::instance()->getOptions());
         if (result.success())
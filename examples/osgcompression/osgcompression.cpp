@@ -0,0 +1,210 @@
+/* OpenSceneGraph example, osgcompression.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Geometry>
+#include <osg/Geode>
+#include <osg/Timer>
+#include <osg/Notify>
+
+#include <OpenThreads/Thread>
+
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+#include <osgDB/ObjectWrapper>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+// build a terrain like tile of numRows x numRows vertices, with normals and texture coordinates.
+osg::Node* createTile(unsigned int numRows)
+{
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array;
+
+    for(unsigned int r=0; r<numRows; ++r)
+    {
+        for(unsigned int c=0; c<numRows; ++c)
+        {
+            float x = float(c)/float(numRows-1);
+            float y = float(r)/float(numRows-1);
+            float z = 0.1f*sinf(x*17.0f)*cosf(y*13.0f) + 0.02f*sinf(x*97.0f+y*61.0f);
+            vertices->push_back(osg::Vec3(x, y, z));
+
+            osg::Vec3 normal(-0.1f*17.0f*cosf(x*17.0f)*cosf(y*13.0f), 0.1f*13.0f*sinf(x*17.0f)*sinf(y*13.0f), 1.0f);
+            normal.normalize();
+            normals->push_back(normal);
+
+            texcoords->push_back(osg::Vec2(x, y));
+        }
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(unsigned int r=0; r<numRows-1; ++r)
+    {
+        for(unsigned int c=0; c<numRows-1; ++c)
+        {
+            unsigned int i = r*numRows+c;
+            triangles->push_back(i); triangles->push_back(i+1); triangles->push_back(i+numRows);
+            triangles->push_back(i+numRows); triangles->push_back(i+1); triangles->push_back(i+numRows+1);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->setTexCoordArray(0, texcoords.get());
+    geometry->addPrimitiveSet(triangles.get());
+
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    return geode;
+}
+
+void setNumCompressionThreads(unsigned int numThreads)
+{
+    // putenv keeps the pointer so the buffer has to outlive the call.
+    static char envString[64];
+    sprintf(envString, "OSG_NUM_COMPRESSION_THREADS=%u", numThreads);
+    putenv(envString);
+}
+
+int main( int argc, char **argv )
+{
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" benchmarks the osgDB compressors used by the .osgb format, reporting MB/s against the number of threads.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename]");
+    arguments.getApplicationUsage()->addCommandLineOption("--compressor <name>","Compressor to benchmark, such as zlib, bgzf, lz4 or zstd, may be repeated. Defaults to all of those available.");
+    arguments.getApplicationUsage()->addCommandLineOption("--rows <num>","Number of rows of vertices in the generated tile used when no file is given, default 1024.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Maximum number of threads to test, default the number of processors.");
+    arguments.getApplicationUsage()->addCommandLineOption("--repeat <num>","Number of times each test is repeated, default 3.");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    typedef std::vector<std::string> CompressorNames;
+    CompressorNames compressorNames;
+    std::string compressorName;
+    while(arguments.read("--compressor", compressorName)) { compressorNames.push_back(compressorName); }
+
+    if (compressorNames.empty())
+    {
+        const char* defaultNames[] = { "zlib", "bgzf", "lz4", "zstd" };
+        for(unsigned int i=0; i<4; ++i)
+        {
+            if (osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor(defaultNames[i])) compressorNames.push_back(defaultNames[i]);
+        }
+    }
+
+    unsigned int numRows = 1024;
+    while(arguments.read("--rows", numRows)) {}
+
+    unsigned int maxThreads = OpenThreads::GetNumberOfProcessors();
+    while(arguments.read("--threads", maxThreads)) {}
+    if (maxThreads<1) maxThreads = 1;
+
+    unsigned int numRepeats = 3;
+    while(arguments.read("--repeat", numRepeats)) {}
+    if (numRepeats<1) numRepeats = 1;
+
+    osg::ref_ptr<osg::Node> node = arguments.argc()>1 ? osgDB::readNodeFiles(arguments) : createTile(numRows);
+    if (!node)
+    {
+        std::cout<<arguments.getApplicationName()<<": No data loaded"<<std::endl;
+        return 1;
+    }
+
+    osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("osgb");
+    if (!rw)
+    {
+        std::cout<<arguments.getApplicationName()<<": osgb plugin not available"<<std::endl;
+        return 1;
+    }
+
+    // the uncompressed .osgb serialization is what the compressor sees when writing a tile.
+    std::stringstream serialized;
+    rw->writeNode(*node, serialized);
+    std::string source = serialized.str();
+
+    double sourceMB = double(source.size())/(1024.0*1024.0);
+    std::cout<<sourceMB<<"MB of uncompressed .osgb data"<<std::endl;
+    std::cout<<"compressor\tthreads\tMB\tratio\twrite MB/s\tread MB/s"<<std::endl;
+
+    for(CompressorNames::iterator itr = compressorNames.begin(); itr != compressorNames.end(); ++itr)
+    {
+        osgDB::BaseCompressor* compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor(*itr);
+        if (!compressor)
+        {
+            std::cout<<*itr<<"\tnot available"<<std::endl;
+            continue;
+        }
+
+        for(unsigned int numThreads=1; ; numThreads = osg::minimum(numThreads*2, maxThreads))
+        {
+            setNumCompressionThreads(numThreads);
+
+            double compressTime = 0.0, decompressTime = 0.0;
+            std::string compressed;
+            bool success = true;
+            for(unsigned int i=0; i<numRepeats && success; ++i)
+            {
+                std::ostringstream out;
+                osg::Timer_t startTick = osg::Timer::instance()->tick();
+                success = compressor->compress(out, source);
+                compressTime += osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+                compressed = out.str();
+
+                std::istringstream in(compressed);
+                std::string target;
+                startTick = osg::Timer::instance()->tick();
+                success = success && compressor->decompress(in, target);
+                decompressTime += osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+                success = success && target==source;
+            }
+
+            if (!success)
+            {
+                std::cout<<*itr<<"\t"<<numThreads<<"\tround trip failed"<<std::endl;
+                break;
+            }
+
+            std::cout<<*itr<<"\t"<<numThreads
+                     <<"\t"<<double(compressed.size())/(1024.0*1024.0)
+                     <<"\t"<<double(source.size())/double(compressed.size())
+                     <<"\t"<<sourceMB*numRepeats/compressTime
+                     <<"\t"<<sourceMB*numRepeats/decompressTime<<std::endl;
+
+            if (numThreads==maxThreads) break;
+        }
+    }
+
+    return 0;
+}
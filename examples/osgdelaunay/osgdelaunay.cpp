@@ -32,6 +32,7 @@
 #include <osg/Projection>
 #include <osg/MatrixTransform>
 #include <osgUtil/Tessellator> // tessellator triangulates the constrained triangles
+#include <osg/Timer>
 
 #include <osgText/Text>
 
@@ -1267,12 +1268,59 @@ deprecated_osg::Geometry * LinearConstraint::makeGeometry(const osg::Vec3Array *
 
 
 
+/** triangulate numPoints random points, optionally with a closed constraint loop through them,
+* and report the time taken and the number of triangles generated.
+*/
+int benchmark(unsigned int numPoints, bool withConstraint)
+{
+    osg::ref_ptr<osg::Vec3Array> points=new osg::Vec3Array;
+    points->reserve(numPoints);
+    srand(1);
+    for (unsigned int i=0; i<numPoints; i++) {
+        points->push_back(osg::Vec3(1000.0f*rand()/RAND_MAX, 1000.0f*rand()/RAND_MAX, 10.0f*rand()/RAND_MAX));
+    }
+
+    osg::ref_ptr<osgUtil::DelaunayTriangulator> trig=new osgUtil::DelaunayTriangulator(points.get());
+    osg::ref_ptr<osgUtil::DelaunayConstraint> dc;
+    if (withConstraint) {
+        // an ellipse of 1000 vertices across the middle of the points
+        dc=new osgUtil::DelaunayConstraint;
+        osg::Vec3Array *bounds=new osg::Vec3Array;
+        for (unsigned int i=0; i<1000; i++) {
+            float angle=2.0f*osg::PI*i/1000.0f;
+            bounds->push_back(osg::Vec3(500.0f+300.0f*cosf(angle), 500.0f+200.0f*sinf(angle), 5.0f));
+        }
+        dc->setVertexArray(bounds);
+        dc->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINE_LOOP,0,bounds->size()));
+        trig->addInputConstraint(dc.get());
+    }
+
+    osg::Timer_t start=osg::Timer::instance()->tick();
+    bool ok=trig->triangulate();
+    double elapsed=osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    if (!ok) {
+        std::cout << "Triangulation of " << numPoints << " points failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Triangulated " << numPoints << " points " << (withConstraint ? "with" : "without") <<
+        " a constraint into " << trig->getTriangles()->getNumPrimitives() << " triangles in " << elapsed << "s" << std::endl;
+
+    return 0;
+}
+
 int main( int argc, char **argv )
 {
 
     // use an ArgumentParser object to manage the program arguments.
     osg::ArgumentParser arguments(&argc,argv);
 
+    // time the triangulation of random points rather than viewing the example terrain.
+    unsigned int numBenchmarkPoints=0;
+    if (arguments.read("--benchmark",numBenchmarkPoints)) {
+        return benchmark(numBenchmarkPoints, arguments.read("--constrained"));
+    }
+
     // construct the viewer.
     osgViewer::Viewer viewer;
 
@@ -0,0 +1,378 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/BackgroundReleaseThread>
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Texture>
+#include <osg/Notify>
+
+#include <set>
+
+using namespace osg;
+
+namespace
+{
+
+/** Estimate the memory that will be reclaimed by releasing a subgraph, only objects that are solely owned
+  * by the subgraph are counted, so data shared with live subgraphs, such as via the SharedStateManager
+  * or the object cache, is skipped as it isn't freed by the release.*/
+class EstimateReleasedBytesVisitor : public osg::NodeVisitor
+{
+public:
+
+    EstimateReleasedBytesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _numBytes(0.0) {}
+
+    static bool solelyOwned(const osg::Referenced* object) { return object->referenceCount()<=1; }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (!solelyOwned(&node)) return;
+
+        apply(node.getStateSet());
+        traverse(node);
+    }
+
+    virtual void apply(osg::Geode& geode)
+    {
+        if (!solelyOwned(&geode)) return;
+
+        apply(geode.getStateSet());
+        for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+        {
+            apply(geode.getDrawable(i));
+        }
+    }
+
+    void apply(osg::Drawable* drawable)
+    {
+        if (!drawable || !solelyOwned(drawable) || !_visited.insert(drawable).second) return;
+
+        apply(drawable->getStateSet());
+
+        osg::Geometry* geometry = drawable->asGeometry();
+        if (!geometry) return;
+
+        osg::Geometry::ArrayList arrays;
+        geometry->getArrayList(arrays);
+        for(osg::Geometry::ArrayList::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+        {
+            // the ArrayList holds an extra reference of its own.
+            if (itr->valid() && (*itr)->referenceCount()<=2) apply(itr->get());
+        }
+
+        osg::Geometry::PrimitiveSetList& primitives = geometry->getPrimitiveSetList();
+        for(osg::Geometry::PrimitiveSetList::iterator itr = primitives.begin(); itr != primitives.end(); ++itr)
+        {
+            if (itr->valid() && solelyOwned(itr->get())) apply(itr->get());
+        }
+    }
+
+    void apply(osg::StateSet* stateset)
+    {
+        if (!stateset || !solelyOwned(stateset) || !_visited.insert(stateset).second) return;
+
+        osg::StateSet::TextureAttributeList& tal = stateset->getTextureAttributeList();
+        for(unsigned int unit=0; unit<tal.size(); ++unit)
+        {
+            osg::Texture* texture = dynamic_cast<osg::Texture*>(stateset->getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+            if (!texture || !solelyOwned(texture) || !_visited.insert(texture).second) continue;
+
+            for(unsigned int i=0; i<texture->getNumImages(); ++i)
+            {
+                osg::Image* image = texture->getImage(i);
+                if (image && solelyOwned(image)) apply(image);
+            }
+        }
+    }
+
+    void apply(osg::BufferData* bufferData)
+    {
+        if (!bufferData || !_visited.insert(bufferData).second) return;
+        _numBytes += static_cast<double>(bufferData->getTotalDataSize());
+    }
+
+    std::set<const osg::Referenced*>    _visited;
+    double                              _numBytes;
+};
+
+double estimateReleasedBytes(const osg::Referenced* object)
+{
+    osg::Node* node = dynamic_cast<osg::Node*>(const_cast<osg::Referenced*>(object));
+    if (node)
+    {
+        EstimateReleasedBytesVisitor erbv;
+        node->accept(erbv);
+        return erbv._numBytes;
+    }
+
+    const osg::BufferData* bufferData = dynamic_cast<const osg::BufferData*>(object);
+    if (bufferData && bufferData->referenceCount()<=1) return static_cast<double>(bufferData->getTotalDataSize());
+
+    return 0.0;
+}
+
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//
+// BackgroundReleaseThread
+//
+BackgroundReleaseThread::BackgroundReleaseThread():
+    osg::Referenced(true),
+    _numObjectsInProgress(0),
+    _numBytesPending(0.0),
+    _batchSize(256),
+    _done(false)
+{
+    setSchedulePriority(THREAD_PRIORITY_LOW);
+}
+
+BackgroundReleaseThread::~BackgroundReleaseThread()
+{
+    cancel();
+}
+
+void BackgroundReleaseThread::release(const osg::Referenced* object)
+{
+    if (!object) return;
+
+    object->ref();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+    _incoming.push_back(Entry(object, 0));
+    _block.release();
+}
+
+void BackgroundReleaseThread::requestDelete(const osg::Referenced* object, DeleteHandler* deleteHandler)
+{
+    if (!object || !deleteHandler) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+    _incoming.push_back(Entry(object, deleteHandler));
+    _block.release();
+}
+
+unsigned int BackgroundReleaseThread::getNumObjectsPending() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+    return static_cast<unsigned int>(_incoming.size()) + _numObjectsInProgress;
+}
+
+double BackgroundReleaseThread::getNumBytesPending() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+    return _numBytesPending;
+}
+
+void BackgroundReleaseThread::releaseEntry(const Entry& entry)
+{
+    if (entry.deleteHandler) entry.deleteHandler->doDelete(entry.object);
+    else entry.object->unref();
+}
+
+void BackgroundReleaseThread::releaseAll()
+{
+    // releasing objects can queue up further deletions via a BackgroundDeleteHandler, so keep going till empty.
+    for(;;)
+    {
+        Entries entries;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+            entries.swap(_incoming);
+        }
+
+        if (entries.empty()) break;
+
+        for(Entries::iterator itr = entries.begin(); itr != entries.end(); ++itr)
+        {
+            releaseEntry(*itr);
+        }
+    }
+}
+
+int BackgroundReleaseThread::cancel()
+{
+    int result = 0;
+    if (isRunning())
+    {
+        _done = true;
+        _block.release();
+
+        // wait for the thread to stop running.
+        while(isRunning())
+        {
+            _block.release();
+            OpenThreads::Thread::YieldCurrentThread();
+        }
+    }
+
+    releaseAll();
+
+    return result;
+}
+
+void BackgroundReleaseThread::run()
+{
+    OSG_INFO<<"BackgroundReleaseThread::run()"<<std::endl;
+
+    Entries entries;
+
+    while(!_done)
+    {
+        _block.block();
+
+        if (_done) break;
+
+        // take ownership of the newly queued objects.
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+            _numObjectsInProgress += static_cast<unsigned int>(_incoming.size());
+            entries.splice(entries.end(), _incoming);
+            _block.reset();
+        }
+
+        // estimate the memory held by the subgraphs before we start releasing them.
+        for(Entries::iterator itr = entries.begin(); itr != entries.end(); ++itr)
+        {
+            if (!itr->deleteHandler && itr->numBytes==0.0)
+            {
+                itr->numBytes = estimateReleasedBytes(itr->object);
+
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+                _numBytesPending += itr->numBytes;
+            }
+        }
+
+        // release the objects in batches, yielding between batches so other threads get a look in.
+        while(!entries.empty() && !_done)
+        {
+            double numBytesReleased = 0.0;
+            unsigned int numReleased = 0;
+            while(!entries.empty() && numReleased<_batchSize)
+            {
+                Entry entry = entries.front();
+                entries.pop_front();
+
+                releaseEntry(entry);
+
+                numBytesReleased += entry.numBytes;
+                ++numReleased;
+            }
+
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+                _numObjectsInProgress -= numReleased;
+                _numBytesPending -= numBytesReleased;
+                if (_numBytesPending<0.0) _numBytesPending = 0.0;
+
+                // pick up objects queued while we were releasing, typically children whose parent has just been deleted.
+                if (!_incoming.empty()) _block.release();
+            }
+
+            OpenThreads::Thread::YieldCurrentThread();
+        }
+    }
+
+    // hand back anything left over so that cancel() can release it.
+    if (!entries.empty())
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_queueMutex);
+        _numObjectsInProgress = 0;
+        _numBytesPending = 0.0;
+        _incoming.splice(_incoming.begin(), entries);
+    }
+
+    OSG_INFO<<"BackgroundReleaseThread::run() done"<<std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//
+// BackgroundDeleteHandler
+//
+BackgroundDeleteHandler::BackgroundDeleteHandler(int numberOfFramesToRetainObjects):
+    DeleteHandler(numberOfFramesToRetainObjects)
+{
+    _releaseThread = new BackgroundReleaseThread;
+    _releaseThread->startThread();
+}
+
+BackgroundDeleteHandler::~BackgroundDeleteHandler()
+{
+    flushAll();
+
+    _releaseThread->cancel();
+
+    // note, release thread is unref'd after the ref_ptr has been reset, so if this
+    // is the active DeleteHandler the thread object is deleted directly.
+    _releaseThread = 0;
+}
+
+void BackgroundDeleteHandler::flush()
+{
+    typedef std::list<const osg::Referenced*> DeletionList;
+    DeletionList deletionList;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        unsigned int frameNumberToClearTo = _currentFrameNumber - _numFramesToRetainObjects;
+
+        ObjectsToDeleteList::iterator itr;
+        for(itr = _objectsToDelete.begin();
+            itr != _objectsToDelete.end();
+            ++itr)
+        {
+            if (itr->first > frameNumberToClearTo) break;
+
+            deletionList.push_back(itr->second);
+
+            itr->second = 0;
+        }
+
+        _objectsToDelete.erase( _objectsToDelete.begin(), itr);
+    }
+
+    for(DeletionList::iterator ditr = deletionList.begin();
+        ditr != deletionList.end();
+        ++ditr)
+    {
+        _releaseThread->requestDelete(*ditr, this);
+    }
+}
+
+void BackgroundDeleteHandler::flushAll()
+{
+    DeleteHandler::flushAll();
+
+    if (_releaseThread.valid()) _releaseThread->releaseAll();
+}
+
+void BackgroundDeleteHandler::requestDelete(const osg::Referenced* object)
+{
+    if (!_releaseThread.valid() || !_releaseThread->isRunning())
+    {
+        doDelete(object);
+    }
+    else if (_numFramesToRetainObjects==0)
+    {
+        _releaseThread->requestDelete(object, this);
+    }
+    else
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _objectsToDelete.push_back(FrameNumberObjectPair(_currentFrameNumber,object));
+    }
+}
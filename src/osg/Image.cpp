@@ -14,6 +14,7 @@
 #include <osg/GLU>
 
 #include <osg/Image>
+#include <osg/ImageUtils>
 #include <osg/Notify>
 #include <osg/io_utils>
 
@@ -1328,20 +1329,30 @@ void Image::scaleImage(int s,int t,int r, GLenum newDataType)
         return;
     }
 
-    PixelStorageModes psm;
-    psm.pack_alignment = _packing;
-    psm.pack_row_length = _rowLength;
-    psm.unpack_alignment = _packing;
+    GLint status = 0;
+    if (isResampleSupported(_pixelFormat, _dataType) && isResampleSupported(_pixelFormat, newDataType))
+    {
+        resampleImageData(_pixelFormat,
+            _s, _t, _dataType, _data, getRowStepInBytes(),
+            s, t, newDataType, newData, computeRowWidthInBytes(s,_pixelFormat,newDataType,_packing));
+    }
+    else
+    {
+        PixelStorageModes psm;
+        psm.pack_alignment = _packing;
+        psm.pack_row_length = _rowLength;
+        psm.unpack_alignment = _packing;
 
-    GLint status = gluScaleImage(&psm, _pixelFormat,
-        _s,
-        _t,
-        _dataType,
-        _data,
-        s,
-        t,
-        newDataType,
-        newData);
+        status = gluScaleImage(&psm, _pixelFormat,
+            _s,
+            _t,
+            _dataType,
+            _data,
+            s,
+            t,
+            newDataType,
+            newData);
+    }
 
     if (status==0)
     {
@@ -1352,6 +1363,9 @@ void Image::scaleImage(int s,int t,int r, GLenum newDataType)
         _rowLength = 0;
         _dataType = newDataType;
         setData(newData,USE_NEW_DELETE);
+
+        // any mipmaps were of the old size and weren't carried over to the new data.
+        _mipmapData.clear();
     }
     else
     {
@@ -1395,6 +1409,14 @@ void Image::copySubImage(int s_offset, int t_offset, int r_offset, const osg::Im
 
     void* data_destination = data(s_offset,t_offset,r_offset);
 
+    if (isResampleSupported(_pixelFormat, source->getDataType()) && isResampleSupported(_pixelFormat, _dataType))
+    {
+        resampleImageData(_pixelFormat,
+            source->s(), source->t(), source->getDataType(), source->data(), source->getRowStepInBytes(),
+            source->s(), source->t(), _dataType, static_cast<unsigned char*>(data_destination), getRowStepInBytes());
+        return;
+    }
+
     PixelStorageModes psm;
     psm.pack_alignment = _packing;
     psm.pack_row_length = _rowLength!=0 ? _rowLength : _s;
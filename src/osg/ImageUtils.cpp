@@ -19,6 +19,16 @@
 #include <osg/ImageUtils>
 #include <osg/Texture>
 
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=1)
+    #include <xmmintrin.h>
+    #define OSG_RESAMPLE_USE_SSE
+#endif
+
 namespace osg
 {
 
@@ -699,7 +709,571 @@ osg::Image* colorSpaceConversion(ColorSpaceOperation op, osg::Image* image, cons
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Image resampling
+//
+namespace
+{
+
+struct ResampleWeights
+{
+    // for each destination pixel the first source pixel and the weights of the numTaps source pixels from it.
+    std::vector<int>    first;
+    std::vector<float>  weights;
+    int                 numTaps;
+};
+
+inline double sinc(double x)
+{
+    if (x==0.0) return 1.0;
+    x *= osg::PI;
+    return sin(x)/x;
+}
+
+// zeroth order modified Bessel function of the first kind, used by the Kaiser window.
+inline double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double halfX = x*0.5;
+    for(int k=1; k<32; ++k)
+    {
+        term *= (halfX/double(k))*(halfX/double(k));
+        sum += term;
+        if (term<sum*1e-12) break;
+    }
+    return sum;
+}
+
+inline double resampleKernel(ResampleFilter filter, double x)
+{
+    x = fabs(x);
+    switch(filter)
+    {
+        case(RESAMPLE_LANCZOS):
+            return x<3.0 ? sinc(x)*sinc(x/3.0) : 0.0;
+        case(RESAMPLE_KAISER):
+        {
+            if (x>=3.0) return 0.0;
+            const double alpha = 4.0;
+            double r = x/3.0;
+            return sinc(x)*besselI0(alpha*sqrt(1.0-r*r))/besselI0(alpha);
+        }
+        default:
+            return x<1.0 ? 1.0-x : 0.0;
+    }
+}
+
+void computeResampleWeights(ResampleFilter filter, int srcSize, int destSize, ResampleWeights& rw)
+{
+    double scale = double(srcSize)/double(destSize);
+    double radius = (filter==RESAMPLE_BOX) ? 0.5 : ((filter==RESAMPLE_BILINEAR) ? 1.0 : 3.0);
+    double support = radius * (scale>1.0 ? scale : 1.0);
+
+    rw.numTaps = static_cast<int>(ceil(support*2.0))+2;
+    rw.first.resize(destSize);
+    rw.weights.assign(destSize*rw.numTaps, 0.0f);
+
+    std::vector<double> w(rw.numTaps);
+    for(int i=0; i<destSize; ++i)
+    {
+        int begin, end;
+        if (filter==RESAMPLE_BOX)
+        {
+            // weight each source pixel by how much of it the destination pixel covers, when magnifying
+            // the box is one source pixel wide so neighbouring source pixels are blended as per gluScaleImage.
+            double center = (double(i)+0.5)*scale;
+            double x0 = center-support;
+            double x1 = center+support;
+            begin = static_cast<int>(floor(x0));
+            end = static_cast<int>(ceil(x1));
+            if (begin<0) begin = 0;
+            if (end>srcSize) end = srcSize;
+            if (end-begin>rw.numTaps) end = begin+rw.numTaps;
+            for(int k=begin; k<end; ++k)
+            {
+                double overlap = osg::minimum(x1, double(k+1)) - osg::maximum(x0, double(k));
+                w[k-begin] = overlap>0.0 ? overlap : 0.0;
+            }
+        }
+        else
+        {
+            double center = (double(i)+0.5)*scale - 0.5;
+            double filterScale = scale>1.0 ? 1.0/scale : 1.0;
+            begin = static_cast<int>(ceil(center-support));
+            end = static_cast<int>(floor(center+support))+1;
+            if (begin<0) begin = 0;
+            if (end>srcSize) end = srcSize;
+            if (end-begin>rw.numTaps) end = begin+rw.numTaps;
+            for(int k=begin; k<end; ++k)
+            {
+                w[k-begin] = resampleKernel(filter, (double(k)-center)*filterScale);
+            }
+        }
+
+        if (end<=begin)
+        {
+            // destination pixel falls outside the source, use the nearest edge pixel.
+            begin = osg::clampBetween(static_cast<int>(double(i)*scale), 0, srcSize-1);
+            end = begin+1;
+            w[0] = 1.0;
+        }
+
+        // normalize so that weights truncated at the image edges still sum to one.
+        double total = 0.0;
+        for(int k=0; k<end-begin; ++k) total += w[k];
+        if (total==0.0) { w[0] = 1.0; total = 1.0; end = begin+1; }
+
+        rw.first[i] = begin;
+        float* weights = &rw.weights[i*rw.numTaps];
+        for(int k=0; k<end-begin; ++k) weights[k] = static_cast<float>(w[k]/total);
+    }
+}
+
+inline float dataTypeScale(GLenum dataType)
+{
+    switch(dataType)
+    {
+        case(GL_BYTE):              return 127.0f;
+        case(GL_UNSIGNED_BYTE):     return 255.0f;
+        case(GL_SHORT):             return 32767.0f;
+        case(GL_UNSIGNED_SHORT):    return 65535.0f;
+        case(GL_INT):               return 2147483647.0f;
+        case(GL_UNSIGNED_INT):      return 4294967295.0f;
+        default:                    return 1.0f;
+    }
+}
+
+template<typename T>
+void _convertRowToFloat(const T* src, float* dest, unsigned int num, float scale)
+{
+    for(unsigned int i=0; i<num; ++i) dest[i] = static_cast<float>(src[i])*scale;
+}
+
+void convertRowToFloat(GLenum dataType, const unsigned char* src, float* dest, unsigned int num)
+{
+    float scale = 1.0f/dataTypeScale(dataType);
+    switch(dataType)
+    {
+        case(GL_BYTE):              _convertRowToFloat(reinterpret_cast<const char*>(src), dest, num, scale); break;
+        case(GL_UNSIGNED_BYTE):     _convertRowToFloat(src, dest, num, scale); break;
+        case(GL_SHORT):             _convertRowToFloat(reinterpret_cast<const short*>(src), dest, num, scale); break;
+        case(GL_UNSIGNED_SHORT):    _convertRowToFloat(reinterpret_cast<const unsigned short*>(src), dest, num, scale); break;
+        case(GL_INT):               _convertRowToFloat(reinterpret_cast<const int*>(src), dest, num, scale); break;
+        case(GL_UNSIGNED_INT):      _convertRowToFloat(reinterpret_cast<const unsigned int*>(src), dest, num, scale); break;
+        case(GL_FLOAT):             memcpy(dest, src, num*sizeof(float)); break;
+        case(GL_DOUBLE):            _convertRowToFloat(reinterpret_cast<const double*>(src), dest, num, scale); break;
+    }
+}
+
+template<typename T>
+void _convertRowFromFloat(const float* src, T* dest, unsigned int num, float scale, float minValue, float maxValue)
+{
+    for(unsigned int i=0; i<num; ++i)
+    {
+        float v = src[i]*scale;
+        if (v<minValue) v = minValue;
+        else if (v>maxValue) v = maxValue;
+        dest[i] = static_cast<T>(v>=0.0f ? v+0.5f : v-0.5f);
+    }
+}
+
+void convertRowFromFloat(GLenum dataType, const float* src, unsigned char* dest, unsigned int num)
+{
+    float scale = dataTypeScale(dataType);
+    switch(dataType)
+    {
+        case(GL_BYTE):              _convertRowFromFloat(src, reinterpret_cast<char*>(dest), num, scale, -127.0f, 127.0f); break;
+        case(GL_UNSIGNED_BYTE):     _convertRowFromFloat(src, dest, num, scale, 0.0f, 255.0f); break;
+        case(GL_SHORT):             _convertRowFromFloat(src, reinterpret_cast<short*>(dest), num, scale, -32767.0f, 32767.0f); break;
+        case(GL_UNSIGNED_SHORT):    _convertRowFromFloat(src, reinterpret_cast<unsigned short*>(dest), num, scale, 0.0f, 65535.0f); break;
+        case(GL_INT):
+        {
+            int* ptr = reinterpret_cast<int*>(dest);
+            for(unsigned int i=0; i<num; ++i) ptr[i] = static_cast<int>(osg::clampBetween(double(src[i])*2147483647.0, -2147483647.0, 2147483647.0));
+            break;
+        }
+        case(GL_UNSIGNED_INT):
+        {
+            unsigned int* ptr = reinterpret_cast<unsigned int*>(dest);
+            for(unsigned int i=0; i<num; ++i) ptr[i] = static_cast<unsigned int>(osg::clampBetween(double(src[i])*4294967295.0+0.5, 0.0, 4294967295.0));
+            break;
+        }
+        case(GL_FLOAT):             memcpy(dest, src, num*sizeof(float)); break;
+        case(GL_DOUBLE):
+        {
+            double* ptr = reinterpret_cast<double*>(dest);
+            for(unsigned int i=0; i<num; ++i) ptr[i] = src[i];
+            break;
+        }
+    }
+}
+
+// horizontal pass, filter a row of numComponents pixels into a row of destination width.
+void filterRow(const float* src, float* dest, unsigned int numComponents, const ResampleWeights& rw)
+{
+    int destWidth = static_cast<int>(rw.first.size());
+    const float* weights = &rw.weights[0];
+
+#ifdef OSG_RESAMPLE_USE_SSE
+    if (numComponents==4)
+    {
+        for(int i=0; i<destWidth; ++i, weights += rw.numTaps)
+        {
+            const float* s = src + rw.first[i]*4;
+            __m128 acc = _mm_setzero_ps();
+            for(int k=0; k<rw.numTaps; ++k, s+=4)
+            {
+                if (weights[k]!=0.0f) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(s)));
+            }
+            _mm_storeu_ps(dest + i*4, acc);
+        }
+        return;
+    }
+#endif
+
+    for(int i=0; i<destWidth; ++i, weights += rw.numTaps)
+    {
+        const float* s = src + rw.first[i]*numComponents;
+        float* d = dest + i*numComponents;
+        for(unsigned int c=0; c<numComponents; ++c) d[c] = 0.0f;
+        for(int k=0; k<rw.numTaps; ++k, s+=numComponents)
+        {
+            float w = weights[k];
+            if (w==0.0f) continue;
+            for(unsigned int c=0; c<numComponents; ++c) d[c] += w*s[c];
+        }
+    }
+}
+
+// vertical pass, accumulate weight*row into a destination row, the rows are contiguous so vectorize regardless of the pixel format.
+void accumulateRow(const float* src, float* dest, unsigned int num, float weight)
+{
+    unsigned int i=0;
+#ifdef OSG_RESAMPLE_USE_SSE
+    __m128 w = _mm_set1_ps(weight);
+    for(; i+4<=num; i+=4)
+    {
+        _mm_storeu_ps(dest+i, _mm_add_ps(_mm_loadu_ps(dest+i), _mm_mul_ps(w, _mm_loadu_ps(src+i))));
+    }
+#endif
+    for(; i<num; ++i) dest[i] += weight*src[i];
+}
+
+struct ResampleOperation
+{
+    GLenum                  pixelFormat;
+    unsigned int            numComponents;
+    int                     srcWidth, srcHeight;
+    GLenum                  srcDataType;
+    const unsigned char*    srcData;
+    unsigned int            srcRowStep;
+    int                     destWidth, destHeight;
+    GLenum                  destDataType;
+    unsigned char*          destData;
+    unsigned int            destRowStep;
+    ResampleWeights         horizontal;
+    ResampleWeights         vertical;
+
+    // source rows filtered horizontally to the destination width.
+    std::vector<float>      intermediate;
+
+    void filterRows(int begin, int end)
+    {
+        std::vector<float> row(srcWidth*numComponents);
+        unsigned int destRowSize = destWidth*numComponents;
+        for(int j=begin; j<end; ++j)
+        {
+            convertRowToFloat(srcDataType, srcData + j*srcRowStep, &row[0], srcWidth*numComponents);
+            filterRow(&row[0], &intermediate[j*destRowSize], numComponents, horizontal);
+        }
+    }
+
+    void filterColumns(int begin, int end)
+    {
+        unsigned int destRowSize = destWidth*numComponents;
+        std::vector<float> row(destRowSize);
+        for(int j=begin; j<end; ++j)
+        {
+            std::fill(row.begin(), row.end(), 0.0f);
+            const float* weights = &vertical.weights[j*vertical.numTaps];
+            int first = vertical.first[j];
+            for(int k=0; k<vertical.numTaps; ++k)
+            {
+                if (weights[k]!=0.0f) accumulateRow(&intermediate[(first+k)*destRowSize], &row[0], destRowSize, weights[k]);
+            }
+            convertRowFromFloat(destDataType, &row[0], destData + j*destRowStep, destRowSize);
+        }
+    }
+};
+
+inline float sRGBToLinear(float c)
+{
+    if (c<=0.04045f) return c/12.92f;
+    return powf((c+0.055f)/1.055f, 2.4f);
+}
+
+inline float linearToSRGB(float c)
+{
+    if (c<=0.0f) return 0.0f;
+    if (c<=0.0031308f) return c*12.92f;
+    return 1.055f*powf(c, 1.0f/2.4f)-0.055f;
+}
+
+// return the index of the alpha component in a pixel, or -1 if there isn't one.
+inline int alphaComponent(GLenum pixelFormat)
+{
+    switch(pixelFormat)
+    {
+        case(GL_LUMINANCE_ALPHA):   return 1;
+        case(GL_RGBA):
+        case(GL_BGRA):              return 3;
+        default:                    return -1;
+    }
+}
+
+void convertGamma(GLenum pixelFormat, unsigned int numComponents, float* data, unsigned int numPixels, bool toLinear)
+{
+    // alpha and depth values are always linear.
+    if (pixelFormat==GL_ALPHA || pixelFormat==GL_DEPTH_COMPONENT) return;
+
+    int alpha = alphaComponent(pixelFormat);
+    for(unsigned int i=0; i<numPixels; ++i, data+=numComponents)
+    {
+        for(int c=0; c<static_cast<int>(numComponents); ++c)
+        {
+            if (c!=alpha) data[c] = toLinear ? sRGBToLinear(data[c]) : linearToSRGB(data[c]);
+        }
+    }
+}
+
+class ResampleThread : public OpenThreads::Thread
+{
+    public:
+
+        ResampleThread(ResampleOperation& operation, bool rows, int begin, int end):
+            _operation(operation),
+            _rows(rows),
+            _begin(begin),
+            _end(end) {}
+
+        virtual void run()
+        {
+            if (_rows) _operation.filterRows(_begin, _end);
+            else _operation.filterColumns(_begin, _end);
+        }
+
+    protected:
+
+        ResampleOperation&  _operation;
+        bool                _rows;
+        int                 _begin;
+        int                 _end;
+};
+
+void runResamplePass(ResampleOperation& operation, bool rows, int numRows, unsigned int numThreads)
+{
+    if (numThreads<=1 || numRows<static_cast<int>(numThreads)*16)
+    {
+        if (rows) operation.filterRows(0, numRows);
+        else operation.filterColumns(0, numRows);
+        return;
+    }
+
+    // the calling thread does the last range itself.
+    std::vector<ResampleThread*> threads;
+    int rowsPerThread = (numRows+numThreads-1)/numThreads;
+    int begin = 0;
+    for(unsigned int i=0; i<numThreads-1 && begin<numRows; ++i, begin+=rowsPerThread)
+    {
+        ResampleThread* thread = new ResampleThread(operation, rows, begin, osg::minimum(begin+rowsPerThread, numRows));
+        if (thread->start()==0) threads.push_back(thread);
+        else { thread->run(); delete thread; }
+    }
+
+    ResampleThread(operation, rows, begin, numRows).run();
+
+    for(std::vector<ResampleThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+}
+
+bool isResampleSupported(GLenum pixelFormat, GLenum dataType)
+{
+    switch(pixelFormat)
+    {
+        case(GL_INTENSITY):
+        case(GL_LUMINANCE):
+        case(GL_ALPHA):
+        case(GL_RED):
+        case(GL_RG):
+        case(GL_LUMINANCE_ALPHA):
+        case(GL_RGB):
+        case(GL_BGR):
+        case(GL_RGBA):
+        case(GL_BGRA):
+        case(GL_DEPTH_COMPONENT):
+            break;
+        default:
+            return false;
+    }
+
+    switch(dataType)
+    {
+        case(GL_BYTE):
+        case(GL_UNSIGNED_BYTE):
+        case(GL_SHORT):
+        case(GL_UNSIGNED_SHORT):
+        case(GL_INT):
+        case(GL_UNSIGNED_INT):
+        case(GL_FLOAT):
+        case(GL_DOUBLE):
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool resampleImageData(GLenum pixelFormat,
+                       int srcWidth, int srcHeight, GLenum srcDataType, const unsigned char* srcData, unsigned int srcRowStepInBytes,
+                       int destWidth, int destHeight, GLenum destDataType, unsigned char* destData, unsigned int destRowStepInBytes,
+                       ResampleFilter filter, unsigned int numThreads)
+{
+    if (!isResampleSupported(pixelFormat, srcDataType) || !isResampleSupported(pixelFormat, destDataType)) return false;
+    if (srcWidth<=0 || srcHeight<=0 || destWidth<=0 || destHeight<=0 || !srcData || !destData) return false;
+
+    ResampleOperation operation;
+    operation.pixelFormat = pixelFormat;
+    operation.numComponents = osg::Image::computeNumComponents(pixelFormat);
+    operation.srcWidth = srcWidth;
+    operation.srcHeight = srcHeight;
+    operation.srcDataType = srcDataType;
+    operation.srcData = srcData;
+    operation.srcRowStep = srcRowStepInBytes;
+    operation.destWidth = destWidth;
+    operation.destHeight = destHeight;
+    operation.destDataType = destDataType;
+    operation.destData = destData;
+    operation.destRowStep = destRowStepInBytes;
+
+    computeResampleWeights(filter, srcWidth, destWidth, operation.horizontal);
+    computeResampleWeights(filter, srcHeight, destHeight, operation.vertical);
+
+    operation.intermediate.resize(srcHeight*destWidth*operation.numComponents);
+
+    if (numThreads==0) numThreads = static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    // threads are only worth starting for large images.
+    if (static_cast<double>(destWidth)*static_cast<double>(osg::maximum(srcHeight, destHeight)) < 256.0*256.0) numThreads = 1;
+
+    runResamplePass(operation, true, srcHeight, numThreads);
+    runResamplePass(operation, false, destHeight, numThreads);
+
+    return true;
+}
+
+osg::Image* resampleImage(const osg::Image* image, int s, int t, ResampleFilter filter, unsigned int numThreads)
+{
+    if (!image || !image->data() || image->r()!=1 || s<=0 || t<=0) return 0;
+    if (!isResampleSupported(image->getPixelFormat(), image->getDataType())) return 0;
+
+    osg::ref_ptr<osg::Image> newImage = new osg::Image;
+    newImage->allocateImage(s, t, 1, image->getPixelFormat(), image->getDataType(), image->getPacking());
+    newImage->setInternalTextureFormat(image->getInternalTextureFormat());
+    newImage->setFileName(image->getFileName());
+
+    if (!resampleImageData(image->getPixelFormat(),
+                           image->s(), image->t(), image->getDataType(), image->data(), image->getRowStepInBytes(),
+                           s, t, newImage->getDataType(), newImage->data(), newImage->getRowStepInBytes(),
+                           filter, numThreads))
+    {
+        return 0;
+    }
+
+    return newImage.release();
+}
+
+bool generateMipmaps(osg::Image* image, ResampleFilter filter, bool gammaCorrect, unsigned int numThreads)
+{
+    if (!image || !image->data() || image->r()!=1) return false;
+    if (image->isMipmap()) return true;
+
+    GLenum pixelFormat = image->getPixelFormat();
+    GLenum dataType = image->getDataType();
+    if (!isResampleSupported(pixelFormat, dataType)) return false;
+
+    unsigned int numComponents = osg::Image::computeNumComponents(pixelFormat);
+    int width = image->s();
+    int height = image->t();
+    int packing = image->getPacking();
+    int numLevels = osg::Image::computeNumberOfMipmapLevels(width, height);
+
+    // floating point images are assumed to already be linear.
+    bool linearize = gammaCorrect && dataType!=GL_FLOAT && dataType!=GL_DOUBLE;
+
+    osg::Image::MipmapDataType mipmapOffsets;
+    unsigned int totalSize = 0;
+    for(int level=0; level<numLevels; ++level)
+    {
+        int w = osg::maximum(width>>level, 1);
+        int h = osg::maximum(height>>level, 1);
+        if (level>0) mipmapOffsets.push_back(totalSize);
+        totalSize += osg::Image::computeRowWidthInBytes(w, pixelFormat, dataType, packing)*h;
+    }
+
+    unsigned char* newData = new unsigned char[totalSize];
 
+    // the top level is copied unchanged, and converted to floating point to filter the remaining levels from.
+    unsigned int rowSize = image->getRowSizeInBytes();
+    unsigned int rowStep = osg::Image::computeRowWidthInBytes(width, pixelFormat, dataType, packing);
+    std::vector<float> current(width*height*numComponents);
+    for(int j=0; j<height; ++j)
+    {
+        memcpy(newData + j*rowStep, image->data(0,j), rowSize);
+        convertRowToFloat(dataType, image->data(0,j), &current[j*width*numComponents], width*numComponents);
+    }
+    if (linearize) convertGamma(pixelFormat, numComponents, &current[0], width*height, true);
 
+    std::vector<float> next;
+    std::vector<float> row;
+    int w = width;
+    int h = height;
+    for(int level=1; level<numLevels; ++level)
+    {
+        int nw = osg::maximum(w>>1, 1);
+        int nh = osg::maximum(h>>1, 1);
+        unsigned int rowSizeInFloats = nw*numComponents;
+        next.resize(nw*nh*numComponents);
+        row.resize(rowSizeInFloats);
+
+        resampleImageData(pixelFormat,
+                          w, h, GL_FLOAT, reinterpret_cast<const unsigned char*>(&current[0]), w*numComponents*sizeof(float),
+                          nw, nh, GL_FLOAT, reinterpret_cast<unsigned char*>(&next[0]), rowSizeInFloats*sizeof(float),
+                          filter, numThreads);
+
+        unsigned char* levelData = newData + mipmapOffsets[level-1];
+        unsigned int levelRowStep = osg::Image::computeRowWidthInBytes(nw, pixelFormat, dataType, packing);
+        for(int j=0; j<nh; ++j)
+        {
+            std::copy(next.begin()+j*rowSizeInFloats, next.begin()+(j+1)*rowSizeInFloats, row.begin());
+            if (linearize) convertGamma(pixelFormat, numComponents, &row[0], nw, false);
+            convertRowFromFloat(dataType, &row[0], levelData + j*levelRowStep, rowSizeInFloats);
+        }
+
+        current.swap(next);
+        w = nw;
+        h = nh;
+    }
+
+    image->setImage(width, height, 1, image->getInternalTextureFormat(), pixelFormat, dataType, newData, osg::Image::USE_NEW_DELETE, packing);
+    image->setMipmapLevels(mipmapOffsets);
+
+    return true;
 }
 
+}
@@ -113,6 +113,92 @@ double osg::asciiToDouble(const char* str)
     }
 }
 
+const char* osg::asciiToDouble(const char* str, const char* end, double& value)
+{
+    // powers of ten that are exactly representable as doubles.
+    static const double s_powersOfTen[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* ptr = str;
+    value = 0.0;
+
+    bool negative = false;
+    if (ptr<end && (*ptr=='-' || *ptr=='+'))
+    {
+        negative = (*ptr=='-');
+        ++ptr;
+    }
+
+    // accumulate up to 19 significant digits in an integer, only the exponent is adjusted for any further digits.
+    unsigned long long mantissa = 0;
+    int numDigits = 0;
+    int exponent = 0;
+    bool hadDigits = false;
+
+    for(; ptr<end && *ptr>='0' && *ptr<='9'; ++ptr)
+    {
+        hadDigits = true;
+        if (numDigits<19)
+        {
+            mantissa = mantissa*10 + (*ptr-'0');
+            if (mantissa!=0) ++numDigits;
+        }
+        else ++exponent;
+    }
+
+    if (ptr<end && *ptr=='.')
+    {
+        for(++ptr; ptr<end && *ptr>='0' && *ptr<='9'; ++ptr)
+        {
+            hadDigits = true;
+            if (numDigits<19)
+            {
+                mantissa = mantissa*10 + (*ptr-'0');
+                if (mantissa!=0) ++numDigits;
+                --exponent;
+            }
+        }
+    }
+
+    if (!hadDigits) return str;
+
+    if (ptr<end && (*ptr=='e' || *ptr=='E'))
+    {
+        const char* exponentPtr = ptr+1;
+        bool negativeExponent = false;
+        if (exponentPtr<end && (*exponentPtr=='-' || *exponentPtr=='+'))
+        {
+            negativeExponent = (*exponentPtr=='-');
+            ++exponentPtr;
+        }
+
+        // an 'e' that isn't followed by digits isn't part of the number.
+        if (exponentPtr<end && *exponentPtr>='0' && *exponentPtr<='9')
+        {
+            int exponentValue = 0;
+            for(; exponentPtr<end && *exponentPtr>='0' && *exponentPtr<='9'; ++exponentPtr)
+            {
+                if (exponentValue<100000) exponentValue = exponentValue*10 + (*exponentPtr-'0');
+            }
+            exponent += negativeExponent ? -exponentValue : exponentValue;
+            ptr = exponentPtr;
+        }
+    }
+
+    // a mantissa of at most 2^53 scaled by an exact power of ten is correctly rounded by a single multiply or divide.
+    double result = static_cast<double>(mantissa);
+    if (mantissa==0) result = 0.0;
+    else if (exponent>=0 && exponent<=22 && mantissa<=(1ull<<53)) result *= s_powersOfTen[exponent];
+    else if (exponent<0 && exponent>=-22 && mantissa<=(1ull<<53)) result /= s_powersOfTen[-exponent];
+    else result *= pow(10.0, static_cast<double>(exponent));
+
+    value = negative ? -result : result;
+    return ptr;
+}
+
 double osg::findAsciiToDouble(const char* str)
 {
    const char* ptr = str;
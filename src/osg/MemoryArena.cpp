@@ -0,0 +1,277 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/MemoryArena>
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Mutex>
+
+#include <stdlib.h>
+
+#if defined(_WIN32)
+    #include <malloc.h>
+#endif
+
+#if defined(_MSC_VER)
+    #define OSG_ARENA_THREAD_LOCAL __declspec(thread)
+#else
+    #define OSG_ARENA_THREAD_LOCAL __thread
+#endif
+
+using namespace osg;
+
+namespace
+{
+
+// arena current on each thread, plain pointer so it's safe to use during static initialization.
+static OSG_ARENA_THREAD_LOCAL MemoryArena* s_currentArena = 0;
+
+// space reserved at the start of each block for the pointer to the owning arena, keeps allocations 16 byte aligned.
+static const size_t BLOCK_HEADER_SIZE = 16;
+
+// open addressed table of the start addresses of all the blocks, written under the mutex but read without locking.
+static const unsigned int BLOCK_TABLE_SIZE = 1<<16;
+static const unsigned int BLOCK_TABLE_MAX_PROBES = 64;
+static void* const BLOCK_TABLE_REMOVED = reinterpret_cast<void*>(1);
+
+// number of blocks registered, read without locking so that deallocation is cheap when no arenas are in use.
+static volatile unsigned int s_numBlocks = 0;
+static size_t s_totalNumBytesReserved = 0;
+
+// both the table and mutex are intentionally never deleted, objects held in static containers of other
+// modules may be freed after this module's statics have been destructed.
+static OpenThreads::AtomicPtr* volatile s_blockTable = 0;
+
+OpenThreads::Mutex& getBlockTableMutex()
+{
+    static OpenThreads::Mutex* s_blockTableMutex = new OpenThreads::Mutex;
+    return *s_blockTableMutex;
+}
+
+inline size_t alignSize(size_t size) { return (size + 15) & ~static_cast<size_t>(15); }
+
+inline const char* blockStart(const void* ptr)
+{
+    return reinterpret_cast<const char*>(reinterpret_cast<size_t>(ptr) & ~(MemoryArena::BLOCK_SIZE-1));
+}
+
+inline unsigned int blockTableIndex(const char* block)
+{
+    size_t key = reinterpret_cast<size_t>(block) / MemoryArena::BLOCK_SIZE;
+    return static_cast<unsigned int>(key * 2654435761u) & (BLOCK_TABLE_SIZE-1);
+}
+
+// must be called with the mutex held
+bool insertBlock(char* block)
+{
+    if (!s_blockTable) s_blockTable = new OpenThreads::AtomicPtr[BLOCK_TABLE_SIZE];
+
+    unsigned int index = blockTableIndex(block);
+    for(unsigned int i=0; i<BLOCK_TABLE_MAX_PROBES; ++i, index = (index+1) & (BLOCK_TABLE_SIZE-1))
+    {
+        void* entry = s_blockTable[index].get();
+        if (entry==0 || entry==BLOCK_TABLE_REMOVED)
+        {
+            s_blockTable[index].assign(block, entry);
+            ++s_numBlocks;
+            return true;
+        }
+    }
+    return false;
+}
+
+// must be called with the mutex held
+void removeBlock(char* block)
+{
+    unsigned int index = blockTableIndex(block);
+    for(unsigned int i=0; i<BLOCK_TABLE_MAX_PROBES; ++i, index = (index+1) & (BLOCK_TABLE_SIZE-1))
+    {
+        if (s_blockTable[index].get()==block)
+        {
+            s_blockTable[index].assign(BLOCK_TABLE_REMOVED, block);
+            --s_numBlocks;
+            return;
+        }
+    }
+}
+
+char* allocateAlignedBlock()
+{
+#if defined(_WIN32)
+    return static_cast<char*>(_aligned_malloc(MemoryArena::BLOCK_SIZE, MemoryArena::BLOCK_SIZE));
+#else
+    void* ptr = 0;
+    if (posix_memalign(&ptr, MemoryArena::BLOCK_SIZE, MemoryArena::BLOCK_SIZE)!=0) return 0;
+    return static_cast<char*>(ptr);
+#endif
+}
+
+void freeAlignedBlock(char* block)
+{
+#if defined(_WIN32)
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+}
+
+MemoryArena::MemoryArena():
+    osg::Referenced(true),
+    _current(0),
+    _end(0),
+    _numLiveAllocations(0)
+{
+}
+
+MemoryArena::~MemoryArena()
+{
+    if (_numLiveAllocations!=0)
+    {
+        OSG_WARN<<"Warning: MemoryArena::~MemoryArena() "<<_numLiveAllocations<<" allocations still live."<<std::endl;
+    }
+
+    if (!_blocks.empty())
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getBlockTableMutex());
+        for(Blocks::iterator itr = _blocks.begin(); itr != _blocks.end(); ++itr)
+        {
+            removeBlock(*itr);
+        }
+        s_totalNumBytesReserved -= _blocks.size()*BLOCK_SIZE;
+    }
+
+    // blocks are only returned to the heap once they can no longer be found in the table.
+    for(Blocks::iterator itr = _blocks.begin(); itr != _blocks.end(); ++itr)
+    {
+        freeAlignedBlock(*itr);
+    }
+}
+
+char* MemoryArena::allocateBlock()
+{
+    char* block = allocateAlignedBlock();
+    if (!block) return 0;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getBlockTableMutex());
+        if (!insertBlock(block))
+        {
+            OSG_INFO<<"MemoryArena::allocateBlock() block table full, falling back to heap allocation."<<std::endl;
+            freeAlignedBlock(block);
+            return 0;
+        }
+        s_totalNumBytesReserved += BLOCK_SIZE;
+    }
+
+    *reinterpret_cast<MemoryArena**>(block) = this;
+    _blocks.push_back(block);
+
+    return block;
+}
+
+void* MemoryArena::allocate(size_t size)
+{
+    size = alignSize(size>0 ? size : 1);
+
+    // large allocations would waste much of a block so go straight to the heap, and aren't counted as live.
+    if (size > BLOCK_SIZE/4) return ::operator new(size);
+
+    if (!_current || _current+size > _end)
+    {
+        char* block = allocateBlock();
+        if (!block) return ::operator new(size);
+
+        _current = block + BLOCK_HEADER_SIZE;
+        _end = block + BLOCK_SIZE;
+    }
+
+    void* ptr = _current;
+    _current += size;
+
+    // each live allocation keeps the arena alive, so the arena holds one reference while any are outstanding.
+    if (++_numLiveAllocations==1) ref();
+
+    return ptr;
+}
+
+void MemoryArena::deallocate(void*)
+{
+    if (--_numLiveAllocations==0) unref();
+}
+
+size_t MemoryArena::getTotalNumBytesReserved()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getBlockTableMutex());
+    return s_totalNumBytesReserved;
+}
+
+MemoryArena* MemoryArena::findArena(const void* ptr)
+{
+    if (s_numBlocks==0 || !ptr) return 0;
+
+    OpenThreads::AtomicPtr* table = s_blockTable;
+    if (!table) return 0;
+
+    // a pointer can only belong to the block its address rounds down to, and a block is removed from the
+    // table before it's freed, so the header can be read safely for any live allocation.
+    const char* block = blockStart(ptr);
+    unsigned int index = blockTableIndex(block);
+    for(unsigned int i=0; i<BLOCK_TABLE_MAX_PROBES; ++i, index = (index+1) & (BLOCK_TABLE_SIZE-1))
+    {
+        void* entry = table[index].get();
+        if (entry==block) return *reinterpret_cast<MemoryArena* const*>(block);
+        if (entry==0) break;
+    }
+    return 0;
+}
+
+MemoryArena* MemoryArena::getCurrentArena()
+{
+    return s_currentArena;
+}
+
+void* MemoryArena::allocateReferenced(size_t size)
+{
+    MemoryArena* arena = s_currentArena;
+    if (arena) return arena->allocate(size);
+    return ::operator new(size);
+}
+
+void MemoryArena::deallocateReferenced(void* ptr)
+{
+    if (!ptr) return;
+
+    MemoryArena* arena = findArena(ptr);
+    if (arena)
+    {
+        arena->deallocate(ptr);
+        return;
+    }
+
+    ::operator delete(ptr);
+}
+
+MemoryArena::ScopedArena::ScopedArena(MemoryArena* arena):
+    _arena(arena),
+    _previousArena(s_currentArena)
+{
+    s_currentArena = arena;
+}
+
+MemoryArena::ScopedArena::~ScopedArena()
+{
+    s_currentArena = _previousArena;
+}
@@ -25,6 +25,7 @@
 #include <OpenThreads/Mutex>
 
 #include <osg/DeleteHandler>
+#include <osg/MemoryArena>
 
 namespace osg
 {
@@ -133,6 +134,43 @@ DeleteHandler* Referenced::getDeleteHandler()
     return s_deleteHandler.get();
 }
 
+void* Referenced::operator new(size_t size)
+{
+    return MemoryArena::allocateReferenced(size);
+}
+
+void* Referenced::operator new(size_t size, const std::nothrow_t&) throw()
+{
+    try
+    {
+        return MemoryArena::allocateReferenced(size);
+    }
+    catch(...)
+    {
+        return 0;
+    }
+}
+
+void* Referenced::operator new[](size_t size)
+{
+    return MemoryArena::allocateReferenced(size);
+}
+
+void Referenced::operator delete(void* ptr)
+{
+    MemoryArena::deallocateReferenced(ptr);
+}
+
+void Referenced::operator delete(void* ptr, const std::nothrow_t&) throw()
+{
+    MemoryArena::deallocateReferenced(ptr);
+}
+
+void Referenced::operator delete[](void* ptr)
+{
+    MemoryArena::deallocateReferenced(ptr);
+}
+
 #ifdef DEBUG_OBJECT_ALLOCATION_DESTRUCTION
 OpenThreads::Mutex& getNumObjectMutex()
 {
@@ -14,104 +14,236 @@
 #include <osg/Stats>
 #include <osg/Notify>
 
+#include <fstream>
+
 using namespace osg;
 
+namespace
+{
+
+struct AttributeNameRegistry
+{
+    typedef std::map<std::string, unsigned int> NameIDMap;
+    typedef std::vector<std::string> IDNameList;
+    typedef std::vector<NameIDMap*> NameIDMapList;
+
+    AttributeNameRegistry():
+        _currentNameIDMap(new NameIDMap)
+    {
+        _nameIDMaps.push_back(static_cast<NameIDMap*>(_currentNameIDMap.get()));
+    }
+
+    ~AttributeNameRegistry()
+    {
+        for(NameIDMapList::iterator itr = _nameIDMaps.begin(); itr != _nameIDMaps.end(); ++itr)
+        {
+            delete *itr;
+        }
+    }
+
+    // the current map is replaced, never modified, when a name is added so it can be read without locking.
+    // Superseded maps are kept till exit as readers may still be using them.
+    OpenThreads::AtomicPtr  _currentNameIDMap;
+
+    OpenThreads::Mutex      _mutex;
+    IDNameList              _idNameList;
+    NameIDMapList           _nameIDMaps;
+};
+
+AttributeNameRegistry& getAttributeNameRegistry()
+{
+    static AttributeNameRegistry s_registry;
+    return s_registry;
+}
+
+}
+
+unsigned int Stats::getAttributeID(const std::string& attributeName)
+{
+    AttributeNameRegistry& registry = getAttributeNameRegistry();
+
+    // fast path, the name is already registered.
+    const AttributeNameRegistry::NameIDMap* nameIDMap = static_cast<const AttributeNameRegistry::NameIDMap*>(registry._currentNameIDMap.get());
+    AttributeNameRegistry::NameIDMap::const_iterator itr = nameIDMap->find(attributeName);
+    if (itr != nameIDMap->end()) return itr->second;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(registry._mutex);
+
+    // another thread may have registered the name since we looked.
+    nameIDMap = static_cast<const AttributeNameRegistry::NameIDMap*>(registry._currentNameIDMap.get());
+    itr = nameIDMap->find(attributeName);
+    if (itr != nameIDMap->end()) return itr->second;
+
+    unsigned int attributeID = static_cast<unsigned int>(registry._idNameList.size());
+    if (attributeID==getMaxNumAttributeIDs())
+    {
+        OSG_NOTICE<<"Warning: Stats::getAttributeID("<<attributeName<<") maximum number of attribute IDs exceeded, attribute will not be recorded."<<std::endl;
+    }
+
+    AttributeNameRegistry::NameIDMap* newNameIDMap = new AttributeNameRegistry::NameIDMap(*nameIDMap);
+    (*newNameIDMap)[attributeName] = attributeID;
+    registry._idNameList.push_back(attributeName);
+    registry._nameIDMaps.push_back(newNameIDMap);
+    registry._currentNameIDMap.assign(newNameIDMap, nameIDMap);
+
+    return attributeID;
+}
+
+std::string Stats::getAttributeName(unsigned int attributeID)
+{
+    AttributeNameRegistry& registry = getAttributeNameRegistry();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(registry._mutex);
+    return attributeID<registry._idNameList.size() ? registry._idNameList[attributeID] : std::string();
+}
+
+unsigned int Stats::getNumAttributeIDs()
+{
+    // every registered name has an entry in the current map, so its size can be read without locking.
+    const AttributeNameRegistry::NameIDMap* nameIDMap = static_cast<const AttributeNameRegistry::NameIDMap*>(getAttributeNameRegistry()._currentNameIDMap.get());
+    return static_cast<unsigned int>(nameIDMap->size());
+}
+
 Stats::Stats(const std::string& name):
-    _name(name)
+    _name(name),
+    _numberOfFrames(0)
 {
     allocate(25);
 }
 
 
 Stats::Stats(const std::string& name, unsigned int numberOfFrames):
-    _name(name)
+    _name(name),
+    _numberOfFrames(0)
 {
     allocate(numberOfFrames);
 }
 
+Stats::~Stats()
+{
+    releaseAttributeBlocks();
+}
+
+void Stats::releaseAttributeBlocks()
+{
+    for(unsigned int i=0; i<MAX_NUM_ATTRIBUTE_BLOCKS; ++i)
+    {
+        AttributeRecord* block = reinterpret_cast<AttributeRecord*>(_attributeBlocks[i].get());
+        if (block && _attributeBlocks[i].assign(0, block))
+        {
+            delete [] block;
+        }
+    }
+}
+
 void Stats::allocate(unsigned int numberOfFrames)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
 
-    _baseFrameNumber = 0;
-    _latestFrameNumber  = 0;
-    _attributeMapList.clear();
-    _attributeMapList.resize(numberOfFrames);
-}
+    releaseAttributeBlocks();
 
+    _numberOfFrames = numberOfFrames>0 ? numberOfFrames : 1;
+    _latestFrameNumber.exchange(0);
+    _attributeMapSnapshot.clear();
+}
 
-bool Stats::setAttribute(unsigned int frameNumber, const std::string& attributeName, double value)
+Stats::AttributeRecord* Stats::getAttributeRecord(unsigned int frameNumber, unsigned int attributeID) const
 {
-    if (frameNumber<getEarliestFrameNumber()) return false;
+    unsigned int blockIndex = attributeID / ATTRIBUTE_BLOCK_SIZE;
+    if (blockIndex>=MAX_NUM_ATTRIBUTE_BLOCKS) return 0;
 
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    AttributeRecord* block = reinterpret_cast<AttributeRecord*>(_attributeBlocks[blockIndex].get());
+    if (!block) return 0;
 
-    if (frameNumber>_latestFrameNumber)
-    {
-        // need to advance
+    return block + (attributeID % ATTRIBUTE_BLOCK_SIZE)*_numberOfFrames + (frameNumber % _numberOfFrames);
+}
 
-        // first clear the entries up to and including the new frameNumber
-        for(unsigned int i = _latestFrameNumber+1; i<= frameNumber; ++i)
-        {
-            unsigned int index = (i - _baseFrameNumber) % _attributeMapList.size();
-            _attributeMapList[index].clear();
-        }
+Stats::AttributeRecord* Stats::getOrCreateAttributeRecord(unsigned int frameNumber, unsigned int attributeID)
+{
+    unsigned int blockIndex = attributeID / ATTRIBUTE_BLOCK_SIZE;
+    if (blockIndex>=MAX_NUM_ATTRIBUTE_BLOCKS) return 0;
 
-        if ( (frameNumber-_baseFrameNumber) >= static_cast<unsigned int>(_attributeMapList.size()))
+    AttributeRecord* block = reinterpret_cast<AttributeRecord*>(_attributeBlocks[blockIndex].get());
+    if (!block)
+    {
+        // first use of an attribute in this block, allocate it and install it, if another thread beats us to it use theirs.
+        AttributeRecord* newBlock = new AttributeRecord[ATTRIBUTE_BLOCK_SIZE*_numberOfFrames];
+        if (!_attributeBlocks[blockIndex].assign(newBlock, 0))
         {
-            _baseFrameNumber = (frameNumber/_attributeMapList.size())*_attributeMapList.size();
+            delete [] newBlock;
         }
+        block = reinterpret_cast<AttributeRecord*>(_attributeBlocks[blockIndex].get());
+    }
 
-        _latestFrameNumber = frameNumber;
+    return block + (attributeID % ATTRIBUTE_BLOCK_SIZE)*_numberOfFrames + (frameNumber % _numberOfFrames);
+}
 
-    }
+bool Stats::setAttribute(unsigned int frameNumber, unsigned int attributeID, double value)
+{
+    if (frameNumber<getEarliestFrameNumber()) return false;
+
+    AttributeRecord* record = getOrCreateAttributeRecord(frameNumber, attributeID);
+    if (!record) return false;
 
-    int index = getIndex(frameNumber);
-    if (index<0)
+    // advance the latest frame number, if another thread advances it concurrently
+    // reinstate the largest of the two.
+    unsigned int latestFrameNumber = frameNumber;
+    while(latestFrameNumber > getLatestFrameNumber())
     {
-        OSG_NOTICE<<"Failed to assing valid index for Stats::setAttribute("<<frameNumber<<","<<attributeName<<","<<value<<")"<<std::endl;
-        return false;
+        unsigned int previousFrameNumber = _latestFrameNumber.exchange(latestFrameNumber);
+        if (previousFrameNumber <= latestFrameNumber) break;
+        latestFrameNumber = previousFrameNumber;
     }
 
-    AttributeMap& attributeMap = _attributeMapList[index];
-    attributeMap[attributeName] = value;
+    // mark the record as being written so readers don't pick up a partially written value.
+    record->_frameTag.exchange(0);
+    record->_value = value;
+
+    // publish with XOR rather than exchange, as exchange is only an acquire barrier, while XOR is a full barrier
+    // so the value is visible before the tag. The tag is 0 at this point so XOR sets it.
+    record->_frameTag.XOR(frameNumber+1);
 
     return true;
 }
 
-bool Stats::getAttributeNoMutex(unsigned int frameNumber, const std::string& attributeName, double& value) const
+bool Stats::getAttribute(unsigned int frameNumber, unsigned int attributeID, double& value) const
 {
-    int index = getIndex(frameNumber);
-    if (index<0) return false;
+    if (!isValidFrameNumber(frameNumber)) return false;
+
+    const AttributeRecord* record = getAttributeRecord(frameNumber, attributeID);
+    if (!record) return false;
 
-    const AttributeMap& attributeMap = _attributeMapList[index];
-    AttributeMap::const_iterator itr = attributeMap.find(attributeName);
-    if (itr == attributeMap.end()) return false;
+    // OR(0) reads the tag with a full barrier, so the value can't be read ahead of the tag.
+    unsigned int frameTag = record->_frameTag.OR(0);
+    if (frameTag!=frameNumber+1) return false;
 
-    value = itr->second;
+    double v = record->_value;
+
+    // check that the record hasn't been overwritten while it was being read
+    if (record->_frameTag!=frameTag) return false;
+
+    value = v;
     return true;
 }
 
-bool Stats::getAveragedAttribute(const std::string& attributeName, double& value, bool averageInInverseSpace) const
+bool Stats::getAveragedAttribute(unsigned int attributeID, double& value, bool averageInInverseSpace) const
 {
-    return getAveragedAttribute(getEarliestFrameNumber(), getLatestFrameNumber(), attributeName, value, averageInInverseSpace);
+    return getAveragedAttribute(getEarliestFrameNumber(), getLatestFrameNumber(), attributeID, value, averageInInverseSpace);
 }
 
-bool Stats::getAveragedAttribute(unsigned int startFrameNumber, unsigned int endFrameNumber, const std::string& attributeName, double& value, bool averageInInverseSpace) const
+bool Stats::getAveragedAttribute(unsigned int startFrameNumber, unsigned int endFrameNumber, unsigned int attributeID, double& value, bool averageInInverseSpace) const
 {
     if (endFrameNumber<startFrameNumber)
     {
         std::swap(endFrameNumber, startFrameNumber);
     }
 
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
-
     double total = 0.0;
     double numValidSamples = 0.0;
     for(unsigned int i = startFrameNumber; i<=endFrameNumber; ++i)
     {
         double v = 0.0;
-        if (getAttributeNoMutex(i,attributeName,v))
+        if (getAttribute(i,attributeID,v))
         {
             if (averageInInverseSpace) total += 1.0/v;
             else total += v;
@@ -127,20 +259,26 @@ bool Stats::getAveragedAttribute(unsigned int startFrameNumber, unsigned int end
     else return false;
 }
 
-Stats::AttributeMap& Stats::getAttributeMapNoMutex(unsigned int frameNumber)
+void Stats::getAttributeMap(unsigned int frameNumber, AttributeMap& attributeMap) const
 {
-    int index = getIndex(frameNumber);
-    if (index<0) return _invalidAttributeMap;
+    attributeMap.clear();
+    if (!isValidFrameNumber(frameNumber)) return;
 
-    return _attributeMapList[index];
+    unsigned int numAttributeIDs = getNumAttributeIDs();
+    for(unsigned int attributeID=0; attributeID<numAttributeIDs; ++attributeID)
+    {
+        double value;
+        if (getAttribute(frameNumber, attributeID, value))
+        {
+            attributeMap[getAttributeName(attributeID)] = value;
+        }
+    }
 }
 
-const Stats::AttributeMap& Stats::getAttributeMapNoMutex(unsigned int frameNumber) const
+Stats::AttributeMap& Stats::getAttributeMapNoMutex(unsigned int frameNumber) const
 {
-    int index = getIndex(frameNumber);
-    if (index<0) return _invalidAttributeMap;
-
-    return _attributeMapList[index];
+    getAttributeMap(frameNumber, _attributeMapSnapshot);
+    return _attributeMapSnapshot;
 }
 
 void Stats::report(std::ostream& out, const char* indent) const
@@ -179,3 +317,113 @@ void Stats::report(std::ostream& out, unsigned int frameNumber, const char* inde
         out<<"    "<<itr->first<<"\t"<<itr->second<<std::endl;
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// StatsTraceWriter
+//
+namespace
+{
+
+const std::string s_beginTimeSuffix(" begin time");
+const std::string s_endTimeSuffix(" end time");
+const std::string s_referenceTime("Reference time");
+
+bool hasSuffix(const std::string& str, const std::string& suffix, std::string& prefix)
+{
+    // some attribute names carry a trailing space, so ignore it when matching
+    std::string::size_type length = str.size();
+    if (length>0 && str[length-1]==' ') --length;
+
+    if (length<=suffix.size() || str.compare(length-suffix.size(), suffix.size(), suffix)!=0) return false;
+
+    prefix = str.substr(0, length-suffix.size());
+    return true;
+}
+
+void writeJSONString(std::ostream& out, const std::string& str)
+{
+    out<<'"';
+    for(std::string::const_iterator itr = str.begin(); itr != str.end(); ++itr)
+    {
+        if (*itr=='"' || *itr=='\\') out<<'\\';
+        if (static_cast<unsigned char>(*itr)>=0x20) out<<*itr;
+    }
+    out<<'"';
+}
+
+}
+
+void StatsTraceWriter::write(std::ostream& out) const
+{
+    std::streamsize previousPrecision = out.precision(15);
+
+    out<<"{\"traceEvents\":["<<std::endl;
+
+    unsigned int referenceTimeID = Stats::getAttributeID(s_referenceTime);
+
+    bool first = true;
+    for(unsigned int tid=0; tid<_statsList.size(); ++tid)
+    {
+        const Stats* stats = _statsList[tid].get();
+
+        if (!first) out<<","<<std::endl;
+        first = false;
+
+        out<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"<<tid<<",\"args\":{\"name\":";
+        writeJSONString(out, stats->getName());
+        out<<"}}";
+
+        Stats::AttributeMap attributes;
+        for(unsigned int frameNumber = stats->getEarliestFrameNumber(); frameNumber<= stats->getLatestFrameNumber(); ++frameNumber)
+        {
+            stats->getAttributeMap(frameNumber, attributes);
+
+            // counters are placed at the start of the frame they belong to, as recorded by the first Stats object, typically the viewer's.
+            double referenceTime = 0.0;
+            _statsList.front()->getAttribute(frameNumber, referenceTimeID, referenceTime);
+
+            for(Stats::AttributeMap::const_iterator itr = attributes.begin();
+                itr != attributes.end();
+                ++itr)
+            {
+                std::string prefix;
+                if (hasSuffix(itr->first, s_beginTimeSuffix, prefix))
+                {
+                    // find the matching end time, allowing for the trailing space used by some attribute names
+                    Stats::AttributeMap::const_iterator end_itr = attributes.find(prefix+s_endTimeSuffix);
+                    if (end_itr==attributes.end()) end_itr = attributes.find(prefix+s_endTimeSuffix+" ");
+                    if (end_itr==attributes.end()) continue;
+
+                    out<<","<<std::endl<<"{\"name\":";
+                    writeJSONString(out, prefix);
+                    out<<",\"ph\":\"X\",\"pid\":0,\"tid\":"<<tid
+                       <<",\"ts\":"<<itr->second*1.0e6
+                       <<",\"dur\":"<<(end_itr->second-itr->second)*1.0e6
+                       <<",\"args\":{\"frame\":"<<frameNumber<<"}}";
+                }
+                else if (!hasSuffix(itr->first, s_endTimeSuffix, prefix) && itr->first!=s_referenceTime)
+                {
+                    out<<","<<std::endl<<"{\"name\":";
+                    writeJSONString(out, stats->getName()+" "+itr->first);
+                    out<<",\"ph\":\"C\",\"pid\":0,\"tid\":"<<tid
+                       <<",\"ts\":"<<referenceTime*1.0e6
+                       <<",\"args\":{\"value\":"<<itr->second<<"}}";
+                }
+            }
+        }
+    }
+
+    out<<std::endl<<"]}"<<std::endl;
+
+    out.precision(previousPrecision);
+}
+
+bool StatsTraceWriter::write(const std::string& filename) const
+{
+    std::ofstream fout(filename.c_str());
+    if (!fout) return false;
+
+    write(fout);
+    return !fout.fail();
+}
@@ -0,0 +1,262 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/TraceRecorder>
+#include <osg/Notify>
+#include <osg/ref_ptr>
+#include <osg/Object>
+#include <osg/ApplicationUsage>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+
+#include <stdlib.h>
+#include <sstream>
+
+using namespace osg;
+
+static ApplicationUsageProxy TraceRecorder_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_TRACE_FILE <filename>","Record timed zones of the frame traversals, database paging and compilation to the specified Chrome trace event JSON file.");
+
+#if defined(_MSC_VER)
+    #define OSG_TRACE_THREAD_LOCAL __declspec(thread)
+#else
+    #define OSG_TRACE_THREAD_LOCAL __thread
+#endif
+
+volatile bool TraceRecorder::s_enabled = false;
+
+namespace
+{
+    // the calling thread's zone buffer, along with the TraceRecorder that owns it.
+    static OSG_TRACE_THREAD_LOCAL void* s_threadBuffer = 0;
+    static OSG_TRACE_THREAD_LOCAL const TraceRecorder* s_threadBufferOwner = 0;
+}
+
+/** Thread that periodically collects the zones recorded by each thread and writes them out,
+  * keeping the file I/O off the threads being traced.*/
+class TraceRecorder::WriterThread : public OpenThreads::Thread
+{
+    public:
+
+        WriterThread(TraceRecorder* traceRecorder):
+            _traceRecorder(traceRecorder),
+            _done(false)
+        {
+            setSchedulePriority(THREAD_PRIORITY_LOW);
+        }
+
+        virtual void run()
+        {
+            Timer_t lastFlushTick = Timer::instance()->tick();
+            while(!_done)
+            {
+                // sleep in short steps so that cancel() doesn't have to wait for a whole flush interval.
+                OpenThreads::Thread::microSleep(10000);
+
+                Timer_t tick = Timer::instance()->tick();
+                if (!_done && Timer::instance()->delta_m(lastFlushTick, tick)>=_traceRecorder->getFlushInterval())
+                {
+                    _traceRecorder->flush();
+                    lastFlushTick = tick;
+                }
+            }
+        }
+
+        virtual int cancel()
+        {
+            _done = true;
+            while(isRunning()) OpenThreads::Thread::YieldCurrentThread();
+            return 0;
+        }
+
+    protected:
+
+        TraceRecorder*  _traceRecorder;
+        volatile bool   _done;
+};
+
+TraceRecorder* TraceRecorder::instance()
+{
+    static osg::ref_ptr<TraceRecorder> s_traceRecorder = new TraceRecorder;
+    return s_traceRecorder.get();
+}
+
+// initialize the trace recorder at load time, so that the OSG_TRACE_FILE env var is picked up before any traversals.
+OSG_INIT_SINGLETON_PROXY(TraceRecorderSingletonProxy, TraceRecorder::instance())
+
+TraceRecorder::TraceRecorder():
+    _firstEvent(true),
+    _flushInterval(100.0),
+    _writerThread(0)
+{
+    const char* ptr = 0;
+    if ((ptr = getenv("OSG_TRACE_FILE")) != 0 && *ptr!=0)
+    {
+        open(ptr);
+    }
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    close();
+
+    for(ThreadBuffers::iterator itr = _threadBuffers.begin(); itr != _threadBuffers.end(); ++itr)
+    {
+        delete *itr;
+    }
+}
+
+bool TraceRecorder::open(const std::string& filename)
+{
+    close();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    _fout.open(filename.c_str());
+    if (!_fout)
+    {
+        OSG_NOTICE<<"Warning: TraceRecorder unable to open trace file "<<filename<<std::endl;
+        return false;
+    }
+
+    _fout.precision(15);
+    _fout<<"{\"traceEvents\":["<<std::endl;
+    _firstEvent = true;
+
+    // thread names need writing to each new file.
+    for(ThreadBuffers::iterator itr = _threadBuffers.begin(); itr != _threadBuffers.end(); ++itr)
+    {
+        (*itr)->namePending = true;
+    }
+
+    _writerThread = new WriterThread(this);
+    _writerThread->startThread();
+
+    s_enabled = true;
+    return true;
+}
+
+void TraceRecorder::close()
+{
+    s_enabled = false;
+
+    if (_writerThread)
+    {
+        _writerThread->cancel();
+        delete _writerThread;
+        _writerThread = 0;
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    if (_fout.is_open())
+    {
+        flushNoMutex();
+
+        _fout<<std::endl<<"]}"<<std::endl;
+        _fout.close();
+    }
+}
+
+void TraceRecorder::flush()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    flushNoMutex();
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::getOrCreateThreadBuffer()
+{
+    if (s_threadBufferOwner==this) return static_cast<ThreadBuffer*>(s_threadBuffer);
+
+    ThreadBuffer* threadBuffer = new ThreadBuffer;
+
+    // give each thread its own track, OpenThreads ids aren't unique across OpenThreads and non OpenThreads threads.
+    OpenThreads::Thread* thread = OpenThreads::Thread::CurrentThread();
+    std::ostringstream name;
+    if (thread) name<<"OpenThreads::Thread "<<thread->getThreadId();
+    else name<<"Application thread";
+    threadBuffer->threadName = name.str();
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _threadBuffers.push_back(threadBuffer);
+        threadBuffer->threadId = static_cast<unsigned int>(_threadBuffers.size());
+    }
+
+    s_threadBuffer = threadBuffer;
+    s_threadBufferOwner = this;
+
+    return threadBuffer;
+}
+
+void TraceRecorder::recordZone(const char* name, const char* category, Timer_t startTick, Timer_t endTick)
+{
+    // zones completing after the trace has been closed are discarded.
+    if (!s_enabled) return;
+
+    Zone zone;
+    zone.name = name;
+    zone.category = category;
+    zone.startTick = startTick;
+    zone.endTick = endTick;
+
+    ThreadBuffer* threadBuffer = getOrCreateThreadBuffer();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(threadBuffer->mutex);
+    threadBuffer->zones.push_back(zone);
+}
+
+void TraceRecorder::flushNoMutex()
+{
+    if (!_fout.is_open()) return;
+
+    const Timer* timer = Timer::instance();
+    Timer_t startTick = timer->getStartTick();
+    for(ThreadBuffers::iterator bitr = _threadBuffers.begin();
+        bitr != _threadBuffers.end();
+        ++bitr)
+    {
+        ThreadBuffer* threadBuffer = *bitr;
+
+        // take the recorded zones, leaving the thread an empty buffer with the previously allocated capacity.
+        _flushZones.clear();
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(threadBuffer->mutex);
+            _flushZones.swap(threadBuffer->zones);
+        }
+
+        if (threadBuffer->namePending)
+        {
+            if (!_firstEvent) _fout<<","<<std::endl;
+            _firstEvent = false;
+
+            _fout<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"<<threadBuffer->threadId
+                 <<",\"args\":{\"name\":\""<<threadBuffer->threadName<<"\"}}";
+            threadBuffer->namePending = false;
+        }
+
+        for(Zones::const_iterator itr = _flushZones.begin();
+            itr != _flushZones.end();
+            ++itr)
+        {
+            if (!_firstEvent) _fout<<","<<std::endl;
+            _firstEvent = false;
+
+            _fout<<"{\"name\":\""<<itr->name<<"\",\"cat\":\""<<itr->category<<"\",\"ph\":\"X\",\"pid\":0,\"tid\":"<<threadBuffer->threadId
+                 <<",\"ts\":"<<(itr->startTick>=startTick ? timer->delta_u(startTick, itr->startTick) : -timer->delta_u(itr->startTick, startTick))
+                 <<",\"dur\":"<<timer->delta_u(itr->startTick, itr->endTick)<<"}";
+        }
+    }
+
+    _fout.flush();
+    _flushZones.clear();
+}
@@ -16,7 +16,12 @@
 #include <osgDB/Registry>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <osg/ApplicationUsage>
+#include <OpenThreads/Thread>
 #include <sstream>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
 
 using namespace osgDB;
 
@@ -48,12 +53,345 @@ public:
 
 REGISTER_COMPRESSOR( "null", NullCompressor )
 
+static osg::ApplicationUsageProxy Compressors_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_COMPRESSION_THREADS <num>","Set the number of threads the block compressors (bgzf, lz4 and zstd) use, defaults to the number of processors.");
+
+namespace
+{
+
+inline unsigned int readUInt16( const unsigned char* ptr ) { return ptr[0] | (ptr[1]<<8); }
+inline unsigned int readUInt32( const unsigned char* ptr ) { return ptr[0] | (ptr[1]<<8) | (ptr[2]<<16) | (static_cast<unsigned int>(ptr[3])<<24); }
+inline void writeUInt16( unsigned char* ptr, unsigned int value ) { ptr[0] = value&0xff; ptr[1] = (value>>8)&0xff; }
+inline void writeUInt32( unsigned char* ptr, unsigned int value ) { writeUInt16(ptr, value&0xffff); writeUInt16(ptr+2, value>>16); }
+
+// read the rest of the stream in large chunks rather than a character at a time.
+void readRemaining( std::istream& fin, std::string& data )
+{
+    char buffer[65536];
+    while ( fin.read(buffer, sizeof(buffer)) || fin.gcount()>0 )
+    {
+        data.append( buffer, fin.gcount() );
+    }
+}
+
+unsigned int getNumCompressionThreads( size_t numBlocks )
+{
+    int numThreads = OpenThreads::GetNumberOfProcessors();
+    const char* str = getenv("OSG_NUM_COMPRESSION_THREADS");
+    if ( str ) numThreads = atoi(str);
+
+    if ( numThreads<1 ) numThreads = 1;
+    if ( static_cast<size_t>(numThreads)>numBlocks ) numThreads = static_cast<int>(numBlocks);
+    return numThreads>0 ? static_cast<unsigned int>(numThreads) : 1u;
+}
+
+// work on a contiguous range of blocks, each block is independent so ranges can run on separate threads.
+struct BlockOperation
+{
+    virtual ~BlockOperation() {}
+    virtual bool processBlock( size_t i ) = 0;
+};
+
+class BlockThread : public OpenThreads::Thread
+{
+public:
+    BlockThread( BlockOperation& operation, size_t begin, size_t end ):
+        _operation(operation), _begin(begin), _end(end), _success(true) {}
+
+    virtual void run()
+    {
+        for ( size_t i=_begin; i<_end; ++i )
+        {
+            if ( !_operation.processBlock(i) ) _success = false;
+        }
+    }
+
+    bool success() const { return _success; }
+
+protected:
+    BlockOperation& _operation;
+    size_t          _begin;
+    size_t          _end;
+    bool            _success;
+};
+
+bool runBlockOperation( BlockOperation& operation, size_t numBlocks )
+{
+    unsigned int numThreads = getNumCompressionThreads( numBlocks );
+    size_t blocksPerThread = (numBlocks+numThreads-1)/numThreads;
+    bool success = true;
+
+    // the calling thread does the last range itself.
+    std::vector<BlockThread*> threads;
+    size_t begin = 0;
+    for ( unsigned int i=0; i<numThreads-1 && begin<numBlocks; ++i, begin+=blocksPerThread )
+    {
+        BlockThread* thread = new BlockThread( operation, begin, osg::minimum(begin+blocksPerThread, numBlocks) );
+        if ( thread->start()==0 ) threads.push_back( thread );
+        else
+        {
+            thread->run();
+            if ( !thread->success() ) success = false;
+            delete thread;
+        }
+    }
+
+    BlockThread lastRange( operation, begin, numBlocks );
+    lastRange.run();
+    if ( !lastRange.success() ) success = false;
+
+    for ( std::vector<BlockThread*>::iterator itr=threads.begin(); itr!=threads.end(); ++itr )
+    {
+        (*itr)->join();
+        if ( !(*itr)->success() ) success = false;
+        delete *itr;
+    }
+    return success;
+}
+
+}
+
 #ifdef USE_ZLIB
 
 #include <zlib.h>
 
 #define CHUNK 32768
 
+namespace
+{
+
+// gzip member layout with the BGZF extra field recording the size of the member.
+const unsigned int GZIP_BLOCK_HEADER_SIZE = 18;
+const unsigned int GZIP_BLOCK_FOOTER_SIZE = 8;
+const unsigned int GZIP_MAX_BLOCK_SIZE = 65536;
+const unsigned int GZIP_MAX_BLOCK_INPUT_SIZE = 0xff00;
+
+// empty member marking the end of a block compressed stream.
+const unsigned char GZIP_BLOCK_EOF[28] =
+{
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43, 0x02, 0x00,
+    0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+bool isGZipBlock( const unsigned char* data, size_t size )
+{
+    return size>=GZIP_BLOCK_HEADER_SIZE+GZIP_BLOCK_FOOTER_SIZE &&
+           data[0]==0x1f && data[1]==0x8b && data[2]==Z_DEFLATED && (data[3]&0x04)!=0 &&
+           readUInt16(data+10)==6 && data[12]=='B' && data[13]=='C' && readUInt16(data+14)==2;
+}
+
+bool deflateGZipBlock( const char* source, unsigned int size, std::string& block, int level )
+{
+    block.resize( GZIP_MAX_BLOCK_SIZE );
+    unsigned char* out = reinterpret_cast<unsigned char*>( &block[0] );
+
+    z_stream strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    if ( deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)!=Z_OK ) return false;
+
+    strm.next_in = (Bytef*)source;
+    strm.avail_in = size;
+    strm.next_out = out + GZIP_BLOCK_HEADER_SIZE;
+    strm.avail_out = GZIP_MAX_BLOCK_SIZE - GZIP_BLOCK_HEADER_SIZE - GZIP_BLOCK_FOOTER_SIZE;
+
+    int ret = deflate( &strm, Z_FINISH );
+    unsigned int compressedSize = strm.total_out;
+    (void)deflateEnd( &strm );
+
+    // incompressible data can expand beyond the 64k limit, store it instead.
+    if ( ret!=Z_STREAM_END )
+    {
+        return level!=0 ? deflateGZipBlock( source, size, block, 0 ) : false;
+    }
+
+    unsigned int blockSize = GZIP_BLOCK_HEADER_SIZE + compressedSize + GZIP_BLOCK_FOOTER_SIZE;
+    memcpy( out, GZIP_BLOCK_EOF, GZIP_BLOCK_HEADER_SIZE );
+    writeUInt16( out+16, blockSize-1 );
+    writeUInt32( out+blockSize-8, crc32(0L, (const Bytef*)source, size) );
+    writeUInt32( out+blockSize-4, size );
+
+    block.resize( blockSize );
+    return true;
+}
+
+struct DeflateBlocks : public BlockOperation
+{
+    DeflateBlocks( const std::string& src ):
+        _src(src), _blocks((src.size()+GZIP_MAX_BLOCK_INPUT_SIZE-1)/GZIP_MAX_BLOCK_INPUT_SIZE) {}
+
+    virtual bool processBlock( size_t i )
+    {
+        size_t offset = i*GZIP_MAX_BLOCK_INPUT_SIZE;
+        unsigned int size = static_cast<unsigned int>( osg::minimum(_src.size()-offset, static_cast<size_t>(GZIP_MAX_BLOCK_INPUT_SIZE)) );
+        return deflateGZipBlock( _src.data()+offset, size, _blocks[i], 6 );
+    }
+
+    const std::string&          _src;
+    std::vector<std::string>    _blocks;
+};
+
+struct InflateBlocks : public BlockOperation
+{
+    struct Block
+    {
+        size_t          offset;
+        unsigned int    size;
+        size_t          targetOffset;
+        unsigned int    targetSize;
+    };
+
+    InflateBlocks( const std::string& src, std::string& target ): _src(src), _target(target) {}
+
+    virtual bool processBlock( size_t i )
+    {
+        const Block& block = _blocks[i];
+        const unsigned char* data = reinterpret_cast<const unsigned char*>( _src.data() ) + block.offset;
+        if ( block.targetSize==0 ) return true;
+
+        z_stream strm;
+        strm.zalloc = Z_NULL;
+        strm.zfree = Z_NULL;
+        strm.opaque = Z_NULL;
+        strm.avail_in = 0;
+        strm.next_in = Z_NULL;
+        if ( inflateInit2(&strm, -MAX_WBITS)!=Z_OK ) return false;
+
+        Bytef* out = (Bytef*)( &_target[block.targetOffset] );
+        strm.next_in = (Bytef*)( data+GZIP_BLOCK_HEADER_SIZE );
+        strm.avail_in = block.size - GZIP_BLOCK_HEADER_SIZE - GZIP_BLOCK_FOOTER_SIZE;
+        strm.next_out = out;
+        strm.avail_out = block.targetSize;
+
+        int ret = inflate( &strm, Z_FINISH );
+        bool success = ret==Z_STREAM_END && strm.total_out==block.targetSize;
+        (void)inflateEnd( &strm );
+
+        return success && crc32(0L, out, block.targetSize)==readUInt32(data+block.size-8);
+    }
+
+    // find the members of a block compressed stream, return false if it isn't made up only of blocks.
+    bool indexBlocks()
+    {
+        const unsigned char* data = reinterpret_cast<const unsigned char*>( _src.data() );
+        size_t size = _src.size();
+        size_t offset = 0, targetOffset = 0;
+        while ( offset<size )
+        {
+            if ( !isGZipBlock(data+offset, size-offset) ) return false;
+
+            Block block;
+            block.offset = offset;
+            block.size = readUInt16(data+offset+16) + 1;
+            if ( block.size<GZIP_BLOCK_HEADER_SIZE+GZIP_BLOCK_FOOTER_SIZE || offset+block.size>size ) return false;
+
+            block.targetOffset = targetOffset;
+            block.targetSize = readUInt32(data+offset+block.size-4);
+            _blocks.push_back( block );
+
+            offset += block.size;
+            targetOffset += block.targetSize;
+        }
+        _targetSize = targetOffset;
+        return true;
+    }
+
+    const std::string&  _src;
+    std::string&        _target;
+    std::vector<Block>  _blocks;
+    size_t              _targetSize;
+};
+
+bool deflateGZipBlocks( std::ostream& fout, const std::string& src )
+{
+    DeflateBlocks operation( src );
+    if ( !operation._blocks.empty() && !runBlockOperation(operation, operation._blocks.size()) ) return false;
+
+    for ( std::vector<std::string>::const_iterator itr=operation._blocks.begin(); itr!=operation._blocks.end(); ++itr )
+    {
+        fout.write( itr->data(), itr->size() );
+    }
+    fout.write( (const char*)GZIP_BLOCK_EOF, sizeof(GZIP_BLOCK_EOF) );
+
+    return !fout.fail();
+}
+
+// single zlib or gzip stream, continuing across concatenated gzip members.
+bool inflateGZipStream( const std::string& src, std::string& target )
+{
+    int ret;
+    unsigned have;
+    z_stream strm;
+    unsigned char out[CHUNK];
+
+    /* allocate inflate state */
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = 0;
+    strm.next_in = Z_NULL;
+    ret = inflateInit2( &strm,
+                        15 + 32 ); // autodected zlib or gzip header
+
+    if ( ret!=Z_OK )
+    {
+        OSG_INFO << "failed to init" << std::endl;
+        return false;
+    }
+
+    strm.next_in = (Bytef*)( src.data() );
+    strm.avail_in = src.size();
+
+    /* decompress until the last stream ends or the input is used up */
+    do
+    {
+        strm.avail_out = CHUNK;
+        strm.next_out = out;
+        ret = inflate( &strm, Z_NO_FLUSH );
+
+        switch (ret)
+        {
+        case Z_NEED_DICT:
+        case Z_DATA_ERROR:
+        case Z_MEM_ERROR:
+        case Z_STREAM_ERROR:
+            (void)inflateEnd( &strm );
+            return false;
+        }
+        have = CHUNK - strm.avail_out;
+        target.append( (char*)out, have );
+
+        // another gzip member follows
+        if ( ret==Z_STREAM_END && strm.avail_in>=2 && strm.next_in[0]==0x1f && strm.next_in[1]==0x8b )
+        {
+            inflateReset( &strm );
+            ret = Z_OK;
+        }
+    } while ( ret!=Z_STREAM_END && (strm.avail_in>0 || strm.avail_out==0) );
+
+    /* clean up and return */
+    (void)inflateEnd( &strm );
+    return ret==Z_STREAM_END ? true : false;
+}
+
+bool inflateGZip( std::istream& fin, std::string& target )
+{
+    std::string src;
+    readRemaining( fin, src );
+
+    // block compressed streams are inflated in parallel straight into the target.
+    InflateBlocks operation( src, target );
+    if ( !src.empty() && operation.indexBlocks() )
+    {
+        target.resize( operation._targetSize );
+        return runBlockOperation( operation, operation._blocks.size() );
+    }
+
+    return inflateGZipStream( src, target );
+}
+
+}
+
 // ZLib compressor
 class ZLibCompressor : public BaseCompressor
 {
@@ -114,63 +452,359 @@ public:
 
     virtual bool decompress( std::istream& fin, std::string& target )
     {
-        int ret;
-        unsigned have;
-        z_stream strm;
-        unsigned char in[CHUNK];
-        unsigned char out[CHUNK];
+        return inflateGZip( fin, target );
+    }
+};
 
-        /* allocate inflate state */
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-        strm.avail_in = 0;
-        strm.next_in = Z_NULL;
-        ret = inflateInit2( &strm,
-                            15 + 32 ); // autodected zlib or gzip header
+REGISTER_COMPRESSOR( "zlib", ZLibCompressor )
 
-        if ( ret!=Z_OK )
+// Block compressor writing a series of independent gzip members of at most 64k each, in the BGZF layout
+// used by bioinformatics tools, so that blocks can be compressed and decompressed in parallel and the
+// output is still a valid multi-member gzip stream.
+class BlockZLibCompressor : public BaseCompressor
+{
+public:
+    BlockZLibCompressor() {}
+
+    virtual bool compress( std::ostream& fout, const std::string& src )
+    {
+        return deflateGZipBlocks( fout, src );
+    }
+
+    virtual bool decompress( std::istream& fin, std::string& target )
+    {
+        return inflateGZip( fin, target );
+    }
+};
+
+REGISTER_COMPRESSOR( "bgzf", BlockZLibCompressor )
+
+#endif
+
+// Base class for compressors that split the data into independently coded blocks, which are compressed
+// and decompressed in parallel. The stream holds the number of blocks, the uncompressed and compressed
+// size of each block, then the blocks themselves.
+class BlockCodecCompressor : public BaseCompressor
+{
+public:
+    BlockCodecCompressor() {}
+
+    static const unsigned int BLOCK_SIZE = 1024*1024;
+
+    /** Maximum size of a compressed block of the given size.*/
+    virtual size_t compressBound( size_t size ) const = 0;
+
+    /** Compress a block, returning the compressed size or 0 on failure.*/
+    virtual size_t compressBlock( const char* src, size_t srcSize, char* dst, size_t dstCapacity ) const = 0;
+
+    /** Decompress a block, returning false if the data is corrupt or doesn't decompress to exactly dstSize.*/
+    virtual bool decompressBlock( const char* src, size_t srcSize, char* dst, size_t dstSize ) const = 0;
+
+    virtual bool compress( std::ostream& fout, const std::string& src )
+    {
+        CompressBlocks operation( *this, src );
+        size_t numBlocks = operation._blocks.size();
+        if ( numBlocks>0 && !runBlockOperation(operation, numBlocks) ) return false;
+
+        std::vector<unsigned char> header( 4 + numBlocks*8 );
+        writeUInt32( &header[0], static_cast<unsigned int>(numBlocks) );
+        for ( size_t i=0; i<numBlocks; ++i )
         {
-            OSG_INFO << "failed to init" << std::endl;
-            return ret!=0;
+            writeUInt32( &header[4+i*8], operation.blockSize(i) );
+            writeUInt32( &header[8+i*8], static_cast<unsigned int>(operation._blocks[i].size()) );
         }
+        fout.write( (const char*)&header[0], header.size() );
 
-        /* decompress until deflate stream ends or end of file */
-        do
+        for ( size_t i=0; i<numBlocks; ++i )
+        {
+            fout.write( operation._blocks[i].data(), operation._blocks[i].size() );
+        }
+        return !fout.fail();
+    }
+
+    virtual bool decompress( std::istream& fin, std::string& target )
+    {
+        std::string src;
+        readRemaining( fin, src );
+        const unsigned char* data = reinterpret_cast<const unsigned char*>( src.data() );
+        if ( src.size()<4 ) return false;
+
+        size_t numBlocks = readUInt32( data );
+        if ( 4+numBlocks*8 > src.size() ) return false;
+
+        DecompressBlocks operation( *this, src, target );
+        operation._blocks.resize( numBlocks );
+
+        size_t offset = 4 + numBlocks*8, targetOffset = 0;
+        for ( size_t i=0; i<numBlocks; ++i )
+        {
+            DecompressBlocks::Block& block = operation._blocks[i];
+            block.targetOffset = targetOffset;
+            block.targetSize = readUInt32( data+4+i*8 );
+            block.offset = offset;
+            block.size = readUInt32( data+8+i*8 );
+            if ( block.size > src.size()-offset ) return false;
+
+            offset += block.size;
+            targetOffset += block.targetSize;
+        }
+
+        target.resize( targetOffset );
+        return numBlocks==0 || runBlockOperation( operation, numBlocks );
+    }
+
+protected:
+
+    struct CompressBlocks : public BlockOperation
+    {
+        CompressBlocks( const BlockCodecCompressor& codec, const std::string& src ):
+            _codec(codec), _src(src), _blocks((src.size()+BLOCK_SIZE-1)/BLOCK_SIZE) {}
+
+        unsigned int blockSize( size_t i ) const
+        {
+            return static_cast<unsigned int>( osg::minimum(_src.size()-i*BLOCK_SIZE, static_cast<size_t>(BLOCK_SIZE)) );
+        }
+
+        virtual bool processBlock( size_t i )
+        {
+            size_t size = blockSize( i );
+            std::string& block = _blocks[i];
+            block.resize( _codec.compressBound(size) );
+
+            size_t compressedSize = _codec.compressBlock( _src.data()+i*BLOCK_SIZE, size, &block[0], block.size() );
+            block.resize( compressedSize );
+            return compressedSize>0;
+        }
+
+        const BlockCodecCompressor& _codec;
+        const std::string&          _src;
+        std::vector<std::string>    _blocks;
+    };
+
+    struct DecompressBlocks : public BlockOperation
+    {
+        struct Block
+        {
+            size_t          offset;
+            size_t          size;
+            size_t          targetOffset;
+            size_t          targetSize;
+        };
+
+        DecompressBlocks( const BlockCodecCompressor& codec, const std::string& src, std::string& target ):
+            _codec(codec), _src(src), _target(target) {}
+
+        virtual bool processBlock( size_t i )
+        {
+            const Block& block = _blocks[i];
+            if ( block.targetSize==0 ) return block.size==0;
+            return _codec.decompressBlock( _src.data()+block.offset, block.size, &_target[block.targetOffset], block.targetSize );
+        }
+
+        const BlockCodecCompressor& _codec;
+        const std::string&          _src;
+        std::string&                _target;
+        std::vector<Block>          _blocks;
+    };
+};
+
+namespace
+{
+
+// LZ4 block format, see lz4_Block_format.md in the LZ4 distribution.
+const size_t LZ4_MIN_MATCH = 4;
+const size_t LZ4_MF_LIMIT = 12;
+const size_t LZ4_LAST_LITERALS = 5;
+const size_t LZ4_MAX_DISTANCE = 65535;
+const unsigned int LZ4_HASH_LOG = 14;
+
+inline unsigned int readUInt32Native( const unsigned char* ptr ) { unsigned int value; memcpy(&value, ptr, 4); return value; }
+inline unsigned int lz4Hash( unsigned int sequence ) { return (sequence*2654435761u) >> (32-LZ4_HASH_LOG); }
+
+inline unsigned char* lz4WriteLength( unsigned char* op, size_t length )
+{
+    for ( ; length>=255; length-=255 ) *op++ = 255;
+    *op++ = static_cast<unsigned char>(length);
+    return op;
+}
+
+inline unsigned char* lz4WriteSequence( unsigned char* op, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength )
+{
+    unsigned char* token = op++;
+    *token = static_cast<unsigned char>( (literalLength>=15 ? 15 : literalLength)<<4 );
+    if ( literalLength>=15 ) op = lz4WriteLength( op, literalLength-15 );
+
+    memcpy( op, literals, literalLength );
+    op += literalLength;
+
+    // the last sequence is literals only
+    if ( offset==0 ) return op;
+
+    *op++ = static_cast<unsigned char>( offset&0xff );
+    *op++ = static_cast<unsigned char>( offset>>8 );
+
+    *token |= static_cast<unsigned char>( matchLength>=15 ? 15 : matchLength );
+    if ( matchLength>=15 ) op = lz4WriteLength( op, matchLength-15 );
+    return op;
+}
+
+// greedy single pass compressor, skipping ahead faster through data that doesn't match.
+size_t lz4CompressBlock( const unsigned char* src, size_t srcSize, unsigned char* dst )
+{
+    const unsigned char* ip = src;
+    const unsigned char* anchor = src;
+    const unsigned char* iend = src + srcSize;
+    unsigned char* op = dst;
+
+    if ( srcSize>LZ4_MF_LIMIT )
+    {
+        const unsigned char* mflimit = iend - LZ4_MF_LIMIT;
+        const unsigned char* matchlimit = iend - LZ4_LAST_LITERALS;
+
+        std::vector<unsigned int> table( 1<<LZ4_HASH_LOG, 0 );
+
+        while ( ip<mflimit )
         {
-            fin.read( (char *)in, CHUNK );
-            strm.avail_in = fin.gcount();
-            if (strm.avail_in==0 ) break;
+            unsigned int sequence = readUInt32Native( ip );
+            unsigned int& entry = table[lz4Hash(sequence)];
+            const unsigned char* ref = src + entry;
+            entry = static_cast<unsigned int>( ip-src );
 
-            /* run inflate() on input until output buffer not full */
-            strm.next_in = in;
-            do
+            if ( ref>=ip || static_cast<size_t>(ip-ref)>LZ4_MAX_DISTANCE || readUInt32Native(ref)!=sequence )
             {
-                strm.avail_out = CHUNK;
-                strm.next_out = out;
-                ret = inflate( &strm, Z_NO_FLUSH );
-
-                switch (ret)
-                {
-                case Z_NEED_DICT:
-                case Z_DATA_ERROR:
-                case Z_MEM_ERROR:
-                    (void)inflateEnd( &strm );
-                    return false;
-                }
-                have = CHUNK - strm.avail_out;
-                target.append( (char*)out, have );
-            } while ( strm.avail_out==0 );
-
-            /* done when inflate() says it's done */
-        } while ( ret!=Z_STREAM_END );
+                ip += 1 + ((ip-anchor)>>6);
+                continue;
+            }
 
-        /* clean up and return */
-        (void)inflateEnd( &strm );
-        return ret==Z_STREAM_END ? true : false;
+            // extend the match backwards over the pending literals, then forwards.
+            while ( ip>anchor && ref>src && ip[-1]==ref[-1] ) { --ip; --ref; }
+
+            const unsigned char* matchEnd = ip + LZ4_MIN_MATCH;
+            const unsigned char* refEnd = ref + LZ4_MIN_MATCH;
+            while ( matchEnd+sizeof(size_t)<=matchlimit && memcmp(matchEnd, refEnd, sizeof(size_t))==0 ) { matchEnd+=sizeof(size_t); refEnd+=sizeof(size_t); }
+            while ( matchEnd<matchlimit && *matchEnd==*refEnd ) { ++matchEnd; ++refEnd; }
+
+            op = lz4WriteSequence( op, anchor, ip-anchor, ip-ref, (matchEnd-ip)-LZ4_MIN_MATCH );
+
+            ip = matchEnd;
+            anchor = ip;
+
+            if ( ip<mflimit ) table[lz4Hash(readUInt32Native(ip-2))] = static_cast<unsigned int>( ip-2-src );
+        }
+    }
+
+    op = lz4WriteSequence( op, anchor, iend-anchor, 0, 0 );
+    return op-dst;
+}
+
+inline bool lz4ReadLength( const unsigned char*& ip, const unsigned char* iend, size_t& length )
+{
+    unsigned int s;
+    do
+    {
+        if ( ip>=iend ) return false;
+        s = *ip++;
+        length += s;
+    } while ( s==255 );
+    return true;
+}
+
+bool lz4DecompressBlock( const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize )
+{
+    const unsigned char* ip = src;
+    const unsigned char* iend = src + srcSize;
+    unsigned char* op = dst;
+    unsigned char* oend = dst + dstSize;
+
+    for (;;)
+    {
+        if ( ip>=iend ) return false;
+        unsigned int token = *ip++;
+
+        size_t literalLength = token>>4;
+        if ( literalLength==15 && !lz4ReadLength(ip, iend, literalLength) ) return false;
+        if ( literalLength>static_cast<size_t>(iend-ip) || literalLength>static_cast<size_t>(oend-op) ) return false;
+
+        // short runs are copied as a fixed 16 bytes when there is room, which is much cheaper than a variable length copy.
+        if ( literalLength<=16 && iend-ip>=16 && oend-op>=16 ) memcpy( op, ip, 16 );
+        else memcpy( op, ip, literalLength );
+        op += literalLength;
+        ip += literalLength;
+
+        if ( ip==iend ) break;
+
+        if ( iend-ip<2 ) return false;
+        size_t offset = ip[0] | (ip[1]<<8);
+        ip += 2;
+        if ( offset==0 || offset>static_cast<size_t>(op-dst) ) return false;
+
+        size_t matchLength = token & 15;
+        if ( matchLength==15 && !lz4ReadLength(ip, iend, matchLength) ) return false;
+        matchLength += LZ4_MIN_MATCH;
+        if ( matchLength>static_cast<size_t>(oend-op) ) return false;
+
+        // overlapping matches repeat the last offset bytes so have to be copied forwards a byte at a time.
+        const unsigned char* match = op - offset;
+        if ( offset>=16 && static_cast<size_t>(oend-op)>=matchLength+16 )
+        {
+            for ( size_t i=0; i<matchLength; i+=16 ) memcpy( op+i, match+i, 16 );
+        }
+        else if ( offset>=matchLength ) memcpy( op, match, matchLength );
+        else for ( size_t i=0; i<matchLength; ++i ) op[i] = match[i];
+        op += matchLength;
+    }
+
+    return op==oend;
+}
+
+}
+
+// LZ4 compressor, trades compression ratio for very fast decompression.
+class LZ4Compressor : public BlockCodecCompressor
+{
+public:
+    LZ4Compressor() {}
+
+    virtual size_t compressBound( size_t size ) const { return size + size/255 + 16; }
+
+    virtual size_t compressBlock( const char* src, size_t srcSize, char* dst, size_t ) const
+    {
+        return lz4CompressBlock( (const unsigned char*)src, srcSize, (unsigned char*)dst );
+    }
+
+    virtual bool decompressBlock( const char* src, size_t srcSize, char* dst, size_t dstSize ) const
+    {
+        return lz4DecompressBlock( (const unsigned char*)src, srcSize, (unsigned char*)dst, dstSize );
     }
 };
 
-REGISTER_COMPRESSOR( "zlib", ZLibCompressor )
+REGISTER_COMPRESSOR( "lz4", LZ4Compressor )
+
+#ifdef USE_ZSTD
+
+#include <zstd.h>
+
+// Zstandard compressor, better compression than zlib with faster decompression.
+class ZstdCompressor : public BlockCodecCompressor
+{
+public:
+    ZstdCompressor() {}
+
+    virtual size_t compressBound( size_t size ) const { return ZSTD_compressBound(size); }
+
+    virtual size_t compressBlock( const char* src, size_t srcSize, char* dst, size_t dstCapacity ) const
+    {
+        size_t result = ZSTD_compress( dst, dstCapacity, src, srcSize, 9 );
+        return ZSTD_isError(result) ? 0 : result;
+    }
+
+    virtual bool decompressBlock( const char* src, size_t srcSize, char* dst, size_t dstSize ) const
+    {
+        size_t result = ZSTD_decompress( dst, dstSize, src, srcSize );
+        return !ZSTD_isError(result) && result==dstSize;
+    }
+};
+
+REGISTER_COMPRESSOR( "zstd", ZstdCompressor )
 
 #endif
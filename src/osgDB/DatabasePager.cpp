@@ -23,6 +23,7 @@
 #include <osg/Notify>
 #include <osg/ProxyNode>
 #include <osg/ApplicationUsage>
+#include <osg/TraceRecorder>
 
 #include <OpenThreads/ScopedLock>
 
@@ -47,6 +48,8 @@ static osg::ApplicationUsageProxy DatabasePager_e0(osg::ApplicationUsage::ENVIRO
 static osg::ApplicationUsageProxy DatabasePager_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_DRAWABLE <mode>","Set the drawable policy for setting of loaded drawable to specified type.  mode can be one of DoNotModify, DisplayList, VBO or VertexArrays>.");
 static osg::ApplicationUsageProxy DatabasePager_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PRIORITY <mode>", "Set the thread priority to DEFAULT, MIN, LOW, NOMINAL, HIGH or MAX.");
 static osg::ApplicationUsageProxy DatabasePager_e11(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD <num>","Set the target maximum number of PagedLOD to maintain.");
+static osg::ApplicationUsageProxy DatabasePager_e13(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_UPDATE_TIME_BUDGET <milliseconds>","Set the maximum time per frame spent expiring and merging paged subgraphs, 0 disables the limit.");
+static osg::ApplicationUsageProxy DatabasePager_e14(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_MEMORY_ARENAS <ON/OFF>","Set whether each paged subgraph is allocated from a MemoryArena of its own, reducing heap fragmentation.");
 static osg::ApplicationUsageProxy DatabasePager_e12(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_ASSIGN_PBO_TO_IMAGES <ON/OFF>","Set whether PixelBufferObjects should be assigned to Images to aid download to the GPU.");
 
 // Convert function objects that take pointer args into functions that a
@@ -192,9 +195,14 @@ public:
     typedef std::set< osg::observer_ptr<osg::PagedLOD> > PagedLODs;
     PagedLODs _pagedLODs;
 
+    SetBasedPagedLODList()
+    {
+        _cursorValid[0] = false;
+        _cursorValid[1] = false;
+    }
 
     virtual PagedLODList* clone() { return new SetBasedPagedLODList(); }
-    virtual void clear() { _pagedLODs.clear(); }
+    virtual void clear() { _pagedLODs.clear(); _cursorValid[0] = false; _cursorValid[1] = false; }
     virtual unsigned int size() { return _pagedLODs.size(); }
 
     virtual void removeExpiredChildren(
@@ -206,46 +214,94 @@ public:
             itr!=_pagedLODs.end() && leftToRemove > 0;
             )
         {
-            osg::ref_ptr<osg::PagedLOD> plod;
-            if (itr->lock(plod))
+            PagedLODs::iterator current = itr++;
+            visitPagedLOD(current, expiryTime, expiryFrame, childrenRemoved, visitActive, leftToRemove);
+        }
+    }
+
+    virtual void removeExpiredChildren(
+        int numberChildrenToRemove, double expiryTime, unsigned int expiryFrame,
+        DatabasePager::ObjectList& childrenRemoved, bool visitActive, osg::Timer_t endTick)
+    {
+        // resume from where the previous call for this pass left off, so that PagedLODs
+        // visited on previous calls aren't rescanned before the rest of the set is visited.
+        int pass = visitActive ? 1 : 0;
+        if (!_cursorValid[pass])
+        {
+            _cursor[pass] = _pagedLODs.begin();
+            _cursorValid[pass] = true;
+        }
+
+        const osg::Timer* timer = osg::Timer::instance();
+        int leftToRemove = numberChildrenToRemove;
+        unsigned int numToVisit = _pagedLODs.size();
+        for(unsigned int numVisited = 0;
+            numVisited<numToVisit && leftToRemove>0 && !_pagedLODs.empty();
+            ++numVisited)
+        {
+            if (endTick!=0 && timer->tick()>=endTick) break;
+
+            if (_cursor[pass]==_pagedLODs.end()) _cursor[pass] = _pagedLODs.begin();
+
+            // advance the cursor before visiting, visitPagedLOD may erase the current entry.
+            PagedLODs::iterator current = _cursor[pass]++;
+            visitPagedLOD(current, expiryTime, expiryFrame, childrenRemoved, visitActive, leftToRemove);
+        }
+    }
+
+    void visitPagedLOD(PagedLODs::iterator itr, double expiryTime, unsigned int expiryFrame,
+                       DatabasePager::ObjectList& childrenRemoved, bool visitActive, int& leftToRemove)
+    {
+        osg::ref_ptr<osg::PagedLOD> plod;
+        if (itr->lock(plod))
+        {
+            bool plodActive = expiryFrame < plod->getFrameNumberOfLastTraversal();
+            if (visitActive==plodActive) // true if (visitActive && plodActive) OR (!visitActive &&!plodActive)
             {
-                bool plodActive = expiryFrame < plod->getFrameNumberOfLastTraversal();
-                if (visitActive==plodActive) // true if (visitActive && plodActive) OR (!visitActive &&!plodActive)
+                DatabasePager::ExpirePagedLODsVisitor expirePagedLODsVisitor;
+                osg::NodeList expiredChildren; // expired PagedLODs
+                expirePagedLODsVisitor.removeExpiredChildrenAndFindPagedLODs(
+                    plod.get(), expiryTime, expiryFrame, expiredChildren);
+                // Clear any expired PagedLODs out of the set
+                for (DatabasePager::ExpirePagedLODsVisitor::PagedLODset::iterator
+                         citr = expirePagedLODsVisitor._childPagedLODs.begin(),
+                         end = expirePagedLODsVisitor._childPagedLODs.end();
+                     citr != end;
+                    ++citr)
                 {
-                    DatabasePager::ExpirePagedLODsVisitor expirePagedLODsVisitor;
-                    osg::NodeList expiredChildren; // expired PagedLODs
-                    expirePagedLODsVisitor.removeExpiredChildrenAndFindPagedLODs(
-                        plod.get(), expiryTime, expiryFrame, expiredChildren);
-                    // Clear any expired PagedLODs out of the set
-                    for (DatabasePager::ExpirePagedLODsVisitor::PagedLODset::iterator
-                             citr = expirePagedLODsVisitor._childPagedLODs.begin(),
-                             end = expirePagedLODsVisitor._childPagedLODs.end();
-                         citr != end;
-                        ++citr)
+                    osg::observer_ptr<osg::PagedLOD> clod(*citr);
+                    // This child PagedLOD cannot be equal to the
+                    // PagedLOD pointed to by itr because it must be
+                    // in itr's subgraph. Therefore erasing it doesn't
+                    // invalidate itr.
+                    PagedLODs::iterator clod_itr = _pagedLODs.find(clod);
+                    if (clod_itr != _pagedLODs.end())
                     {
-                        osg::observer_ptr<osg::PagedLOD> clod(*citr);
-                        // This child PagedLOD cannot be equal to the
-                        // PagedLOD pointed to by itr because it must be
-                        // in itr's subgraph. Therefore erasing it doesn't
-                        // invalidate itr.
-                        if (_pagedLODs.erase(clod) > 0)
-                            leftToRemove--;
+                        erasePagedLOD(clod_itr);
+                        leftToRemove--;
                     }
-                    std::copy(expiredChildren.begin(), expiredChildren.end(), std::back_inserter(childrenRemoved));
                 }
-
-                // advance the iterator to the next element
-                ++itr;
-            }
-            else
-            {
-                _pagedLODs.erase(itr++);
-                // numberChildrenToRemove includes possibly expired
-                // observer pointers.
-                leftToRemove--;
-                OSG_INFO<<"DatabasePager::removeExpiredSubgraphs() _inactivePagedLOD has been invalidated, but ignored"<<std::endl;
+                std::copy(expiredChildren.begin(), expiredChildren.end(), std::back_inserter(childrenRemoved));
             }
         }
+        else
+        {
+            erasePagedLOD(itr);
+            // numberChildrenToRemove includes possibly expired
+            // observer pointers.
+            leftToRemove--;
+            OSG_INFO<<"DatabasePager::removeExpiredSubgraphs() _inactivePagedLOD has been invalidated, but ignored"<<std::endl;
+        }
+    }
+
+    /** Erase an entry, moving any resume cursor that points at it on to the next entry.*/
+    void erasePagedLOD(PagedLODs::iterator itr)
+    {
+        for(int pass=0; pass<2; ++pass)
+        {
+            if (_cursorValid[pass] && _cursor[pass]==itr) ++_cursor[pass];
+        }
+        _pagedLODs.erase(itr);
     }
 
     virtual void removeNodes(osg::NodeList& nodesToRemove)
@@ -260,7 +316,7 @@ public:
             if (plod_itr != _pagedLODs.end())
             {
                 OSG_INFO<<"Removing node from PagedLOD list"<<std::endl;
-                _pagedLODs.erase(plod_itr);
+                erasePagedLOD(plod_itr);
             }
         }
     }
@@ -284,6 +340,11 @@ public:
         return (_pagedLODs.count(plod)!=0);
     }
 
+protected:
+
+    // resume positions of the inactive and active expiry passes.
+    PagedLODs::iterator _cursor[2];
+    bool                _cursorValid[2];
 };
 
 
@@ -726,6 +787,8 @@ void DatabasePager::DatabaseThread::run()
         //
         if (_pager->_deleteRemovedSubgraphsInDatabaseThread/* && !(read_queue->_childrenToDeleteList.empty())*/)
         {
+            OSG_TRACE_ZONE("osgDB", "DatabaseThread delete subgraphs");
+
             ObjectList deleteList;
             {
                 // Don't hold lock during destruction of deleteList
@@ -841,6 +904,7 @@ void DatabasePager::DatabaseThread::run()
 
         if (databaseRequest.valid())
         {
+            OSG_TRACE_ZONE("osgDB", "DatabaseThread read request");
 
             // load the data, note safe to write to the databaseRequest since once
             // it is created this thread is the only one to write to the _loadedModel pointer.
@@ -849,9 +913,16 @@ void DatabasePager::DatabaseThread::run()
 
 
             // assume that readNode is thread safe...
-            ReaderWriter::ReadResult rr = readFromFileCache ?
+            ReaderWriter::ReadResult rr;
+            {
+                // allocate the tile from its own arena so its memory is returned to the heap in one go once the tile is expired.
+                osg::ref_ptr<osg::MemoryArena> arena = _pager->_useMemoryArenas ? new osg::MemoryArena : 0;
+                osg::MemoryArena::ScopedArena scopedArena(arena.get());
+
+                rr = readFromFileCache ?
                         fileCache->readNode(fileName, dr_loadOptions.get(), false) :
                         Registry::instance()->readNode(fileName, dr_loadOptions.get(), false);
+            }
 
             osg::ref_ptr<osg::Node> loadedModel;
             if (rr.validNode()) loadedModel = rr.getNode();
@@ -1024,6 +1095,21 @@ DatabasePager::DatabasePager()
         OSG_NOTICE<<"_targetMaximumNumberOfPageLOD = "<<_targetMaximumNumberOfPageLOD<<std::endl;
     }
 
+    _updateSceneGraphTimeBudget = 0.0;
+    if( (str = getenv("OSG_DATABASE_PAGER_UPDATE_TIME_BUDGET")) != 0)
+    {
+        _updateSceneGraphTimeBudget = osg::asciiToDouble(str);
+        OSG_NOTICE<<"_updateSceneGraphTimeBudget = "<<_updateSceneGraphTimeBudget<<"ms"<<std::endl;
+    }
+    _updateSceneGraphStartTick = 0;
+
+    _useMemoryArenas = false;
+    if( (str = getenv("OSG_DATABASE_PAGER_MEMORY_ARENAS")) != 0)
+    {
+        _useMemoryArenas = strcmp(str,"yes")==0 || strcmp(str,"YES")==0 ||
+                           strcmp(str,"on")==0 || strcmp(str,"ON")==0;
+    }
+
 
     _doPreCompile = true;
     if( (str = getenv("OSG_DO_PRE_COMPILE")) != 0)
@@ -1100,9 +1186,14 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
     _valueAnisotropy = rhs._valueAnisotropy;
 
     _deleteRemovedSubgraphsInDatabaseThread = rhs._deleteRemovedSubgraphsInDatabaseThread;
+    _backgroundReleaseThread = rhs._backgroundReleaseThread;
+    _useMemoryArenas = rhs._useMemoryArenas;
 
     _targetMaximumNumberOfPageLOD = rhs._targetMaximumNumberOfPageLOD;
 
+    _updateSceneGraphTimeBudget = rhs._updateSceneGraphTimeBudget;
+    _updateSceneGraphStartTick = 0;
+
     _doPreCompile = rhs._doPreCompile;
 
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
@@ -1293,6 +1384,10 @@ void DatabasePager::resetStats()
     _maximumTimeToMergeTile = -DBL_MAX;
     _totalTimeToMergeTiles = 0.0;
     _numTilesMerges = 0;
+
+    _minimumMergeCostPerTile = DBL_MAX;
+    _maximumMergeCostPerTile = -DBL_MAX;
+    _totalMergeCostOfTiles = 0.0;
 }
 
 bool DatabasePager::getRequestsInProgress() const
@@ -1528,6 +1623,7 @@ bool DatabasePager::requiresUpdateSceneGraph() const
 
 void DatabasePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
 {
+    OSG_TRACE_ZONE("osgDB", "DatabasePager::updateSceneGraph");
 
 #define UPDATE_TIMING 0
 #if UPDATE_TIMING
@@ -1535,6 +1631,8 @@ void DatabasePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
     double timeFor_removeExpiredSubgraphs, timeFor_addLoadedDataToSceneGraph;
 #endif
 
+    _updateSceneGraphStartTick = osg::Timer::instance()->tick();
+
     {
         removeExpiredSubgraphs(frameStamp);
 
@@ -1567,6 +1665,8 @@ void DatabasePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
 
 void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 {
+    OSG_TRACE_ZONE("osgDB", "DatabasePager::addLoadedDataToSceneGraph");
+
     double timeStamp = frameStamp.getReferenceTime();
     unsigned int frameNumber = frameStamp.getFrameNumber();
 
@@ -1579,13 +1679,21 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 
     mid = osg::Timer::instance()->tick();
 
+    unsigned int numMerged = 0;
+
     // add the loaded data into the scene graph.
-    for(RequestQueue::RequestList::iterator itr=localFileLoadedList.begin();
+    RequestQueue::RequestList::iterator itr=localFileLoadedList.begin();
+    for(;
         itr!=localFileLoadedList.end();
         ++itr)
     {
+        // once over the time budget carry the remaining tiles over to the next frame, always merging at least one tile per frame.
+        if (numMerged>0 && updateSceneGraphTimeBudgetExceeded(1.0)) break;
+
         DatabaseRequest* databaseRequest = itr->get();
 
+        osg::Timer_t mergeStartTick = osg::Timer::instance()->tick();
+
         // No need to take _dr_mutex. The pager threads are done with
         // the request; the cull traversal -- which might redispatch
         // the request -- can't run at the sametime as this update traversal.
@@ -1633,6 +1741,13 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 
             _totalTimeToMergeTiles += timeToMerge;
             ++_numTilesMerges;
+
+            double mergeCost = osg::Timer::instance()->delta_m(mergeStartTick, osg::Timer::instance()->tick());
+
+            if (mergeCost<_minimumMergeCostPerTile) _minimumMergeCostPerTile = mergeCost;
+            if (mergeCost>_maximumMergeCostPerTile) _maximumMergeCostPerTile = mergeCost;
+
+            _totalMergeCostOfTiles += mergeCost;
         }
         else
         {
@@ -1642,17 +1757,34 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
         // reset the loadedModel pointer
         databaseRequest->_loadedModel = 0;
 
+        ++numMerged;
+
         // OSG_NOTICE<<"curr = "<<timeToMerge<<" min "<<getMinimumTimeToMergeTile()*1000.0<<" max = "<<getMaximumTimeToMergeTile()*1000.0<<" average = "<<getAverageTimToMergeTiles()*1000.0<<std::endl;
     }
 
+    if (itr!=localFileLoadedList.end())
+    {
+        // return the tiles that didn't fit in this frame's budget to the front of the merge list, ahead of any newly loaded tiles.
+        unsigned int numCarriedOver = 0;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dataToMergeList->_requestMutex);
+            RequestQueue::RequestList& requestList = _dataToMergeList->_requestList;
+            RequestQueue::RequestList::size_type previousSize = requestList.size();
+            requestList.splice(requestList.begin(), localFileLoadedList, itr, localFileLoadedList.end());
+            numCarriedOver = static_cast<unsigned int>(requestList.size() - previousSize);
+        }
+
+        OSG_INFO<<"DatabasePager::addLoadedDataToSceneGraph() time budget exceeded, carrying "<<numCarriedOver<<" tiles over to next frame."<<std::endl;
+    }
+
     last = osg::Timer::instance()->tick();
 
-    if (!localFileLoadedList.empty())
+    if (numMerged>0)
     {
         OSG_INFO<<"Done DatabasePager::addLoadedDataToSceneGraph"<<
             osg::Timer::instance()->delta_m(before,mid)<<"ms,\t"<<
             osg::Timer::instance()->delta_m(mid,last)<<"ms"<<
-            "  objects"<<localFileLoadedList.size()<<std::endl<<std::endl;
+            "  objects"<<numMerged<<std::endl<<std::endl;
     }
 
 }
@@ -1661,6 +1793,7 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 
 void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
 {
+    OSG_TRACE_ZONE("osgDB", "DatabasePager::removeExpiredSubgraphs");
 
     static double s_total_iter_stage_a = 0.0;
     static double s_total_time_stage_a = 0.0;
@@ -1712,13 +1845,31 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
     // certainly have expired. Then traverse active nodes if we still
     // need to prune.
     //OSG_NOTICE<<"numToPrune "<<numToPrune;
-    if (numToPrune>0)
-        _activePagedLODList->removeExpiredChildren(
-            numToPrune, expiryTime, expiryFrame, childrenRemoved, false);
-    numToPrune = _activePagedLODList->size() - _targetMaximumNumberOfPageLOD;
-    if (numToPrune>0)
-        _activePagedLODList->removeExpiredChildren(
-            numToPrune, expiryTime, expiryFrame, childrenRemoved, true);
+    if (_updateSceneGraphTimeBudget>0.0)
+    {
+        // when running to a time budget stop once half the budget has been used, the PagedLODList
+        // checks the time as it scans and resumes from where it left off on the next frame.
+        osg::Timer_t endTick = _updateSceneGraphStartTick +
+            static_cast<osg::Timer_t>(_updateSceneGraphTimeBudget*0.5*0.001/osg::Timer::instance()->getSecondsPerTick());
+
+        if (numToPrune>0)
+            _activePagedLODList->removeExpiredChildren(
+                numToPrune, expiryTime, expiryFrame, childrenRemoved, false, endTick);
+        numToPrune = _activePagedLODList->size() - _targetMaximumNumberOfPageLOD;
+        if (numToPrune>0 && osg::Timer::instance()->tick()<endTick)
+            _activePagedLODList->removeExpiredChildren(
+                numToPrune, expiryTime, expiryFrame, childrenRemoved, true, endTick);
+    }
+    else
+    {
+        if (numToPrune>0)
+            _activePagedLODList->removeExpiredChildren(
+                numToPrune, expiryTime, expiryFrame, childrenRemoved, false);
+        numToPrune = _activePagedLODList->size() - _targetMaximumNumberOfPageLOD;
+        if (numToPrune>0)
+            _activePagedLODList->removeExpiredChildren(
+                numToPrune, expiryTime, expiryFrame, childrenRemoved, true);
+    }
 
     osg::Timer_t end_b_Tick = osg::Timer::instance()->tick();
     double time_b = osg::Timer::instance()->delta_m(end_a_Tick,end_b_Tick);
@@ -1731,8 +1882,14 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
 
     if (!childrenRemoved.empty())
     {
+        osg::BackgroundReleaseThread* releaseThread = getActiveBackgroundReleaseThread();
+        if (releaseThread && releaseThread->isRunning())
+        {
+            // hand our references to the expired subgraphs over to the release thread so the final unref happens off this thread.
+            releaseThread->release(childrenRemoved);
+        }
         // pass the objects across to the database pager delete list
-        if (_deleteRemovedSubgraphsInDatabaseThread)
+        else if (_deleteRemovedSubgraphsInDatabaseThread)
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
             // splice transfers the entire list in constant time.
@@ -1758,6 +1915,21 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
                               " C="<<time_c<<" avg="<<s_total_time_stage_c/s_total_iter_stage_c<<" max = "<<s_total_max_stage_c<<std::endl;
 }
 
+osg::BackgroundReleaseThread* DatabasePager::getActiveBackgroundReleaseThread()
+{
+    if (_backgroundReleaseThread.valid()) return _backgroundReleaseThread.get();
+
+    osg::BackgroundDeleteHandler* deleteHandler = dynamic_cast<osg::BackgroundDeleteHandler*>(osg::Referenced::getDeleteHandler());
+    return deleteHandler ? deleteHandler->getReleaseThread() : 0;
+}
+
+bool DatabasePager::updateSceneGraphTimeBudgetExceeded(double fraction) const
+{
+    if (_updateSceneGraphTimeBudget<=0.0) return false;
+
+    return osg::Timer::instance()->delta_m(_updateSceneGraphStartTick, osg::Timer::instance()->tick()) >= _updateSceneGraphTimeBudget*fraction;
+}
+
 class DatabasePager::FindPagedLODsVisitor : public osg::NodeVisitor
 {
 public:
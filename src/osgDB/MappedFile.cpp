@@ -0,0 +1,146 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/MappedFile>
+#include <osgDB/ConvertUTF>
+#include <osg/Notify>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace osgDB;
+
+MappedFile::MappedFile():
+    _data(0),
+    _size(0),
+    _isOpen(false)
+{
+}
+
+MappedFile::MappedFile(const std::string& filename):
+    _data(0),
+    _size(0),
+    _isOpen(false)
+{
+    open(filename);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+#ifdef OSG_USE_UTF8_FILENAME
+    HANDLE file = CreateFileW(convertUTF8toUTF16(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#else
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#endif
+    if (file==INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || static_cast<unsigned long long>(fileSize.QuadPart)>static_cast<size_t>(-1))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    _size = static_cast<size_t>(fileSize.QuadPart);
+    if (_size>0)
+    {
+        // the view keeps the mapping and file open, so both handles can be closed straight away.
+        HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            _data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+
+    if (_size>0 && !_data)
+    {
+        OSG_INFO<<"MappedFile::open("<<filename<<") unable to map file."<<std::endl;
+        _size = 0;
+        return false;
+    }
+
+    _isOpen = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data) UnmapViewOfFile(_data);
+    _data = 0;
+    _size = 0;
+    _isOpen = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd<0) return false;
+
+    struct stat stbuf;
+    if (fstat(fd, &stbuf)!=0 || static_cast<unsigned long long>(stbuf.st_size)>static_cast<size_t>(-1))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    _size = static_cast<size_t>(stbuf.st_size);
+    if (_size>0)
+    {
+        // the mapping holds its own reference to the file, so the descriptor can be closed straight away.
+        void* ptr = mmap(0, _size, PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr==MAP_FAILED)
+        {
+            OSG_INFO<<"MappedFile::open("<<filename<<") unable to map file."<<std::endl;
+            ::close(fd);
+            _size = 0;
+            return false;
+        }
+        _data = static_cast<const char*>(ptr);
+    }
+    ::close(fd);
+
+    _isOpen = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data) munmap(const_cast<char*>(_data), _size);
+    _data = 0;
+    _size = 0;
+    _isOpen = false;
+}
+
+#endif
@@ -17,6 +17,7 @@
 #include <osg/Notify>
 #include <osg/Object>
 #include <osg/Image>
+#include <osg/ImageUtils>
 #include <osg/Shader>
 #include <osg/Node>
 #include <osg/Group>
@@ -613,7 +614,11 @@ ImageProcessor* Registry::getImageProcessor()
             return _ipList.front().get();
         }
     }
-    return getImageProcessorForExtension("nvtt");
+
+    // prefer nvtt when available, otherwise fall back to the built in dxtc compressor.
+    ImageProcessor* ip = getImageProcessorForExtension("nvtt");
+    if (!ip) ip = getImageProcessorForExtension("dxtc");
+    return ip;
 }
 
 ImageProcessor* Registry::getImageProcessorForExtension(const std::string& ext)
@@ -790,7 +795,12 @@ Registry::LoadStatus Registry::loadLibrary(const std::string& fileName)
 
     _openingLibrary=true;
 
-    DynamicLibrary* dl = DynamicLibrary::loadLibrary(fileName);
+    // plugins live for the lifetime of the Registry so must not be allocated from the MemoryArena of the file being read.
+    DynamicLibrary* dl = 0;
+    {
+        osg::MemoryArena::ScopedArena noArena(0);
+        dl = DynamicLibrary::loadLibrary(fileName);
+    }
     _openingLibrary=false;
 
     if (dl)
@@ -913,7 +923,18 @@ struct Registry::ReadImageFunctor : public Registry::ReadFunctor
 {
     ReadImageFunctor(const std::string& filename, const Options* options):ReadFunctor(filename,options) {}
 
-    virtual ReaderWriter::ReadResult doRead(ReaderWriter& rw)const  { return rw.readImage(_filename, _options); }
+    virtual ReaderWriter::ReadResult doRead(ReaderWriter& rw)const
+    {
+        ReaderWriter::ReadResult rr = rw.readImage(_filename, _options);
+
+        // generate mipmaps here so that it's done before the image is added to the object cache.
+        if (rr.validImage() && _options && _options->getGenerateMipmapsHint()!=Options::DO_NOT_GENERATE_MIPMAPS)
+        {
+            osg::generateMipmaps(rr.getImage(), osg::RESAMPLE_BOX, _options->getGenerateMipmapsHint()==Options::GENERATE_GAMMA_CORRECT_MIPMAPS);
+        }
+
+        return rr;
+    }
     virtual bool isValid(ReaderWriter::ReadResult& readResult) const { return readResult.validImage(); }
     virtual bool isValid(osg::Object* object) const { return dynamic_cast<osg::Image*>(object)!=0;  }
 
@@ -1233,6 +1254,10 @@ ReaderWriter::ReadResult Registry::readImplementation(const ReadFunctor& readFun
         useObjectCache=options ? (options->getObjectCacheHint()&cacheHint)!=0: false;
     }
 
+    // objects held by the object or archive caches outlive the subgraph being read, so must not
+    // be allocated from the memory arena of an enclosing read as they would pin its blocks.
+    osg::MemoryArena::ScopedArena scopedArena((useObjectCache || cacheHint==Options::CACHE_ARCHIVES) ? 0 : osg::MemoryArena::getCurrentArena());
+
     if (useObjectCache)
     {
         // search for entry in the object cache.
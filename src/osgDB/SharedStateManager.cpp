@@ -12,10 +12,54 @@
 */
 
 #include <osg/Timer>
+#include <osg/MemoryArena>
+#include <osg/Texture>
 #include <osgDB/SharedStateManager>
 
 using namespace osgDB;
 
+namespace
+{
+
+// deep copies only the state that was allocated from a MemoryArena, used so that state kept in the
+// shared lists doesn't pin the arena of the subgraph it was first loaded with.
+class CopyOutOfArenaOp : public osg::CopyOp
+{
+    public:
+
+        CopyOutOfArenaOp():
+            osg::CopyOp(DEEP_COPY_STATESETS | DEEP_COPY_STATEATTRIBUTES | DEEP_COPY_TEXTURES | DEEP_COPY_IMAGES | DEEP_COPY_UNIFORMS) {}
+
+        using osg::CopyOp::operator();
+
+        virtual osg::StateSet* operator() (const osg::StateSet* stateset) const
+        {
+            return osg::MemoryArena::isArenaAllocated(stateset) ? osg::CopyOp::operator()(stateset) : const_cast<osg::StateSet*>(stateset);
+        }
+
+        virtual osg::StateAttribute* operator() (const osg::StateAttribute* attr) const
+        {
+            return osg::MemoryArena::isArenaAllocated(attr) ? osg::CopyOp::operator()(attr) : const_cast<osg::StateAttribute*>(attr);
+        }
+
+        virtual osg::Texture* operator() (const osg::Texture* texture) const
+        {
+            return osg::MemoryArena::isArenaAllocated(texture) ? osg::CopyOp::operator()(texture) : const_cast<osg::Texture*>(texture);
+        }
+
+        virtual osg::Image* operator() (const osg::Image* image) const
+        {
+            return osg::MemoryArena::isArenaAllocated(image) ? osg::CopyOp::operator()(image) : const_cast<osg::Image*>(image);
+        }
+
+        virtual osg::Uniform* operator() (const osg::Uniform* uniform) const
+        {
+            return osg::MemoryArena::isArenaAllocated(uniform) ? osg::CopyOp::operator()(uniform) : const_cast<osg::Uniform*>(uniform);
+        }
+};
+
+}
+
 SharedStateManager::SharedStateManager(unsigned int mode):
     osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
 {
@@ -210,10 +254,22 @@ void SharedStateManager::shareTextures(osg::StateSet* ss)
                 {
                     // Texture is not in _sharedAttributeList:
                     // Add to _sharedAttributeList. Not needed to be
-                    // shared all next times.
+                    // shared all next times, unless it had to be copied
+                    // out of the MemoryArena it was loaded into.
+                    osg::StateAttribute* sharedTexture = texture;
+                    if (osg::MemoryArena::isArenaAllocated(texture))
+                    {
+                        osg::MemoryArena::ScopedArena noArena(0);
+                        sharedTexture = osg::clone(texture, CopyOutOfArenaOp());
+
+                        if(_mutex) _mutex->lock();
+                        ss->setTextureAttributeAndModes(unit, sharedTexture, osg::StateAttribute::ON);
+                        if(_mutex) _mutex->unlock();
+                    }
+
                     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-                    _sharedTextureList.insert(texture);
-                    tmpSharedTextureList[texture] = TextureSharePair(texture, false);
+                    _sharedTextureList.insert(sharedTexture);
+                    tmpSharedTextureList[texture] = TextureSharePair(sharedTexture, sharedTexture!=texture);
                 }
             }
             else if(titr->second.second)
@@ -255,17 +311,29 @@ void SharedStateManager::process(osg::StateSet* ss, osg::Object* parent)
             else
             {
                 // StateSet is not in sharedStateSetList:
-                // Add to sharedStateSetList. Not needed to be shared all next times.
+                // Add to sharedStateSetList. Not needed to be shared all next times,
+                // unless it had to be copied out of the MemoryArena it was loaded into.
+                osg::StateSet* sharedStateSet = ss;
+                if (osg::MemoryArena::isArenaAllocated(ss))
+                {
+                    osg::MemoryArena::ScopedArena noArena(0);
+                    sharedStateSet = osg::clone(ss, CopyOutOfArenaOp());
+
+                    if (_mutex) _mutex->lock();
+                    setStateSet(sharedStateSet, parent);
+                    if (_mutex) _mutex->unlock();
+                }
+
                 {
                     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-                    _sharedStateSetList.insert(ss);
+                    _sharedStateSetList.insert(sharedStateSet);
                     tmpSharedStateSetList[ss]
-                        = StateSetSharePair(ss, false);
+                        = StateSetSharePair(sharedStateSet, sharedStateSet!=ss);
                 }
                 // Only in this case sharing textures is also required
                 if (_shareMode & (SHARE_DYNAMIC_TEXTURES | SHARE_STATIC_TEXTURES | SHARE_UNSPECIFIED_TEXTURES))
                 {
-                    shareTextures(ss);
+                    shareTextures(sharedStateSet);
                 }
             }
         }
@@ -0,0 +1,664 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/Texture>
+#include <osg/ImageUtils>
+#include <osg/Notify>
+#include <osgDB/Registry>
+
+#include <OpenThreads/Thread>
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// Software S3TC (BC1/BC2/BC3) and RGTC (BC4/BC5) block compressor, used when neither the nvtt plugin nor
+// a graphics context are available to compress textures, such as on headless conversion machines.
+
+namespace
+{
+
+enum BlockFormat
+{
+    BLOCK_DXT1,
+    BLOCK_DXT1a,
+    BLOCK_DXT3,
+    BLOCK_DXT5,
+    BLOCK_RGTC1,
+    BLOCK_RGTC2
+};
+
+inline unsigned int blockSizeInBytes(BlockFormat format)
+{
+    return (format==BLOCK_DXT1 || format==BLOCK_DXT1a || format==BLOCK_RGTC1) ? 8 : 16;
+}
+
+inline int clampByte(int v) { return v<0 ? 0 : (v>255 ? 255 : v); }
+
+inline int square(int v) { return v*v; }
+
+inline void writeUInt16(unsigned char* out, unsigned int v)
+{
+    out[0] = static_cast<unsigned char>(v & 0xff);
+    out[1] = static_cast<unsigned char>((v>>8) & 0xff);
+}
+
+inline unsigned int packRGB565(const float* c)
+{
+    int r = clampByte(static_cast<int>(c[0]+0.5f));
+    int g = clampByte(static_cast<int>(c[1]+0.5f));
+    int b = clampByte(static_cast<int>(c[2]+0.5f));
+    return ((r*31+127)/255)<<11 | ((g*63+127)/255)<<5 | ((b*31+127)/255);
+}
+
+inline void unpackRGB565(unsigned int v, int* c)
+{
+    int r = (v>>11) & 31;
+    int g = (v>>5) & 63;
+    int b = v & 31;
+    c[0] = (r<<3) | (r>>2);
+    c[1] = (g<<2) | (g>>4);
+    c[2] = (b<<3) | (b>>2);
+}
+
+struct ColorBlockEncoder
+{
+    // pixels of the 4x4 block as RGBA bytes.
+    const unsigned char*    pixels;
+    bool                    transparent[16];
+    bool                    threeColorMode;
+    int                     quality;
+
+    void computePalette(unsigned int c0, unsigned int c1, int palette[4][3]) const
+    {
+        unpackRGB565(c0, palette[0]);
+        unpackRGB565(c1, palette[1]);
+        for(int i=0; i<3; ++i)
+        {
+            if (threeColorMode)
+            {
+                palette[2][i] = (palette[0][i]+palette[1][i])/2;
+                palette[3][i] = 0;
+            }
+            else
+            {
+                palette[2][i] = (2*palette[0][i]+palette[1][i])/3;
+                palette[3][i] = (palette[0][i]+2*palette[1][i])/3;
+            }
+        }
+    }
+
+    // assign each pixel its nearest palette entry, return the total squared error.
+    int computeIndices(unsigned int c0, unsigned int c1, unsigned char indices[16]) const
+    {
+        int palette[4][3];
+        computePalette(c0, c1, palette);
+
+        int numColors = threeColorMode ? 3 : 4;
+        int totalError = 0;
+        for(int p=0; p<16; ++p)
+        {
+            if (transparent[p]) { indices[p] = 3; continue; }
+
+            const unsigned char* pixel = pixels + p*4;
+            int bestError = 0x7fffffff;
+            int bestIndex = 0;
+            for(int i=0; i<numColors; ++i)
+            {
+                int error = square(pixel[0]-palette[i][0]) + square(pixel[1]-palette[i][1]) + square(pixel[2]-palette[i][2]);
+                if (error<bestError) { bestError = error; bestIndex = i; }
+            }
+            indices[p] = static_cast<unsigned char>(bestIndex);
+            totalError += bestError;
+        }
+        return totalError;
+    }
+
+    // choose the initial end points from the extent of the block along its principal axis.
+    void computeEndPoints(float endPoint0[3], float endPoint1[3]) const
+    {
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+        float minimum[3] = { 255.0f, 255.0f, 255.0f };
+        float maximum[3] = { 0.0f, 0.0f, 0.0f };
+        int numPixels = 0;
+        for(int p=0; p<16; ++p)
+        {
+            if (transparent[p]) continue;
+            for(int i=0; i<3; ++i)
+            {
+                float v = pixels[p*4+i];
+                mean[i] += v;
+                if (v<minimum[i]) minimum[i] = v;
+                if (v>maximum[i]) maximum[i] = v;
+            }
+            ++numPixels;
+        }
+
+        if (numPixels==0)
+        {
+            for(int i=0; i<3; ++i) endPoint0[i] = endPoint1[i] = 0.0f;
+            return;
+        }
+
+        for(int i=0; i<3; ++i) mean[i] /= float(numPixels);
+
+        float axis[3] = { maximum[0]-minimum[0], maximum[1]-minimum[1], maximum[2]-minimum[2] };
+
+        if (quality>osgDB::ImageProcessor::FASTEST)
+        {
+            float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+            for(int p=0; p<16; ++p)
+            {
+                if (transparent[p]) continue;
+                float r = pixels[p*4+0]-mean[0];
+                float g = pixels[p*4+1]-mean[1];
+                float b = pixels[p*4+2]-mean[2];
+                covariance[0] += r*r; covariance[1] += r*g; covariance[2] += r*b;
+                covariance[3] += g*g; covariance[4] += g*b; covariance[5] += b*b;
+            }
+
+            // power iteration, starting from the bounding box diagonal.
+            for(int iteration=0; iteration<8; ++iteration)
+            {
+                float x = axis[0]*covariance[0] + axis[1]*covariance[1] + axis[2]*covariance[2];
+                float y = axis[0]*covariance[1] + axis[1]*covariance[3] + axis[2]*covariance[4];
+                float z = axis[0]*covariance[2] + axis[1]*covariance[4] + axis[2]*covariance[5];
+                float length = sqrtf(x*x+y*y+z*z);
+                if (length<1e-6f) break;
+                axis[0] = x/length; axis[1] = y/length; axis[2] = z/length;
+            }
+        }
+
+        float length2 = axis[0]*axis[0]+axis[1]*axis[1]+axis[2]*axis[2];
+        if (length2<1e-6f)
+        {
+            for(int i=0; i<3; ++i) endPoint0[i] = endPoint1[i] = mean[i];
+            return;
+        }
+
+        float minProjection = 1e30f;
+        float maxProjection = -1e30f;
+        for(int p=0; p<16; ++p)
+        {
+            if (transparent[p]) continue;
+            float projection = (pixels[p*4+0]-mean[0])*axis[0] + (pixels[p*4+1]-mean[1])*axis[1] + (pixels[p*4+2]-mean[2])*axis[2];
+            if (projection<minProjection) minProjection = projection;
+            if (projection>maxProjection) maxProjection = projection;
+        }
+
+        for(int i=0; i<3; ++i)
+        {
+            endPoint0[i] = mean[i] + axis[i]*maxProjection/length2;
+            endPoint1[i] = mean[i] + axis[i]*minProjection/length2;
+        }
+    }
+
+    // least squares fit of the end points to the current index assignment.
+    bool refineEndPoints(const unsigned char indices[16], float endPoint0[3], float endPoint1[3]) const
+    {
+        static const float fourColorWeights[4] = { 1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f };
+        static const float threeColorWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+        const float* weights = threeColorMode ? threeColorWeights : fourColorWeights;
+
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        float ax[3] = { 0.0f, 0.0f, 0.0f };
+        float bx[3] = { 0.0f, 0.0f, 0.0f };
+        for(int p=0; p<16; ++p)
+        {
+            if (transparent[p]) continue;
+            float a = weights[indices[p]];
+            float b = 1.0f-a;
+            aa += a*a; bb += b*b; ab += a*b;
+            for(int i=0; i<3; ++i)
+            {
+                ax[i] += a*pixels[p*4+i];
+                bx[i] += b*pixels[p*4+i];
+            }
+        }
+
+        float denominator = aa*bb - ab*ab;
+        if (fabsf(denominator)<1e-6f) return false;
+
+        for(int i=0; i<3; ++i)
+        {
+            endPoint0[i] = (ax[i]*bb - bx[i]*ab)/denominator;
+            endPoint1[i] = (bx[i]*aa - ax[i]*ab)/denominator;
+        }
+        return true;
+    }
+
+    void orderEndPoints(unsigned int& c0, unsigned int& c1) const
+    {
+        // the order of the end points selects between the four and three colour modes.
+        if (threeColorMode ? (c0>c1) : (c0<c1)) { unsigned int tmp = c0; c0 = c1; c1 = tmp; }
+    }
+
+    void encode(unsigned char* out)
+    {
+        float endPoint0[3], endPoint1[3];
+        computeEndPoints(endPoint0, endPoint1);
+
+        unsigned int c0 = packRGB565(endPoint0);
+        unsigned int c1 = packRGB565(endPoint1);
+        orderEndPoints(c0, c1);
+
+        unsigned char indices[16];
+        int error = computeIndices(c0, c1, indices);
+
+        int numIterations = quality==osgDB::ImageProcessor::FASTEST ? 0 : (quality==osgDB::ImageProcessor::NORMAL ? 1 : 3);
+        for(int iteration=0; iteration<numIterations && error>0; ++iteration)
+        {
+            if (!refineEndPoints(indices, endPoint0, endPoint1)) break;
+
+            unsigned int n0 = packRGB565(endPoint0);
+            unsigned int n1 = packRGB565(endPoint1);
+            orderEndPoints(n0, n1);
+
+            unsigned char newIndices[16];
+            int newError = computeIndices(n0, n1, newIndices);
+            if (newError>=error) break;
+
+            c0 = n0; c1 = n1; error = newError;
+            memcpy(indices, newIndices, 16);
+        }
+
+        if (c0==c1 && !threeColorMode)
+        {
+            // a single colour block has to use index 0 as the four colour mode requires c0>c1.
+            for(int p=0; p<16; ++p) indices[p] = 0;
+        }
+
+        unsigned int bits = 0;
+        for(int p=0; p<16; ++p) bits |= static_cast<unsigned int>(indices[p]) << (p*2);
+
+        writeUInt16(out, c0);
+        writeUInt16(out+2, c1);
+        writeUInt16(out+4, bits & 0xffff);
+        writeUInt16(out+6, bits >> 16);
+    }
+};
+
+void encodeColorBlock(const unsigned char* pixels, bool allowTransparency, int quality, unsigned char* out)
+{
+    ColorBlockEncoder encoder;
+    encoder.pixels = pixels;
+    encoder.quality = quality;
+    encoder.threeColorMode = false;
+    for(int p=0; p<16; ++p)
+    {
+        encoder.transparent[p] = allowTransparency && pixels[p*4+3]<128;
+        if (encoder.transparent[p]) encoder.threeColorMode = true;
+    }
+    encoder.encode(out);
+}
+
+void computeAlphaPalette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0>a1)
+    {
+        for(int i=1; i<7; ++i) palette[i+1] = ((7-i)*a0 + i*a1)/7;
+    }
+    else
+    {
+        for(int i=1; i<5; ++i) palette[i+1] = ((5-i)*a0 + i*a1)/5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+int computeAlphaIndices(const unsigned char* values, int stride, int a0, int a1, unsigned char indices[16])
+{
+    int palette[8];
+    computeAlphaPalette(a0, a1, palette);
+
+    int totalError = 0;
+    for(int p=0; p<16; ++p)
+    {
+        int value = values[p*stride];
+        int bestError = 0x7fffffff;
+        int bestIndex = 0;
+        for(int i=0; i<8; ++i)
+        {
+            int error = square(value-palette[i]);
+            if (error<bestError) { bestError = error; bestIndex = i; }
+        }
+        indices[p] = static_cast<unsigned char>(bestIndex);
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+// encode a single channel block, as used by the alpha of DXT5 and the channels of RGTC.
+void encodeAlphaBlock(const unsigned char* values, int stride, int quality, unsigned char* out)
+{
+    int minimum = 255, maximum = 0;
+    int innerMinimum = 255, innerMaximum = 0;
+    for(int p=0; p<16; ++p)
+    {
+        int v = values[p*stride];
+        if (v<minimum) minimum = v;
+        if (v>maximum) maximum = v;
+        if (v!=0 && v<innerMinimum) innerMinimum = v;
+        if (v!=255 && v>innerMaximum) innerMaximum = v;
+    }
+
+    int a0 = maximum;
+    int a1 = minimum;
+    unsigned char indices[16];
+    int error = computeAlphaIndices(values, stride, a0, a1, indices);
+
+    // the six value mode has exact 0 and 255 so may suit blocks with a few fully transparent or opaque pixels.
+    if (quality>osgDB::ImageProcessor::FASTEST && error>0 && innerMinimum<=innerMaximum && (minimum==0 || maximum==255))
+    {
+        unsigned char sixValueIndices[16];
+        int sixValueError = computeAlphaIndices(values, stride, innerMinimum, innerMaximum, sixValueIndices);
+        if (sixValueError<error)
+        {
+            a0 = innerMinimum;
+            a1 = innerMaximum;
+            error = sixValueError;
+            memcpy(indices, sixValueIndices, 16);
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(a0);
+    out[1] = static_cast<unsigned char>(a1);
+
+    unsigned int bits[2] = { 0, 0 };
+    for(int p=0; p<16; ++p)
+    {
+        bits[p/8] |= static_cast<unsigned int>(indices[p]) << ((p%8)*3);
+    }
+    for(int i=0; i<3; ++i)
+    {
+        out[2+i] = static_cast<unsigned char>((bits[0]>>(i*8)) & 0xff);
+        out[5+i] = static_cast<unsigned char>((bits[1]>>(i*8)) & 0xff);
+    }
+}
+
+void encodeExplicitAlphaBlock(const unsigned char* pixels, unsigned char* out)
+{
+    for(int p=0; p<16; p+=2)
+    {
+        int a0 = (pixels[p*4+3]+8)/17;
+        int a1 = (pixels[(p+1)*4+3]+8)/17;
+        out[p/2] = static_cast<unsigned char>(a0 | (a1<<4));
+    }
+}
+
+void encodeBlock(BlockFormat format, const unsigned char* pixels, int quality, unsigned char* out)
+{
+    switch(format)
+    {
+        case(BLOCK_DXT1):   encodeColorBlock(pixels, false, quality, out); break;
+        case(BLOCK_DXT1a):  encodeColorBlock(pixels, true, quality, out); break;
+        case(BLOCK_DXT3):   encodeExplicitAlphaBlock(pixels, out); encodeColorBlock(pixels, false, quality, out+8); break;
+        case(BLOCK_DXT5):   encodeAlphaBlock(pixels+3, 4, quality, out); encodeColorBlock(pixels, false, quality, out+8); break;
+        case(BLOCK_RGTC1):  encodeAlphaBlock(pixels, 4, quality, out); break;
+        case(BLOCK_RGTC2):  encodeAlphaBlock(pixels, 4, quality, out); encodeAlphaBlock(pixels+1, 4, quality, out+8); break;
+    }
+}
+
+// expand a row of unsigned byte pixels to RGBA, luminance is replicated to RGB so that it compresses into the red channel of RGTC.
+void expandRowToRGBA(GLenum pixelFormat, const unsigned char* src, unsigned char* dest, int width)
+{
+    for(int i=0; i<width; ++i, dest+=4)
+    {
+        switch(pixelFormat)
+        {
+            case(GL_RGBA):              dest[0]=src[0]; dest[1]=src[1]; dest[2]=src[2]; dest[3]=src[3]; src+=4; break;
+            case(GL_BGRA):              dest[0]=src[2]; dest[1]=src[1]; dest[2]=src[0]; dest[3]=src[3]; src+=4; break;
+            case(GL_RGB):               dest[0]=src[0]; dest[1]=src[1]; dest[2]=src[2]; dest[3]=255; src+=3; break;
+            case(GL_BGR):               dest[0]=src[2]; dest[1]=src[1]; dest[2]=src[0]; dest[3]=255; src+=3; break;
+            case(GL_RG):                dest[0]=src[0]; dest[1]=src[1]; dest[2]=0; dest[3]=255; src+=2; break;
+            case(GL_LUMINANCE_ALPHA):   dest[0]=dest[1]=dest[2]=src[0]; dest[3]=src[1]; src+=2; break;
+            case(GL_ALPHA):             dest[0]=dest[1]=dest[2]=255; dest[3]=src[0]; src+=1; break;
+            case(GL_INTENSITY):         dest[0]=dest[1]=dest[2]=dest[3]=src[0]; src+=1; break;
+            case(GL_RED):               dest[0]=src[0]; dest[1]=dest[2]=0; dest[3]=255; src+=1; break;
+            default:                    dest[0]=dest[1]=dest[2]=src[0]; dest[3]=255; src+=1; break;
+        }
+    }
+}
+
+struct CompressLevelOperation
+{
+    BlockFormat             format;
+    int                     quality;
+    int                     width;
+    int                     height;
+    const unsigned char*    rgba;
+    unsigned char*          out;
+
+    void compressBlockRows(int begin, int end) const
+    {
+        unsigned int blockSize = blockSizeInBytes(format);
+        int numBlocksWide = (width+3)/4;
+        unsigned char block[16*4];
+        for(int by=begin; by<end; ++by)
+        {
+            unsigned char* blockOut = out + by*numBlocksWide*blockSize;
+            for(int bx=0; bx<numBlocksWide; ++bx, blockOut+=blockSize)
+            {
+                // pixels beyond the edge of the image repeat the last row and column.
+                for(int y=0; y<4; ++y)
+                {
+                    int sy = osg::minimum(by*4+y, height-1);
+                    for(int x=0; x<4; ++x)
+                    {
+                        int sx = osg::minimum(bx*4+x, width-1);
+                        memcpy(block + (y*4+x)*4, rgba + (sy*width+sx)*4, 4);
+                    }
+                }
+                encodeBlock(format, block, quality, blockOut);
+            }
+        }
+    }
+};
+
+class CompressThread : public OpenThreads::Thread
+{
+    public:
+
+        CompressThread(const CompressLevelOperation& operation, int begin, int end):
+            _operation(operation),
+            _begin(begin),
+            _end(end) {}
+
+        virtual void run() { _operation.compressBlockRows(_begin, _end); }
+
+    protected:
+
+        const CompressLevelOperation&   _operation;
+        int                             _begin;
+        int                             _end;
+};
+
+void compressLevel(const CompressLevelOperation& operation)
+{
+    int numBlockRows = (operation.height+3)/4;
+    unsigned int numThreads = static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    // small levels aren't worth the cost of starting threads.
+    if (numThreads<=1 || operation.width*operation.height<128*128)
+    {
+        operation.compressBlockRows(0, numBlockRows);
+        return;
+    }
+
+    std::vector<CompressThread*> threads;
+    int rowsPerThread = (numBlockRows+numThreads-1)/numThreads;
+    int begin = 0;
+    for(unsigned int i=0; i<numThreads-1 && begin<numBlockRows; ++i, begin+=rowsPerThread)
+    {
+        CompressThread* thread = new CompressThread(operation, begin, osg::minimum(begin+rowsPerThread, numBlockRows));
+        if (thread->start()==0) threads.push_back(thread);
+        else { thread->run(); delete thread; }
+    }
+
+    operation.compressBlockRows(begin, numBlockRows);
+
+    for(std::vector<CompressThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+}
+
+class DXTCImageProcessor : public osgDB::ImageProcessor
+{
+public:
+
+    virtual void compress(osg::Image& image, osg::Texture::InternalFormatMode compressedFormat, bool generateMipMap, bool resizeToPowerOfTwo, CompressionMethod method, CompressionQuality quality);
+    virtual void generateMipMap(osg::Image& image, bool resizeToPowerOfTwo, CompressionMethod method);
+
+protected:
+
+    bool prepareImage(osg::Image& image, bool generateMipMap, bool resizeToPowerOfTwo);
+};
+
+bool DXTCImageProcessor::prepareImage(osg::Image& image, bool generateMipMap, bool resizeToPowerOfTwo)
+{
+    if (!image.data() || image.r()!=1 || image.isCompressed() || !osg::isResampleSupported(image.getPixelFormat(), image.getDataType()))
+    {
+        OSG_WARN<<"DXTCImageProcessor: image "<<image.getFileName()<<" is not a supported uncompressed 2D image."<<std::endl;
+        return false;
+    }
+
+    if (resizeToPowerOfTwo)
+    {
+        int s = osg::Image::computeNearestPowerOfTwo(image.s());
+        int t = osg::Image::computeNearestPowerOfTwo(image.t());
+        if (s!=image.s() || t!=image.t()) image.scaleImage(s, t, 1);
+    }
+
+    if (generateMipMap && !image.isMipmap())
+    {
+        osg::generateMipmaps(&image);
+    }
+
+    return true;
+}
+
+void DXTCImageProcessor::compress(osg::Image& image, osg::Texture::InternalFormatMode compressedFormat, bool generateMipMap, bool resizeToPowerOfTwo, CompressionMethod /*method*/, CompressionQuality quality)
+{
+    BlockFormat format;
+    GLenum pixelFormat;
+    bool hasAlpha = image.getPixelFormat()==GL_RGBA || image.getPixelFormat()==GL_BGRA ||
+                    image.getPixelFormat()==GL_LUMINANCE_ALPHA || image.getPixelFormat()==GL_ALPHA || image.getPixelFormat()==GL_INTENSITY;
+    switch (compressedFormat)
+    {
+    case osg::Texture::USE_S3TC_DXT1_COMPRESSION:
+        format = hasAlpha ? BLOCK_DXT1a : BLOCK_DXT1;
+        pixelFormat = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        break;
+    case osg::Texture::USE_S3TC_DXT1c_COMPRESSION:
+        format = BLOCK_DXT1;
+        pixelFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        break;
+    case osg::Texture::USE_S3TC_DXT1a_COMPRESSION:
+        format = BLOCK_DXT1a;
+        pixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        break;
+    case osg::Texture::USE_S3TC_DXT3_COMPRESSION:
+        format = BLOCK_DXT3;
+        pixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        break;
+    case osg::Texture::USE_S3TC_DXT5_COMPRESSION:
+        format = BLOCK_DXT5;
+        pixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        break;
+    case osg::Texture::USE_RGTC1_COMPRESSION:
+        format = BLOCK_RGTC1;
+        pixelFormat = GL_COMPRESSED_RED_RGTC1_EXT;
+        break;
+    case osg::Texture::USE_RGTC2_COMPRESSION:
+        format = BLOCK_RGTC2;
+        pixelFormat = GL_COMPRESSED_RED_GREEN_RGTC2_EXT;
+        break;
+    default:
+        OSG_WARN<<" Invalid or not supported compress format"<<std::endl;
+        return;
+    }
+
+    if (!prepareImage(image, generateMipMap, resizeToPowerOfTwo)) return;
+
+    int width = image.s();
+    int height = image.t();
+    unsigned int numLevels = image.getNumMipmapLevels();
+    unsigned int blockSize = blockSizeInBytes(format);
+
+    osg::Image::MipmapDataType mipmapOffsets;
+    unsigned int totalSize = 0;
+    for(unsigned int level=0; level<numLevels; ++level)
+    {
+        int w = osg::maximum(width>>level, 1);
+        int h = osg::maximum(height>>level, 1);
+        if (level>0) mipmapOffsets.push_back(totalSize);
+        totalSize += ((w+3)/4)*((h+3)/4)*blockSize;
+    }
+
+    unsigned char* data = new unsigned char[totalSize];
+
+    GLenum sourcePixelFormat = image.getPixelFormat();
+    GLenum sourceDataType = image.getDataType();
+    std::vector<unsigned char> bytes;
+    std::vector<unsigned char> rgba;
+    for(unsigned int level=0; level<numLevels; ++level)
+    {
+        int w = osg::maximum(width>>level, 1);
+        int h = osg::maximum(height>>level, 1);
+
+        // mipmap levels are tightly packed, only the top level may have a row length.
+        const unsigned char* levelData = image.getMipmapData(level);
+        unsigned int rowStep = level==0 ? image.getRowStepInBytes() : osg::Image::computeRowWidthInBytes(w, sourcePixelFormat, sourceDataType, image.getPacking());
+
+        if (sourceDataType!=GL_UNSIGNED_BYTE)
+        {
+            unsigned int byteRowStep = w*osg::Image::computeNumComponents(sourcePixelFormat);
+            bytes.resize(byteRowStep*h);
+            osg::resampleImageData(sourcePixelFormat, w, h, sourceDataType, levelData, rowStep,
+                                   w, h, GL_UNSIGNED_BYTE, &bytes[0], byteRowStep);
+            levelData = &bytes[0];
+            rowStep = byteRowStep;
+        }
+
+        rgba.resize(w*h*4);
+        for(int j=0; j<h; ++j)
+        {
+            expandRowToRGBA(sourcePixelFormat, levelData + j*rowStep, &rgba[j*w*4], w);
+        }
+
+        CompressLevelOperation operation;
+        operation.format = format;
+        operation.quality = quality;
+        operation.width = w;
+        operation.height = h;
+        operation.rgba = &rgba[0];
+        operation.out = data + (level>0 ? mipmapOffsets[level-1] : 0);
+        compressLevel(operation);
+    }
+
+    image.setImage(width, height, 1, pixelFormat, pixelFormat, GL_UNSIGNED_BYTE, data, osg::Image::USE_NEW_DELETE);
+    image.setMipmapLevels(mipmapOffsets);
+}
+
+void DXTCImageProcessor::generateMipMap(osg::Image& image, bool resizeToPowerOfTwo, CompressionMethod /*method*/)
+{
+    prepareImage(image, true, resizeToPowerOfTwo);
+}
+
+REGISTER_OSGIMAGEPROCESSOR(dxtc, DXTCImageProcessor)
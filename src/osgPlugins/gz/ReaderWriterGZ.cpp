@@ -16,6 +16,7 @@
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <osgDB/Registry>
+#include <osgDB/ObjectWrapper>
 
 #include <iostream>
 #include <sstream>
@@ -104,6 +105,20 @@ class ReaderWriterGZ : public osgDB::ReaderWriter
         WriteResult writeFile(ObjectType objectType, const osg::Object* object, const std::string& fullFileName, const osgDB::ReaderWriter::Options* options) const;
 
 
+        bool useBlocks(const osgDB::ReaderWriter::Options* options) const
+        {
+            if (options)
+            {
+                std::istringstream iss(options->getOptionString());
+                std::string opt;
+                while (iss >> opt)
+                {
+                    if (opt=="BGZF") return true;
+                }
+            }
+            return false;
+        }
+
         bool read(std::istream& fin, std::string& destination) const;
         bool write(std::ostream& fout, const std::string& source) const;
 
@@ -117,6 +132,8 @@ ReaderWriterGZ::ReaderWriterGZ()
     supportsExtension("osgz","Compressed .osg file extension.");
     supportsExtension("ivez","Compressed .ive file extension.");
     supportsExtension("gz","Compressed file extension.");
+
+    supportsOption("BGZF","Write blocks of at most 64k that are compressed and decompressed in parallel, as used by the osgDB bgzf compressor.");
 }
 
 ReaderWriterGZ::~ReaderWriterGZ()
@@ -177,8 +194,17 @@ osgDB::ReaderWriter::ReadResult ReaderWriterGZ::readFile(ObjectType objectType,
     if (!fin) return ReadResult::ERROR_IN_READING_FILE;
 
 
+    // the osgDB zlib compressor handles block compressed files, inflating their blocks in parallel, as well as single stream files.
     std::string dest;
-    read(fin, dest);
+    osgDB::BaseCompressor* compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+    if (compressor)
+    {
+        if (!compressor->decompress(fin, dest)) return ReadResult::ERROR_IN_READING_FILE;
+    }
+    else
+    {
+        read(fin, dest);
+    }
 
     std::stringstream strstream(dest);
 
@@ -229,7 +255,15 @@ osgDB::ReaderWriter::WriteResult ReaderWriterGZ::writeFile(ObjectType objectType
 
     osgDB::ofstream fout(fullFileName.c_str(), std::ios::binary|std::ios::out);
 
-    write(fout,strstream.str());
+    osgDB::BaseCompressor* compressor = useBlocks(options) ? osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("bgzf") : 0;
+    if (compressor)
+    {
+        compressor->compress(fout, strstream.str());
+    }
+    else
+    {
+        write(fout,strstream.str());
+    }
 
     return writeResult;
 }
@@ -68,13 +68,6 @@ extern "C"
 namespace osgDBJPEG
 {
 
-#define ERR_NO_ERROR 0
-#define ERR_OPEN     1
-#define ERR_MEM      2
-#define ERR_JPEGLIB  3
-
-static int jpegerror = ERR_NO_ERROR;
-
 /* Some versions of jmorecfg.h define boolean, some don't...
    Those that do also define HAVE_BOOLEAN, so we can guard using that. */
 #ifndef HAVE_BOOLEAN
@@ -390,25 +383,6 @@ void jpeg_stream_dest (j_compress_ptr cinfo, std::ostream * outfile)
 
 /* END OF READ/WRITE STREAM CODE */
 
-int
-simage_jpeg_error(char * buffer, int buflen)
-{
-    switch (jpegerror)
-    {
-        case ERR_OPEN:
-            strncpy(buffer, "JPEG loader: Error opening file", buflen);
-            break;
-        case ERR_MEM:
-            strncpy(buffer, "JPEG loader: Out of memory error", buflen);
-            break;
-        case ERR_JPEGLIB:
-            strncpy(buffer, "JPEG loader: Illegal jpeg file", buflen);
-            break;
-    }
-    return jpegerror;
-}
-
-
 struct my_error_mgr
 {
     struct jpeg_error_mgr pub;   /* "public" fields */
@@ -459,23 +433,13 @@ int headerlen)
 }
 
 
-static unsigned char*
-copyScanline(unsigned char *currPtr, unsigned char *from, int cnt)
-{
-    memcpy((void*)currPtr, (void*)from, cnt);
-    currPtr -= cnt;
-    return currPtr;
-}
-
 unsigned char *
 simage_jpeg_load(std::istream& fin,
+int scaleDenominator,
 int *width_ret,
 int *height_ret,
 int *numComponents_ret)
 {
-    int width;
-    int height;
-    unsigned char *currPtr;
     int format;
     /* This struct contains the JPEG decompression parameters and pointers to
      * working space (which is allocated as needed by the JPEG library).
@@ -486,24 +450,9 @@ int *numComponents_ret)
      * struct, to avoid dangling-pointer problems.
      */
     struct my_error_mgr jerr;
-    /* More stuff */
-    //FILE * infile;               /* source file */
-    JSAMPARRAY rowbuffer;        /* Output row buffer */
-    int row_stride;              /* physical row width in output buffer */
-
-    jpegerror = ERR_NO_ERROR;
-
-    /* In this example we want to open the input file before doing anything else,
-     * so that the setjmp() error recovery below can assume the file is open.
-     * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-     * requires it in order to read binary files.
-     */
 
-    /*if ((infile = fopen(filename, "rb")) == NULL)
-    {
-        jpegerror = ERR_OPEN;
-        return NULL;
-    }*/
+    /* The buffer is assigned after setjmp() so must be volatile to be valid when an error returns to it. */
+    unsigned char * volatile buffer = NULL;
 
     /* Step 1: allocate and initialize JPEG decompression object */
 
@@ -515,24 +464,18 @@ int *numComponents_ret)
     if (setjmp(jerr.setjmp_buffer))
     {
         /* If we get here, the JPEG code has signaled an error.
-         * We need to clean up the JPEG object, close the input file, and return.
+         * We need to clean up the JPEG object and return.
          */
-        jpegerror = ERR_JPEGLIB;
         jpeg_destroy_decompress(&cinfo);
-        //fclose(infile);
-        //if (buffer) delete [] buffer;
+        delete [] buffer;
         return NULL;
     }
 
-    // used to be before setjump above, but have moved to after to avoid compile warnings.
-    unsigned char *buffer = NULL;
-
     /* Now we can initialize the JPEG decompression object. */
     jpeg_create_decompress(&cinfo);
 
     /* Step 2: specify data source (eg, a file) */
 
-    //jpeg_stdio_src(&cinfo, infile);
     jpeg_istream_src(&cinfo,&fin);
 
     /* Step 3: read file parameters with jpeg_read_header() */
@@ -545,11 +488,15 @@ int *numComponents_ret)
      */
 
     /* Step 4: set parameters for decompression */
-    /* In this example, we don't need to change any of the defaults set by
-     * jpeg_read_header(), so we do nothing here.
-     */
 
-    /* Step 5: Start decompressor */
+    /* Reduced resolution decoding is done by the inverse DCT so is much cheaper than decoding the
+     * full image and scaling it down, libjpeg supports scaling by 1/2, 1/4 and 1/8. */
+    if (scaleDenominator>1)
+    {
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = scaleDenominator>=8 ? 8 : (scaleDenominator>=4 ? 4 : 2);
+    }
+
     if (cinfo.jpeg_color_space == JCS_GRAYSCALE)
     {
         format = 1;
@@ -561,83 +508,52 @@ int *numComponents_ret)
         cinfo.out_color_space = JCS_RGB;
     }
 
+    /* Step 5: Start decompressor */
+
     (void) jpeg_start_decompress(&cinfo);
     /* We can ignore the return value since suspension is not possible
      * with the stdio data source.
      */
 
-    /* We may need to do some setup of our own at this point before reading
-     * the data.  After jpeg_start_decompress() we have the correct scaled
-     * output image dimensions available, as well as the output colormap
-     * if we asked for color quantization.
-     * In this example, we need to make an output work buffer of the right size.
-     */
-    /* JSAMPLEs per row in output buffer */
-    row_stride = cinfo.output_width * cinfo.output_components;
-    /* Make a one-row-high sample array that will go away when done with image */
-    rowbuffer = (*cinfo.mem->alloc_sarray)
-        ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
-    width = cinfo.output_width;
-    height = cinfo.output_height;
-    buffer = currPtr = new unsigned char [width*height*cinfo.output_components];
-
-    /* Step 6: while (scan lines remain to be read) */
-    /*           jpeg_read_scanlines(...); */
+    /* After jpeg_start_decompress() we have the correct scaled output image dimensions available. */
+    int width = cinfo.output_width;
+    int height = cinfo.output_height;
+    int row_stride = width * cinfo.output_components;
 
-    /* Here we use the library's state variable cinfo.output_scanline as the
-     * loop counter, so that we don't have to keep track ourselves.
-     */
+    buffer = new unsigned char [row_stride*height];
 
-    /* flip image upside down */
-    if (buffer)
+    /* Decode straight into the final image, the row pointers are in reverse order
+     * so that the image ends up bottom to top as osg::Image expects. */
+    JSAMPARRAY rows = (JSAMPARRAY)(*cinfo.mem->alloc_small)
+        ((j_common_ptr) &cinfo, JPOOL_IMAGE, height*sizeof(JSAMPROW));
+    for(int i=0; i<height; ++i)
     {
-        currPtr = buffer + row_stride * (cinfo.output_height-1);
+        rows[i] = buffer + row_stride*(height-1-i);
+    }
 
-        while (cinfo.output_scanline < cinfo.output_height)
-        {
-            /* jpeg_read_scanlines expects an array of pointers to scanlines.
-             * Here the array is only one element long, but you could ask for
-             * more than one scanline at a time if that's more convenient.
-             */
-            (void) jpeg_read_scanlines(&cinfo, rowbuffer, 1);
-            /* Assume put_scanline_someplace wants a pointer and sample count. */
-            currPtr = copyScanline(currPtr, rowbuffer[0], row_stride);
-        }
+    /* Step 6: while (scan lines remain to be read) */
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        (void) jpeg_read_scanlines(&cinfo, rows + cinfo.output_scanline, cinfo.output_height - cinfo.output_scanline);
     }
+
     /* Step 7: Finish decompression */
 
     (void) jpeg_finish_decompress(&cinfo);
-    /* We can ignore the return value since suspension is not possible
-     * with the stdio data source.
-     */
 
     /* Step 8: Release JPEG decompression object */
 
     /* This is an important step since it will release a good deal of memory. */
     jpeg_destroy_decompress(&cinfo);
 
-    /* After finish_decompress, we can close the input file.
-     * Here we postpone it until after no more JPEG errors are possible,
-     * so as to simplify the setjmp error logic above.  (Actually, I don't
-     * think that jpeg_destroy can do an error exit, but why assume anything...)
-     */
-    //fclose(infile);
-
     /* At this point you may want to check to see whether any corrupt-data
      * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
      */
 
-    /* And we're done! */
-    if (buffer)
-    {
-        *width_ret = width;
-        *height_ret = height;
-        *numComponents_ret = format;
-    }
-    else
-    {
-        jpegerror = ERR_MEM;
-    }
+    *width_ret = width;
+    *height_ret = height;
+    *numComponents_ret = format;
+
     return buffer;
 }
 } // namespace osgDBJPEG
@@ -794,6 +710,26 @@ class ReaderWriterJPEG : public osgDB::ReaderWriter
             /* And we're done! */
             return WriteResult::FILE_SAVED;
         }
+        int getScaleDenominator(const osgDB::ReaderWriter::Options *options) const
+        {
+            if (options)
+            {
+                std::istringstream iss(options->getOptionString());
+                std::string opt;
+                while (iss >> opt)
+                {
+                    if (opt=="JPEG_SCALE_DENOMINATOR")
+                    {
+                        int denominator = 1;
+                        iss >> denominator;
+                        return denominator;
+                    }
+                }
+            }
+
+            return 1;
+        }
+
         int getQuality(const osgDB::ReaderWriter::Options *options) const {
             if(options) {
                 std::istringstream iss(options->getOptionString());
@@ -815,18 +751,21 @@ class ReaderWriterJPEG : public osgDB::ReaderWriter
         {
             supportsExtension("jpeg","JPEG image format");
             supportsExtension("jpg","JPEG image format");
+
+            supportsOption("JPEG_QUALITY <quality>","Quality of written images, from 0 to 100");
+            supportsOption("JPEG_SCALE_DENOMINATOR <denominator>","Read images at 1/2, 1/4 or 1/8 of their full resolution");
         }
 
         virtual const char* className() const { return "JPEG Image Reader/Writer"; }
 
-        ReadResult readJPGStream(std::istream& fin) const
+        ReadResult readJPGStream(std::istream& fin, const osgDB::ReaderWriter::Options* options) const
         {
             unsigned char *imageData = NULL;
             int width_ret;
             int height_ret;
             int numComponents_ret;
 
-            imageData = osgDBJPEG::simage_jpeg_load(fin,&width_ret,&height_ret,&numComponents_ret);
+            imageData = osgDBJPEG::simage_jpeg_load(fin,getScaleDenominator(options),&width_ret,&height_ret,&numComponents_ret);
 
             if (imageData==NULL) return ReadResult::ERROR_IN_READING_FILE;
 
@@ -870,9 +809,9 @@ class ReaderWriterJPEG : public osgDB::ReaderWriter
             return readImage(file, options);
         }
 
-        virtual ReadResult readImage(std::istream& fin,const osgDB::ReaderWriter::Options* =NULL) const
+        virtual ReadResult readImage(std::istream& fin,const osgDB::ReaderWriter::Options* options =NULL) const
         {
-            return readJPGStream(fin);
+            return readJPGStream(fin, options);
         }
 
         virtual ReadResult readImage(const std::string& file, const osgDB::ReaderWriter::Options* options) const
@@ -885,7 +824,7 @@ class ReaderWriterJPEG : public osgDB::ReaderWriter
 
             osgDB::ifstream istream(fileName.c_str(), std::ios::in | std::ios::binary);
             if(!istream) return ReadResult::ERROR_IN_READING_FILE;
-            ReadResult rr = readJPGStream(istream);
+            ReadResult rr = readJPGStream(istream, options);
             if(rr.validImage()) rr.getImage()->setFileName(file);
             return rr;
         }
@@ -35,11 +35,13 @@
 #include <osg/Texture2D>
 #include <osg/TexGen>
 #include <osg/TexMat>
+#include <osg/Timer>
 
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <osgDB/MappedFile>
 
 #include <osgUtil/TriStripVisitor>
 #include <osgUtil/SmoothingVisitor>
@@ -861,9 +863,11 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(const std::string& fil
     if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
 
 
-    osgDB::ifstream fin(fileName.c_str());
-    if (fin)
+    // the file is mapped rather than streamed so that it can be parsed in place by several threads.
+    osgDB::MappedFile mappedFile(fileName);
+    if (mappedFile.valid())
     {
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
 
         // code for setting up the database path so that internally referenced file are searched for on relative paths.
         osg::ref_ptr<Options> local_opt = options ? static_cast<Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new Options;
@@ -871,11 +875,14 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(const std::string& fil
 
         obj::Model model;
         model.setDatabasePath(osgDB::getFilePath(fileName.c_str()));
-        model.readOBJ(fin, local_opt.get());
+        model.readOBJ(mappedFile.begin(), mappedFile.end(), local_opt.get());
 
         ObjOptionsStruct localOptions = parseOptions(options);
 
         osg::Node* node = convertModelToSceneGraph(model, localOptions, options);
+
+        OSG_INFO<<"ReaderWriterOBJ::readNode("<<fileName<<") read in "<<osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick())<<"ms"<<std::endl;
+
         return node;
     }
 
@@ -20,11 +20,15 @@
 #include "obj.h"
 
 #include <osg/Notify>
+#include <osg/Math>
+
+#include <OpenThreads/Thread>
 
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 
 #include <string.h>
+#include <limits.h>
 
 using namespace obj;
 
@@ -514,234 +518,630 @@ std::string trim(const std::string& s)
   return std::string(s, b, e - b + 1);
 }
 
-bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options)
+namespace
 {
-    OSG_INFO<<"Reading OBJ file"<<std::endl;
 
-    const int LINE_SIZE = 4096;
-    char line[LINE_SIZE];
-    float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
+/**********************************************************************
+ *
+ * Threading, each operation is split into ranges that are processed
+ * in parallel, the calling thread processes the last range itself.
+ *
+ **********************************************************************/
 
-    while (fin)
+struct RangeOperation
+{
+    virtual ~RangeOperation() {}
+    virtual void processRange(unsigned int i) = 0;
+};
+
+class RangeThread : public OpenThreads::Thread
+{
+public:
+    RangeThread(RangeOperation& operation, unsigned int range):
+        _operation(operation),
+        _range(range) {}
+
+    virtual void run() { _operation.processRange(_range); }
+
+protected:
+    RangeOperation& _operation;
+    unsigned int    _range;
+};
+
+// number of ranges to split work into, small amounts of work aren't worth the cost of starting threads.
+unsigned int getNumRanges(size_t workSize, size_t minWorkPerRange)
+{
+    size_t numRanges = osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
+    numRanges = osg::minimum(numRanges, workSize/minWorkPerRange);
+    return numRanges>0 ? static_cast<unsigned int>(numRanges) : 1u;
+}
+
+void runRangeOperation(RangeOperation& operation, unsigned int numRanges)
+{
+    std::vector<RangeThread*> threads;
+    for (unsigned int i = 0; i + 1 < numRanges; ++i)
     {
-        readline(fin,line,LINE_SIZE);
-        if (line[0]=='#' || line[0]=='$')
+        RangeThread* thread = new RangeThread(operation, i);
+        if (thread->start() == 0) threads.push_back(thread);
+        else { thread->run(); delete thread; }
+    }
+
+    operation.processRange(numRanges - 1);
+
+    for (std::vector<RangeThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+/**********************************************************************
+ *
+ * Chunked parsing of OBJ data held in memory. The data is split at line
+ * boundaries into chunks that are tokenized in parallel, negative indices
+ * and state changes are recorded relative to the chunk so that the chunks
+ * can be merged in order to give the same Model as a serial read.
+ *
+ **********************************************************************/
+
+// files smaller than this are parsed in a single chunk.
+const size_t MinChunkSize = 1024*1024;
+
+// marks a texcoord or normal index missing from a face vertex.
+const int NoIndex = INT_MIN;
+
+// return the start of the first line at or after ptr, lines continued with a trailing backslash are kept together.
+const char* findLineStart(const char* begin, const char* end, const char* ptr)
+{
+    if (ptr<=begin) return begin;
+
+    for(--ptr; ptr<end; ++ptr)
+    {
+        ptr = static_cast<const char*>(memchr(ptr, '\n', end-ptr));
+        if (!ptr) return end;
+
+        // as in Model::readline(), a continuation swallows a dos line ending or any number of unix line endings.
+        const char* prev = ptr;
+        if (prev>begin && *(prev-1)=='\r') --prev;
+        else while (prev>begin && *(prev-1)=='\n') --prev;
+
+        if (prev>begin && *(prev-1)=='\\') continue;
+
+        return ptr+1;
+    }
+    return end;
+}
+
+// read a line from [ptr, end) into line, following the same rules as Model::readline() but without a limit on the line length.
+const char* readLine(const char* ptr, const char* end, std::string& line)
+{
+    line.clear();
+
+    bool eatWhiteSpaceAtStart = true;
+    bool skipNewline = false;
+    while (ptr<end)
+    {
+        const char* segment = ptr;
+        while (ptr<end && *ptr!='\n' && *ptr!='\r' && *ptr!='\\') ++ptr;
+
+        if (segment<ptr) skipNewline = false;
+
+        if (eatWhiteSpaceAtStart)
         {
-            // comment line
-            // OSG_NOTICE <<"Comment: "<<line<<std::endl;
+            while (segment<ptr && (*segment==' ' || *segment=='\t')) ++segment;
+            if (segment<ptr) eatWhiteSpaceAtStart = false;
         }
-        else if (strlen(line)>0)
+        line.append(segment, ptr);
+
+        if (ptr==end) break;
+
+        char c = *ptr++;
+        if (c=='\\')
         {
-            if (strncmp(line,"v ",2)==0)
+            if (ptr<end && (*ptr=='\r' || *ptr=='\n'))
             {
-                unsigned int fieldsRead = sscanf(line+2,"%f %f %f %f", &x, &y, &z, &w);
-
-                if (fieldsRead==1) vertices.push_back(osg::Vec3(x,0.0f,0.0f));
-                else if (fieldsRead==2) vertices.push_back(osg::Vec3(x,y,0.0f));
-                else if (fieldsRead==3) vertices.push_back(osg::Vec3(x,y,z));
-                else if (fieldsRead>=4) vertices.push_back(osg::Vec3(x/w,y/w,z/w));
+                skipNewline = true;
             }
-            else if (strncmp(line,"vn ",3)==0)
+            else
             {
-                unsigned int fieldsRead = sscanf(line+3,"%f %f %f", &x, &y, &z);
-
-                if (fieldsRead==1) normals.push_back(osg::Vec3(x,0.0f,0.0f));
-                else if (fieldsRead==2) normals.push_back(osg::Vec3(x,y,0.0f));
-                else if (fieldsRead==3) normals.push_back(osg::Vec3(x,y,z));
+                line.push_back(c);
+                eatWhiteSpaceAtStart = false;
+                skipNewline = false;
             }
-            else if (strncmp(line,"vt ",3)==0)
-            {
-                unsigned int fieldsRead = sscanf(line+3,"%f %f %f", &x, &y, &z);
+        }
+        else if (c=='\r')
+        {
+            if (ptr<end && *ptr=='\n') ++ptr;
+            if (!skipNewline) break;
 
-                if (fieldsRead==1) texcoords.push_back(osg::Vec2(x,0.0f));
-                else if (fieldsRead==2) texcoords.push_back(osg::Vec2(x,y));
-                else if (fieldsRead==3) texcoords.push_back(osg::Vec2(x,y));
-            }
-            else if (strncmp(line,"l ",2)==0 ||
-                     strncmp(line,"p ",2)==0 ||
-                     strncmp(line,"f ",2)==0)
-            {
-                char* ptr = line+2;
+            skipNewline = false;
+            line.push_back(' ');
+        }
+        else
+        {
+            if (!skipNewline) break;
 
-                Element* element = new Element( (line[0]=='p') ? Element::POINTS :
-                                                (line[0]=='l') ? Element::POLYLINE :
-                                                Element::POLYGON );
+            line.push_back(' ');
+        }
+    }
 
-                // OSG_NOTICE<<"face"<<ptr<<std::endl;
+    // strip trailing spaces, then change tabs to spaces
+    std::string::size_type last = line.find_last_not_of(' ');
+    line.erase(last==std::string::npos ? 0 : last+1);
 
-                int vi=0, ti=0, ni=0;
-                while(*ptr!=0)
-                {
-                    // skip white space
-                    while(*ptr==' ') ++ptr;
+    for(std::string::iterator itr = line.begin(); itr != line.end(); ++itr)
+    {
+        if (*itr=='\t') *itr = ' ';
+    }
 
-                    if (sscanf(ptr, "%d/%d/%d", &vi, &ti, &ni) == 3)
-                    {
-                        // OSG_NOTICE<<"   vi="<<vi<<"/ti="<<ti<<"/ni="<<ni<<std::endl;
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        element->normalIndices.push_back(remapNormalIndex(ni));
-                        element->texCoordIndices.push_back(remapTexCoordIndex(ti));
-                    }
-                    else if (sscanf(ptr, "%d//%d", &vi, &ni) == 2)
-                    {
-                        // OSG_NOTICE<<"   vi="<<vi<<"//ni="<<ni<<std::endl;
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        element->normalIndices.push_back(remapNormalIndex(ni));
-                    }
-                    else if (sscanf(ptr, "%d/%d", &vi, &ti) == 2)
-                    {
-                        // OSG_NOTICE<<"   vi="<<vi<<"/ti="<<ti<<std::endl;
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        element->texCoordIndices.push_back(remapTexCoordIndex(ti));
-                    }
-                    else if (sscanf(ptr, "%d", &vi) == 1)
-                    {
-                        // OSG_NOTICE<<"   vi="<<vi<<std::endl;
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                    }
+    return ptr;
+}
 
-                    // skip to white space or end of line
-                    while(*ptr!=' ' && *ptr!=0) ++ptr;
+// read up to maxValues floats separated by white space, returning the number read.
+unsigned int readFloats(const char* ptr, const char* end, float* values, unsigned int maxValues)
+{
+    unsigned int numRead = 0;
+    while (numRead<maxValues)
+    {
+        while (ptr<end && *ptr==' ') ++ptr;
 
-                }
+        const char* next = osg::asciiToFloat(ptr, end, values[numRead]);
+        if (next==ptr) break;
 
-                if (!element->normalIndices.empty() && element->normalIndices.size() != element->vertexIndices.size())
-                {
-                    element->normalIndices.clear();
-                }
+        ptr = next;
+        ++numRead;
+    }
+    return numRead;
+}
 
-                if (!element->texCoordIndices.empty() && element->texCoordIndices.size() != element->vertexIndices.size())
-                {
-                    element->texCoordIndices.clear();
-                }
+inline const char* skipSpaces(const char* ptr, const char* end)
+{
+    while (ptr<end && *ptr==' ') ++ptr;
+    return ptr;
+}
 
-                if (!element->vertexIndices.empty())
-                {
-                    Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
-                    if (coordateCombination!=currentElementState.coordinateCombination)
-                    {
-                        currentElementState.coordinateCombination = coordateCombination;
-                        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                    }
-                    addElement(element);
-                }
-                else
-                {
-                    // empty element, don't both adding, just unref to delete it.
-                    element->unref();
-                }
+// read a signed decimal integer, value is left unchanged and ptr returned if there isn't one.
+const char* readIndex(const char* ptr, const char* end, int& value)
+{
+    const char* start = ptr;
 
-            }
-            else if (strncmp(line,"usemtl ",7)==0)
-            {
-                std::string materialName( line+7 );
-                if (currentElementState.materialName != materialName)
-                {
-                    currentElementState.materialName = materialName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strncmp(line,"mtllib ",7)==0)
+    bool negative = false;
+    if (ptr<end && (*ptr=='-' || *ptr=='+'))
+    {
+        negative = (*ptr=='-');
+        ++ptr;
+    }
+
+    if (ptr==end || *ptr<'0' || *ptr>'9') return start;
+
+    int result = 0;
+    for(; ptr<end && *ptr>='0' && *ptr<='9'; ++ptr)
+    {
+        result = result*10 + (*ptr-'0');
+    }
+
+    value = negative ? -result : result;
+    return ptr;
+}
+
+struct ObjChunk
+{
+    // a p, l or f line, the counts of vertex data read before it resolve negative indices.
+    struct Face
+    {
+        Element::DataType   dataType;
+        unsigned int        firstIndex;
+        unsigned int        numIndices;
+        unsigned int        numNormalIndices;
+        unsigned int        numTexCoordIndices;
+        unsigned int        numVerticesBefore;
+        unsigned int        numNormalsBefore;
+        unsigned int        numTexCoordsBefore;
+    };
+
+    // a line changing the state applied to the following faces, applied when the chunks are merged.
+    struct StateChange
+    {
+        enum Type
+        {
+            MATERIAL,
+            MATERIAL_LIBRARY,
+            OBJECT,
+            GROUP,
+            SMOOTHING_GROUP,
+            NOT_HANDLED
+        };
+
+        StateChange(unsigned int face, Type t, const std::string& v, int sg=0):
+            faceIndex(face), type(t), value(v), smoothingGroup(sg) {}
+
+        unsigned int    faceIndex;
+        Type            type;
+        std::string     value;
+        int             smoothingGroup;
+    };
+
+    typedef std::vector<Face> Faces;
+    typedef std::vector<StateChange> StateChanges;
+    typedef std::vector< osg::ref_ptr<Element> > Elements;
+
+    ObjChunk(): begin(0), end(0) {}
+
+    void parse();
+    void parseLine(const std::string& line);
+    void buildElements(unsigned int vertexOffset, unsigned int normalOffset, unsigned int texCoordOffset);
+
+    const char*         begin;
+    const char*         end;
+
+    Model::Vec3Array    vertices;
+    Model::Vec3Array    normals;
+    Model::Vec2Array    texcoords;
+
+    Faces               faces;
+    std::vector<int>    indices;    // vertex, texcoord and normal index for each face vertex
+    StateChanges        stateChanges;
+
+    Elements            elements;   // an element for each face, NULL for empty faces
+};
+
+void ObjChunk::parse()
+{
+    std::string line;
+    const char* ptr = begin;
+    while (ptr<end)
+    {
+        ptr = readLine(ptr, end, line);
+        if (!line.empty() && line[0]!='#' && line[0]!='$') parseLine(line);
+    }
+}
+
+void ObjChunk::parseLine(const std::string& lineString)
+{
+    const char* line = lineString.c_str();
+    const char* lineEnd = line + strlen(line);
+    float v[4];
+
+    if (strncmp(line,"v ",2)==0)
+    {
+        unsigned int fieldsRead = readFloats(line+2, lineEnd, v, 4);
+
+        if (fieldsRead==1) vertices.push_back(osg::Vec3(v[0],0.0f,0.0f));
+        else if (fieldsRead==2) vertices.push_back(osg::Vec3(v[0],v[1],0.0f));
+        else if (fieldsRead==3) vertices.push_back(osg::Vec3(v[0],v[1],v[2]));
+        else if (fieldsRead>=4) vertices.push_back(osg::Vec3(v[0]/v[3],v[1]/v[3],v[2]/v[3]));
+    }
+    else if (strncmp(line,"vn ",3)==0)
+    {
+        unsigned int fieldsRead = readFloats(line+3, lineEnd, v, 3);
+
+        if (fieldsRead==1) normals.push_back(osg::Vec3(v[0],0.0f,0.0f));
+        else if (fieldsRead==2) normals.push_back(osg::Vec3(v[0],v[1],0.0f));
+        else if (fieldsRead==3) normals.push_back(osg::Vec3(v[0],v[1],v[2]));
+    }
+    else if (strncmp(line,"vt ",3)==0)
+    {
+        unsigned int fieldsRead = readFloats(line+3, lineEnd, v, 3);
+
+        if (fieldsRead==1) texcoords.push_back(osg::Vec2(v[0],0.0f));
+        else if (fieldsRead>=2) texcoords.push_back(osg::Vec2(v[0],v[1]));
+    }
+    else if (strncmp(line,"l ",2)==0 ||
+             strncmp(line,"p ",2)==0 ||
+             strncmp(line,"f ",2)==0)
+    {
+        Face face;
+        face.dataType = (line[0]=='p') ? Element::POINTS :
+                        (line[0]=='l') ? Element::POLYLINE :
+                        Element::POLYGON;
+        face.firstIndex = indices.size();
+        face.numIndices = 0;
+        face.numNormalIndices = 0;
+        face.numTexCoordIndices = 0;
+        face.numVerticesBefore = vertices.size();
+        face.numNormalsBefore = normals.size();
+        face.numTexCoordsBefore = texcoords.size();
+
+        // accepts the same vi/ti/ni, vi//ni, vi/ti and vi forms as the sscanf patterns of the serial reader.
+        const char* ptr = line+2;
+        while (ptr<lineEnd)
+        {
+            // skip white space
+            while (ptr<lineEnd && *ptr==' ') ++ptr;
+
+            // like %d, the indices following a slash may be preceded by white space.
+            int vi = 0, ti = NoIndex, ni = NoIndex;
+            const char* next = readIndex(ptr, lineEnd, vi);
+            if (next!=ptr)
             {
-                std::string materialFileName = trim( line+7 );
-                std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
-                if (!fullPathFileName.empty())
+                if (next<lineEnd && *next=='/')
                 {
-                    osgDB::ifstream mfin( fullPathFileName.c_str() );
-                    if (mfin)
+                    ++next;
+                    if (next<lineEnd && *next=='/')
                     {
-                        OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
-                        readMTL(mfin);
+                        readIndex(skipSpaces(next+1, lineEnd), lineEnd, ni);
                     }
                     else
                     {
-                        OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
+                        const char* start = skipSpaces(next, lineEnd);
+                        next = readIndex(start, lineEnd, ti);
+                        if (next!=start && next<lineEnd && *next=='/') readIndex(skipSpaces(next+1, lineEnd), lineEnd, ni);
                     }
                 }
-                else
-                {
-                    OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
-                }
-            }
-            else if (strncmp(line,"o ",2)==0)
-            {
-                std::string objectName(line+2);
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strcmp(line,"o")==0)
-            {
-                std::string objectName(""); // empty name
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strncmp(line,"g ",2)==0)
-            {
-                std::string groupName(line+2);
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+
+                indices.push_back(vi);
+                indices.push_back(ti);
+                indices.push_back(ni);
+
+                ++face.numIndices;
+                if (ni!=NoIndex) ++face.numNormalIndices;
+                if (ti!=NoIndex) ++face.numTexCoordIndices;
             }
-            else if (strcmp(line,"g")==0)
+
+            // skip to white space or end of line
+            while (ptr<lineEnd && *ptr!=' ') ++ptr;
+        }
+
+        faces.push_back(face);
+    }
+    else if (strncmp(line,"usemtl ",7)==0)
+    {
+        stateChanges.push_back(StateChange(faces.size(), StateChange::MATERIAL, line+7));
+    }
+    else if (strncmp(line,"mtllib ",7)==0)
+    {
+        stateChanges.push_back(StateChange(faces.size(), StateChange::MATERIAL_LIBRARY, trim(line+7)));
+    }
+    else if (strncmp(line,"o ",2)==0)
+    {
+        stateChanges.push_back(StateChange(faces.size(), StateChange::OBJECT, line+2));
+    }
+    else if (strcmp(line,"o")==0)
+    {
+        stateChanges.push_back(StateChange(faces.size(), StateChange::OBJECT, "")); // empty name
+    }
+    else if (strncmp(line,"g ",2)==0)
+    {
+        stateChanges.push_back(StateChange(faces.size(), StateChange::GROUP, line+2));
+    }
+    else if (strcmp(line,"g")==0)
+    {
+        stateChanges.push_back(StateChange(faces.size(), StateChange::GROUP, "")); // empty name
+    }
+    else if (strncmp(line,"s ",2)==0)
+    {
+        int smoothingGroup=0;
+        if (strncmp(line+2,"off",3)!=0) readIndex(skipSpaces(line+2, lineEnd), lineEnd, smoothingGroup);
+
+        stateChanges.push_back(StateChange(faces.size(), StateChange::SMOOTHING_GROUP, "", smoothingGroup));
+    }
+    else
+    {
+        // reported when merged so that the messages are in file order.
+        stateChanges.push_back(StateChange(faces.size(), StateChange::NOT_HANDLED, line));
+    }
+}
+
+void ObjChunk::buildElements(unsigned int vertexOffset, unsigned int normalOffset, unsigned int texCoordOffset)
+{
+    elements.resize(faces.size());
+    for(unsigned int f=0; f<faces.size(); ++f)
+    {
+        const Face& face = faces[f];
+        if (face.numIndices==0) continue;
+
+        // as with the serial reader, normals and texcoords are only used if every vertex of the face has one.
+        bool useNormals = face.numNormalIndices==face.numIndices;
+        bool useTexCoords = face.numTexCoordIndices==face.numIndices;
+
+        int numVertices = vertexOffset + face.numVerticesBefore;
+        int numNormals = normalOffset + face.numNormalsBefore;
+        int numTexCoords = texCoordOffset + face.numTexCoordsBefore;
+
+        Element* element = new Element(face.dataType);
+        element->vertexIndices.reserve(face.numIndices);
+        if (useNormals) element->normalIndices.reserve(face.numIndices);
+        if (useTexCoords) element->texCoordIndices.reserve(face.numIndices);
+
+        const int* index = &indices[face.firstIndex];
+        for(unsigned int i=0; i<face.numIndices; ++i, index+=3)
+        {
+            element->vertexIndices.push_back(index[0]<0 ? numVertices+index[0] : index[0]-1);
+            if (useTexCoords) element->texCoordIndices.push_back(index[1]<0 ? numTexCoords+index[1] : index[1]-1);
+            if (useNormals) element->normalIndices.push_back(index[2]<0 ? numNormals+index[2] : index[2]-1);
+        }
+
+        elements[f] = element;
+    }
+
+    // the raw indices are no longer needed
+    std::vector<int>().swap(indices);
+}
+
+struct ParseChunks : public RangeOperation
+{
+    ParseChunks(std::vector<ObjChunk>& chunks): _chunks(chunks) {}
+
+    virtual void processRange(unsigned int i) { _chunks[i].parse(); }
+
+    std::vector<ObjChunk>& _chunks;
+};
+
+struct BuildChunkElements : public RangeOperation
+{
+    struct Offsets
+    {
+        unsigned int vertexOffset;
+        unsigned int normalOffset;
+        unsigned int texCoordOffset;
+    };
+
+    BuildChunkElements(std::vector<ObjChunk>& chunks): _chunks(chunks), _offsets(chunks.size()) {}
+
+    virtual void processRange(unsigned int i)
+    {
+        _chunks[i].buildElements(_offsets[i].vertexOffset, _offsets[i].normalOffset, _offsets[i].texCoordOffset);
+    }
+
+    std::vector<ObjChunk>&  _chunks;
+    std::vector<Offsets>    _offsets;
+};
+
+template<typename T>
+void appendArray(std::vector<T>& array, std::vector<T>& chunkArray)
+{
+    if (array.empty()) array.swap(chunkArray);
+    else array.insert(array.end(), chunkArray.begin(), chunkArray.end());
+
+    std::vector<T>().swap(chunkArray);
+}
+
+}
+
+bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options)
+{
+    // read the whole stream into memory so that it can be parsed in parallel.
+    std::string buffer;
+    char block[65536];
+    while (fin.read(block, sizeof(block)) || fin.gcount()>0)
+    {
+        buffer.append(block, static_cast<size_t>(fin.gcount()));
+    }
+
+    return readOBJ(buffer.data(), buffer.data()+buffer.size(), options);
+}
+
+bool Model::readOBJ(const char* begin, const char* end, const osgDB::ReaderWriter::Options* options)
+{
+    OSG_INFO<<"Reading OBJ file"<<std::endl;
+
+    // split into chunks at line boundaries and tokenize them in parallel.
+    unsigned int numChunks = getNumRanges(end-begin, MinChunkSize);
+
+    std::vector<ObjChunk> chunks(numChunks);
+    for(unsigned int i=0; i<numChunks; ++i)
+    {
+        chunks[i].begin = (i==0) ? begin : chunks[i-1].end;
+        chunks[i].end = (i+1==numChunks) ? end : findLineStart(begin, end, begin + (end-begin)/numChunks*(i+1));
+        if (chunks[i].end<chunks[i].begin) chunks[i].end = chunks[i].begin;
+    }
+
+    ParseChunks parseChunks(chunks);
+    runRangeOperation(parseChunks, numChunks);
+
+    // the data read by the preceding chunks gives the offsets needed to resolve each chunk's indices.
+    BuildChunkElements buildElements(chunks);
+    unsigned int numVertices = vertices.size(), numNormals = normals.size(), numTexCoords = texcoords.size();
+    for(unsigned int i=0; i<numChunks; ++i)
+    {
+        buildElements._offsets[i].vertexOffset = numVertices;
+        buildElements._offsets[i].normalOffset = numNormals;
+        buildElements._offsets[i].texCoordOffset = numTexCoords;
+
+        numVertices += chunks[i].vertices.size();
+        numNormals += chunks[i].normals.size();
+        numTexCoords += chunks[i].texcoords.size();
+    }
+
+    runRangeOperation(buildElements, numChunks);
+
+    // merge the chunks in order, applying the state changes between the faces.
+    vertices.reserve(numVertices);
+    normals.reserve(numNormals);
+    texcoords.reserve(numTexCoords);
+
+    for(std::vector<ObjChunk>::iterator citr = chunks.begin(); citr != chunks.end(); ++citr)
+    {
+        ObjChunk& chunk = *citr;
+
+        appendArray(vertices, chunk.vertices);
+        appendArray(normals, chunk.normals);
+        appendArray(texcoords, chunk.texcoords);
+
+        ObjChunk::StateChanges::const_iterator sitr = chunk.stateChanges.begin();
+        for(unsigned int f=0; f<=chunk.elements.size(); ++f)
+        {
+            for(; sitr != chunk.stateChanges.end() && sitr->faceIndex==f; ++sitr)
             {
-                std::string groupName(""); // empty name
-                if (currentElementState.groupName != groupName)
+                switch(sitr->type)
                 {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+                    case(ObjChunk::StateChange::MATERIAL):
+                        if (currentElementState.materialName != sitr->value)
+                        {
+                            currentElementState.materialName = sitr->value;
+                            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+                        }
+                        break;
+                    case(ObjChunk::StateChange::MATERIAL_LIBRARY):
+                    {
+                        const std::string& materialFileName = sitr->value;
+                        std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
+                        if (!fullPathFileName.empty())
+                        {
+                            osgDB::ifstream mfin( fullPathFileName.c_str() );
+                            if (mfin)
+                            {
+                                OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
+                                readMTL(mfin);
+                            }
+                            else
+                            {
+                                OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
+                            }
+                        }
+                        else
+                        {
+                            OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
+                        }
+                        break;
+                    }
+                    case(ObjChunk::StateChange::OBJECT):
+                        if (currentElementState.objectName != sitr->value)
+                        {
+                            currentElementState.objectName = sitr->value;
+                            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+                        }
+                        break;
+                    case(ObjChunk::StateChange::GROUP):
+                        if (currentElementState.groupName != sitr->value)
+                        {
+                            currentElementState.groupName = sitr->value;
+                            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+                        }
+                        break;
+                    case(ObjChunk::StateChange::SMOOTHING_GROUP):
+                        if (currentElementState.smoothingGroup != sitr->smoothingGroup)
+                        {
+                            currentElementState.smoothingGroup = sitr->smoothingGroup;
+                            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+                        }
+                        break;
+                    case(ObjChunk::StateChange::NOT_HANDLED):
+                        OSG_NOTICE <<"*** line not handled *** :"<<sitr->value<<std::endl;
+                        break;
                 }
             }
-            else if (strncmp(line,"s ",2)==0)
-            {
-                int smoothingGroup=0;
-                if (strncmp(line+2,"off",3)==0) smoothingGroup = 0;
-                else sscanf(line+2,"%d",&smoothingGroup);
 
-                if (currentElementState.smoothingGroup != smoothingGroup)
-                {
-                    currentElementState.smoothingGroup = smoothingGroup;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else
+            if (f==chunk.elements.size()) break;
+
+            Element* element = chunk.elements[f].get();
+            if (!element) continue;
+
+            Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
+            if (coordateCombination!=currentElementState.coordinateCombination)
             {
-                OSG_NOTICE <<"*** line not handled *** :"<<line<<std::endl;
+                currentElementState.coordinateCombination = coordateCombination;
+                currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
             }
-
+            addElement(element);
         }
 
+        // release the chunk's memory as soon as it's merged
+        ObjChunk::StateChanges().swap(chunk.stateChanges);
+        ObjChunk::Elements().swap(chunk.elements);
+        ObjChunk::Faces().swap(chunk.faces);
     }
-#if 0
-    OSG_NOTICE <<"vertices :"<<vertices.size()<<std::endl;
-    OSG_NOTICE <<"normals :"<<normals.size()<<std::endl;
-    OSG_NOTICE <<"texcoords :"<<texcoords.size()<<std::endl;
-    OSG_NOTICE <<"materials :"<<materialMap.size()<<std::endl;
-    OSG_NOTICE <<"elementStates :"<<elementStateMap.size()<<std::endl;
-
-    unsigned int pos=0;
-    for(ElementStateMap::iterator itr=elementStateMap.begin();
-        itr!=elementStateMap.end();
-        ++itr,++pos)
-    {
-        const ElementState& es = itr->first;
-        ElementList& el = itr->second;
-        OSG_NOTICE<<"ElementState "<<pos<<std::endl;
-        OSG_NOTICE<<"    es.objectName="<<es.objectName<<std::endl;
-        OSG_NOTICE<<"    es.groupName="<<es.groupName<<std::endl;
-        OSG_NOTICE<<"    es.materialName="<<es.materialName<<std::endl;
-        OSG_NOTICE<<"    es.smoothGroup="<<es.smoothingGroup<<std::endl;
-        OSG_NOTICE<<"    ElementList ="<<el.size()<<std::endl;
 
-    }
-#endif
     return true;
 }
 
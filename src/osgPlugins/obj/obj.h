@@ -197,6 +197,9 @@ public:
     bool readMTL(std::istream& fin);
     bool readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options);
 
+    /** Read the OBJ data held in memory in [begin, end), which is split at line boundaries into chunks that are parsed in parallel.*/
+    bool readOBJ(const char* begin, const char* end, const osgDB::ReaderWriter::Options* options);
+
     bool readline(std::istream& fin, char* line, const int LINE_SIZE);
     void addElement(Element* element);
 
@@ -13,10 +13,16 @@
 #include "ply.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include <osg/Geometry>
 #include <osg/Geode>
+#include <osg/Endian>
+#include <osg/Timer>
 #include <osg/io_utils>
+#include <osgDB/MappedFile>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
 
 using namespace std;
 using namespace ply;
@@ -251,6 +257,577 @@ void VertexData::readTriangles( PlyFile* file, const int nFaces )
 }
 
 
+/*  Determine which vertex fields are stored in the file.  */
+int VertexData::getVertexFields( PlyProperty** props, const int nProps,
+                                 const bool ignoreColors )
+{
+    int fields = NONE;
+    // determine if the file stores vertex colors
+    for( int j = 0; j < nProps; ++j )
+    {
+        // if the string have the red means color info is there
+        if( equal_strings( props[j]->name, "x" ) )
+            fields |= XYZ;
+        if( equal_strings( props[j]->name, "nx" ) )
+            fields |= NORMALS;
+        if( equal_strings( props[j]->name, "alpha" ) )
+            fields |= RGBA;
+        if ( equal_strings( props[j]->name, "red" ) )
+            fields |= RGB;
+        if( equal_strings( props[j]->name, "ambient" ) )
+            fields |= AMBIENT;
+        if( equal_strings( props[j]->name, "diffuse_red" ) )
+            fields |= DIFFUSE;
+        if( equal_strings( props[j]->name, "specular_red" ) )
+            fields |= SPECULAR;
+    }
+
+    if( ignoreColors )
+    {
+        fields &= ~(XYZ | NORMALS);
+        MESHINFO << "Colors in PLY file ignored per request." << endl;
+    }
+
+    return fields;
+}
+
+
+namespace
+{
+    // vertex properties that are converted, in the order of the arrays they are stored in
+    enum VertexProperty
+    {
+        PROP_X, PROP_Y, PROP_Z,
+        PROP_NX, PROP_NY, PROP_NZ,
+        PROP_RED, PROP_GREEN, PROP_BLUE, PROP_ALPHA,
+        PROP_AMBIENT_RED, PROP_AMBIENT_GREEN, PROP_AMBIENT_BLUE,
+        PROP_DIFFUSE_RED, PROP_DIFFUSE_GREEN, PROP_DIFFUSE_BLUE,
+        PROP_SPECULAR_RED, PROP_SPECULAR_GREEN, PROP_SPECULAR_BLUE,
+        NUM_VERTEX_PROPERTIES
+    };
+
+    const char* vertexPropertyNames[NUM_VERTEX_PROPERTIES] =
+    {
+        "x", "y", "z",
+        "nx", "ny", "nz",
+        "red", "green", "blue", "alpha",
+        "ambient_red", "ambient_green", "ambient_blue",
+        "diffuse_red", "diffuse_green", "diffuse_blue",
+        "specular_red", "specular_green", "specular_blue"
+    };
+
+    int getVertexProperty( const char* name )
+    {
+        for( int i = 0; i < NUM_VERTEX_PROPERTIES; ++i )
+            if( equal_strings( name, vertexPropertyNames[i] ) )
+                return i;
+        return -1;
+    }
+
+    int getTypeSize( int type )
+    {
+        switch( type )
+        {
+            case PLY_CHAR:
+            case PLY_UCHAR:
+            case PLY_UINT8:     return 1;
+            case PLY_SHORT:
+            case PLY_USHORT:    return 2;
+            case PLY_INT:
+            case PLY_UINT:
+            case PLY_INT32:
+            case PLY_FLOAT:
+            case PLY_FLOAT32:   return 4;
+            case PLY_DOUBLE:    return 8;
+            default:            return 0;
+        }
+    }
+
+    template<typename T>
+    inline T readRaw( const char* ptr, bool swap )
+    {
+        T value;
+        memcpy( &value, ptr, sizeof(T) );
+        if( swap ) osg::swapBytes( (char*)&value, sizeof(T) );
+        return value;
+    }
+
+    inline double readBinaryValue( const char* ptr, int type, bool swap )
+    {
+        switch( type )
+        {
+            case PLY_CHAR:      return static_cast<signed char>( *ptr );
+            case PLY_UCHAR:
+            case PLY_UINT8:     return static_cast<unsigned char>( *ptr );
+            case PLY_SHORT:     return readRaw<short>( ptr, swap );
+            case PLY_USHORT:    return readRaw<unsigned short>( ptr, swap );
+            case PLY_INT:
+            case PLY_INT32:     return readRaw<int>( ptr, swap );
+            case PLY_UINT:      return readRaw<unsigned int>( ptr, swap );
+            case PLY_FLOAT:
+            case PLY_FLOAT32:   return readRaw<float>( ptr, swap );
+            case PLY_DOUBLE:    return readRaw<double>( ptr, swap );
+            default:            return 0.0;
+        }
+    }
+
+    inline bool isSpace( char c )
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* readAsciiValue( const char* ptr, const char* end, double& value )
+    {
+        while( ptr < end && isSpace( *ptr ) ) ++ptr;
+        const char* next = osg::asciiToDouble( ptr, end, value );
+
+        // skip over anything that isn't a number so that the line stays in step
+        if( next == ptr )
+            while( next < end && !isSpace( *next ) ) ++next;
+        return next;
+    }
+
+    inline const char* findLineEnd( const char* ptr, const char* end )
+    {
+        const char* lineEnd = static_cast<const char*>( memchr( ptr, '\n', end - ptr ) );
+        return lineEnd ? lineEnd : end;
+    }
+
+    // layout of an element in the file
+    struct ElementLayout
+    {
+        PlyElement*         element;
+        bool                isVertex;
+        bool                isFace;
+
+        // index of the vertex property or vertex_indices list for each property
+        std::vector<int>    targets;
+
+        // binary files, offset of each property in an element of fixed size
+        std::vector<size_t> offsets;
+        size_t              stride;
+        size_t              begin;
+
+        // ascii files, line of the first element
+        size_t              firstLine;
+    };
+
+    // arrays the data is converted into
+    struct ConvertedData
+    {
+        osg::Vec3*      vertices;
+        osg::Vec3*      normals;
+        osg::Vec4*      colors;
+        osg::Vec4*      ambient;
+        osg::Vec4*      diffuse;
+        osg::Vec4*      specular;
+        bool            hasAlpha;
+        unsigned int*   triangles;
+        bool            invertFaces;
+
+        // colors are converted as unsigned char, as the element by element reader does
+        static float color( double value )
+        {
+            return static_cast<unsigned char>( static_cast<int>( value ) ) / 255.0f;
+        }
+
+        void storeVertex( size_t i, const double* v ) const
+        {
+            vertices[i].set( v[PROP_X], v[PROP_Y], v[PROP_Z] );
+            if( normals )
+                normals[i].set( v[PROP_NX], v[PROP_NY], v[PROP_NZ] );
+            if( colors )
+                colors[i].set( color( v[PROP_RED] ), color( v[PROP_GREEN] ), color( v[PROP_BLUE] ),
+                               hasAlpha ? color( v[PROP_ALPHA] ) : 1.0f );
+            if( ambient )
+                ambient[i].set( color( v[PROP_AMBIENT_RED] ), color( v[PROP_AMBIENT_GREEN] ), color( v[PROP_AMBIENT_BLUE] ), 1.0f );
+            if( diffuse )
+                diffuse[i].set( color( v[PROP_DIFFUSE_RED] ), color( v[PROP_DIFFUSE_GREEN] ), color( v[PROP_DIFFUSE_BLUE] ), 1.0f );
+            if( specular )
+                specular[i].set( color( v[PROP_SPECULAR_RED] ), color( v[PROP_SPECULAR_GREEN] ), color( v[PROP_SPECULAR_BLUE] ), 1.0f );
+        }
+
+        void storeTriangle( size_t i, const double* indices ) const
+        {
+            unsigned int* triangle = triangles + i * 3;
+            triangle[0] = static_cast<unsigned int>( indices[invertFaces ? 2 : 0] );
+            triangle[1] = static_cast<unsigned int>( indices[1] );
+            triangle[2] = static_cast<unsigned int>( indices[invertFaces ? 0 : 2] );
+        }
+    };
+
+    // work is split into ranges that are converted in parallel, the calling thread converts the last range itself
+    struct RangeOperation
+    {
+        RangeOperation(): failed( 0 ) {}
+        virtual ~RangeOperation() {}
+        virtual void processRange( unsigned int i ) = 0;
+
+        // set by any range that finds data the bulk conversion doesn't support
+        OpenThreads::Atomic failed;
+    };
+
+    class RangeThread : public OpenThreads::Thread
+    {
+    public:
+        RangeThread( RangeOperation& operation, unsigned int range ):
+            _operation( operation ),
+            _range( range ) {}
+
+        virtual void run() { _operation.processRange( _range ); }
+
+    protected:
+        RangeOperation& _operation;
+        unsigned int    _range;
+    };
+
+    unsigned int getNumRanges( size_t workSize, size_t minWorkPerRange )
+    {
+        size_t numRanges = osg::maximum( OpenThreads::GetNumberOfProcessors(), 1 );
+        numRanges = osg::minimum( numRanges, workSize / minWorkPerRange );
+        return numRanges > 0 ? static_cast<unsigned int>( numRanges ) : 1u;
+    }
+
+    bool runRangeOperation( RangeOperation& operation, unsigned int numRanges )
+    {
+        std::vector<RangeThread*> threads;
+        for( unsigned int i = 0; i + 1 < numRanges; ++i )
+        {
+            RangeThread* thread = new RangeThread( operation, i );
+            if( thread->start() == 0 ) threads.push_back( thread );
+            else { thread->run(); delete thread; }
+        }
+
+        operation.processRange( numRanges - 1 );
+
+        for( std::vector<RangeThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr )
+        {
+            (*itr)->join();
+            delete *itr;
+        }
+
+        return operation.failed == 0;
+    }
+
+    // convert the elements of fixed size of a binary file
+    struct ConvertBinaryElements : public RangeOperation
+    {
+        ConvertBinaryElements( const char* data, const ElementLayout& layout, const ConvertedData& converted,
+                               bool swap, unsigned int numRanges ):
+            _data( data ),
+            _layout( layout ),
+            _converted( converted ),
+            _swap( swap ),
+            _num( layout.element->num ),
+            _numPerRange( ( _num + numRanges - 1 ) / numRanges ) {}
+
+        virtual void processRange( unsigned int range )
+        {
+            size_t begin = osg::minimum( range * _numPerRange, _num );
+            size_t end = osg::minimum( begin + _numPerRange, _num );
+
+            PlyElement* element = _layout.element;
+            double values[NUM_VERTEX_PROPERTIES] = { 0.0 };
+
+            for( size_t i = begin; i < end; ++i )
+            {
+                const char* ptr = _data + _layout.begin + i * _layout.stride;
+
+                for( int j = 0; j < element->nprops; ++j )
+                {
+                    int target = _layout.targets[j];
+                    if( target < 0 ) continue;
+
+                    PlyProperty* prop = element->props[j];
+                    const char* propPtr = ptr + _layout.offsets[j];
+
+                    if( _layout.isFace )
+                    {
+                        // all faces are expected to be triangles
+                        if( readBinaryValue( propPtr, prop->count_external, _swap ) != 3.0 )
+                        {
+                            ++failed;
+                            return;
+                        }
+
+                        int size = getTypeSize( prop->external_type );
+                        propPtr += getTypeSize( prop->count_external );
+                        for( int k = 0; k < 3; ++k )
+                            values[k] = readBinaryValue( propPtr + k * size, prop->external_type, _swap );
+                    }
+                    else
+                        values[target] = readBinaryValue( propPtr, prop->external_type, _swap );
+                }
+
+                if( _layout.isFace )
+                    _converted.storeTriangle( i, values );
+                else
+                    _converted.storeVertex( i, values );
+            }
+        }
+
+        const char*             _data;
+        const ElementLayout&    _layout;
+        const ConvertedData&    _converted;
+        bool                    _swap;
+        size_t                  _num;
+        size_t                  _numPerRange;
+    };
+
+    // convert the lines of an ascii file, each element is expected to be on a line of its own
+    struct ConvertAsciiLines : public RangeOperation
+    {
+        struct Range
+        {
+            const char* begin;
+            const char* end;
+            size_t      firstLine;
+            size_t      numLines;
+        };
+
+        ConvertAsciiLines( const char* begin, const char* end, const std::vector<ElementLayout>& layouts,
+                           const ConvertedData& converted, unsigned int numRanges ):
+            _layouts( layouts ),
+            _converted( converted ),
+            _countLines( true ),
+            _ranges( numRanges )
+        {
+            // ranges start at the beginning of lines
+            size_t rangeSize = ( end - begin + numRanges - 1 ) / numRanges;
+            for( unsigned int i = 0; i < numRanges; ++i )
+            {
+                const char* ptr = begin + osg::minimum( size_t( end - begin ), i * rangeSize );
+                if( ptr > begin ) ptr = osg::minimum( findLineEnd( ptr - 1, end ) + 1, end );
+                _ranges[i].begin = ptr;
+                _ranges[i].firstLine = 0;
+                _ranges[i].numLines = 0;
+            }
+            for( unsigned int i = 0; i < numRanges; ++i )
+                _ranges[i].end = ( i + 1 < numRanges ) ? _ranges[i + 1].begin : end;
+        }
+
+        // first pass counts the lines of each range, second pass converts the elements on them
+        virtual void processRange( unsigned int i )
+        {
+            Range& range = _ranges[i];
+            if( _countLines )
+            {
+                for( const char* ptr = range.begin; ptr < range.end; ptr = findLineEnd( ptr, range.end ) + 1 )
+                    ++range.numLines;
+                return;
+            }
+
+            double values[NUM_VERTEX_PROPERTIES] = { 0.0 };
+
+            size_t line = range.firstLine;
+            std::vector<ElementLayout>::const_iterator layout = _layouts.begin();
+            for( const char* ptr = range.begin; ptr < range.end; ++line )
+            {
+                const char* lineEnd = findLineEnd( ptr, range.end );
+
+                while( layout != _layouts.end() && line >= layout->firstLine + layout->element->num ) ++layout;
+                if( layout == _layouts.end() ) break;
+
+                if( line >= layout->firstLine && ( layout->isVertex || layout->isFace ) )
+                {
+                    PlyElement* element = layout->element;
+                    for( int j = 0; j < element->nprops; ++j )
+                    {
+                        int target = layout->targets[j];
+                        double value;
+                        ptr = readAsciiValue( ptr, lineEnd, value );
+
+                        if( element->props[j]->is_list )
+                        {
+                            // all faces are expected to be triangles
+                            if( target < 0 || value != 3.0 )
+                            {
+                                ++failed;
+                                return;
+                            }
+                            for( int k = 0; k < 3; ++k )
+                                ptr = readAsciiValue( ptr, lineEnd, values[k] );
+                        }
+                        else if( target >= 0 )
+                            values[target] = value;
+                    }
+
+                    if( layout->isFace )
+                        _converted.storeTriangle( line - layout->firstLine, values );
+                    else
+                        _converted.storeVertex( line - layout->firstLine, values );
+                }
+
+                ptr = lineEnd + 1;
+            }
+        }
+
+        // number the lines of the ranges, returning the total
+        size_t numberLines()
+        {
+            size_t numLines = 0;
+            for( std::vector<Range>::iterator itr = _ranges.begin(); itr != _ranges.end(); ++itr )
+            {
+                itr->firstLine = numLines;
+                numLines += itr->numLines;
+            }
+            _countLines = false;
+            return numLines;
+        }
+
+        const std::vector<ElementLayout>&   _layouts;
+        const ConvertedData&                _converted;
+        bool                                _countLines;
+        std::vector<Range>                  _ranges;
+    };
+
+    // minimum amount of data worth converting in a thread of its own
+    const size_t MinRangeSize = 1024 * 1024;
+}
+
+
+/*  Read the data of the file in bulk from the memory mapped file.  */
+bool VertexData::readMappedData( PlyFile* file, const char* filename,
+                                 const bool ignoreColors )
+{
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    // the header has been read up to the start of the data
+    long dataStart = ftell( file->fp );
+    if( dataStart < 0 )
+        return false;
+
+    std::vector<ElementLayout> layouts( file->nelems );
+    size_t dataSize = 0;
+    int numVertices = 0;
+    int numFaces = 0;
+    bool hasVertices = false;
+    bool hasFaces = false;
+    int vertexFields = NONE;
+
+    for( int i = 0; i < file->nelems; ++i )
+    {
+        ElementLayout& layout = layouts[i];
+        PlyElement* element = file->elems[i];
+        layout.element = element;
+        layout.isVertex = equal_strings( element->name, "vertex" );
+        layout.isFace = equal_strings( element->name, "face" );
+        layout.targets.resize( element->nprops, -1 );
+        layout.offsets.resize( element->nprops, 0 );
+        layout.stride = 0;
+        layout.begin = dataStart + dataSize;
+        layout.firstLine = i > 0 ? layouts[i-1].firstLine + layouts[i-1].element->num : 0;
+
+        if( layout.isVertex )
+        {
+            hasVertices = true;
+            numVertices = element->num;
+            vertexFields = getVertexFields( element->props, element->nprops, ignoreColors );
+        }
+        if( layout.isFace )
+        {
+            hasFaces = true;
+            numFaces = element->num;
+        }
+
+        for( int j = 0; j < element->nprops; ++j )
+        {
+            PlyProperty* prop = element->props[j];
+            layout.offsets[j] = layout.stride;
+
+            if( prop->is_list )
+            {
+                // only faces made of lists of vertex indices are supported, expected to be triangles
+                if( !layout.isFace || !equal_strings( prop->name, "vertex_indices" ) )
+                    return false;
+                layout.targets[j] = 0;
+                layout.stride += getTypeSize( prop->count_external ) + 3 * getTypeSize( prop->external_type );
+            }
+            else
+            {
+                if( layout.isVertex )
+                    layout.targets[j] = getVertexProperty( prop->name );
+                layout.stride += getTypeSize( prop->external_type );
+            }
+        }
+
+        dataSize += layout.stride * element->num;
+    }
+
+    osgDB::MappedFile mappedFile( filename );
+    if( !mappedFile.valid() )
+        return false;
+
+    if( file->file_type != PLY_ASCII && dataStart + dataSize > mappedFile.size() )
+        return false;
+
+    // allocate the arrays up front and convert straight into them
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array( numVertices );
+    osg::ref_ptr<osg::Vec3Array> normals = ( vertexFields & NORMALS ) ? new osg::Vec3Array( numVertices ) : 0;
+    osg::ref_ptr<osg::Vec4Array> colors = ( vertexFields & ( RGB | RGBA ) ) ? new osg::Vec4Array( numVertices ) : 0;
+    osg::ref_ptr<osg::Vec4Array> ambient = ( vertexFields & AMBIENT ) ? new osg::Vec4Array( numVertices ) : 0;
+    osg::ref_ptr<osg::Vec4Array> diffuse = ( vertexFields & DIFFUSE ) ? new osg::Vec4Array( numVertices ) : 0;
+    osg::ref_ptr<osg::Vec4Array> specular = ( vertexFields & SPECULAR ) ? new osg::Vec4Array( numVertices ) : 0;
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt( osg::PrimitiveSet::TRIANGLES, numFaces * 3 );
+
+    ConvertedData converted;
+    converted.vertices = numVertices > 0 ? &vertices->front() : 0;
+    converted.normals = normals.valid() && numVertices > 0 ? &normals->front() : 0;
+    converted.colors = colors.valid() && numVertices > 0 ? &colors->front() : 0;
+    converted.ambient = ambient.valid() && numVertices > 0 ? &ambient->front() : 0;
+    converted.diffuse = diffuse.valid() && numVertices > 0 ? &diffuse->front() : 0;
+    converted.specular = specular.valid() && numVertices > 0 ? &specular->front() : 0;
+    converted.hasAlpha = ( vertexFields & RGBA ) != 0;
+    converted.triangles = numFaces > 0 ? &triangles->front() : 0;
+    converted.invertFaces = _invertFaces;
+
+    if( file->file_type == PLY_ASCII )
+    {
+        const char* begin = mappedFile.data() + dataStart;
+        ConvertAsciiLines operation( begin, mappedFile.end(), layouts, converted,
+                                     getNumRanges( mappedFile.end() - begin, MinRangeSize ) );
+
+        runRangeOperation( operation, operation._ranges.size() );
+        if( operation.numberLines() < layouts.back().firstLine + layouts.back().element->num )
+            return false;
+
+        if( !runRangeOperation( operation, operation._ranges.size() ) )
+            return false;
+    }
+    else
+    {
+        bool swap = ( file->file_type == PLY_BINARY_LE ) != ( osg::getCpuByteOrder() == osg::LittleEndian );
+        for( std::vector<ElementLayout>::iterator itr = layouts.begin(); itr != layouts.end(); ++itr )
+        {
+            if( ( !itr->isVertex && !itr->isFace ) || itr->element->num == 0 )
+                continue;
+
+            unsigned int numRanges = getNumRanges( itr->stride * itr->element->num, MinRangeSize );
+            ConvertBinaryElements operation( mappedFile.data(), *itr, converted, swap, numRanges );
+            if( !runRangeOperation( operation, numRanges ) )
+                return false;
+        }
+    }
+
+    if( hasVertices )
+    {
+        _vertices = vertices;
+        _normals = normals;
+        _colors = colors;
+        _ambient = ambient;
+        _diffuse = diffuse;
+        _specular = specular;
+    }
+    if( hasFaces )
+        _triangles = triangles;
+
+    MESHINFO << filename << ": read " << numVertices << " vertices and " << numFaces << " faces in "
+             << osg::Timer::instance()->delta_m( startTick, osg::Timer::instance()->tick() ) << "ms" << endl;
+
+    return true;
+}
+
+
 /*  Open a PLY file and read vertex, color and index data. and returns the node  */
 osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColors )
 {
@@ -304,7 +881,13 @@ osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColor
         }
 
     }
-    for( int i = 0; i < nPlyElems; ++i )
+
+    // the data of most files is converted in bulk, otherwise it's read element by element
+    bool readMapped = readMappedData( file, filename, ignoreColors );
+    if( readMapped )
+        result = _vertices.valid() || _triangles.valid();
+
+    for( int i = 0; !readMapped && i < nPlyElems; ++i )
     {
         int nElems;
         int nProps;
@@ -334,32 +917,7 @@ osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColor
         // if the string is vertex means vertex data is started
         if( equal_strings( elemNames[i], "vertex" ) )
         {
- 	    int fields = NONE;
-            // determine if the file stores vertex colors
-            for( int j = 0; j < nProps; ++j )
-	      {
-                // if the string have the red means color info is there
-                if( equal_strings( props[j]->name, "x" ) )
-                    fields |= XYZ;
-                if( equal_strings( props[j]->name, "nx" ) )
-                    fields |= NORMALS;
-                if( equal_strings( props[j]->name, "alpha" ) )
-                    fields |= RGBA;
-                if ( equal_strings( props[j]->name, "red" ) )
-                    fields |= RGB;
-                if( equal_strings( props[j]->name, "ambient" ) )
-                    fields |= AMBIENT;
-                if( equal_strings( props[j]->name, "diffuse_red" ) )
-                    fields |= DIFFUSE;
-                if( equal_strings( props[j]->name, "specular_red" ) )
-                    fields |= SPECULAR;
-	      }
-
-            if( ignoreColors )
-	      {
-		fields &= ~(XYZ | NORMALS);
-                MESHINFO << "Colors in PLY file ignored per request." << endl;
-	      }
+            int fields = getVertexFields( props, nProps, ignoreColors );
 
             try {
                 // Read vertices and store in a std::vector array
@@ -27,6 +27,7 @@
 
 // defined elsewhere
 struct PlyFile;
+struct PlyProperty;
 
 namespace ply
 {
@@ -66,6 +67,17 @@ namespace ply
         // Reads the triangle indices from the ply file
         void readTriangles( PlyFile* file, const int nFaces );
 
+        // Reads the vertices and triangles of the layouts written by most
+        // tools in bulk, straight from the memory mapped file, in parallel.
+        // Returns false if the layout isn't supported, leaving the file
+        // unread so that it can be read element by element instead
+        bool readMappedData( PlyFile* file, const char* filename,
+                             const bool ignoreColors );
+
+        // Returns the VertexFields of the properties of the vertex element
+        static int getVertexFields( PlyProperty** props, const int nProps,
+                                    const bool ignoreColors );
+
         // Calculates the normals according to passed flag
         // if vertexNormals is true then computes normal per vertices
         // otherwise per triangle means per face
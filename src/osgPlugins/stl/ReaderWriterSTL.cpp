@@ -30,6 +30,7 @@
 #include <osgDB/ReadFile>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
+#include <osgDB/MappedFile>
 
 #include <osgUtil/TriStripVisitor>
 #include <osgUtil/SmoothingVisitor>
@@ -37,14 +38,16 @@
 
 #include <osg/Geode>
 #include <osg/Geometry>
+#include <osg/Timer>
 
-#include <stdio.h>
-#include <sys/types.h>
-#include <sys/stat.h>
+#include <OpenThreads/Thread>
 
+#include <stdio.h>
 #include <string.h>
 
 #include <memory>
+#include <sstream>
+#include <vector>
 
 /**
  * STL importer for OpenSceneGraph.
@@ -56,7 +59,9 @@ public:
     {
         supportsExtension("stl", "STL binary format");
         supportsExtension("sta", "STL ASCII format");
-        supportsOption("smooth", "Run SmoothingVisitor");
+        supportsOption("smooth", "Run SmoothingVisitor, vertices are shared between facets");
+        supportsOption("dedupVertices", "Share vertices with identical position, normal and color between facets, creating indexed triangles");
+        supportsOption("noTriStripPolygons", "Do not do the default tri stripping of facets that aren't indexed");
         supportsOption("separateFiles", "Save each geode in a different file. Can result in a huge amount of files!");
         supportsOption("dontSaveNormals", "Set all normals to [0 0 0] when saving to a file.");
     }
@@ -73,8 +78,9 @@ private:
     class ReaderObject
     {
     public:
-        ReaderObject(bool generateNormals = true):
+        ReaderObject(bool generateNormals = true, bool createNormals = true):
             _generateNormal(generateNormals),
+            _createNormals(createNormals),
             _numFacets(0)
         {
         }
@@ -90,53 +96,10 @@ private:
             ReadEOF
         };
 
-        virtual ReadResult read(FILE *fp) = 0;
-
-        osg::ref_ptr<osg::Geometry> asGeometry() const
-        {
-            osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
-
-            geom->setVertexArray(_vertex.get());
-
-            if (_normal.valid())
-            {
-                // need to convert per triangle normals to per vertex
-                osg::ref_ptr<osg::Vec3Array> perVertexNormals = new osg::Vec3Array;
-                perVertexNormals->reserveArray(_normal->size() * 3);
-                for(osg::Vec3Array::iterator itr = _normal->begin();
-                    itr != _normal->end();
-                    ++itr)
-                {
-                    perVertexNormals->push_back(*itr);
-                    perVertexNormals->push_back(*itr);
-                    perVertexNormals->push_back(*itr);
-                }
-
-                geom->setNormalArray(perVertexNormals.get(), osg::Array::BIND_PER_VERTEX);
-            }
+        /** Read the next solid from the mapped file, advancing ptr past it.*/
+        virtual ReadResult read(const char*& ptr, const char* end) = 0;
 
-            if (_color.valid())
-            {
-                // need to convert per triangle colours to per vertex
-                OSG_INFO << "STL file with color" << std::endl;
-                osg::ref_ptr<osg::Vec4Array> perVertexColours = new osg::Vec4Array;
-                perVertexColours->reserveArray(_color->size() * 3);
-                for(osg::Vec4Array::iterator itr = _color->begin();
-                    itr != _color->end();
-                    ++itr)
-                {
-                    perVertexColours->push_back(*itr);
-                }
-                geom->setColorArray(perVertexColours.get(), osg::Array::BIND_PER_VERTEX);
-            }
-
-            geom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES, 0, _numFacets * 3));
-
-            osgUtil::TriStripVisitor tristripper;
-            tristripper.stripify(*geom);
-
-            return geom;
-        }
+        osg::ref_ptr<osg::Geometry> asGeometry(bool dedupVertices, bool triStrip);
 
         bool isEmpty()
         {
@@ -150,13 +113,18 @@ private:
 
     protected:
         bool _generateNormal;
+        bool _createNormals;
         unsigned int _numFacets;
 
         std::string _solidName;
+
+        // per vertex arrays, three vertices for each facet
         osg::ref_ptr<osg::Vec3Array> _vertex;
         osg::ref_ptr<osg::Vec3Array> _normal;
         osg::ref_ptr<osg::Vec4Array> _color;
 
+        osg::ref_ptr<osg::DrawElementsUInt> shareVertices();
+
         void clear()
         {
             _solidName = "";
@@ -170,19 +138,24 @@ private:
     class AsciiReaderObject : public ReaderObject
     {
     public:
-        ReadResult read(FILE *fp);
+        AsciiReaderObject(bool createNormals = true)
+            : ReaderObject(false, createNormals)
+        {
+        }
+
+        ReadResult read(const char*& ptr, const char* end);
     };
 
     class BinaryReaderObject : public ReaderObject
     {
     public:
-        BinaryReaderObject(unsigned int expectNumFacets, bool generateNormals = true)
-            : ReaderObject(generateNormals),
+        BinaryReaderObject(unsigned int expectNumFacets, bool generateNormals = true, bool createNormals = true)
+            : ReaderObject(generateNormals, createNormals),
             _expectNumFacets(expectNumFacets)
         {
         }
 
-        ReadResult read(FILE *fp);
+        ReadResult read(const char*& ptr, const char* end);
 
     protected:
         unsigned int _expectNumFacets;
@@ -341,6 +314,434 @@ const unsigned short StlHasColor = 0x8000;
 const unsigned short StlColorSize = 0x1f;        // 5 bit
 const float StlColorDepth = float(StlColorSize); // 2^5 - 1
 
+namespace
+{
+
+/**********************************************************************
+ *
+ * Threading, each operation is split into ranges that are processed
+ * in parallel, the calling thread processes the last range itself.
+ *
+ **********************************************************************/
+
+struct RangeOperation
+{
+    virtual ~RangeOperation() {}
+    virtual void processRange(unsigned int i) = 0;
+};
+
+class RangeThread : public OpenThreads::Thread
+{
+public:
+    RangeThread(RangeOperation& operation, unsigned int range):
+        _operation(operation),
+        _range(range) {}
+
+    virtual void run() { _operation.processRange(_range); }
+
+protected:
+    RangeOperation& _operation;
+    unsigned int    _range;
+};
+
+// number of ranges to split work into, small amounts of work aren't worth the cost of starting threads.
+unsigned int getNumRanges(size_t workSize, size_t minWorkPerRange)
+{
+    size_t numRanges = osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
+    numRanges = osg::minimum(numRanges, workSize/minWorkPerRange);
+    return numRanges>0 ? static_cast<unsigned int>(numRanges) : 1u;
+}
+
+void runRangeOperation(RangeOperation& operation, unsigned int numRanges)
+{
+    std::vector<RangeThread*> threads;
+    for (unsigned int i = 0; i + 1 < numRanges; ++i)
+    {
+        RangeThread* thread = new RangeThread(operation, i);
+        if (thread->start() == 0) threads.push_back(thread);
+        else { thread->run(); delete thread; }
+    }
+
+    operation.processRange(numRanges - 1);
+
+    for (std::vector<RangeThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+/**********************************************************************
+ *
+ * Binary facets
+ *
+ **********************************************************************/
+
+// binary STL files are always little endian.
+inline float readFloat(const char* ptr, bool swap)
+{
+    float value;
+    memcpy(&value, ptr, 4);
+    if (swap) osg::swapBytes4((char*) &value);
+    return value;
+}
+
+inline unsigned short readColor(const char* facet, bool swap)
+{
+    unsigned short color;
+    memcpy(&color, facet + 48, 2);
+    if (swap) osg::swapBytes2((char*) &color);
+    return color;
+}
+
+struct ConvertBinaryFacets : public RangeOperation
+{
+    ConvertBinaryFacets(const char* facets, unsigned int numFacets, unsigned int numRanges, bool generateNormals, osg::Vec3* vertices, osg::Vec3* normals):
+        _facets(facets),
+        _numFacets(numFacets),
+        _facetsPerRange((numFacets + numRanges - 1) / numRanges),
+        _generateNormals(generateNormals),
+        _swap(osg::getCpuByteOrder() == osg::BigEndian),
+        _vertices(vertices),
+        _normals(normals),
+        _hasColor(numRanges, 0) {}
+
+    virtual void processRange(unsigned int range)
+    {
+        unsigned int begin = osg::minimum(range * _facetsPerRange, _numFacets);
+        unsigned int end = osg::minimum(begin + _facetsPerRange, _numFacets);
+
+        const char* facet = _facets + size_t(begin) * sizeof_StlFacet;
+        osg::Vec3* vertex = _vertices + size_t(begin) * 3;
+        for (unsigned int i = begin; i < end; ++i, facet += sizeof_StlFacet, vertex += 3)
+        {
+            for (unsigned int v = 0; v < 3; ++v)
+            {
+                const char* ptr = facet + 12 + v * 12;
+                vertex[v].set(readFloat(ptr, _swap), readFloat(ptr + 4, _swap), readFloat(ptr + 8, _swap));
+            }
+
+            if (_normals)
+            {
+                // per-facet normal
+                osg::Vec3 normal;
+                if (_generateNormals)
+                {
+                    normal = (vertex[1] - vertex[0]) ^ (vertex[2] - vertex[0]);
+                    normal.normalize();
+                }
+                else
+                {
+                    normal.set(readFloat(facet, _swap), readFloat(facet + 4, _swap), readFloat(facet + 8, _swap));
+                }
+
+                osg::Vec3* normalPtr = _normals + size_t(i) * 3;
+                normalPtr[0] = normal;
+                normalPtr[1] = normal;
+                normalPtr[2] = normal;
+            }
+
+            if (readColor(facet, _swap) & StlHasColor) _hasColor[range] = 1;
+        }
+    }
+
+    bool hasColor() const
+    {
+        for (std::vector<unsigned char>::const_iterator itr = _hasColor.begin(); itr != _hasColor.end(); ++itr)
+        {
+            if (*itr) return true;
+        }
+        return false;
+    }
+
+    const char*                 _facets;
+    unsigned int                _numFacets;
+    unsigned int                _facetsPerRange;
+    bool                        _generateNormals;
+    bool                        _swap;
+    osg::Vec3*                  _vertices;
+    osg::Vec3*                  _normals;
+    std::vector<unsigned char>  _hasColor;
+};
+
+/*
+ * color extension
+ * RGB555 with most-significat bit indicating if color is present, facets without color are white
+ */
+struct ConvertBinaryColors : public RangeOperation
+{
+    ConvertBinaryColors(const char* facets, unsigned int numFacets, unsigned int numRanges, osg::Vec4* colors):
+        _facets(facets),
+        _numFacets(numFacets),
+        _facetsPerRange((numFacets + numRanges - 1) / numRanges),
+        _swap(osg::getCpuByteOrder() == osg::BigEndian),
+        _colors(colors) {}
+
+    virtual void processRange(unsigned int range)
+    {
+        unsigned int begin = osg::minimum(range * _facetsPerRange, _numFacets);
+        unsigned int end = osg::minimum(begin + _facetsPerRange, _numFacets);
+
+        const char* facet = _facets + size_t(begin) * sizeof_StlFacet;
+        osg::Vec4* color = _colors + size_t(begin) * 3;
+        for (unsigned int i = begin; i < end; ++i, facet += sizeof_StlFacet, color += 3)
+        {
+            unsigned short value = readColor(facet, _swap);
+            osg::Vec4 c(1.0f, 1.0f, 1.0f, 1.0f);
+            if (value & StlHasColor)
+            {
+                float r = ((value >> 10) & StlColorSize) / StlColorDepth;
+                float g = ((value >> 5) & StlColorSize) / StlColorDepth;
+                float b = (value & StlColorSize) / StlColorDepth;
+                c.set(r, g, b, 1.0f);
+            }
+            color[0] = c;
+            color[1] = c;
+            color[2] = c;
+        }
+    }
+
+    const char*     _facets;
+    unsigned int    _numFacets;
+    unsigned int    _facetsPerRange;
+    bool            _swap;
+    osg::Vec4*      _colors;
+};
+
+/**********************************************************************
+ *
+ * ASCII facets
+ *
+ **********************************************************************/
+
+// minimum amount of text worth parsing in a thread of its own
+const size_t MinAsciiRangeSize = 1024 * 1024;
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline const char* skipSpace(const char* ptr, const char* end)
+{
+    while (ptr < end && isSpace(*ptr)) ++ptr;
+    return ptr;
+}
+
+inline const char* findLineEnd(const char* ptr, const char* end)
+{
+    const char* lineEnd = static_cast<const char*>(memchr(ptr, '\n', end - ptr));
+    return lineEnd ? lineEnd : end;
+}
+
+inline bool startsWith(const char* ptr, const char* end, const char* keyword, size_t length)
+{
+    return size_t(end - ptr) >= length && memcmp(ptr, keyword, length) == 0;
+}
+
+// missing or malformed numbers are read as 0 so that counting and parsing a range always agree.
+inline const char* parseVec3(const char* ptr, const char* end, osg::Vec3& v)
+{
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        ptr = skipSpace(ptr, end);
+        ptr = osg::asciiToFloat(ptr, end, v[i]);
+    }
+    return ptr;
+}
+
+/*
+ * Parse the facets between ptr and end, stopping at an endsolid line.
+ * When vertices is NULL only the triangles are counted, otherwise the
+ * vertices and (if not NULL) normals of each triangle are written.
+ * Returns the number of triangles.
+ */
+unsigned int parseAsciiFacets(const char* ptr, const char* end, osg::Vec3* vertices, osg::Vec3* normals, const char** endSolid)
+{
+    unsigned int numTriangles = 0;
+    unsigned int vertexCount = 0;
+    osg::Vec3 normal, first, previous;
+
+    if (endSolid) *endSolid = 0;
+
+    while (ptr < end)
+    {
+        ptr = skipSpace(ptr, end);
+        if (ptr == end) break;
+
+        const char* lineEnd = findLineEnd(ptr, end);
+
+        if (startsWith(ptr, lineEnd, "vertex", 6))
+        {
+            ++vertexCount;
+
+            if (vertices)
+            {
+                osg::Vec3 v;
+                parseVec3(ptr + 6, lineEnd, v);
+
+                if (vertexCount == 1) first = v;
+                else if (vertexCount == 2) previous = v;
+                else
+                {
+                    /*
+                     * There are some invalid ASCII files around (at least one ;-)
+                     * that have more than three vertices per facet - add an
+                     * additional triangle.
+                     */
+                    osg::Vec3* vertex = vertices + size_t(numTriangles) * 3;
+                    vertex[0] = first;
+                    vertex[1] = previous;
+                    vertex[2] = v;
+                    previous = v;
+
+                    if (normals)
+                    {
+                        osg::Vec3* normalPtr = normals + size_t(numTriangles) * 3;
+                        normalPtr[0] = normal;
+                        normalPtr[1] = normal;
+                        normalPtr[2] = normal;
+                    }
+                }
+            }
+
+            if (vertexCount >= 3) ++numTriangles;
+        }
+        else if (startsWith(ptr, lineEnd, "facet", 5))
+        {
+            vertexCount = 0;
+
+            if (normals)
+            {
+                // skip the "normal" keyword
+                const char* np = skipSpace(ptr + 5, lineEnd);
+                while (np < lineEnd && !isSpace(*np)) ++np;
+
+                parseVec3(np, lineEnd, normal);
+                normal.normalize();
+            }
+        }
+        else if (startsWith(ptr, lineEnd, "endsolid", 8))
+        {
+            if (endSolid) *endSolid = ptr;
+            break;
+        }
+
+        ptr = lineEnd;
+    }
+
+    return numTriangles;
+}
+
+// move to the start of the next facet or endsolid line, so that ranges can be parsed independently.
+const char* findRangeStart(const char* ptr, const char* begin, const char* end)
+{
+    if (ptr <= begin) return begin;
+
+    // make sure ptr is at the start of a line
+    ptr = findLineEnd(ptr - 1, end);
+    while (ptr < end)
+    {
+        ptr = skipSpace(ptr, end);
+        if (startsWith(ptr, end, "facet", 5) || startsWith(ptr, end, "endsolid", 8)) return ptr;
+        ptr = findLineEnd(ptr, end);
+    }
+    return end;
+}
+
+struct ParseAsciiFacets : public RangeOperation
+{
+    struct Range
+    {
+        const char*     begin;
+        const char*     end;
+        const char*     endSolid;
+        unsigned int    numTriangles;
+        unsigned int    firstTriangle;
+    };
+
+    ParseAsciiFacets(const char* begin, const char* end, unsigned int numRanges):
+        _ranges(numRanges),
+        _vertices(0),
+        _normals(0)
+    {
+        size_t rangeSize = (end - begin + numRanges - 1) / numRanges;
+        for (unsigned int i = 0; i < numRanges; ++i)
+        {
+            _ranges[i].begin = findRangeStart(begin + osg::minimum(size_t(end - begin), i * rangeSize), begin, end);
+            _ranges[i].endSolid = 0;
+            _ranges[i].numTriangles = 0;
+            _ranges[i].firstTriangle = 0;
+        }
+        for (unsigned int i = 0; i < numRanges; ++i)
+        {
+            _ranges[i].end = (i + 1 < numRanges) ? _ranges[i + 1].begin : end;
+        }
+    }
+
+    // first pass counts the triangles, second pass parses them into place.
+    virtual void processRange(unsigned int i)
+    {
+        Range& range = _ranges[i];
+        if (range.begin >= range.end) return;
+
+        if (!_vertices)
+        {
+            range.numTriangles = parseAsciiFacets(range.begin, range.end, 0, 0, &range.endSolid);
+        }
+        else
+        {
+            parseAsciiFacets(range.begin, range.end,
+                             _vertices + size_t(range.firstTriangle) * 3,
+                             _normals ? _normals + size_t(range.firstTriangle) * 3 : 0,
+                             0);
+        }
+    }
+
+    // truncate the ranges at the first endsolid, returning it and the total number of triangles before it.
+    const char* endSolid(unsigned int& numTriangles)
+    {
+        numTriangles = 0;
+        for (unsigned int i = 0; i < _ranges.size(); ++i)
+        {
+            Range& range = _ranges[i];
+            range.firstTriangle = numTriangles;
+            numTriangles += range.numTriangles;
+
+            if (range.endSolid)
+            {
+                range.end = range.endSolid;
+                _ranges.resize(i + 1);
+                return range.endSolid;
+            }
+        }
+        return 0;
+    }
+
+    std::vector<Range>  _ranges;
+    osg::Vec3*          _vertices;
+    osg::Vec3*          _normals;
+};
+
+/**********************************************************************
+ *
+ * Vertex sharing
+ *
+ **********************************************************************/
+
+inline unsigned int hashBits(unsigned int hash, const float* values, unsigned int num)
+{
+    for (unsigned int i = 0; i < num; ++i)
+    {
+        unsigned int bits;
+        memcpy(&bits, &values[i], 4);
+        hash = (hash ^ bits) * 16777619u;
+    }
+    return hash;
+}
+
+}
+
 osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& file, const osgDB::ReaderWriter::Options* options) const
 {
     std::string ext = osgDB::getLowerCaseFileExtension(file);
@@ -349,94 +750,91 @@ osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& fil
     std::string fileName = osgDB::findDataFile(file, options);
     if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
 
-    if (sizeof(unsigned int) != 4)
+    OSG_INFO << "ReaderWriterSTL::readNode(" << fileName.c_str() << ")" << std::endl;
+
+    bool smooth = false;
+    bool dedupVertices = false;
+    bool triStrip = true;
+    if (options)
     {
-        OSG_NOTICE<<"Waring: STL reading not supported as unsigned int is not 4 bytes on this system."<<std::endl;
-        return ReadResult::ERROR_IN_READING_FILE;
+        std::istringstream iss(options->getOptionString());
+        std::string opt;
+        while (iss >> opt)
+        {
+            if (opt == "smooth") smooth = true;
+            else if (opt == "dedupVertices") dedupVertices = true;
+            else if (opt == "noTriStripPolygons") triStrip = false;
+        }
     }
 
-    OSG_INFO << "ReaderWriterSTL::readNode(" << fileName.c_str() << ")" << std::endl;
+    // the smoothing visitor generates per vertex normals across shared vertices, so facet normals aren't needed
+    if (smooth) dedupVertices = true;
 
-    // determine ASCII vs. binary mode
-    FILE* fp = osgDB::fopen(fileName.c_str(), "rb");
-    if (!fp)
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    // the whole file is mapped and parsed in place
+    osgDB::MappedFile mappedFile(fileName);
+    if (!mappedFile.valid())
     {
         return ReadResult::FILE_NOT_FOUND;
     }
 
-    // assumes "unsigned int" is 4 bytes...
-    StlHeader header;
-    if (fread((void*) &header, sizeof(header), 1, fp) != 1)
+    if (mappedFile.size() < sizeof_StlHeader)
     {
-        fclose(fp);
         return ReadResult::ERROR_IN_READING_FILE;
     }
+
+    // determine ASCII vs. binary mode
     bool isBinary = false;
 
     // calculate expected file length from number of facets
-    unsigned int expectFacets = header.numFacets;
+    unsigned int expectFacets;
+    memcpy(&expectFacets, mappedFile.data() + 80, 4);
     if (osg::getCpuByteOrder() == osg::BigEndian)
     {
         osg::swapBytes4((char*) &expectFacets);
     }
-    off_t expectLen = sizeof_StlHeader + expectFacets * sizeof_StlFacet;
-
-    struct stat stb;
-    if (fstat(fileno(fp), &stb) < 0)
-    {
-        OSG_FATAL << "ReaderWriterSTL::readNode: Unable to stat '" << fileName << "'" << std::endl;
-        fclose(fp);
-        return ReadResult::ERROR_IN_READING_FILE;
-    }
+    unsigned long long expectLen = sizeof_StlHeader + (unsigned long long)(expectFacets) * sizeof_StlFacet;
 
-    if (stb.st_size == expectLen)
+    std::string headerText(mappedFile.data(), 80);
+    if (mappedFile.size() == expectLen)
     {
         isBinary = true;
     }
-    else if (strstr(header.text, "solid") != 0)
+    else if (headerText.find("solid") != std::string::npos)
     {
         isBinary = false;
     }
     else
     {
         OSG_FATAL << "ReaderWriterSTL::readNode(" << fileName.c_str() << ") unable to determine file format" << std::endl;
-        fclose(fp);
         return ReadResult::ERROR_IN_READING_FILE;
     }
 
-    if (!isBinary)
-    {
-        fclose(fp);
-        fp = osgDB::fopen(fileName.c_str(), "r");
-    }
-
     osg::ref_ptr<osg::Group> group = new osg::Group;
 
-    // read
-    rewind(fp);
-
     ReaderObject *readerObject;
 
     if (isBinary)
-        readerObject = new BinaryReaderObject(expectFacets);
+        readerObject = new BinaryReaderObject(expectFacets, true, !smooth);
     else
-        readerObject = new AsciiReaderObject();
+        readerObject = new AsciiReaderObject(!smooth);
 
     std::auto_ptr<ReaderObject> readerPtr(readerObject);
 
+    const char* ptr = mappedFile.begin();
     while (1)
     {
         ReaderObject::ReadResult result;
 
-        if ((result = readerPtr->read(fp)) == ReaderObject::ReadError)
+        if ((result = readerPtr->read(ptr, mappedFile.end())) == ReaderObject::ReadError)
         {
-            fclose(fp);
             return ReadResult::FILE_NOT_HANDLED;
         }
 
         if (!readerPtr->isEmpty())
         {
-            osg::ref_ptr<osg::Geometry> geom = readerPtr->asGeometry();
+            osg::ref_ptr<osg::Geometry> geom = readerPtr->asGeometry(dedupVertices, triStrip);
             osg::ref_ptr<osg::Geode> geode = new osg::Geode;
             geode->addDrawable(geom.get());
             geode->setName(readerPtr->getName());
@@ -447,14 +845,15 @@ osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& fil
             break;
     }
 
-    fclose(fp);
-
-    if (options && (options->getOptionString() == "smooth"))
+    if (smooth)
     {
         osgUtil::SmoothingVisitor smoother;
         group->accept(smoother);
     }
 
+    OSG_INFO << "ReaderWriterSTL::readNode(" << fileName.c_str() << ") read in "
+             << osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick()) << "ms" << std::endl;
+
     return group.get();
 }
 
@@ -464,179 +863,213 @@ osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& fil
  *
  **********************************************************************/
 
-ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::AsciiReaderObject::read(FILE* fp)
+osg::ref_ptr<osg::Geometry> ReaderWriterSTL::ReaderObject::asGeometry(bool dedupVertices, bool triStrip)
 {
-    unsigned int vertexCount = 0;
-    unsigned int facetIndex[] = { 0, 0, 0 };
-    unsigned int vertexIndex = 0;
-    unsigned int normalIndex = 0;
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
 
-    const int MaxLineSize = 256;
-    char buf[MaxLineSize];
-    char sx[MaxLineSize], sy[MaxLineSize], sz[MaxLineSize];
+    osg::ref_ptr<osg::DrawElementsUInt> indices;
+    if (dedupVertices) indices = shareVertices();
 
-    if (!isEmpty())
+    geom->setVertexArray(_vertex.get());
+
+    if (_normal.valid())
     {
-        clear();
+        geom->setNormalArray(_normal.get(), osg::Array::BIND_PER_VERTEX);
     }
 
-    while (fgets(buf, sizeof(buf), fp))
+    if (_color.valid())
     {
-        // strip '\n' or '\r\n' and trailing whitespace
-        unsigned int len = strlen(buf) - 1;
+        OSG_INFO << "STL file with color" << std::endl;
+        geom->setColorArray(_color.get(), osg::Array::BIND_PER_VERTEX);
+    }
 
-        while (len && (buf[len] == '\n' || buf[len] == '\r' || isspace(buf[len])))
-        {
-            buf[len--] = '\0';
-        }
+    if (indices.valid())
+    {
+        geom->addPrimitiveSet(indices.get());
+    }
+    else
+    {
+        geom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES, 0, _numFacets * 3));
 
-        if (len == 0 || buf[0] == '\0')
+        if (triStrip)
         {
-            continue;
+            osgUtil::TriStripVisitor tristripper;
+            tristripper.stripify(*geom);
         }
+    }
 
-        // strip leading whitespace
-        char* bp = buf;
-        while (isspace(*bp))
-        {
-            ++bp;
-        }
+    return geom;
+}
 
-        if (strncmp(bp, "vertex", 6) == 0)
-        {
-            if (sscanf(bp + 6, "%s %s %s", sx, sy, sz) == 3)
-            {
-                if (!_vertex.valid())
-                    _vertex = new osg::Vec3Array;
+/*
+ * Replace vertices that are identical to an earlier vertex with an index to it, compacting the
+ * arrays in place. Vertices are identical when the bits of the position, and of the normal and
+ * color if present, are equal.
+ */
+osg::ref_ptr<osg::DrawElementsUInt> ReaderWriterSTL::ReaderObject::shareVertices()
+{
+    unsigned int numVertices = _vertex->size();
+    osg::ref_ptr<osg::DrawElementsUInt> indices = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES, numVertices);
+
+    osg::Vec3* vertices = &(*_vertex)[0];
+    osg::Vec3* normals = _normal.valid() ? &(*_normal)[0] : 0;
+    osg::Vec4* colors = _color.valid() ? &(*_color)[0] : 0;
+
+    unsigned int numShared = 0;
+    {
+        // open addressed table of the shared vertices, kept less than two thirds full
+        unsigned int tableSize = 1;
+        while (tableSize < numVertices + numVertices / 2) tableSize <<= 1;
+        const unsigned int Empty = 0xffffffff;
+        std::vector<unsigned int> table(tableSize, Empty);
 
-                float vx = osg::asciiToFloat(sx);
-                float vy = osg::asciiToFloat(sy);
-                float vz = osg::asciiToFloat(sz);
+        for (unsigned int i = 0; i < numVertices; ++i)
+        {
+            unsigned int hash = hashBits(2166136261u, vertices[i].ptr(), 3);
+            if (normals) hash = hashBits(hash, normals[i].ptr(), 3);
+            if (colors) hash = hashBits(hash, colors[i].ptr(), 4);
+            hash ^= hash >> 15;
 
-                vertexIndex = _vertex->size();
-                if (vertexCount < 3)
+            for (unsigned int slot = hash & (tableSize - 1); ; slot = (slot + 1) & (tableSize - 1))
+            {
+                unsigned int shared = table[slot];
+                if (shared == Empty)
                 {
-                    _vertex->push_back(osg::Vec3(vx, vy, vz));
-                    facetIndex[vertexCount++] = vertexIndex;
+                    // shared vertices are never ahead of i, so can be moved down without overwriting unread vertices
+                    vertices[numShared] = vertices[i];
+                    if (normals) normals[numShared] = normals[i];
+                    if (colors) colors[numShared] = colors[i];
+
+                    table[slot] = numShared;
+                    (*indices)[i] = numShared++;
+                    break;
                 }
-                else
+
+                if (memcmp(vertices[shared].ptr(), vertices[i].ptr(), sizeof(osg::Vec3)) == 0 &&
+                    (!normals || memcmp(normals[shared].ptr(), normals[i].ptr(), sizeof(osg::Vec3)) == 0) &&
+                    (!colors || memcmp(colors[shared].ptr(), colors[i].ptr(), sizeof(osg::Vec4)) == 0))
                 {
-                    /*
-                     * There are some invalid ASCII files around (at least one ;-)
-                     * that have more than three vertices per facet - add an
-                     * additional triangle.
-                     */
-                    _normal->push_back((*_normal)[normalIndex]);
-                    _vertex->push_back((*_vertex)[facetIndex[0]]);
-                    _vertex->push_back((*_vertex)[facetIndex[2]]);
-                    _vertex->push_back(osg::Vec3(vx, vy, vz));
-                    facetIndex[1] = facetIndex[2];
-                    facetIndex[2] = vertexIndex;
-                    _numFacets++;
+                    (*indices)[i] = shared;
+                    break;
                 }
             }
         }
-        else if (strncmp(bp, "facet", 5) == 0)
-        {
-            if (sscanf(bp + 5, "%*s %s %s %s", sx, sy, sz) == 3)
-            {
-                float nx = osg::asciiToFloat(sx);
-                float ny = osg::asciiToFloat(sy);
-                float nz = osg::asciiToFloat(sz);
+    }
 
-                if (!_normal.valid())
-                    _normal = new osg::Vec3Array;
+    OSG_INFO << "ReaderWriterSTL: shared " << numVertices << " vertices as " << numShared << std::endl;
 
-                osg::Vec3 normal(nx, ny, nz);
-                normal.normalize();
+    _vertex->resize(numShared);
+    _vertex->trim();
+    if (normals)
+    {
+        _normal->resize(numShared);
+        _normal->trim();
+    }
+    if (colors)
+    {
+        _color->resize(numShared);
+        _color->trim();
+    }
 
-                normalIndex = _normal->size();
-                _normal->push_back(normal);
+    return indices;
+}
 
-                _numFacets++;
-                vertexCount = 0;
-            }
-        }
-        else if (strncmp(bp, "solid", 5) == 0)
-        {
-            OSG_INFO << "STL loader parsing '" << bp + 6 << "'" << std::endl;
-            _solidName = bp + 6;
-        }
-        else if (strncmp(bp, "endsolid", 8) == 0)
+ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::AsciiReaderObject::read(const char*& ptr, const char* end)
+{
+    if (!isEmpty())
+    {
+        clear();
+    }
+
+    ptr = skipSpace(ptr, end);
+    if (ptr == end)
+    {
+        return ReadEOF;
+    }
+
+    if (startsWith(ptr, end, "solid", 5))
+    {
+        const char* lineEnd = findLineEnd(ptr, end);
+        const char* nameBegin = skipSpace(ptr + 5, lineEnd);
+        const char* nameEnd = lineEnd;
+        while (nameEnd > nameBegin && isSpace(nameEnd[-1])) --nameEnd;
+
+        _solidName.assign(nameBegin, nameEnd);
+        OSG_INFO << "STL loader parsing '" << _solidName << "'" << std::endl;
+
+        ptr = lineEnd;
+    }
+
+    // count the triangles in parallel, then parse them in parallel straight into the arrays
+    ParseAsciiFacets operation(ptr, end, getNumRanges(end - ptr, MinAsciiRangeSize));
+    runRangeOperation(operation, operation._ranges.size());
+
+    const char* endSolid = operation.endSolid(_numFacets);
+    if (_numFacets > 0)
+    {
+        _vertex = new osg::Vec3Array(_numFacets * 3);
+        operation._vertices = &(*_vertex)[0];
+
+        if (_createNormals)
         {
-            OSG_INFO << "STL loader done parsing '" << _solidName << "'" << std::endl;
-            return ReadSuccess;
+            _normal = new osg::Vec3Array(_numFacets * 3);
+            operation._normals = &(*_normal)[0];
         }
+
+        runRangeOperation(operation, operation._ranges.size());
     }
 
+    if (endSolid)
+    {
+        OSG_INFO << "STL loader done parsing '" << _solidName << "'" << std::endl;
+        ptr = findLineEnd(endSolid, end);
+        return ReadSuccess;
+    }
+
+    ptr = end;
     return ReadEOF;
 }
 
-ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::BinaryReaderObject::read(FILE* fp)
+ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::BinaryReaderObject::read(const char*& ptr, const char* end)
 {
-    if (isEmpty())
+    if (!isEmpty())
     {
         clear();
     }
 
-    _numFacets = _expectNumFacets;
-
-    // seek to beginning of facets
-    ::fseek(fp, sizeof_StlHeader, SEEK_SET);
+    const char* facets = ptr + sizeof_StlHeader;
+    if (size_t(end - facets) / sizeof_StlFacet < _expectNumFacets)
+    {
+        OSG_FATAL << "ReaderWriterSTL::readStlBinary: File too short for " << _expectNumFacets << " facets" << std::endl;
+        return ReadError;
+    }
 
-    StlFacet facet;
-    for (unsigned int i = 0; i < _expectNumFacets; ++i)
+    ptr = end;
+    _numFacets = _expectNumFacets;
+    if (_numFacets == 0)
     {
-        if (::fread((void*) &facet, sizeof_StlFacet, 1, fp) != 1)
-        {
-            OSG_FATAL << "ReaderWriterSTL::readStlBinary: Failed to read facet " << i << std::endl;
-            return ReadError;
-        }
+        return ReadEOF;
+    }
 
-        // vertices
-        if (!_vertex.valid())
-            _vertex = new osg::Vec3Array;
+    _vertex = new osg::Vec3Array(_numFacets * 3);
+    if (_createNormals)
+    {
+        _normal = new osg::Vec3Array(_numFacets * 3);
+    }
 
-        osg::Vec3 v0(facet.vertex[0].x, facet.vertex[0].y, facet.vertex[0].z);
-        osg::Vec3 v1(facet.vertex[1].x, facet.vertex[1].y, facet.vertex[1].z);
-        osg::Vec3 v2(facet.vertex[2].x, facet.vertex[2].y, facet.vertex[2].z);
-        _vertex->push_back(v0);
-        _vertex->push_back(v1);
-        _vertex->push_back(v2);
+    unsigned int numRanges = getNumRanges(_numFacets, 65536);
 
-        // per-facet normal
-        osg::Vec3 normal;
-        if (_generateNormal)
-        {
-            osg::Vec3 d01 = v1 - v0;
-            osg::Vec3 d02 = v2 - v0;
-            normal = d01 ^ d02;
-            normal.normalize();
-        }
-        else
-        {
-            normal.set(facet.normal.x, facet.normal.y, facet.normal.z);
-        }
+    ConvertBinaryFacets convertFacets(facets, _numFacets, numRanges, _generateNormal,
+                                      &(*_vertex)[0], _normal.valid() ? &(*_normal)[0] : 0);
+    runRangeOperation(convertFacets, numRanges);
 
-        if (!_normal.valid())
-            _normal = new osg::Vec3Array;
-        _normal->push_back(normal);
+    // colors are only allocated if any facet has a color
+    if (convertFacets.hasColor())
+    {
+        _color = new osg::Vec4Array(_numFacets * 3);
 
-        /*
-         * color extension
-         * RGB555 with most-significat bit indicating if color is present
-         */
-        if (facet.color & StlHasColor)
-        {
-            if (!_color.valid())
-            {
-                _color = new osg::Vec4Array;
-            }
-            float r = ((facet.color >> 10) & StlColorSize) / StlColorDepth;
-            float g = ((facet.color >> 5) & StlColorSize) / StlColorDepth;
-            float b = (facet.color & StlColorSize) / StlColorDepth;
-            _color->push_back(osg::Vec4(r, g, b, 1.0f));
-        }
+        ConvertBinaryColors convertColors(facets, _numFacets, numRanges, &(*_color)[0]);
+        runRangeOperation(convertColors, numRanges);
     }
 
     return ReadEOF;
@@ -21,8 +21,21 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <sstream>
 #include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
 #include "unzip.h"
 
 #if !defined(S_ISDIR)
@@ -36,14 +49,107 @@
 #define S_ISREG(x) (((x) & S_IFMT) == S_IFREG)
 #endif
 
+namespace
+{
+
+// record signatures and sizes from the zip APPNOTE
+const unsigned int ZIP_LOCAL_HEADER_SIGNATURE = 0x04034b50;
+const unsigned int ZIP_CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+const unsigned int ZIP_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+const unsigned int ZIP_LOCAL_HEADER_SIZE = 30;
+const unsigned int ZIP_CENTRAL_HEADER_SIZE = 46;
+const unsigned int ZIP_END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+const unsigned int ZIP_MAX_COMMENT_SIZE = 65535;
+
+const unsigned int ZIP_FLAG_ENCRYPTED = 1;
+const unsigned int ZIP_METHOD_STORED = 0;
+const unsigned int ZIP_METHOD_DEFLATED = 8;
+
+inline unsigned int readUInt16(const unsigned char* ptr) { return ptr[0] | (ptr[1]<<8); }
+inline unsigned int readUInt32(const unsigned char* ptr) { return ptr[0] | (ptr[1]<<8) | (ptr[2]<<16) | (static_cast<unsigned int>(ptr[3])<<24); }
+
+unsigned int hashFileName(const std::string& name)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for(std::string::const_iterator itr = name.begin(); itr != name.end(); ++itr)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return hash;
+}
+
+// read only stream buffer over a block of memory, avoids copying entries into a std::stringstream.
+class MemoryStreamBuf : public std::streambuf
+{
+    public:
+        MemoryStreamBuf(const char* data, size_t size)
+        {
+            char* begin = const_cast<char*>(data);
+            setg(begin, begin, begin+size);
+        }
+
+    protected:
+
+        virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in)
+        {
+            if ((which & std::ios_base::in)==0) return pos_type(off_type(-1));
+
+            off_type position = 0;
+            if (dir==std::ios_base::beg) position = off;
+            else if (dir==std::ios_base::cur) position = (gptr()-eback()) + off;
+            else position = (egptr()-eback()) + off;
+
+            if (position<0 || position>(egptr()-eback())) return pos_type(off_type(-1));
+
+            setg(eback(), eback()+position, egptr());
+            return pos_type(position);
+        }
+
+        virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in)
+        {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+};
+
+}
+
+ZipArchive::EntryData::EntryData():
+    _data(0),
+    _size(0),
+    _mapping(0),
+    _mappingSize(0)
+{
+}
+
+ZipArchive::EntryData::~EntryData()
+{
+    if (_mapping)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(_mapping);
+#else
+        munmap(_mapping, _mappingSize);
+#endif
+    }
+}
 
 ZipArchive::ZipArchive()  :
-_zipLoaded( false )
+_zipLoaded( false ),
+#if defined(_WIN32)
+_fileHandle( INVALID_HANDLE_VALUE ),
+_fileMapping( NULL ),
+#else
+_fileDescriptor( -1 ),
+#endif
+_fileSize( 0 ),
+_baseOffset( 0 )
 {
 }
 
 ZipArchive::~ZipArchive()
 {
+    close();
 }
 
 /** close the archive (on all threads) */
@@ -54,15 +160,27 @@ void ZipArchive::close()
         OpenThreads::ScopedLock<OpenThreads::Mutex> exclusive(_zipMutex);
         if ( _zipLoaded )
         {
-            // close the file (on one thread since it's a shared file)
-            const PerThreadData& data = getDataNoLock();
-            CloseZip( data._zipHandle );
-
-            // clear out the file handles
+            // close the unzip handles used for encrypted entries
+            for(PerThreadDataMap::iterator itr = _perThreadData.begin(); itr != _perThreadData.end(); ++itr)
+            {
+                if (itr->second._zipHandle) CloseZip( itr->second._zipHandle );
+            }
             _perThreadData.clear();
 
+#if defined(_WIN32)
+            if (_fileMapping) CloseHandle(_fileMapping);
+            if (_fileHandle!=INVALID_HANDLE_VALUE) CloseHandle(_fileHandle);
+            _fileMapping = NULL;
+            _fileHandle = INVALID_HANDLE_VALUE;
+#else
+            if (_fileDescriptor>=0) ::close(_fileDescriptor);
+            _fileDescriptor = -1;
+#endif
+            _membuffer.clear();
+
             // clear out the index.
-            _zipIndex.clear();
+            _zipEntries.clear();
+            _hashBuckets.clear();
 
             _zipLoaded = false;
         }
@@ -86,7 +204,7 @@ std::string ZipArchive::getArchiveFileName() const
     std::string result;
     if( _zipLoaded )
     {
-        result = _mainRecord.name;
+        result = _filename;
     }
     return result;
 }
@@ -96,12 +214,16 @@ bool ZipArchive::getFileNames(osgDB::Archive::FileNameList& fileNameList) const
 {
     if(_zipLoaded)
     {
-        ZipEntryMap::const_iterator iter = _zipIndex.begin();
-
-        for(;iter != _zipIndex.end(); ++iter)
+        // return the names in alphabetical order as they were when the index was a std::map.
+        osgDB::Archive::FileNameList names;
+        for(ZipEntries::const_iterator iter = _zipEntries.begin(); iter != _zipEntries.end(); ++iter)
         {
-            fileNameList.push_back((*iter).first);
+            if (!iter->name.empty()) names.push_back(iter->name);
         }
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+
+        fileNameList.insert(fileNameList.end(), names.begin(), names.end());
 
         return true;
     }
@@ -111,7 +233,7 @@ bool ZipArchive::getFileNames(osgDB::Archive::FileNameList& fileNameList) const
     }
 }
 
-bool ZipArchive::open(const std::string& file, ArchiveStatus status, const osgDB::ReaderWriter::Options* options)
+bool ZipArchive::open(const std::string& file, ArchiveStatus /*status*/, const osgDB::ReaderWriter::Options* options)
 {
     if ( !_zipLoaded )
     {
@@ -121,22 +243,46 @@ bool ZipArchive::open(const std::string& file, ArchiveStatus status, const osgDB
         if ( !_zipLoaded ) // double-check avoids race condition
         {
             std::string ext = osgDB::getLowerCaseFileExtension(file);
-            if (!acceptsExtension(ext)) return osgDB::ReaderWriter::ReadResult::FILE_NOT_HANDLED;
+            if (!acceptsExtension(ext)) return false;
 
             // save the filename + password so other threads can open the file
             _filename = osgDB::findDataFile( file, options );
-            if (_filename.empty()) return osgDB::ReaderWriter::ReadResult::FILE_NOT_FOUND;
+            if (_filename.empty()) return false;
 
             _password = ReadPassword(options);
 
-            // open the zip file in this thread:
-            const PerThreadData& data = getDataNoLock();
+            // a single handle is shared by all threads, reads are positional so need no locking.
+#if defined(_WIN32)
+            _fileHandle = CreateFileA(_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (_fileHandle==INVALID_HANDLE_VALUE) return false;
+
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(_fileHandle, &fileSize)) fileSize.QuadPart = 0;
+            _fileSize = fileSize.QuadPart;
+
+            if (_fileSize>0) _fileMapping = CreateFileMapping(_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+#else
+            _fileDescriptor = ::open(_filename.c_str(), O_RDONLY);
+            if (_fileDescriptor<0) return false;
+
+            struct stat fileStat;
+            _fileSize = (fstat(_fileDescriptor, &fileStat)==0) ? fileStat.st_size : 0;
+#endif
 
             // establish a shared (read-only) index:
-            if ( data._zipHandle != NULL )
+            _zipLoaded = IndexZipFiles();
+
+            if (!_zipLoaded)
             {
-                IndexZipFiles( data._zipHandle );
-                _zipLoaded = true;
+#if defined(_WIN32)
+                if (_fileMapping) CloseHandle(_fileMapping);
+                CloseHandle(_fileHandle);
+                _fileMapping = NULL;
+                _fileHandle = INVALID_HANDLE_VALUE;
+#else
+                ::close(_fileDescriptor);
+                _fileDescriptor = -1;
+#endif
             }
         }
     }
@@ -153,26 +299,18 @@ bool ZipArchive::open(std::istream& fin, const osgDB::ReaderWriter::Options* opt
 
         if ( !_zipLoaded ) // double-check avoids race condition
         {
-            osgDB::ReaderWriter::ReadResult result = osgDB::ReaderWriter::ReadResult(osgDB::ReaderWriter::ReadResult::FILE_NOT_HANDLED);
-
             if (fin.fail()) return false;
 
-            // read the stream into a memory buffer that we'll keep around for any other
-            // threads that want to open the file
+            // read the stream into a memory buffer that entries are then read from directly
             std::stringstream buf;
             buf << fin.rdbuf();
             _membuffer = buf.str();
+            _fileSize = _membuffer.size();
 
             _password = ReadPassword(options);
 
-            // open on this thread:
-            const PerThreadData& data = getDataNoLock();
-
-            if ( data._zipHandle != NULL )
-            {
-                IndexZipFiles( data._zipHandle );
-                _zipLoaded = true;
-            }
+            _zipLoaded = IndexZipFiles();
+            if (!_zipLoaded) _membuffer.clear();
         }
     }
 
@@ -186,14 +324,17 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readObject(const std::string& file,
     std::string ext = osgDB::getLowerCaseFileExtension(file);
     if (!_zipLoaded || !acceptsExtension(ext)) return osgDB::ReaderWriter::ReadResult::FILE_NOT_HANDLED;
 
-    const ZIPENTRY* ze = GetZipEntry(file);
+    const ZipEntry* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            MemoryStreamBuf streamBuf(entryData.data(), entryData.size());
+            std::istream buffer(&streamBuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
             static_cast<osgDB::ReaderWriter::Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) :
@@ -219,14 +360,17 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readImage(const std::string& file,co
     std::string ext = osgDB::getLowerCaseFileExtension(file);
     if (!_zipLoaded || !acceptsExtension(ext)) return osgDB::ReaderWriter::ReadResult::FILE_NOT_HANDLED;
 
-    const ZIPENTRY* ze = GetZipEntry(file);
+    const ZipEntry* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            MemoryStreamBuf streamBuf(entryData.data(), entryData.size());
+            std::istream buffer(&streamBuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
             static_cast<osgDB::ReaderWriter::Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) :
@@ -252,14 +396,17 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readHeightField(const std::string& f
     std::string ext = osgDB::getLowerCaseFileExtension(file);
     if (!_zipLoaded || !acceptsExtension(ext)) return osgDB::ReaderWriter::ReadResult::FILE_NOT_HANDLED;
 
-    const ZIPENTRY* ze = GetZipEntry(file);
+    const ZipEntry* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            MemoryStreamBuf streamBuf(entryData.data(), entryData.size());
+            std::istream buffer(&streamBuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
             options->cloneOptions() :
@@ -285,14 +432,17 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readNode(const std::string& file,con
     std::string ext = osgDB::getLowerCaseFileExtension(file);
     if (!_zipLoaded || !acceptsExtension(ext)) return osgDB::ReaderWriter::ReadResult::FILE_NOT_HANDLED;
 
-    const ZIPENTRY* ze = GetZipEntry(file);
+    const ZipEntry* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            MemoryStreamBuf streamBuf(entryData.data(), entryData.size());
+            std::istream buffer(&streamBuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
                 options->cloneOptions() :
@@ -319,14 +469,17 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readShader(const std::string& file,c
     std::string ext = osgDB::getLowerCaseFileExtension(file);
     if (!_zipLoaded || !acceptsExtension(ext)) return osgDB::ReaderWriter::ReadResult::FILE_NOT_HANDLED;
 
-    const ZIPENTRY* ze = GetZipEntry(file);
+    const ZipEntry* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            MemoryStreamBuf streamBuf(entryData.data(), entryData.size());
+            std::istream buffer(&streamBuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
                 options->cloneOptions() :
@@ -371,39 +524,20 @@ osgDB::ReaderWriter::WriteResult ZipArchive::writeShader(const osg::Shader& /*sh
 }
 
 
-osgDB::ReaderWriter* ZipArchive::ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, std::stringstream& buffer) const
+osgDB::ReaderWriter* ZipArchive::ReadFromZipEntry(const ZipEntry* ze, const osgDB::ReaderWriter::Options* /*options*/, EntryData& entryData) const
 {
-    if (ze != 0)
+    if (ze != 0 && !ze->isDirectory)
     {
-        char* ibuf = new (std::nothrow) char[ze->unc_size];
-        if (ibuf)
+        if (readEntryData(*ze, entryData))
         {
-            // fetch the handle for the current thread:
-            const PerThreadData& data = getData();
-            if ( data._zipHandle != NULL )
-            {
-                ZRESULT result = UnzipItem(data._zipHandle, ze->index, ibuf, ze->unc_size);
-                bool unzipSuccesful = CheckZipErrorCode(result);
-                if(unzipSuccesful)
-                {
-                    buffer.write(ibuf,ze->unc_size);
-                }
-
-                delete[] ibuf;
+            std::string file_ext = osgDB::getFileExtension(ze->name);
 
-                std::string file_ext = osgDB::getFileExtension(ze->name);
-
-                osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(file_ext);
-                if (rw != NULL)
-                {
-                    return rw;
-                }
+            osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(file_ext);
+            if (rw != NULL)
+            {
+                return rw;
             }
         }
-        else
-        {
-            //std::cout << "Error- failed to allocate enough memory to unzip file '" << ze->name << ", with size '" << ze->unc_size << std::endl;
-        }
     }
 
     return NULL;
@@ -432,79 +566,354 @@ void CleanupFileString(std::string& strFileOrDir)
     }
 
     //add a beginning separator
-    if(strFileOrDir[0] != '/')
+    if(strFileOrDir.empty() || strFileOrDir[0] != '/')
     {
         strFileOrDir.insert(0, "/");
     }
 }
 
-void ZipArchive::IndexZipFiles(HZIP hz)
+// strip drive letters, leading separators and parent directory references from names stored in the archive, as the unzip code does.
+std::string SanitizeZipEntryName(const std::string& name)
 {
-    if(hz != NULL && !_zipLoaded)
+    std::string::size_type start = 0;
+    for(;;)
     {
-        //mZipRecord = hz;
+        if (start+1<name.size() && name[start+1]==':') { start += 2; continue; }
+        if (start<name.size() && (name[start]=='\\' || name[start]=='/')) { ++start; continue; }
+
+        std::string::size_type parent = std::string::npos;
+        const char* patterns[] = { "\\..\\", "\\../", "/../", "/..\\" };
+        for(unsigned int i=0; i<4 && parent==std::string::npos; ++i)
+        {
+            parent = name.find(patterns[i], start);
+        }
+        if (parent != std::string::npos) { start = parent+4; continue; }
+
+        break;
+    }
+    return name.substr(start);
+}
+
+bool ZipArchive::IndexZipFiles()
+{
+    if (_fileSize < ZIP_END_OF_CENTRAL_DIRECTORY_SIZE) return false;
 
-        GetZipItem(hz, -1, &_mainRecord);
-        int numitems = _mainRecord.index;
+    // the end of central directory record is at the end of the file, followed by a comment of up to 64k.
+    size_t tailSize = static_cast<size_t>(std::min<unsigned long long>(_fileSize, ZIP_END_OF_CENTRAL_DIRECTORY_SIZE+ZIP_MAX_COMMENT_SIZE));
+    unsigned long long tailOffset = _fileSize - tailSize;
 
-        // Now loop through each file in zip
-        for (int i = 0; i < numitems; i++)
+    std::vector<unsigned char> tail(tailSize);
+    if (!readBytes(reinterpret_cast<char*>(&tail[0]), tailOffset, tailSize)) return false;
+
+    const unsigned char* eocd = 0;
+    for(size_t i = tailSize-ZIP_END_OF_CENTRAL_DIRECTORY_SIZE+1; i>0; --i)
+    {
+        if (readUInt32(&tail[i-1])==ZIP_END_OF_CENTRAL_DIRECTORY_SIGNATURE)
         {
-            ZIPENTRY* ze = new ZIPENTRY();
+            eocd = &tail[i-1];
+            break;
+        }
+    }
 
-            GetZipItem(hz, i, ze);
-            std::string name = ze->name;
+    if (!eocd)
+    {
+        OSG_WARN << "Error loading zip file: " << _filename << ", end of central directory not found." << std::endl;
+        return false;
+    }
 
-            CleanupFileString(name);
+    unsigned int numEntries = readUInt16(eocd+10);
+    unsigned int directorySize = readUInt32(eocd+12);
+    unsigned int directoryOffset = readUInt32(eocd+16);
 
-            if(!name.empty())
-            {
-                _zipIndex.insert(ZipEntryMapping(name, ze));
-            }
+    if (numEntries==0xffff || directorySize==0xffffffff || directoryOffset==0xffffffff)
+    {
+        OSG_WARN << "Error loading zip file: " << _filename << ", zip64 archives are not supported." << std::endl;
+        return false;
+    }
+
+    // data prepended to the archive, such as a self extractor, shifts all the recorded offsets.
+    unsigned long long eocdOffset = tailOffset + (eocd - &tail[0]);
+    if (eocdOffset < static_cast<unsigned long long>(directoryOffset)+directorySize) return false;
+    _baseOffset = eocdOffset - directorySize - directoryOffset;
+
+    std::vector<unsigned char> directory(directorySize+1);
+    if (directorySize>0 && !readBytes(reinterpret_cast<char*>(&directory[0]), _baseOffset+directoryOffset, directorySize)) return false;
+
+    _zipEntries.clear();
+    _zipEntries.reserve(numEntries);
+
+    size_t pos = 0;
+    for(unsigned int i=0; i<numEntries; ++i)
+    {
+        if (pos+ZIP_CENTRAL_HEADER_SIZE > directorySize || readUInt32(&directory[pos])!=ZIP_CENTRAL_HEADER_SIGNATURE)
+        {
+            OSG_WARN << "Error loading zip file: " << _filename << ", corrupt central directory." << std::endl;
+            return false;
         }
+
+        const unsigned char* header = &directory[pos];
+        unsigned int nameLength = readUInt16(header+28);
+        unsigned int extraLength = readUInt16(header+30);
+        unsigned int commentLength = readUInt16(header+32);
+        unsigned int externalAttributes = readUInt32(header+38);
+
+        if (pos+ZIP_CENTRAL_HEADER_SIZE+nameLength > directorySize) return false;
+
+        std::string rawName(reinterpret_cast<const char*>(header+ZIP_CENTRAL_HEADER_SIZE), nameLength);
+
+        ZipEntry ze;
+        ze.index = i;
+        ze.flags = readUInt16(header+8);
+        ze.method = readUInt16(header+10);
+        ze.crc = readUInt32(header+16);
+        ze.compressedSize = readUInt32(header+20);
+        ze.uncompressedSize = readUInt32(header+24);
+        ze.localHeaderOffset = readUInt32(header+42);
+        ze.nextInBucket = -1;
+
+        // directories end in a separator, and have the MS-DOS or unix directory attribute set.
+        ze.isDirectory = (!rawName.empty() && (rawName[rawName.size()-1]=='/' || rawName[rawName.size()-1]=='\\')) ||
+                         (externalAttributes & 0x10)!=0 ||
+                         ((externalAttributes>>16) & 0170000)==0040000;
+
+        ze.name = SanitizeZipEntryName(rawName);
+        if (!ze.name.empty()) CleanupFileString(ze.name);
+
+        _zipEntries.push_back(ze);
+
+        pos += ZIP_CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
     }
+
+    // chained hash table of the entry names, sized to keep the chains short.
+    unsigned int numBuckets = 16;
+    while (numBuckets < _zipEntries.size()*2) numBuckets *= 2;
+
+    _hashBuckets.assign(numBuckets, -1);
+
+    // insert in reverse so that the first entry of a duplicated name is found first, matching the old std::map insert.
+    for(int i=static_cast<int>(_zipEntries.size())-1; i>=0; --i)
+    {
+        ZipEntry& ze = _zipEntries[i];
+        if (ze.name.empty()) continue;
+
+        unsigned int bucket = hashFileName(ze.name) & (numBuckets-1);
+        ze.nextInBucket = _hashBuckets[bucket];
+        _hashBuckets[bucket] = i;
+    }
+
+    return true;
 }
 
-ZIPENTRY* ZipArchive::GetZipEntry(const std::string& filename)
+const ZipArchive::ZipEntry* ZipArchive::GetZipEntry(const std::string& filename) const
 {
-    ZIPENTRY* ze = NULL;
+    if (_hashBuckets.empty()) return NULL;
+
     std::string fileToLoad = filename;
     CleanupFileString(fileToLoad);
 
-    ZipEntryMap::iterator iter = _zipIndex.find(fileToLoad);
-    if(iter != _zipIndex.end())
+    int index = _hashBuckets[hashFileName(fileToLoad) & (_hashBuckets.size()-1)];
+    while(index>=0)
     {
-        ze = (*iter).second;
+        const ZipEntry& ze = _zipEntries[index];
+        if (ze.name==fileToLoad) return &ze;
+        index = ze.nextInBucket;
     }
 
-    return ze;
+    return NULL;
 }
 
-const ZIPENTRY* ZipArchive::GetZipEntry(const std::string& filename) const
+bool ZipArchive::readBytes(char* dest, unsigned long long offset, size_t size) const
 {
-    ZIPENTRY* ze = NULL;
-    std::string fileToLoad = filename;
-    CleanupFileString(fileToLoad);
+    if (size==0) return true;
+    if (offset+size > _fileSize) return false;
 
-    ZipEntryMap::const_iterator iter = _zipIndex.find(fileToLoad);
-    if(iter != _zipIndex.end())
+    if (!_membuffer.empty())
     {
-        ze = (*iter).second;
+        memcpy(dest, _membuffer.data()+offset, size);
+        return true;
     }
 
-    return ze;
+#if defined(_WIN32)
+    while(size>0)
+    {
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset>>32);
+
+        DWORD toRead = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+        DWORD numRead = 0;
+        if (!ReadFile(_fileHandle, dest, toRead, &numRead, &overlapped) || numRead==0) return false;
+
+        dest += numRead;
+        offset += numRead;
+        size -= numRead;
+    }
+#else
+    while(size>0)
+    {
+        ssize_t numRead = pread(_fileDescriptor, dest, size, static_cast<off_t>(offset));
+        if (numRead<=0) return false;
+
+        dest += numRead;
+        offset += numRead;
+        size -= numRead;
+    }
+#endif
+
+    return true;
+}
+
+bool ZipArchive::mapBytes(EntryData& entryData, unsigned long long offset, size_t size) const
+{
+    if (offset+size > _fileSize) return false;
+
+    if (!_membuffer.empty())
+    {
+        entryData._data = _membuffer.data()+offset;
+        entryData._size = size;
+        return true;
+    }
+
+#if defined(_WIN32)
+    if (!_fileMapping) return false;
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    unsigned long long alignedOffset = offset - (offset % systemInfo.dwAllocationGranularity);
+    size_t mappingSize = static_cast<size_t>(offset - alignedOffset) + size;
+
+    void* mapping = MapViewOfFile(_fileMapping, FILE_MAP_READ, static_cast<DWORD>(alignedOffset>>32), static_cast<DWORD>(alignedOffset), mappingSize);
+    if (!mapping) return false;
+#else
+    long pageSize = sysconf(_SC_PAGESIZE);
+    unsigned long long alignedOffset = offset - (offset % pageSize);
+    size_t mappingSize = static_cast<size_t>(offset - alignedOffset) + size;
+
+    void* mapping = mmap(0, mappingSize, PROT_READ, MAP_SHARED, _fileDescriptor, static_cast<off_t>(alignedOffset));
+    if (mapping==MAP_FAILED) return false;
+#endif
+
+    entryData._mapping = mapping;
+    entryData._mappingSize = mappingSize;
+    entryData._data = static_cast<const char*>(mapping) + (offset - alignedOffset);
+    entryData._size = size;
+    return true;
+}
+
+bool ZipArchive::readEntryData(const ZipEntry& ze, EntryData& entryData) const
+{
+    if (ze.flags & ZIP_FLAG_ENCRYPTED)
+    {
+        return unzipEncryptedEntry(ze, entryData);
+    }
+
+    // the entry's data follows its local header, whose name and extra field lengths may differ from those in the central directory.
+    unsigned char localHeader[ZIP_LOCAL_HEADER_SIZE];
+    unsigned long long headerOffset = _baseOffset + ze.localHeaderOffset;
+    if (!readBytes(reinterpret_cast<char*>(localHeader), headerOffset, ZIP_LOCAL_HEADER_SIZE) ||
+        readUInt32(localHeader)!=ZIP_LOCAL_HEADER_SIGNATURE)
+    {
+        OSG_WARN << "Error loading zip file: " << getArchiveFileName() << ", corrupt local header for " << ze.name << std::endl;
+        return false;
+    }
+
+    unsigned long long dataOffset = headerOffset + ZIP_LOCAL_HEADER_SIZE + readUInt16(localHeader+26) + readUInt16(localHeader+28);
+
+    if (ze.method==ZIP_METHOD_STORED)
+    {
+        if (ze.compressedSize!=ze.uncompressedSize) return false;
+
+        // large entries are used in place, the mapped pages are only read in as the plugin parses them.
+        if ((!_membuffer.empty() || ze.uncompressedSize>=MMAP_THRESHOLD) &&
+            mapBytes(entryData, dataOffset, ze.uncompressedSize))
+        {
+            return true;
+        }
+
+        entryData._buffer.resize(ze.uncompressedSize);
+        if (ze.uncompressedSize>0 && !readBytes(&entryData._buffer[0], dataOffset, ze.uncompressedSize)) return false;
+    }
+    else if (ze.method==ZIP_METHOD_DEFLATED)
+    {
+        // inflate from the in memory archive directly, otherwise read all the compressed data in a single read.
+        std::vector<char> compressed;
+        const char* source = 0;
+        if (!_membuffer.empty())
+        {
+            if (dataOffset+ze.compressedSize > _fileSize) return false;
+            source = _membuffer.data()+dataOffset;
+        }
+        else
+        {
+            compressed.resize(ze.compressedSize+1);
+            if (!readBytes(&compressed[0], dataOffset, ze.compressedSize)) return false;
+            source = &compressed[0];
+        }
+
+        entryData._buffer.resize(ze.uncompressedSize+1);
+
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        if (inflateInit2(&strm, -MAX_WBITS)!=Z_OK) return false;
+
+        strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(source));
+        strm.avail_in = ze.compressedSize;
+        strm.next_out = reinterpret_cast<Bytef*>(&entryData._buffer[0]);
+        strm.avail_out = ze.uncompressedSize;
+
+        int result = inflate(&strm, Z_FINISH);
+        inflateEnd(&strm);
+
+        if (result!=Z_STREAM_END || strm.total_out!=ze.uncompressedSize)
+        {
+            OSG_WARN << "Error loading zip file: " << getArchiveFileName() << ", failed to inflate " << ze.name << std::endl;
+            return false;
+        }
+
+        entryData._buffer.resize(ze.uncompressedSize);
+    }
+    else
+    {
+        OSG_WARN << "Error loading zip file: " << getArchiveFileName() << ", unsupported compression method " << ze.method << " for " << ze.name << std::endl;
+        return false;
+    }
+
+    if (ze.uncompressedSize>0 &&
+        crc32(0L, reinterpret_cast<const Bytef*>(&entryData._buffer[0]), ze.uncompressedSize)!=ze.crc)
+    {
+        OSG_WARN << "Error loading zip file: " << getArchiveFileName() << ", CRC mismatch for " << ze.name << std::endl;
+        return false;
+    }
+
+    entryData._data = entryData._buffer.empty() ? 0 : &entryData._buffer[0];
+    entryData._size = entryData._buffer.size();
+    return true;
+}
+
+bool ZipArchive::unzipEncryptedEntry(const ZipEntry& ze, EntryData& entryData) const
+{
+    // fetch the handle for the current thread:
+    const PerThreadData& data = getData();
+    if ( data._zipHandle == NULL ) return false;
+
+    entryData._buffer.resize(ze.uncompressedSize+1);
+
+    ZRESULT result = UnzipItem(data._zipHandle, ze.index, &entryData._buffer[0], ze.uncompressedSize);
+    if (!CheckZipErrorCode(result)) return false;
+
+    entryData._buffer.resize(ze.uncompressedSize);
+    entryData._data = entryData._buffer.empty() ? 0 : &entryData._buffer[0];
+    entryData._size = entryData._buffer.size();
+    return true;
 }
 
 osgDB::FileType ZipArchive::getFileType(const std::string& filename) const
 {
-    const ZIPENTRY* ze = GetZipEntry(filename);
+    const ZipEntry* ze = GetZipEntry(filename);
     if(ze != NULL)
     {
-    #ifdef ZIP_STD
-        if (ze->attr & S_IFDIR)
-    #else
-        if (ze->attr & FILE_ATTRIBUTE_DIRECTORY)
-    #endif
+        if (ze->isDirectory)
         {
             return osgDB::DIRECTORY;
         }
@@ -521,22 +930,22 @@ osgDB::DirectoryContents ZipArchive::getDirectoryContents(const std::string& dir
 {
     osgDB::DirectoryContents dirContents;
 
-    ZipEntryMap::const_iterator iter = _zipIndex.begin();
-    ZipEntryMap::const_iterator iterEnd = _zipIndex.end();
+    std::string searchPath = dirName;
+    CleanupFileString(searchPath);
 
-    for(; iter != iterEnd; ++iter)
-    {
-        std::string searchPath = dirName;
-        CleanupFileString(searchPath);
+    osgDB::Archive::FileNameList fileNames;
+    getFileNames(fileNames);
 
-        if(iter->first.size() > searchPath.size())
+    for(osgDB::Archive::FileNameList::const_iterator iter = fileNames.begin(); iter != fileNames.end(); ++iter)
+    {
+        if(iter->size() > searchPath.size())
         {
-            size_t endSubElement = iter->first.find(searchPath);
+            size_t endSubElement = iter->find(searchPath);
 
             //we match the whole string in the beginning of the path
             if(endSubElement == 0)
             {
-                std::string remainingFile = iter->first.substr(searchPath.size() + 1, std::string::npos);
+                std::string remainingFile = iter->substr(searchPath.size() + 1, std::string::npos);
                 size_t endFileToken = remainingFile.find_first_of('/');
 
                 if(endFileToken == std::string::npos)
@@ -641,7 +1050,7 @@ ZipArchive::getDataNoLock() const
         {
             data._zipHandle = OpenZip( _filename.c_str(), _password.c_str() );
         }
-        else if ( _membuffer.empty() )
+        else if ( !_membuffer.empty() )
         {
             data._zipHandle = OpenZip( (void*)_membuffer.c_str(), _membuffer.length(), _password.c_str() );
         }
@@ -7,9 +7,17 @@
 #include <osgDB/Archive>
 #include <OpenThreads/Mutex>
 
+#include <vector>
+
 #include "unzip.h"
 
 
+/** Archive that reads the entries of a zip file.
+  * The central directory is read once into a hashed index, entries are then read with positional
+  * reads of the shared file and inflated with independent zlib streams, so any number of threads
+  * can read from the archive concurrently without locking. Large stored entries are mapped into
+  * memory rather than copied. Encrypted entries are decoded with the bundled unzip code using a
+  * handle per thread.*/
 class ZipArchive : public osgDB::Archive
 {
     public:
@@ -62,29 +70,80 @@ class ZipArchive : public osgDB::Archive
         virtual osgDB::ReaderWriter::WriteResult writeNode(const osg::Node& /*node*/, const std::string& /*fileName*/,const osgDB::ReaderWriter::Options* =NULL) const;
         virtual osgDB::ReaderWriter::WriteResult writeShader(const osg::Shader& /*shader*/, const std::string& /*fileName*/,const osgDB::ReaderWriter::Options* =NULL) const;
 
+        /** Stored entries at least this size are mapped into memory rather than read into a buffer.*/
+        static const unsigned int MMAP_THRESHOLD = 1024*1024;
+
     protected:
 
-        osgDB::ReaderWriter* ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, std::stringstream& streamIn) const;
+        /** An entry of the central directory.*/
+        struct ZipEntry
+        {
+            std::string     name;
+            int             index;
+            unsigned int    method;
+            unsigned int    flags;
+            unsigned int    crc;
+            unsigned int    compressedSize;
+            unsigned int    uncompressedSize;
+            unsigned int    localHeaderOffset;
+            bool            isDirectory;
+            int             nextInBucket;
+        };
+
+        /** The uncompressed data of an entry, either held in a buffer, mapped from the file or pointing into the in memory archive.*/
+        class EntryData
+        {
+            public:
+                EntryData();
+                ~EntryData();
+
+                const char* data() const { return _data; }
+                size_t size() const { return _size; }
+
+                std::vector<char>   _buffer;
+                const char*         _data;
+                size_t              _size;
+                void*               _mapping;
+                size_t              _mappingSize;
+
+            protected:
+                EntryData(const EntryData&) {}
+                EntryData& operator = (const EntryData&) { return *this; }
+        };
 
-        void IndexZipFiles(HZIP hz);
-        const ZIPENTRY* GetZipEntry(const std::string& filename) const;
-        ZIPENTRY* GetZipEntry(const std::string& filename);
+        osgDB::ReaderWriter* ReadFromZipEntry(const ZipEntry* ze, const osgDB::ReaderWriter::Options* options, EntryData& entryData) const;
+
+        bool IndexZipFiles();
+        const ZipEntry* GetZipEntry(const std::string& filename) const;
+
+        bool readEntryData(const ZipEntry& ze, EntryData& entryData) const;
+        bool unzipEncryptedEntry(const ZipEntry& ze, EntryData& entryData) const;
+        bool readBytes(char* dest, unsigned long long offset, size_t size) const;
+        bool mapBytes(EntryData& entryData, unsigned long long offset, size_t size) const;
 
         std::string ReadPassword(const osgDB::ReaderWriter::Options* options) const;
         bool CheckZipErrorCode(ZRESULT result) const;
 
     private:
 
-
-        typedef std::pair<std::string, ZIPENTRY*> ZipEntryMapping;
-        typedef std::map<std::string, ZIPENTRY*> ZipEntryMap;
+        typedef std::vector<ZipEntry> ZipEntries;
+        typedef std::vector<int> HashBuckets;
 
         std::string _filename, _password, _membuffer;
 
         OpenThreads::Mutex _zipMutex;
         bool               _zipLoaded;
-        ZipEntryMap        _zipIndex;
-        ZIPENTRY           _mainRecord;
+        ZipEntries         _zipEntries;
+        HashBuckets        _hashBuckets;
+
+#if defined(_WIN32)
+        void*              _fileHandle;
+        void*              _fileMapping;
+#else
+        int                _fileDescriptor;
+#endif
+        unsigned long long _fileSize;
+        unsigned long long _baseOffset;
 
         struct PerThreadData {
             HZIP _zipHandle;
@@ -99,4 +158,3 @@ class ZipArchive : public osgDB::Archive
 
 
 #endif //OSGDB_ZIPARCHIVE
-
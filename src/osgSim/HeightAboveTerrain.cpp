@@ -13,6 +13,7 @@
 
 #include <osg/CoordinateSystemNode>
 #include <osgSim/HeightAboveTerrain>
+#include "IntersectionThreads.h"
 
 #include <osg/Notify>
 #include <osgUtil/LineSegmentIntersector>
@@ -22,6 +23,7 @@ using namespace osgSim;
 HeightAboveTerrain::HeightAboveTerrain()
 {
     _lowestHeight = -1000.0;
+    _numThreads = 0;
 
     setDatabaseCacheReadCallback(new DatabaseCacheReadCallback);
 }
@@ -43,7 +45,8 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
     osg::CoordinateSystemNode* csn = dynamic_cast<osg::CoordinateSystemNode*>(scene);
     osg::EllipsoidModel* em = csn ? csn->getEllipsoidModel() : 0;
 
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    IntersectorList intersectors;
+    intersectors.reserve(_HATList.size());
 
     for(HATList::iterator itr = _HATList.begin();
         itr != _HATList.end();
@@ -61,10 +64,9 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
 
             itr->_hat = height;
 
-            OSG_NOTICE<<"lat = "<<latitude<<" longitude = "<<longitude<<" height = "<<height<<std::endl;
+            OSG_INFO<<"lat = "<<latitude<<" longitude = "<<longitude<<" height = "<<height<<std::endl;
 
-            osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(start, end);
-            intersectorGroup->addIntersector( intersector.get() );
+            intersectors.push_back( new osgUtil::LineSegmentIntersector(start, end) );
         }
         else
         {
@@ -76,34 +78,23 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
 
             itr->_hat = height;
 
-            osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector( start, end);
-            intersectorGroup->addIntersector( intersector.get() );
+            intersectors.push_back( new osgUtil::LineSegmentIntersector(start, end) );
         }
     }
 
-    _intersectionVisitor.reset();
-    _intersectionVisitor.setTraversalMask(traversalMask);
-    _intersectionVisitor.setIntersector( intersectorGroup.get() );
+    computeIntersectionsInParallel(scene, intersectors, _intersectionVisitor, _dcrc.get(), traversalMask, _numThreads);
 
-    scene->accept(_intersectionVisitor);
-
-    unsigned int index = 0;
-    osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
-    for(osgUtil::IntersectorGroup::Intersectors::iterator intersector_itr = intersectors.begin();
-        intersector_itr != intersectors.end();
-        ++intersector_itr, ++index)
+    for(unsigned int index = 0; index < intersectors.size(); ++index)
     {
-        osgUtil::LineSegmentIntersector* lsi = dynamic_cast<osgUtil::LineSegmentIntersector*>(intersector_itr->get());
-        if (lsi)
+        osgUtil::LineSegmentIntersector* lsi = static_cast<osgUtil::LineSegmentIntersector*>(intersectors[index].get());
+
+        osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
+        if (!intersections.empty())
         {
-            osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
-            if (!intersections.empty())
-            {
-                const osgUtil::LineSegmentIntersector::Intersection& intersection = *intersections.begin();
-                osg::Vec3d intersectionPoint = intersection.matrix.valid() ? intersection.localIntersectionPoint * (*intersection.matrix) :
-                                               intersection.localIntersectionPoint;
-                _HATList[index]._hat = (_HATList[index]._point - intersectionPoint).length();
-            }
+            const osgUtil::LineSegmentIntersector::Intersection& intersection = *intersections.begin();
+            osg::Vec3d intersectionPoint = intersection.matrix.valid() ? intersection.localIntersectionPoint * (*intersection.matrix) :
+                                           intersection.localIntersectionPoint;
+            _HATList[index]._hat = (_HATList[index]._point - intersectionPoint).length();
         }
     }
 
@@ -0,0 +1,35 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef OSGSIM_INTERSECTIONTHREADS
+#define OSGSIM_INTERSECTIONTHREADS 1
+
+#include <osgSim/LineOfSight>
+
+#include <vector>
+
+namespace osgSim {
+
+typedef std::vector< osg::ref_ptr<osgUtil::Intersector> > IntersectorList;
+
+/** Intersect the scene with a list of intersectors, splitting the list into contiguous ranges that are each
+  * traversed by their own IntersectionVisitor on a separate thread, the calling thread traversing the first range with iv.
+  * Results are left in the intersectors so can be collected in the order of the list.
+  * A numThreads of 0 uses one thread per processor. External tiles are read via dcrc when it is non null.*/
+extern void computeIntersectionsInParallel(osg::Node* scene, IntersectorList& intersectors, osgUtil::IntersectionVisitor& iv,
+                                           DatabaseCacheReadCallback* dcrc, osg::Node::NodeMask traversalMask,
+                                           unsigned int numThreads);
+
+}
+
+#endif
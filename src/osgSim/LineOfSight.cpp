@@ -12,82 +12,543 @@
 */
 
 #include <osgSim/LineOfSight>
+#include "IntersectionThreads.h"
 
+#include <osg/Geode>
+#include <osg/Geometry>
 #include <osg/Notify>
+#include <osg/Texture>
+#include <osg/Timer>
+#include <OpenThreads/Thread>
 #include <osgDB/ReadFile>
 #include <osgUtil/LineSegmentIntersector>
 
+#include <set>
+
 using namespace osgSim;
 
+namespace
+{
+
+/** Estimate the memory used by a loaded subgraph from the sizes of its vertex arrays, primitive sets and images,
+  * counting shared objects once.*/
+class ComputeSizeVisitor : public osg::NodeVisitor
+{
+    public:
+
+        ComputeSizeVisitor():
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _sizeInBytes(0) {}
+
+        virtual void apply(osg::Node& node)
+        {
+            applyStateSet(node.getStateSet());
+            traverse(node);
+        }
+
+        virtual void apply(osg::Geode& geode)
+        {
+            applyStateSet(geode.getStateSet());
+            for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+            {
+                osg::Drawable* drawable = geode.getDrawable(i);
+                if (!drawable || !_visited.insert(drawable).second) continue;
+
+                applyStateSet(drawable->getStateSet());
+
+                osg::Geometry* geometry = drawable->asGeometry();
+                if (!geometry) continue;
+
+                osg::Geometry::ArrayList arrays;
+                geometry->getArrayList(arrays);
+                for(osg::Geometry::ArrayList::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+                {
+                    if (_visited.insert(itr->get()).second) _sizeInBytes += (*itr)->getTotalDataSize();
+                }
+
+                osg::Geometry::PrimitiveSetList& primitives = geometry->getPrimitiveSetList();
+                for(osg::Geometry::PrimitiveSetList::iterator itr = primitives.begin(); itr != primitives.end(); ++itr)
+                {
+                    if (_visited.insert(itr->get()).second) _sizeInBytes += (*itr)->getTotalDataSize();
+                }
+            }
+            traverse(geode);
+        }
+
+        void applyStateSet(osg::StateSet* stateset)
+        {
+            if (!stateset || !_visited.insert(stateset).second) return;
+
+            const osg::StateSet::TextureAttributeList& tal = stateset->getTextureAttributeList();
+            for(osg::StateSet::TextureAttributeList::const_iterator unitItr = tal.begin(); unitItr != tal.end(); ++unitItr)
+            {
+                for(osg::StateSet::AttributeList::const_iterator itr = unitItr->begin(); itr != unitItr->end(); ++itr)
+                {
+                    const osg::Texture* texture = itr->second.first->asTexture();
+                    if (!texture) continue;
+
+                    for(unsigned int i=0; i<texture->getNumImages(); ++i)
+                    {
+                        const osg::Image* image = texture->getImage(i);
+                        if (image && _visited.insert(image).second) _sizeInBytes += image->getTotalSizeInBytesIncludingMipmaps();
+                    }
+                }
+            }
+        }
+
+        std::size_t _sizeInBytes;
+
+    protected:
+
+        std::set<const osg::Referenced*> _visited;
+};
+
+/** Files to be read in parallel, each read thread takes the next unread file until none remain.*/
+struct ReadQueue
+{
+    ReadQueue(const std::vector<std::string>& filenames):
+        _filenames(filenames),
+        _nodes(filenames.size()),
+        _next(0) {}
+
+    bool takeNext(unsigned int& index)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        if (_next>=_filenames.size()) return false;
+        index = _next++;
+        return true;
+    }
+
+    void read()
+    {
+        unsigned int index;
+        while(takeNext(index))
+        {
+            _nodes[index] = osgDB::readNodeFile(_filenames[index]);
+        }
+    }
+
+    const std::vector<std::string>&         _filenames;
+    std::vector< osg::ref_ptr<osg::Node> >  _nodes;
+    OpenThreads::Mutex                      _mutex;
+    unsigned int                            _next;
+};
+
+class ReadThread : public OpenThreads::Thread
+{
+    public:
+
+        ReadThread(ReadQueue& queue): _queue(queue) {}
+
+        virtual void run() { _queue.read(); }
+
+    protected:
+
+        ReadQueue& _queue;
+};
+
+void intersect(osg::Node* scene, osgUtil::IntersectionVisitor& iv, DatabaseCacheReadCallback* dcrc)
+{
+    if (dcrc) dcrc->computeIntersections(scene, iv);
+    else scene->accept(iv);
+}
+
+class IntersectionThread : public OpenThreads::Thread
+{
+    public:
+
+        IntersectionThread(osg::Node* scene, osgUtil::IntersectionVisitor* iv, DatabaseCacheReadCallback* dcrc):
+            _scene(scene),
+            _iv(iv),
+            _dcrc(dcrc) {}
+
+        virtual void run() { intersect(_scene, *_iv, _dcrc); }
+
+    protected:
+
+        osg::Node*                      _scene;
+        osgUtil::IntersectionVisitor*   _iv;
+        DatabaseCacheReadCallback*      _dcrc;
+};
+
+}
+
+/** ReadCallback used by DatabaseCacheReadCallback::computeIntersections(..), returns the tiles already in the
+  * cache and records the ones that are missing so that they can be read together once the traversal completes.*/
+class DatabaseCacheReadCallback::GatherReadCallback : public osgUtil::IntersectionVisitor::ReadCallback
+{
+    public:
+
+        typedef std::set<std::string> FileNames;
+
+        GatherReadCallback(DatabaseCacheReadCallback* cache):
+            _cache(cache),
+            _readImmediately(false) {}
+
+        virtual osg::Node* readNodeFile(const std::string& filename)
+        {
+            if (_failed.count(filename)!=0) return 0;
+
+            osg::Node* node = _cache->getFromCache(filename);
+            if (node)
+            {
+                if (_requested.insert(filename).second)
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_cache->_mutex);
+                    ++(_cache->_statistics.numHits);
+                }
+                return node;
+            }
+
+            if (_loaded.count(filename)!=0)
+            {
+                // a tile read earlier in this call has already been pruned from the cache, so the tiles needed don't
+                // all fit in the cache at once, fall back to reading the remaining tiles as the traversal needs them.
+                _readImmediately = true;
+            }
+
+            if (_readImmediately)
+            {
+                node = _cache->readNodeFile(filename);
+                if (!node) _failed.insert(filename);
+                return node;
+            }
+
+            _requested.insert(filename);
+            _pending.insert(filename);
+            return 0;
+        }
+
+        DatabaseCacheReadCallback*  _cache;
+        bool                        _readImmediately;
+        FileNames                   _requested;
+        FileNames                   _pending;
+        FileNames                   _loaded;
+        FileNames                   _failed;
+};
+
 DatabaseCacheReadCallback::DatabaseCacheReadCallback()
 {
     _maxNumFilesToCache = 2000;
+    _maxCacheSizeInBytes = 512*1024*1024;
+    _numReadThreads = 4;
+    _cacheSizeInBytes = 0;
 }
 
 void DatabaseCacheReadCallback::clearDatabaseCache()
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
     _filenameSceneMap.clear();
+    _lruList.clear();
+    _cacheSizeInBytes = 0;
 }
 
 void DatabaseCacheReadCallback::pruneUnusedDatabaseCache()
 {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    FileNameSceneMap::iterator itr = _filenameSceneMap.begin();
+    while(itr != _filenameSceneMap.end())
+    {
+        FileNameSceneMap::iterator current = itr++;
+        if (current->second.node->referenceCount()==1)
+        {
+            eraseFromCache(current);
+            ++_statistics.numEvicted;
+        }
+    }
+}
+
+unsigned int DatabaseCacheReadCallback::getNumFilesCached() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return _filenameSceneMap.size();
 }
 
-osg::Node* DatabaseCacheReadCallback::readNodeFile(const std::string& filename)
+std::size_t DatabaseCacheReadCallback::getCacheSizeInBytes() const
 {
-    // first check to see if file is already loaded.
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return _cacheSizeInBytes;
+}
+
+DatabaseCacheReadCallback::Statistics DatabaseCacheReadCallback::getStatistics() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return _statistics;
+}
+
+void DatabaseCacheReadCallback::resetStatistics()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _statistics = Statistics();
+}
+
+osg::Node* DatabaseCacheReadCallback::getFromCache(const std::string& filename)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    FileNameSceneMap::iterator itr = _filenameSceneMap.find(filename);
+    if (itr == _filenameSceneMap.end()) return 0;
+
+    // move to the front of the list as the most recently used.
+    _lruList.splice(_lruList.begin(), _lruList, itr->second.lruItr);
+
+    return itr->second.node.get();
+}
+
+void DatabaseCacheReadCallback::addToCache(const std::string& filename, osg::Node* node)
+{
+    ComputeSizeVisitor csv;
+    node->accept(csv);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // another thread may have read the same file in the meantime, keep the copy already cached.
+    if (_filenameSceneMap.count(filename)!=0) return;
+
+    OSG_INFO<<"Inserting into cache "<<filename<<std::endl;
+
+    _lruList.push_front(filename);
+
+    CacheEntry& entry = _filenameSceneMap[filename];
+    entry.node = node;
+    entry.sizeInBytes = csv._sizeInBytes;
+    entry.lruItr = _lruList.begin();
+    _cacheSizeInBytes += entry.sizeInBytes;
+
+    pruneCache();
+}
+
+void DatabaseCacheReadCallback::pruneCache()
+{
+    FileNameList::iterator itr = _lruList.end();
+    while((_filenameSceneMap.size() > _maxNumFilesToCache || _cacheSizeInBytes > _maxCacheSizeInBytes) &&
+          itr != _lruList.begin())
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        FileNameList::iterator previous = itr;
+        --previous;
 
-        FileNameSceneMap::iterator itr = _filenameSceneMap.find(filename);
-        if (itr != _filenameSceneMap.end())
+        FileNameSceneMap::iterator sitr = _filenameSceneMap.find(*previous);
+        if (sitr->second.node->referenceCount()==1)
         {
-            OSG_INFO<<"Getting from cache "<<filename<<std::endl;
-
-            return itr->second.get();
+            OSG_INFO<<"Erasing "<<sitr->first<<std::endl;
+            // found a node which is only referenced in the cache so we can discard it
+            // and know that the actual memory will be released.
+            eraseFromCache(sitr);
+            ++_statistics.numEvicted;
+        }
+        else
+        {
+            itr = previous;
         }
     }
+}
+
+void DatabaseCacheReadCallback::eraseFromCache(FileNameSceneMap::iterator itr)
+{
+    _cacheSizeInBytes -= itr->second.sizeInBytes;
+    _lruList.erase(itr->second.lruItr);
+    _filenameSceneMap.erase(itr);
+}
+
+osg::Node* DatabaseCacheReadCallback::readNodeFile(const std::string& filename)
+{
+    // first check to see if file is already loaded.
+    osg::Node* cachedNode = getFromCache(filename);
+    if (cachedNode)
+    {
+        OSG_INFO<<"Getting from cache "<<filename<<std::endl;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        ++_statistics.numHits;
+        return cachedNode;
+    }
 
     // now load the file.
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
     osg::ref_ptr<osg::Node> node = osgDB::readNodeFile(filename);
+    double readTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
 
-    // insert into the cache.
-    if (node.valid())
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        ++_statistics.numMisses;
+        _statistics.stallTime += readTime;
+    }
+
+    // insert into the cache.
+    if (node.valid()) addToCache(filename, node.get());
+
+    return node.release();
+}
 
-        if (_filenameSceneMap.size() < _maxNumFilesToCache)
+void DatabaseCacheReadCallback::computeIntersections(osg::Node* scene, osgUtil::IntersectionVisitor& iv)
+{
+    osg::ref_ptr<osgUtil::IntersectionVisitor::ReadCallback> previousReadCallback = iv.getReadCallback();
+
+    if (_numReadThreads==0)
+    {
+        iv.setReadCallback(this);
+        iv.reset();
+        scene->accept(iv);
+        iv.setReadCallback(previousReadCallback.get());
+        return;
+    }
+
+    osg::ref_ptr<GatherReadCallback> gatherReadCallback = new GatherReadCallback(this);
+    iv.setReadCallback(gatherReadCallback.get());
+
+    unsigned int numTraversals = 0;
+    unsigned int numRead = 0;
+    double readTime = 0.0;
+
+    for(;;)
+    {
+        iv.reset();
+        scene->accept(iv);
+        ++numTraversals;
+
+        if (gatherReadCallback->_pending.empty()) break;
+
+        // claim the missing tiles that no other traversal is already reading.
+        std::vector<std::string> filenames;
+        std::vector<std::string> filenamesReadElsewhere;
         {
-            OSG_INFO<<"Inserting into cache "<<filename<<std::endl;
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            for(GatherReadCallback::FileNames::iterator itr = gatherReadCallback->_pending.begin();
+                itr != gatherReadCallback->_pending.end();
+                ++itr)
+            {
+                if (_filenameSceneMap.count(*itr)!=0) gatherReadCallback->_loaded.insert(*itr);
+                else if (_filesBeingRead.insert(*itr).second) filenames.push_back(*itr);
+                else filenamesReadElsewhere.push_back(*itr);
+            }
+        }
+        gatherReadCallback->_pending.clear();
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+        // read the claimed tiles, the calling thread reads alongside the read threads.
+        ReadQueue queue(filenames);
+        unsigned int numThreads = osg::minimum(_numReadThreads, static_cast<unsigned int>(filenames.size()));
 
-            _filenameSceneMap[filename] = node;
+        std::vector<ReadThread*> threads;
+        for(unsigned int i=1; i<numThreads; ++i)
+        {
+            threads.push_back(new ReadThread(queue));
+            threads.back()->start();
         }
-        else
+
+        queue.read();
+
+        for(std::vector<ReadThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
         {
-            // for time being implement a crude search for a candidate to chuck out from the cache.
-            for(FileNameSceneMap::iterator itr = _filenameSceneMap.begin();
-                itr != _filenameSceneMap.end();
-                ++itr)
+            (*itr)->join();
+            delete *itr;
+        }
+
+        unsigned int numLoaded = 0;
+        for(unsigned int i=0; i<filenames.size(); ++i)
+        {
+            if (queue._nodes[i].valid())
             {
-                if (itr->second->referenceCount()==1)
-                {
-                    OSG_NOTICE<<"Erasing "<<itr->first<<std::endl;
-                    // found a node which is only referenced in the cache so we can discard it
-                    // and know that the actual memory will be released.
-                    _filenameSceneMap.erase(itr);
-                    break;
-                }
+                addToCache(filenames[i], queue._nodes[i].get());
+                gatherReadCallback->_loaded.insert(filenames[i]);
+                ++numLoaded;
+            }
+            else
+            {
+                OSG_INFO<<"DatabaseCacheReadCallback : unable to read "<<filenames[i]<<std::endl;
+                gatherReadCallback->_failed.insert(filenames[i]);
             }
-            OSG_INFO<<"And the replacing with "<<filename<<std::endl;
-            _filenameSceneMap[filename] = node;
         }
+        numRead += filenames.size();
+
+        // release the batch so the tiles just read can be pruned if they took the cache over its limits.
+        queue._nodes.clear();
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        for(std::vector<std::string>::iterator itr = filenames.begin(); itr != filenames.end(); ++itr)
+        {
+            _filesBeingRead.erase(*itr);
+        }
+        if (!filenames.empty()) _filesReadCondition.broadcast();
+
+        // wait for the tiles being read by other traversals, if one of these fails the next traversal will retry it.
+        for(std::vector<std::string>::iterator itr = filenamesReadElsewhere.begin(); itr != filenamesReadElsewhere.end(); ++itr)
+        {
+            while(_filesBeingRead.count(*itr)!=0) _filesReadCondition.wait(&_mutex);
+            gatherReadCallback->_loaded.insert(*itr);
+        }
+
+        double batchTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+        readTime += batchTime;
+
+        _statistics.numPrefetched += numLoaded;
+        _statistics.stallTime += batchTime;
+        pruneCache();
     }
 
-    return node.release();
+    iv.setReadCallback(previousReadCallback.get());
+
+    if (numRead>0)
+    {
+        OSG_INFO<<"DatabaseCacheReadCallback : read "<<numRead<<" tiles in "<<readTime<<"s over "<<numTraversals<<" traversals, "
+                <<"cache holds "<<getNumFilesCached()<<" files, "<<getCacheSizeInBytes()<<" bytes, "
+                <<"hit rate "<<getStatistics().getHitRate()<<std::endl;
+    }
 }
 
-LineOfSight::LineOfSight()
+void osgSim::computeIntersectionsInParallel(osg::Node* scene, IntersectorList& intersectors, osgUtil::IntersectionVisitor& iv,
+                                            DatabaseCacheReadCallback* dcrc, osg::Node::NodeMask traversalMask,
+                                            unsigned int numThreads)
+{
+    if (numThreads==0) numThreads = static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    // each thread traverses the whole scene, so only split the list when every range has enough intersectors to pay for that.
+    const unsigned int minNumIntersectorsPerThread = 32;
+    unsigned int numIntersectors = intersectors.size();
+    numThreads = osg::clampBetween(numIntersectors/minNumIntersectorsPerThread, 1u, numThreads);
+
+    std::vector< osg::ref_ptr<osgUtil::IntersectionVisitor> > visitors;
+    std::vector<IntersectionThread*> threads;
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+        for(unsigned int j=numIntersectors*i/numThreads; j<numIntersectors*(i+1)/numThreads; ++j)
+        {
+            intersectorGroup->addIntersector( intersectors[j].get() );
+        }
+
+        osgUtil::IntersectionVisitor* visitor = &iv;
+        if (i>0)
+        {
+            visitors.push_back(new osgUtil::IntersectionVisitor(0, iv.getReadCallback()));
+            visitor = visitors.back().get();
+        }
+
+        visitor->reset();
+        visitor->setTraversalMask(traversalMask);
+        visitor->setIntersector( intersectorGroup.get() );
+
+        if (i>0)
+        {
+            threads.push_back(new IntersectionThread(scene, visitor, dcrc));
+            threads.back()->start();
+        }
+    }
+
+    intersect(scene, iv, dcrc);
+
+    for(std::vector<IntersectionThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+LineOfSight::LineOfSight():
+    _numThreads(0)
 {
     setDatabaseCacheReadCallback(new DatabaseCacheReadCallback);
 }
@@ -106,44 +567,34 @@ unsigned int LineOfSight::addLOS(const osg::Vec3d& start, const osg::Vec3d& end)
 
 void LineOfSight::computeIntersections(osg::Node* scene, osg::Node::NodeMask traversalMask)
 {
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    IntersectorList intersectors;
+    intersectors.reserve(_LOSList.size());
 
     for(LOSList::iterator itr = _LOSList.begin();
         itr != _LOSList.end();
         ++itr)
     {
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(itr->_start, itr->_end);
-        intersectorGroup->addIntersector( intersector.get() );
+        intersectors.push_back( new osgUtil::LineSegmentIntersector(itr->_start, itr->_end) );
     }
 
-    _intersectionVisitor.reset();
-    _intersectionVisitor.setTraversalMask(traversalMask);
-    _intersectionVisitor.setIntersector( intersectorGroup.get() );
-
-    scene->accept(_intersectionVisitor);
+    computeIntersectionsInParallel(scene, intersectors, _intersectionVisitor, _dcrc.get(), traversalMask, _numThreads);
 
-    unsigned int index = 0;
-    osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
-    for(osgUtil::IntersectorGroup::Intersectors::iterator intersector_itr = intersectors.begin();
-        intersector_itr != intersectors.end();
-        ++intersector_itr, ++index)
+    for(unsigned int index = 0; index < intersectors.size(); ++index)
     {
-        osgUtil::LineSegmentIntersector* lsi = dynamic_cast<osgUtil::LineSegmentIntersector*>(intersector_itr->get());
-        if (lsi)
-        {
-            Intersections& intersectionsLOS = _LOSList[index]._intersections;
-            _LOSList[index]._intersections.clear();
+        osgUtil::LineSegmentIntersector* lsi = static_cast<osgUtil::LineSegmentIntersector*>(intersectors[index].get());
 
-            osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
+        Intersections& intersectionsLOS = _LOSList[index]._intersections;
+        intersectionsLOS.clear();
 
-            for(osgUtil::LineSegmentIntersector::Intersections::iterator itr = intersections.begin();
-                itr != intersections.end();
-                ++itr)
-            {
-                const osgUtil::LineSegmentIntersector::Intersection& intersection = *itr;
-                if (intersection.matrix.valid()) intersectionsLOS.push_back( intersection.localIntersectionPoint * (*intersection.matrix) );
-                else intersectionsLOS.push_back( intersection.localIntersectionPoint  );
-            }
+        osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
+
+        for(osgUtil::LineSegmentIntersector::Intersections::iterator itr = intersections.begin();
+            itr != intersections.end();
+            ++itr)
+        {
+            const osgUtil::LineSegmentIntersector::Intersection& intersection = *itr;
+            if (intersection.matrix.valid()) intersectionsLOS.push_back( intersection.localIntersectionPoint * (*intersection.matrix) );
+            else intersectionsLOS.push_back( intersection.localIntersectionPoint  );
         }
     }
 
@@ -27,9 +27,14 @@
 #include <osg/Math>
 #include <osg/Timer>
 
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+
 using namespace osgTerrain;
 
-GeometryTechnique::GeometryTechnique()
+GeometryTechnique::GeometryTechnique():
+    _numThreads(0)
 {
     setFilterBias(0);
     setFilterWidth(0.1);
@@ -38,7 +43,8 @@ GeometryTechnique::GeometryTechnique()
 }
 
 GeometryTechnique::GeometryTechnique(const GeometryTechnique& gt,const osg::CopyOp& copyop):
-    TerrainTechnique(gt,copyop)
+    TerrainTechnique(gt,copyop),
+    _numThreads(gt._numThreads)
 {
     setFilterBias(gt._filterBias);
     setFilterWidth(gt._filterWidth);
@@ -49,6 +55,42 @@ GeometryTechnique::~GeometryTechnique()
 {
 }
 
+GeometryTechnique::GridData::GridData():
+    _numColumns(0),
+    _numRows(0),
+    _scaleHeight(1.0f),
+    _elevationRegionDirty(false),
+    _minDirtyColumn(0),
+    _minDirtyRow(0),
+    _maxDirtyColumn(0),
+    _maxDirtyRow(0)
+{
+}
+
+GeometryTechnique::GridData::GridData(const GridData& rhs):
+    osg::Referenced(),
+    _numColumns(rhs._numColumns),
+    _numRows(rhs._numRows),
+    _scaleHeight(rhs._scaleHeight),
+    _centerModel(rhs._centerModel),
+    _masterLocator(rhs._masterLocator),
+    _elevationLayer(rhs._elevationLayer),
+    _colorLayers(rhs._colorLayers),
+    _valid(rhs._valid),
+    _elevationRegionDirty(rhs._elevationRegionDirty),
+    _minDirtyColumn(rhs._minDirtyColumn),
+    _minDirtyRow(rhs._minDirtyRow),
+    _maxDirtyColumn(rhs._maxDirtyColumn),
+    _maxDirtyRow(rhs._maxDirtyRow)
+{
+    if (rhs._vertices.valid()) _vertices = new osg::Vec3Array(*rhs._vertices);
+    if (rhs._upVectors.valid()) _upVectors = new osg::Vec3Array(*rhs._upVectors);
+    for(TexCoordArrays::const_iterator itr = rhs._texCoords.begin(); itr != rhs._texCoords.end(); ++itr)
+    {
+        _texCoords.push_back(itr->valid() ? new osg::Vec2Array(**itr) : 0);
+    }
+}
+
 void GeometryTechnique::setFilterBias(float filterBias)
 {
     _filterBias = filterBias;
@@ -108,6 +150,27 @@ void GeometryTechnique::init(int dirtyMask, bool assumeMultiThreaded)
 
     osg::ref_ptr<BufferData> buffer = new BufferData;
 
+    // when only the edges, or a region of the elevation layer, have changed pass on the grid of the most
+    // recently generated geometry so that generateGeometry() can update it rather than start from scratch.
+    osg::ref_ptr<BufferData> previous_buffer = _newBufferData.valid() ? _newBufferData : _currentBufferData;
+    if (previous_buffer.valid() && previous_buffer->_gridData.valid() && (dirtyMask & TerrainTile::IMAGERY_DIRTY)==0)
+    {
+        unsigned int minColumn, minRow, maxColumn, maxRow;
+        if ((dirtyMask & TerrainTile::ELEVATION_DIRTY)==0)
+        {
+            buffer->_gridData = previous_buffer->_gridData;
+        }
+        else if (tile->getElevationDirtyRegion(minColumn, minRow, maxColumn, maxRow))
+        {
+            buffer->_gridData = new GridData(*previous_buffer->_gridData);
+            buffer->_gridData->_elevationRegionDirty = true;
+            buffer->_gridData->_minDirtyColumn = minColumn;
+            buffer->_gridData->_minDirtyRow = minRow;
+            buffer->_gridData->_maxDirtyColumn = maxColumn;
+            buffer->_gridData->_maxDirtyRow = maxRow;
+        }
+    }
+
     Locator* masterLocator = computeMasterLocator();
 
     osg::Vec3d centerModel = computeCenterModel(*buffer, masterLocator);
@@ -232,6 +295,215 @@ osg::Vec3d GeometryTechnique::computeCenterModel(BufferData& buffer, Locator* ma
     return centerModel;
 }
 
+namespace
+{
+
+/** Work done on a range of rows of the tile grid, used to split the generation of a tile across threads.*/
+struct RowOperation
+{
+    virtual ~RowOperation() {}
+    virtual void operator () (int beginRow, int endRow) = 0;
+};
+
+class RowOperationThread : public OpenThreads::Thread
+{
+    public:
+
+        RowOperationThread(RowOperation& operation, int beginRow, int endRow):
+            _operation(operation),
+            _beginRow(beginRow),
+            _endRow(endRow) {}
+
+        virtual void run() { _operation(_beginRow, _endRow); }
+
+    protected:
+
+        RowOperation&   _operation;
+        int             _beginRow;
+        int             _endRow;
+};
+
+void runRowOperation(RowOperation& operation, int beginRow, int endRow, unsigned int numThreads)
+{
+    if (numThreads==0) numThreads = static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    // only split the rows when every range has enough work to pay for starting a thread.
+    const int minNumRowsPerThread = 32;
+    int numRows = endRow-beginRow;
+    if (numRows<=0) return;
+    numThreads = osg::clampBetween(static_cast<unsigned int>(numRows/minNumRowsPerThread), 1u, numThreads);
+
+    // the calling thread takes the first range itself
+    std::vector<RowOperationThread*> threads;
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        threads.push_back(new RowOperationThread(operation, beginRow+numRows*i/numThreads, beginRow+numRows*(i+1)/numThreads));
+        threads.back()->start();
+    }
+
+    operation(beginRow, beginRow+numRows/numThreads);
+
+    for(std::vector<RowOperationThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+/** Compute the validity, model position, up vector and texture coordinates of the points of the tile grid
+  * that lie in a block of columns, writing them to arrays with one entry per grid point.*/
+class PopulateGridOperation : public RowOperation
+{
+    public:
+
+        typedef std::vector< std::pair<Layer*, Locator*> > ColorLayerLocators;
+
+        PopulateGridOperation(Locator* masterLocator, const osg::Vec3d& centerModel, int numColumns, int numRows, float scaleHeight,
+                              osgTerrain::Layer* elevationLayer, const ColorLayerLocators& colorLayerLocators,
+                              std::vector<unsigned char>& valid, osg::Vec3Array& vertices, osg::Vec3Array& upVectors,
+                              std::vector< osg::ref_ptr<osg::Vec2Array> >& texCoords,
+                              int beginColumn, int endColumn):
+            _masterLocator(masterLocator),
+            _centerModel(centerModel),
+            _numColumns(numColumns),
+            _numRows(numRows),
+            _scaleHeight(scaleHeight),
+            _elevationLayer(elevationLayer),
+            _colorLayerLocators(colorLayerLocators),
+            _valid(valid),
+            _vertices(vertices),
+            _upVectors(upVectors),
+            _texCoords(texCoords),
+            _beginColumn(beginColumn),
+            _endColumn(endColumn)
+        {
+            _sampled = elevationLayer &&
+                       ( (elevationLayer->getNumRows()!=static_cast<unsigned int>(_numRows)) ||
+                         (elevationLayer->getNumColumns()!=static_cast<unsigned int>(_numColumns)) );
+        }
+
+        virtual void operator () (int beginRow, int endRow)
+        {
+            for(int j=beginRow; j<endRow; ++j)
+            {
+                for(int i=_beginColumn; i<_endColumn; ++i)
+                {
+                    populate(i, j, j*_numColumns+i);
+                }
+            }
+        }
+
+        void populate(int i, int j, unsigned int gi)
+        {
+            osg::Vec3d ndc( ((double)i)/(double)(_numColumns-1), ((double)j)/(double)(_numRows-1), 0.0);
+
+            bool validValue = true;
+            if (_elevationLayer)
+            {
+                float value = 0.0f;
+                if (_sampled) validValue = _elevationLayer->getInterpolatedValidValue(ndc.x(), ndc.y(), value);
+                else validValue = _elevationLayer->getValidValue(i,j,value);
+                ndc.z() = value*_scaleHeight;
+            }
+
+            _valid[gi] = validValue ? 1 : 0;
+
+            // texture coordinates are computed for invalid points too, as equalizing the tile boundaries can
+            // fill them in from the neighbouring tiles.
+            for(unsigned int t=0; t<_colorLayerLocators.size(); ++t)
+            {
+                osg::Vec2& texcoord = (*_texCoords[t])[gi];
+                osgTerrain::ImageLayer* imageLayer(dynamic_cast<osgTerrain::ImageLayer*>(_colorLayerLocators[t].first));
+
+                if (imageLayer != NULL)
+                {
+                    Locator* colorLocator = _colorLayerLocators[t].second;
+                    if (colorLocator != _masterLocator)
+                    {
+                        osg::Vec3d color_ndc;
+                        Locator::convertLocalCoordBetween(*_masterLocator, ndc, *colorLocator, color_ndc);
+                        texcoord.set(color_ndc.x(), color_ndc.y());
+                    }
+                    else
+                    {
+                        texcoord.set(ndc.x(), ndc.y());
+                    }
+                }
+                else
+                {
+                    osgTerrain::ContourLayer* contourLayer(dynamic_cast<osgTerrain::ContourLayer*>(_colorLayerLocators[t].first));
+
+                    bool texCoordSet = false;
+                    if (contourLayer)
+                    {
+                        osg::TransferFunction1D* transferFunction = contourLayer->getTransferFunction();
+                        if (transferFunction)
+                        {
+                            float difference = transferFunction->getMaximum()-transferFunction->getMinimum();
+                            if (difference != 0.0f)
+                            {
+                                osg::Vec3d           color_ndc;
+                                osgTerrain::Locator* colorLocator(_colorLayerLocators[t].second);
+
+                                if (colorLocator != _masterLocator)
+                                {
+                                    Locator::convertLocalCoordBetween(*_masterLocator,ndc,*colorLocator,color_ndc);
+                                }
+                                else
+                                {
+                                    color_ndc = ndc;
+                                }
+
+                                color_ndc[2] /= _scaleHeight;
+
+                                texcoord.set((color_ndc[2]-transferFunction->getMinimum())/difference,0.0f);
+                                texCoordSet = true;
+                            }
+                        }
+                    }
+                    if (!texCoordSet)
+                    {
+                        texcoord.set(0.0f,0.0f);
+                    }
+                }
+            }
+
+            if (!validValue) return;
+
+            osg::Vec3d model;
+            _masterLocator->convertLocalToModel(ndc, model);
+
+            // compute the local normal
+            osg::Vec3d ndc_one = ndc; ndc_one.z() += 1.0;
+            osg::Vec3d model_one;
+            _masterLocator->convertLocalToModel(ndc_one, model_one);
+            model_one = model_one - model;
+            model_one.normalize();
+
+            _vertices[gi] = osg::Vec3(model-_centerModel);
+            _upVectors[gi] = model_one;
+        }
+
+    protected:
+
+        Locator*                                        _masterLocator;
+        osg::Vec3d                                      _centerModel;
+        int                                             _numColumns;
+        int                                             _numRows;
+        float                                           _scaleHeight;
+        osgTerrain::Layer*                              _elevationLayer;
+        bool                                            _sampled;
+        const ColorLayerLocators&                       _colorLayerLocators;
+        std::vector<unsigned char>&                     _valid;
+        osg::Vec3Array&                                 _vertices;
+        osg::Vec3Array&                                 _upVectors;
+        std::vector< osg::ref_ptr<osg::Vec2Array> >&    _texCoords;
+        int                                             _beginColumn;
+        int                                             _endColumn;
+};
+
+}
+
 class VertexNormalGenerator
 {
     public:
@@ -242,13 +514,16 @@ class VertexNormalGenerator
 
         VertexNormalGenerator(Locator* masterLocator, const osg::Vec3d& centerModel, int numRows, int numColmns, float scaleHeight, bool createSkirt);
 
-        void populateCenter(osgTerrain::Layer* elevationLayer, LayerToTexCoordMap& layerToTexCoordMap);
+        void populateCenter(const std::vector<unsigned char>& valid, const osg::Vec3Array& vertices, const osg::Vec3Array& upVectors,
+                            const std::vector< osg::ref_ptr<osg::Vec2Array> >& texCoords, LayerToTexCoordMap& layerToTexCoordMap);
         void populateLeftBoundary(osgTerrain::Layer* elevationLayer);
         void populateRightBoundary(osgTerrain::Layer* elevationLayer);
         void populateAboveBoundary(osgTerrain::Layer* elevationLayer);
         void populateBelowBoundary(osgTerrain::Layer* elevationLayer);
 
-        void computeNormals();
+        void populateMissingTexCoords(const std::vector< osg::ref_ptr<osg::Vec2Array> >& texCoords, LayerToTexCoordMap& layerToTexCoordMap);
+
+        void computeNormals(int beginRow, int endRow);
 
         unsigned int capacity() const { return _vertices->capacity(); }
 
@@ -414,7 +689,6 @@ class VertexNormalGenerator
 
         osg::ref_ptr<osg::Vec3Array>    _vertices;
         osg::ref_ptr<osg::Vec3Array>    _normals;
-        osg::ref_ptr<osg::FloatArray>   _elevations;
 
         osg::ref_ptr<osg::Vec3Array>    _boundaryVertices;
 
@@ -439,115 +713,60 @@ VertexNormalGenerator::VertexNormalGenerator(Locator* masterLocator, const osg::
     _normals = new osg::Vec3Array;
     _normals->reserve(numVertices);
 
-    _elevations = new osg::FloatArray;
-    _elevations->reserve(numVertices);
-
     _boundaryVertices = new osg::Vec3Array;
     _boundaryVertices->reserve(_numRows*2 + _numColumns*2 + 4);
 }
 
-void VertexNormalGenerator::populateCenter(osgTerrain::Layer* elevationLayer, LayerToTexCoordMap& layerToTexCoordMap)
+void VertexNormalGenerator::populateCenter(const std::vector<unsigned char>& valid, const osg::Vec3Array& vertices, const osg::Vec3Array& upVectors,
+                                           const std::vector< osg::ref_ptr<osg::Vec2Array> >& texCoords, LayerToTexCoordMap& layerToTexCoordMap)
 {
-    // OSG_NOTICE<<std::endl<<"VertexNormalGenerator::populateCenter("<<elevationLayer<<")"<<std::endl;
+    // OSG_NOTICE<<std::endl<<"VertexNormalGenerator::populateCenter()"<<std::endl;
 
-    bool sampled = elevationLayer &&
-                   ( (elevationLayer->getNumRows()!=static_cast<unsigned int>(_numRows)) ||
-                     (elevationLayer->getNumColumns()!=static_cast<unsigned int>(_numColumns)) );
+    // texCoords are ordered the same as the entries of layerToTexCoordMap
+    std::vector<osg::Vec2Array*> destinationTexCoords;
+    for(VertexNormalGenerator::LayerToTexCoordMap::iterator itr = layerToTexCoordMap.begin();
+        itr != layerToTexCoordMap.end();
+        ++itr)
+    {
+        destinationTexCoords.push_back(itr->second.first.get());
+    }
 
-    for(int j=0; j<_numRows; ++j)
+    unsigned int numTexCoords = osg::minimum(destinationTexCoords.size(), texCoords.size());
+
+    if (std::find(valid.begin(), valid.end(), 0)==valid.end() && _vertices->empty())
     {
-        for(int i=0; i<_numColumns; ++i)
+        // every point of the grid is valid so the arrays can be copied across in one go.
+        _vertices->insert(_vertices->end(), vertices.begin(), vertices.end());
+        _normals->insert(_normals->end(), upVectors.begin(), upVectors.end());
+        for(unsigned int t=0; t<numTexCoords; ++t)
         {
-            osg::Vec3d ndc( ((double)i)/(double)(_numColumns-1), ((double)j)/(double)(_numRows-1), 0.0);
+            destinationTexCoords[t]->insert(destinationTexCoords[t]->end(), texCoords[t]->begin(), texCoords[t]->end());
+        }
 
-            bool validValue = true;
-            if (elevationLayer)
+        int i = 1;
+        for(int r=0; r<_numRows; ++r)
+        {
+            for(int c=0; c<_numColumns; ++c)
             {
-                float value = 0.0f;
-                if (sampled) validValue = elevationLayer->getInterpolatedValidValue(ndc.x(), ndc.y(), value);
-                else validValue = elevationLayer->getValidValue(i,j,value);
-                ndc.z() = value*_scaleHeight;
+                index(c,r) = i++;
             }
+        }
+        return;
+    }
 
-            if (validValue)
-            {
-                osg::Vec3d model;
-                _masterLocator->convertLocalToModel(ndc, model);
-
-                for(VertexNormalGenerator::LayerToTexCoordMap::iterator itr = layerToTexCoordMap.begin();
-                    itr != layerToTexCoordMap.end();
-                    ++itr)
-                {
-                    osg::Vec2Array* texcoords = itr->second.first.get();
-                    osgTerrain::ImageLayer* imageLayer(dynamic_cast<osgTerrain::ImageLayer*>(itr->first));
-
-                    if (imageLayer != NULL)
-                    {
-                        Locator* colorLocator = itr->second.second;
-                        if (colorLocator != _masterLocator)
-                        {
-                            osg::Vec3d color_ndc;
-                            Locator::convertLocalCoordBetween(*_masterLocator, ndc, *colorLocator, color_ndc);
-                            (*texcoords).push_back(osg::Vec2(color_ndc.x(), color_ndc.y()));
-                        }
-                        else
-                        {
-                            (*texcoords).push_back(osg::Vec2(ndc.x(), ndc.y()));
-                        }
-                    }
-                    else
-                    {
-                        osgTerrain::ContourLayer* contourLayer(dynamic_cast<osgTerrain::ContourLayer*>(itr->first));
-
-                        bool texCoordSet = false;
-                        if (contourLayer)
-                        {
-                            osg::TransferFunction1D* transferFunction = contourLayer->getTransferFunction();
-                            if (transferFunction)
-                            {
-                                float difference = transferFunction->getMaximum()-transferFunction->getMinimum();
-                                if (difference != 0.0f)
-                                {
-                                    osg::Vec3d           color_ndc;
-                                    osgTerrain::Locator* colorLocator(itr->second.second);
-
-                                    if (colorLocator != _masterLocator)
-                                    {
-                                        Locator::convertLocalCoordBetween(*_masterLocator,ndc,*colorLocator,color_ndc);
-                                    }
-                                    else
-                                    {
-                                        color_ndc = ndc;
-                                    }
-
-                                    color_ndc[2] /= _scaleHeight;
-
-                                    (*texcoords).push_back(osg::Vec2((color_ndc[2]-transferFunction->getMinimum())/difference,0.0f));
-                                    texCoordSet = true;
-                                }
-                            }
-                        }
-                        if (!texCoordSet)
-                        {
-                            (*texcoords).push_back(osg::Vec2(0.0f,0.0f));
-                        }
-                    }
-                }
-
-                if (_elevations.valid())
-                {
-                    (*_elevations).push_back(ndc.z());
-                }
-
-                // compute the local normal
-                osg::Vec3d ndc_one = ndc; ndc_one.z() += 1.0;
-                osg::Vec3d model_one;
-                _masterLocator->convertLocalToModel(ndc_one, model_one);
-                model_one = model_one - model;
-                model_one.normalize();
+    unsigned int gi = 0;
+    for(int j=0; j<_numRows; ++j)
+    {
+        for(int i=0; i<_numColumns; ++i, ++gi)
+        {
+            if (!valid[gi]) continue;
 
-                setVertex(i, j, osg::Vec3(model-_centerModel), model_one);
+            for(unsigned int t=0; t<numTexCoords; ++t)
+            {
+                destinationTexCoords[t]->push_back((*texCoords[t])[gi]);
             }
+
+            setVertex(i, j, vertices[gi], upVectors[gi]);
         }
     }
 }
@@ -734,10 +953,45 @@ void VertexNormalGenerator::populateBelowBoundary(osgTerrain::Layer* elevationLa
 }
 
 
-void VertexNormalGenerator::computeNormals()
+void VertexNormalGenerator::populateMissingTexCoords(const std::vector< osg::ref_ptr<osg::Vec2Array> >& texCoords, LayerToTexCoordMap& layerToTexCoordMap)
+{
+    // vertices added by the boundary population, where the tile's own elevation was invalid, are appended after
+    // those of populateCenter() without texture coordinates, so add them in the order the vertices were created.
+    typedef std::vector< std::pair<int, unsigned int> > VertexGridIndices;
+    VertexGridIndices missing;
+
+    unsigned int t = 0;
+    for(VertexNormalGenerator::LayerToTexCoordMap::iterator itr = layerToTexCoordMap.begin();
+        itr != layerToTexCoordMap.end() && t<texCoords.size();
+        ++itr, ++t)
+    {
+        osg::Vec2Array* destination = itr->second.first.get();
+        if (destination->size()>=_vertices->size()) continue;
+
+        if (missing.empty())
+        {
+            for(int r=0; r<_numRows; ++r)
+            {
+                for(int c=0; c<_numColumns; ++c)
+                {
+                    int vi = vertex_index(c,r);
+                    if (vi>=static_cast<int>(destination->size())) missing.push_back(VertexGridIndices::value_type(vi, r*_numColumns+c));
+                }
+            }
+            std::sort(missing.begin(), missing.end());
+        }
+
+        for(VertexGridIndices::iterator mitr = missing.begin(); mitr != missing.end(); ++mitr)
+        {
+            destination->push_back((*texCoords[t])[mitr->second]);
+        }
+    }
+}
+
+void VertexNormalGenerator::computeNormals(int beginRow, int endRow)
 {
     // compute normals for the center section
-    for(int j=0; j<_numRows; ++j)
+    for(int j=beginRow; j<endRow; ++j)
     {
         for(int i=0; i<_numColumns; ++i)
         {
@@ -748,6 +1002,24 @@ void VertexNormalGenerator::computeNormals()
     }
 }
 
+namespace
+{
+
+class ComputeNormalsOperation : public RowOperation
+{
+    public:
+
+        ComputeNormalsOperation(VertexNormalGenerator& vng): _vng(vng) {}
+
+        virtual void operator () (int beginRow, int endRow) { _vng.computeNormals(beginRow, endRow); }
+
+    protected:
+
+        VertexNormalGenerator& _vng;
+};
+
+}
+
 void GeometryTechnique::generateGeometry(BufferData& buffer, Locator* masterLocator, const osg::Vec3d& centerModel)
 {
     Terrain* terrain = _terrainTile->getTerrain();
@@ -868,7 +1140,105 @@ void GeometryTechnique::generateGeometry(BufferData& buffer, Locator* masterLoca
     //
     // populate vertex and tex coord arrays
     //
-    VNG.populateCenter(elevationLayer, layerToTexCoordMap);
+    GridData::Layers colorLayers;
+    PopulateGridOperation::ColorLayerLocators colorLayerLocators;
+    for(VertexNormalGenerator::LayerToTexCoordMap::iterator itr = layerToTexCoordMap.begin();
+        itr != layerToTexCoordMap.end();
+        ++itr)
+    {
+        colorLayers.push_back(itr->first);
+        colorLayerLocators.push_back(PopulateGridOperation::ColorLayerLocators::value_type(itr->first, itr->second.second));
+    }
+
+    // the grid passed on by init() can only be reused if it was computed from the same layers and locator
+    osg::ref_ptr<GridData> grid = buffer._gridData;
+    bool reuseGrid = grid.valid() &&
+                     grid->_numColumns==static_cast<int>(numColumns) &&
+                     grid->_numRows==static_cast<int>(numRows) &&
+                     grid->_scaleHeight==scaleHeight &&
+                     grid->_centerModel==centerModel &&
+                     grid->_masterLocator==masterLocator &&
+                     grid->_elevationLayer==elevationLayer &&
+                     grid->_colorLayers==colorLayers;
+
+    bool dirtyLeftEdge = false;
+    bool dirtyRightEdge = false;
+    bool dirtyTopEdge = false;
+    bool dirtyBottomEdge = false;
+
+    if (!reuseGrid)
+    {
+        unsigned int numGridPoints = numColumns*numRows;
+
+        grid = new GridData;
+        grid->_numColumns = numColumns;
+        grid->_numRows = numRows;
+        grid->_scaleHeight = scaleHeight;
+        grid->_centerModel = centerModel;
+        grid->_masterLocator = masterLocator;
+        grid->_elevationLayer = elevationLayer;
+        grid->_colorLayers = colorLayers;
+        grid->_valid.resize(numGridPoints, 0);
+        grid->_vertices = new osg::Vec3Array(numGridPoints);
+        grid->_upVectors = new osg::Vec3Array(numGridPoints);
+        for(unsigned int t=0; t<colorLayers.size(); ++t)
+        {
+            grid->_texCoords.push_back(new osg::Vec2Array(numGridPoints));
+        }
+
+        PopulateGridOperation populateGrid(masterLocator, centerModel, numColumns, numRows, scaleHeight,
+                                           elevationLayer, colorLayerLocators,
+                                           grid->_valid, *(grid->_vertices), *(grid->_upVectors), grid->_texCoords,
+                                           0, numColumns);
+        runRowOperation(populateGrid, 0, numRows, _numThreads);
+    }
+    else if (grid->_elevationRegionDirty)
+    {
+        // map the modified region of the elevation layer on to the grid, when the layer is being sampled each grid
+        // point is interpolated from the surrounding posts so the region is widened by a post on each side.
+        int beginColumn = grid->_minDirtyColumn;
+        int endColumn = grid->_maxDirtyColumn+1;
+        int beginRow = grid->_minDirtyRow;
+        int endRow = grid->_maxDirtyRow+1;
+
+        if (elevationLayer &&
+            (elevationLayer->getNumColumns()!=numColumns || elevationLayer->getNumRows()!=numRows) &&
+            elevationLayer->getNumColumns()>1 && elevationLayer->getNumRows()>1)
+        {
+            double columnScale = double(numColumns-1)/double(elevationLayer->getNumColumns()-1);
+            double rowScale = double(numRows-1)/double(elevationLayer->getNumRows()-1);
+            beginColumn = static_cast<int>(floor((double(grid->_minDirtyColumn)-1.0)*columnScale));
+            endColumn = static_cast<int>(ceil((double(grid->_maxDirtyColumn)+1.0)*columnScale))+1;
+            beginRow = static_cast<int>(floor((double(grid->_minDirtyRow)-1.0)*rowScale));
+            endRow = static_cast<int>(ceil((double(grid->_maxDirtyRow)+1.0)*rowScale))+1;
+        }
+
+        beginColumn = osg::clampBetween(beginColumn, 0, static_cast<int>(numColumns));
+        endColumn = osg::clampBetween(endColumn, beginColumn, static_cast<int>(numColumns));
+        beginRow = osg::clampBetween(beginRow, 0, static_cast<int>(numRows));
+        endRow = osg::clampBetween(endRow, beginRow, static_cast<int>(numRows));
+
+        OSG_INFO<<"GeometryTechnique::generateGeometry() updating columns "<<beginColumn<<" to "<<endColumn
+                <<", rows "<<beginRow<<" to "<<endRow<<" of "<<numColumns<<"x"<<numRows<<" grid"<<std::endl;
+
+        PopulateGridOperation populateGrid(masterLocator, centerModel, numColumns, numRows, scaleHeight,
+                                           elevationLayer, colorLayerLocators,
+                                           grid->_valid, *(grid->_vertices), *(grid->_upVectors), grid->_texCoords,
+                                           beginColumn, endColumn);
+        runRowOperation(populateGrid, beginRow, endRow, _numThreads);
+
+        // neighbours equalize their edges against the two outermost rows and columns of this tile
+        dirtyLeftEdge = beginColumn<=1;
+        dirtyRightEdge = endColumn>=static_cast<int>(numColumns)-1;
+        dirtyBottomEdge = beginRow<=1;
+        dirtyTopEdge = endRow>=static_cast<int>(numRows)-1;
+
+        grid->_elevationRegionDirty = false;
+    }
+
+    buffer._gridData = grid;
+
+    VNG.populateCenter(grid->_valid, *(grid->_vertices), *(grid->_upVectors), grid->_texCoords, layerToTexCoordMap);
 
     if (terrain && terrain->getEqualizeBoundaries())
     {
@@ -944,6 +1314,12 @@ void GeometryTechnique::generateGeometry(BufferData& buffer, Locator* masterLoca
             }
         }
 
+        // an edited region of the elevation layer that reaches the edge of this tile changes the neighbour's boundary too
+        if (left_tile.valid() && dirtyLeftEdge) left_tile->setDirtyMask(left_tile->getDirtyMask() | TerrainTile::LEFT_EDGE_DIRTY);
+        if (right_tile.valid() && dirtyRightEdge) right_tile->setDirtyMask(right_tile->getDirtyMask() | TerrainTile::RIGHT_EDGE_DIRTY);
+        if (top_tile.valid() && dirtyTopEdge) top_tile->setDirtyMask(top_tile->getDirtyMask() | TerrainTile::TOP_EDGE_DIRTY);
+        if (bottom_tile.valid() && dirtyBottomEdge) bottom_tile->setDirtyMask(bottom_tile->getDirtyMask() | TerrainTile::BOTTOM_EDGE_DIRTY);
+
 #if 0
         if (bottom_left_tile.valid())
         {
@@ -988,8 +1364,11 @@ void GeometryTechnique::generateGeometry(BufferData& buffer, Locator* masterLoca
     }
 
 
+    VNG.populateMissingTexCoords(grid->_texCoords, layerToTexCoordMap);
+
     osg::ref_ptr<osg::Vec3Array> skirtVectors = new osg::Vec3Array((*VNG._normals));
-    VNG.computeNormals();
+    ComputeNormalsOperation computeNormals(VNG);
+    runRowOperation(computeNormals, 0, numRows, _numThreads);
 
     //
     // populate the primitive data
@@ -0,0 +1,88 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgTerrain/HeightFieldTechnique>
+#include <osgTerrain/TerrainTile>
+#include <osgTerrain/Terrain>
+
+#include <osg/ShapeDrawable>
+
+using namespace osgTerrain;
+
+HeightFieldTechnique::HeightFieldTechnique()
+{
+}
+
+HeightFieldTechnique::HeightFieldTechnique(const HeightFieldTechnique& hft,const osg::CopyOp& copyop):
+    GeometryTechnique(hft,copyop)
+{
+}
+
+HeightFieldTechnique::~HeightFieldTechnique()
+{
+}
+
+bool HeightFieldTechnique::canUseHeightField(Locator* masterLocator) const
+{
+    if (!_terrainTile || !masterLocator) return false;
+
+    const HeightFieldLayer* hfl = dynamic_cast<const HeightFieldLayer*>(_terrainTile->getElevationLayer());
+    const osg::HeightField* hf = hfl ? hfl->getHeightField() : 0;
+    if (!hf || hf->getNumColumns()<2 || hf->getNumRows()<2) return false;
+    if (hf->getXInterval()==0.0f || hf->getYInterval()==0.0f || !hf->zeroRotation()) return false;
+
+    // invalid values leave holes in the mesh that the heightfield can't represent.
+    if (hfl->getValidDataOperator()) return false;
+
+    if (hfl->getLocator() && hfl->getLocator()!=masterLocator) return false;
+
+    // the model position of heightfield cells must be an affine transform of their grid position,
+    // with the heights only contributing along the z axis.
+    if (masterLocator->getCoordinateSystemType()==Locator::GEOCENTRIC) return false;
+
+    const osg::Matrixd& transform = masterLocator->getTransform();
+    return transform(0,1)==0.0 && transform(0,2)==0.0 &&
+           transform(1,0)==0.0 && transform(1,2)==0.0 &&
+           transform(2,0)==0.0 && transform(2,1)==0.0;
+}
+
+void HeightFieldTechnique::generateGeometry(BufferData& buffer, Locator* masterLocator, const osg::Vec3d& centerModel)
+{
+    if (!canUseHeightField(masterLocator))
+    {
+        GeometryTechnique::generateGeometry(buffer, masterLocator, centerModel);
+        return;
+    }
+
+    // the ShapeDrawable renders straight from the heightfield, so there is no grid to keep for later updates
+    buffer._gridData = 0;
+
+    HeightFieldLayer* hfl = static_cast<HeightFieldLayer*>(_terrainTile->getElevationLayer());
+    osg::HeightField* hf = hfl->getHeightField();
+
+    Terrain* terrain = _terrainTile->getTerrain();
+    float scaleHeight = terrain ? terrain->getVerticalScale() : 1.0f;
+
+    // map heightfield coordinates into the tile's local NDC coordinates, as used by GeometryTechnique, then on into model coordinates.
+    osg::Matrixd heightFieldToLocal = osg::Matrixd::translate(-hf->getOrigin()) *
+                                      osg::Matrixd::scale(1.0/(double(hf->getXInterval())*double(hf->getNumColumns()-1)),
+                                                          1.0/(double(hf->getYInterval())*double(hf->getNumRows()-1)),
+                                                          scaleHeight);
+
+    buffer._transform->setMatrix(heightFieldToLocal * masterLocator->getTransform());
+
+    buffer._geode = new osg::Geode;
+    buffer._transform->addChild(buffer._geode.get());
+
+    buffer._geode->addDrawable(new osg::ShapeDrawable(hf));
+}
@@ -59,6 +59,11 @@ osg::ref_ptr<TerrainTile::TileLoadedCallback>& TerrainTile::getTileLoadedCallbac
 TerrainTile::TerrainTile():
     _terrain(0),
     _dirtyMask(NOT_DIRTY),
+    _hasElevationDirtyRegion(false),
+    _minDirtyColumn(0),
+    _minDirtyRow(0),
+    _maxDirtyColumn(0),
+    _maxDirtyRow(0),
     _hasBeenTraversal(false),
     _requiresNormals(true),
     _treatBoundariesToValidDataAsDefaultValue(false),
@@ -71,6 +76,11 @@ TerrainTile::TerrainTile(const TerrainTile& terrain,const osg::CopyOp& copyop):
     Group(terrain,copyop),
     _terrain(0),
     _dirtyMask(NOT_DIRTY),
+    _hasElevationDirtyRegion(false),
+    _minDirtyColumn(0),
+    _minDirtyRow(0),
+    _maxDirtyColumn(0),
+    _maxDirtyRow(0),
     _hasBeenTraversal(false),
     _elevationLayer(terrain._elevationLayer),
     _colorLayers(terrain._colorLayers),
@@ -210,6 +220,10 @@ void TerrainTile::setTerrainTechnique(TerrainTechnique* terrainTechnique)
 
 void TerrainTile::setDirtyMask(int dirtyMask)
 {
+    // neighbouring tiles only add edge and corner bits, any other change means that a modified elevation
+    // region no longer describes what needs to be regenerated.
+    if ((dirtyMask & ~EDGES_DIRTY)!=(_dirtyMask & ~EDGES_DIRTY)) _hasElevationDirtyRegion = false;
+
     if (_dirtyMask==dirtyMask) return;
 
     int dirtyDelta = (_dirtyMask==NOT_DIRTY) ? 0 : -1;
@@ -238,6 +252,42 @@ void TerrainTile::setDirtyMask(int dirtyMask)
 #endif
 }
 
+void TerrainTile::dirtyElevationRegion(unsigned int minColumn, unsigned int minRow, unsigned int maxColumn, unsigned int maxRow)
+{
+    if (minColumn>maxColumn || minRow>maxRow) return;
+
+    if ((_dirtyMask & ELEVATION_DIRTY)!=0)
+    {
+        // the whole of the elevation layer is already due to be regenerated
+        if (!_hasElevationDirtyRegion) return;
+
+        _minDirtyColumn = osg::minimum(_minDirtyColumn, minColumn);
+        _minDirtyRow = osg::minimum(_minDirtyRow, minRow);
+        _maxDirtyColumn = osg::maximum(_maxDirtyColumn, maxColumn);
+        _maxDirtyRow = osg::maximum(_maxDirtyRow, maxRow);
+        return;
+    }
+
+    setDirtyMask(_dirtyMask | ELEVATION_DIRTY);
+
+    _hasElevationDirtyRegion = true;
+    _minDirtyColumn = minColumn;
+    _minDirtyRow = minRow;
+    _maxDirtyColumn = maxColumn;
+    _maxDirtyRow = maxRow;
+}
+
+bool TerrainTile::getElevationDirtyRegion(unsigned int& minColumn, unsigned int& minRow, unsigned int& maxColumn, unsigned int& maxRow) const
+{
+    if (!_hasElevationDirtyRegion) return false;
+
+    minColumn = _minDirtyColumn;
+    minRow = _minDirtyRow;
+    maxColumn = _maxDirtyColumn;
+    maxRow = _maxDirtyRow;
+    return true;
+}
+
 
 
 void TerrainTile::setElevationLayer(Layer* layer)
@@ -34,6 +34,7 @@
 #include <algorithm>
 
 #include <osg/Timer>
+#include <osg/TraceRecorder>
 
 using namespace osg;
 using namespace osgUtil;
@@ -1225,6 +1226,8 @@ void CullVisitor::apply(Group& node)
 
 void CullVisitor::apply(Transform& node)
 {
+    OSG_TRACE_ZONE("osgUtil", "CullVisitor::apply(Transform)");
+
     if (isCulled(node)) return;
 
     // push the culling mode.
@@ -1313,6 +1316,8 @@ void CullVisitor::apply(Switch& node)
 
 void CullVisitor::apply(LOD& node)
 {
+    OSG_TRACE_ZONE("osgUtil", "CullVisitor::apply(LOD)");
+
     if (isCulled(node)) return;
 
     // push the culling mode.
@@ -1415,6 +1420,8 @@ class RenderStageCache : public osg::Object
 
 void CullVisitor::apply(osg::Camera& camera)
 {
+    OSG_TRACE_ZONE("osgUtil", "CullVisitor::apply(Camera)");
+
     // push the node's state.
     StateSet* node_state = camera.getStateSet();
     if (node_state) pushStateSet(node_state);
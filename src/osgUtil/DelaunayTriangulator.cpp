@@ -12,18 +12,20 @@
 */
 
 #include <osgUtil/DelaunayTriangulator>
-// NB this algorithm makes heavy use of the osgUtil::Tessellator for constrained triangulation.
+// NB the osgUtil::Tessellator is used to merge overlapping constraints.
 // truly it is built on the shoulders of giants.
 
 #include <osg/GL>
 #include <osg/Vec3>
 #include <osg/Array>
 #include <osg/Notify>
+#include <osg/BoundingBox>
 
 #include <algorithm>
+#include <vector>
 #include <set>
 #include <map> //GWM July 2005 map is used in constraints.
-#include <osgUtil/Tessellator> // tessellator triangulates the constrained triangles
+#include <osgUtil/Tessellator> // tessellator merges overlapping constraints
 #include <stdlib.h>
 #include <iterator>
 
@@ -372,8 +374,6 @@ private:
     Edge edge_[3];
 };
 
-typedef std::list<Triangle> Triangle_list;
-
 // comparison function for sorting sample points by the X coordinate
 bool Sample_point_compare(const osg::Vec3 &p1, const osg::Vec3 &p2)
 {
@@ -386,9 +386,6 @@ bool Sample_point_compare(const osg::Vec3 &p1, const osg::Vec3 &p2)
 }
 
 
-// container types
-typedef std::set<Edge, Edge::Less> Edge_set;
-
 
 DelaunayTriangulator::DelaunayTriangulator():
     osg::Referenced()
@@ -414,23 +411,6 @@ DelaunayTriangulator::~DelaunayTriangulator()
 {
 }
 
-const Triangle * getTriangleWithEdge(const unsigned int ip1,const unsigned int ip2, const Triangle_list *triangles)
-{ // find triangle in list with edge from ip1 to ip2...
-    Triangle_list::const_iterator trconnitr; // connecting triangle
-    int idx=0;
-    for (trconnitr=triangles->begin(); trconnitr!=triangles->end(); )
-    {
-        if (trconnitr->isedge (ip1,ip2))
-        {
-            // this is the triangle.
-            return &(*trconnitr);
-        }
-        ++trconnitr;
-        idx++;
-    }
-    return NULL; //-1;
-}
-
 int DelaunayTriangulator::getindex(const osg::Vec3 &pt,const osg::Vec3Array *points)
 {
     // return index of pt in points (or -1)
@@ -444,174 +424,6 @@ int DelaunayTriangulator::getindex(const osg::Vec3 &pt,const osg::Vec3Array *poi
     return -1;
 }
 
-Triangle_list fillHole(osg::Vec3Array *points,    std::vector<unsigned int> vindexlist)
-{
-    // eg clockwise vertex neighbours around the hole made by the constraint
-    Triangle_list triangles; // returned list
-    osg::ref_ptr<osg::Geometry> gtess=new osg::Geometry; // add all the contours to this for analysis
-    osg::ref_ptr<osg::Vec3Array> constraintverts=new osg::Vec3Array;
-    osg::ref_ptr<osgUtil::Tessellator> tscx=new osgUtil::Tessellator; // this assembles all the constraints
-
-    for (std::vector<unsigned int>::iterator itint=vindexlist.begin(); itint!=vindexlist.end(); itint++)
-    {
-    //    OSG_WARN<< "add point " << (*itint) << " at " << (*points)[*itint].x() << ","<< (*points)[*itint].y() <<std::endl;
-        constraintverts->push_back((*points)[*itint]);
-    }
-
-    unsigned int npts=vindexlist.size();
-
-    gtess->setVertexArray(constraintverts.get());
-    gtess->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::POLYGON,0,npts));
-    tscx->setTessellationNormal(osg::Vec3(0.0,0.0,1.0));
-    tscx->setTessellationType(osgUtil::Tessellator::TESS_TYPE_GEOMETRY);
-    tscx->setBoundaryOnly(false);
-    tscx->setWindingType( osgUtil::Tessellator::TESS_WINDING_ODD); // the commonest tessellation is default, ODD. GE2 allows intersections of constraints to be found.
-    tscx->retessellatePolygons(*(gtess.get())); // this should insert extra vertices where constraints overlap
-
-    // extract triangles from gtess
-
-    unsigned int ipr;
-    for (ipr=0; ipr<gtess->getNumPrimitiveSets(); ipr++)
-    {
-        unsigned int ic;
-        osg::PrimitiveSet* prset=gtess->getPrimitiveSet(ipr);
-        //                    OSG_WARN<< "gtess set " << ipr << " nprims " << prset->getNumPrimitives() <<
-        //                        " type " << prset->getMode() << std::endl;
-        unsigned int pidx,pidx1,pidx2;
-        switch (prset->getMode()) {
-        case osg::PrimitiveSet::TRIANGLES:
-            for (ic=0; ic<prset->getNumIndices()-2; ic+=3)
-            {
-                if (prset->index(ic)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic)]);
-                    pidx=points->size()-1;
-                }
-                else
-                {
-                    pidx=vindexlist[prset->index(ic)];
-                }
-
-                if (prset->index(ic+1)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic+1)]);
-                    pidx1=points->size()-1;
-                }
-                else
-                {
-                    pidx1=vindexlist[prset->index(ic+1)];
-                }
-
-                if (prset->index(ic+2)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic+2)]);
-                    pidx2=points->size()-1;
-                }
-                else
-                {
-                    pidx2=vindexlist[prset->index(ic+2)];
-                }
-                triangles.push_back(Triangle(pidx, pidx1, pidx2, points));
-                //                    OSG_WARN<< "vert " << prset->index(ic) << " in array"<<std::endl;
-            }
-            break;
-        case osg::PrimitiveSet::TRIANGLE_STRIP: // 123, 234, 345...
-
-            for (ic=0; ic<prset->getNumIndices()-2; ic++)
-            {
-                if (prset->index(ic)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic)]);
-                    pidx=points->size()-1;
-                } else {
-                    pidx=vindexlist[prset->index(ic)];
-                }
-                if (prset->index(ic+1)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic+1)]);
-                    pidx1=points->size()-1;
-                }
-                else
-                {
-                    pidx1=vindexlist[prset->index(ic+1)];
-                }
-
-                if (prset->index(ic+2)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic+2)]);
-                    pidx2=points->size()-1;
-                }
-                else
-                {
-                    pidx2=vindexlist[prset->index(ic+2)];
-                }
-
-                if (ic%2==0)
-                {
-                    triangles.push_back(Triangle(pidx, pidx1, pidx2, points));
-                }
-                else
-                {
-                    triangles.push_back(Triangle(pidx1, pidx, pidx2, points));
-                }
-                //                    OSG_WARN<< "vert " << prset->index(ic) << " in array"<<std::endl;
-            }
-            break;
-
-        case osg::PrimitiveSet::TRIANGLE_FAN:
-            {
-                if (prset->index(0)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(0)]);
-                    pidx=points->size()-1;
-                }
-                else
-                {
-                    pidx=vindexlist[prset->index(0)];
-                }
-                //        OSG_WARN<< "tfan has " << prset->getNumIndices() << " indices"<<std::endl;
-                for (ic=1; ic<prset->getNumIndices()-1; ic++)
-                {
-                    if (prset->index(ic)>=npts)
-                    {
-                        // this is an added point.
-                        points->push_back((*constraintverts)[prset->index(ic)]);
-                        pidx1=points->size()-1;
-                    }
-                    else
-                    {
-                        pidx1=vindexlist[prset->index(ic)];
-                    }
-
-                    if (prset->index(ic+1)>=npts)
-                    { // this is an added point.
-                        points->push_back((*constraintverts)[prset->index(ic+1)]);
-                        pidx2=points->size()-1;
-                    }
-                    else
-                    {
-                        pidx2=vindexlist[prset->index(ic+1)];
-                    }
-                    triangles.push_back(Triangle(pidx, pidx1, pidx2, points));
-                }
-            }
-            break;
-        default:
-            OSG_WARN<< "WARNING set " << ipr << " nprims " << prset->getNumPrimitives() <<
-                " type " << prset->getMode() << " Type not triangle, tfan or strip"<< std::endl;
-            break;
-        }
-    }
-    return triangles;
-}
-
 template <typename TVector>
 void removeIndices( TVector& elements, unsigned int index )
 {
@@ -769,6 +581,615 @@ osgUtil::DelaunayConstraint *getconvexhull(osg::Vec3Array *points)
     return dcconvexhull.release();
 }
 
+//////////////////////////////////////////////////////////////////////////////////////
+// TRIANGULATION MESH
+//
+// The triangulation is held as an array of triangles that know their neighbours. Points are
+// inserted in a biased randomized order with each round sorted along a Hilbert curve, so each
+// point is found by a short walk from the last triangle created, and the triangles whose
+// circumcircles contain it are found by searching outwards through the neighbours. The cost of
+// an insertion is then independent of the number of points already in the triangulation.
+
+namespace
+{
+
+const int NoTriangle = -1;
+const GLuint DeletedVertex = 0xffffffff;
+
+// twice the signed area of triangle abc, positive when abc is counter clockwise.
+inline double orient2d(const osg::Vec3 &a, const osg::Vec3 &b, const osg::Vec3 &c)
+{
+    return (double(b.x())-double(a.x()))*(double(c.y())-double(a.y())) -
+           (double(b.y())-double(a.y()))*(double(c.x())-double(a.x()));
+}
+
+// positive when d lies inside the circumcircle of the counter clockwise triangle abc.
+inline double incircle(const osg::Vec3 &a, const osg::Vec3 &b, const osg::Vec3 &c, const osg::Vec3 &d)
+{
+    double adx = double(a.x())-double(d.x()), ady = double(a.y())-double(d.y());
+    double bdx = double(b.x())-double(d.x()), bdy = double(b.y())-double(d.y());
+    double cdx = double(c.x())-double(d.x()), cdy = double(c.y())-double(d.y());
+
+    double alift = adx*adx + ady*ady;
+    double blift = bdx*bdx + bdy*bdy;
+    double clift = cdx*cdx + cdy*cdy;
+
+    return alift*(bdx*cdy - cdx*bdy) + blift*(cdx*ady - adx*cdy) + clift*(adx*bdy - bdx*ady);
+}
+
+// dot product of b-a and c-a in the x,y plane.
+inline double dot2d(const osg::Vec3 &a, const osg::Vec3 &b, const osg::Vec3 &c)
+{
+    return (double(b.x())-double(a.x()))*(double(c.x())-double(a.x())) +
+           (double(b.y())-double(a.y()))*(double(c.y())-double(a.y()));
+}
+
+// distance of (x,y) along a Hilbert curve filling a 2^16 by 2^16 grid.
+inline unsigned int hilbertIndex(unsigned int x, unsigned int y)
+{
+    const unsigned int n = 1u<<16;
+    unsigned int d = 0;
+    for (unsigned int s=n/2; s>0; s/=2)
+    {
+        unsigned int rx = (x & s)>0 ? 1 : 0;
+        unsigned int ry = (y & s)>0 ? 1 : 0;
+        d += s*s*((3*rx)^ry);
+        if (ry==0)
+        {
+            if (rx==1)
+            {
+                x = n-1-x;
+                y = n-1-y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+struct PointXYLess
+{
+    bool operator() (const osg::Vec3 &lhs, const osg::Vec3 &rhs) const
+    {
+        if (lhs.x() != rhs.x()) return lhs.x() < rhs.x();
+        return lhs.y() < rhs.y();
+    }
+};
+
+// index of the point at pt's x,y amongst the first numPoints points, which must be sorted by x then y, or -1.
+int findSortedPoint(const osg::Vec3 &pt, const osg::Vec3Array *points, GLuint numPoints)
+{
+    osg::Vec3Array::const_iterator end = points->begin()+numPoints;
+    osg::Vec3Array::const_iterator itr = std::lower_bound(points->begin(), end, pt, PointXYLess());
+    if (itr==end || itr->x()!=pt.x() || itr->y()!=pt.y()) return -1;
+    return static_cast<int>(itr-points->begin());
+}
+
+struct HilbertLess
+{
+    HilbertLess(const std::vector<unsigned int>& keys): _keys(keys) {}
+    bool operator() (GLuint lhs, GLuint rhs) const { return _keys[lhs]<_keys[rhs]; }
+    const std::vector<unsigned int>& _keys;
+};
+
+// orders the points for insertion: a deterministic shuffle split into rounds that double in size,
+// with each round sorted along a Hilbert curve. The randomness keeps the expected cost of building
+// the triangulation O(n log n) whatever the input order, the curve keeps consecutive points close.
+void computeInsertionOrder(const osg::Vec3Array *points, GLuint numPoints, std::vector<GLuint>& order)
+{
+    order.resize(numPoints);
+    for (GLuint i=0; i<numPoints; ++i) order[i] = i;
+    if (numPoints==0) return;
+
+    osg::BoundingBox bb;
+    for (GLuint i=0; i<numPoints; ++i) bb.expandBy((*points)[i]);
+
+    double scalex = bb.xMax()>bb.xMin() ? 65535.0/(double(bb.xMax())-double(bb.xMin())) : 0.0;
+    double scaley = bb.yMax()>bb.yMin() ? 65535.0/(double(bb.yMax())-double(bb.yMin())) : 0.0;
+
+    std::vector<unsigned int> keys(numPoints);
+    for (GLuint i=0; i<numPoints; ++i)
+    {
+        const osg::Vec3& pt = (*points)[i];
+        keys[i] = hilbertIndex(static_cast<unsigned int>((double(pt.x())-double(bb.xMin()))*scalex),
+                               static_cast<unsigned int>((double(pt.y())-double(bb.yMin()))*scaley));
+    }
+
+    // linear congruential generator rather than rand() so the triangulation is repeatable across platforms.
+    unsigned int seed = 12345;
+    for (GLuint i=numPoints-1; i>0; --i)
+    {
+        seed = seed*1664525u + 1013904223u;
+        std::swap(order[i], order[(seed>>8) % (i+1)]);
+    }
+
+    GLuint end = numPoints;
+    while (end>0)
+    {
+        GLuint begin = end>64 ? end/2 : 0;
+        std::sort(order.begin()+begin, order.begin()+end, HilbertLess(keys));
+        end = begin;
+    }
+}
+
+class TriangleMesh
+{
+public:
+
+    // edge i runs from v[i] to v[(i+1)%3], n[i] is the triangle on the other side of edge i.
+    struct MeshTriangle
+    {
+        GLuint  v[3];
+        int     n[3];
+    };
+
+    typedef std::vector<MeshTriangle> MeshTriangles;
+
+    TriangleMesh(const osg::Vec3Array *points):
+        _points(points),
+        _vertexTriangles(points->size(), NoTriangle),
+        _last(0),
+        _stamp(0),
+        _random(1) {}
+
+    const MeshTriangles& getTriangles() const { return _triangles; }
+
+    // start with the quad a,b,c,d (counter clockwise) that encloses all the points.
+    void initialize(GLuint a, GLuint b, GLuint c, GLuint d)
+    {
+        int t0 = createTriangle(a, b, c);
+        int t1 = createTriangle(d, a, c);
+        _triangles[t0].n[2] = t1;
+        _triangles[t1].n[1] = t0;
+        _last = t0;
+    }
+
+    void insertPoint(GLuint p);
+
+    bool insertConstraint(GLuint p1, GLuint p2);
+
+protected:
+
+    struct BoundaryEdge
+    {
+        GLuint  a, b;
+        int     outer;
+        int     outerEdge;
+    };
+
+    typedef std::pair<GLuint, GLuint> DirectedEdge;
+    typedef std::map<DirectedEdge, std::pair<int, int> > EdgeMap;
+
+    const osg::Vec3& point(GLuint i) const { return (*_points)[i]; }
+
+    int createTriangle(GLuint a, GLuint b, GLuint c)
+    {
+        int t;
+        if (!_freeTriangles.empty())
+        {
+            t = _freeTriangles.back();
+            _freeTriangles.pop_back();
+        }
+        else
+        {
+            t = static_cast<int>(_triangles.size());
+            _triangles.push_back(MeshTriangle());
+            _marks.push_back(0);
+        }
+
+        MeshTriangle& tri = _triangles[t];
+        tri.v[0] = a; tri.v[1] = b; tri.v[2] = c;
+        tri.n[0] = tri.n[1] = tri.n[2] = NoTriangle;
+
+        _vertexTriangles[a] = _vertexTriangles[b] = _vertexTriangles[c] = t;
+        return t;
+    }
+
+    void deleteTriangle(int t)
+    {
+        _triangles[t].v[0] = DeletedVertex;
+        _freeTriangles.push_back(t);
+    }
+
+    int edgeTo(int t, int neighbour) const
+    {
+        const MeshTriangle& tri = _triangles[t];
+        return tri.n[0]==neighbour ? 0 : (tri.n[1]==neighbour ? 1 : 2);
+    }
+
+    unsigned int nextRandom()
+    {
+        _random = _random*1664525u + 1013904223u;
+        return _random>>16;
+    }
+
+    int locate(GLuint p);
+
+    bool collectBoundary(GLuint p, int seed);
+
+    void triangulatePseudoPolygon(GLuint a, GLuint b, const GLuint* begin, const GLuint* end, std::vector<GLuint>& indices) const;
+
+    void linkTriangles(const std::vector<GLuint>& indices, const EdgeMap& outerEdges);
+
+    const osg::Vec3Array*       _points;
+    MeshTriangles               _triangles;
+    std::vector<int>            _freeTriangles;
+    std::vector<int>            _vertexTriangles;
+    std::vector<unsigned int>   _marks;
+    std::vector<int>            _cavity;
+    std::vector<BoundaryEdge>   _boundary;
+    int                         _last;
+    unsigned int                _stamp;
+    unsigned int                _random;
+};
+
+int TriangleMesh::locate(GLuint p)
+{
+    const osg::Vec3& pt = point(p);
+
+    // walk from the last triangle created towards the point, not stepping straight back and starting
+    // from a random edge so that the walk can't cycle.
+    int t = _last;
+    int previous = NoTriangle;
+    for (unsigned int step=0; step<_triangles.size(); ++step)
+    {
+        const MeshTriangle& tri = _triangles[t];
+        unsigned int start = nextRandom()%3;
+        int next = NoTriangle;
+        for (unsigned int k=0; k<3 && next==NoTriangle; ++k)
+        {
+            unsigned int e = (start+k)%3;
+            if (tri.n[e]==NoTriangle || tri.n[e]==previous) continue;
+            if (orient2d(point(tri.v[e]), point(tri.v[(e+1)%3]), pt)<0.0) next = tri.n[e];
+        }
+        if (next==NoTriangle) return t;
+
+        previous = t;
+        t = next;
+    }
+
+    // only reached if rounding errors leave the walk circling, fall back to a search of all the triangles.
+    OSG_INFO << "DelaunayTriangulator: point location walk failed, searching all triangles\n";
+    for (unsigned int i=0; i<_triangles.size(); ++i)
+    {
+        const MeshTriangle& tri = _triangles[i];
+        if (tri.v[0]==DeletedVertex) continue;
+        if (orient2d(point(tri.v[0]), point(tri.v[1]), pt)>=0.0 &&
+            orient2d(point(tri.v[1]), point(tri.v[2]), pt)>=0.0 &&
+            orient2d(point(tri.v[2]), point(tri.v[0]), pt)>=0.0) return i;
+    }
+    return t;
+}
+
+bool TriangleMesh::collectBoundary(GLuint p, int seed)
+{
+    const osg::Vec3& pt = point(p);
+
+    // each boundary edge must face p for the new triangles to be valid, where rounding in the
+    // circumcircle test has let in a triangle that spoils this, that triangle is dropped from the cavity.
+    for (unsigned int pass=0; pass<_cavity.size()+8; ++pass)
+    {
+        _boundary.clear();
+
+        int trim = NoTriangle;
+        for (std::vector<int>::const_iterator itr = _cavity.begin(); itr != _cavity.end() && trim==NoTriangle; ++itr)
+        {
+            const MeshTriangle& tri = _triangles[*itr];
+            for (unsigned int e=0; e<3; ++e)
+            {
+                int nb = tri.n[e];
+                if (nb!=NoTriangle && _marks[nb]==_stamp) continue;
+
+                GLuint a = tri.v[e];
+                GLuint b = tri.v[(e+1)%3];
+                if (orient2d(point(a), point(b), pt)<=0.0)
+                {
+                    trim = *itr;
+                    break;
+                }
+
+                BoundaryEdge edge;
+                edge.a = a;
+                edge.b = b;
+                edge.outer = nb;
+                edge.outerEdge = nb!=NoTriangle ? edgeTo(nb, *itr) : 0;
+                _boundary.push_back(edge);
+            }
+        }
+
+        // a cavity with no vertices inside it has two more boundary edges than triangles.
+        if (trim==NoTriangle) return _boundary.size()==_cavity.size()+2;
+        if (trim==seed) return false;
+
+        // drop the triangle, then keep just the triangles still connected to the seed.
+        _marks[trim] = 0;
+        unsigned int previousStamp = _stamp++;
+        _cavity.clear();
+        _cavity.push_back(seed);
+        _marks[seed] = _stamp;
+        for (unsigned int i=0; i<_cavity.size(); ++i)
+        {
+            const MeshTriangle& tri = _triangles[_cavity[i]];
+            for (unsigned int e=0; e<3; ++e)
+            {
+                int nb = tri.n[e];
+                if (nb!=NoTriangle && _marks[nb]==previousStamp)
+                {
+                    _marks[nb] = _stamp;
+                    _cavity.push_back(nb);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void TriangleMesh::insertPoint(GLuint p)
+{
+    const osg::Vec3& pt = point(p);
+    int seed = locate(p);
+
+    // Bowyer-Watson cavity, the triangles whose circumcircles contain p form a connected region around the seed.
+    ++_stamp;
+    _cavity.clear();
+    _cavity.push_back(seed);
+    _marks[seed] = _stamp;
+    for (unsigned int i=0; i<_cavity.size(); ++i)
+    {
+        const MeshTriangle& tri = _triangles[_cavity[i]];
+        for (unsigned int e=0; e<3; ++e)
+        {
+            int nb = tri.n[e];
+            if (nb==NoTriangle || _marks[nb]==_stamp) continue;
+
+            const MeshTriangle& ntri = _triangles[nb];
+            if (incircle(point(ntri.v[0]), point(ntri.v[1]), point(ntri.v[2]), pt)>0.0)
+            {
+                _marks[nb] = _stamp;
+                _cavity.push_back(nb);
+            }
+        }
+    }
+
+    if (!collectBoundary(p, seed))
+    {
+        // degenerate input has defeated the circumcircle test, just split the seed triangle and
+        // those neighbours that p lies on the edge of.
+        ++_stamp;
+        _cavity.clear();
+        _cavity.push_back(seed);
+        _marks[seed] = _stamp;
+        const MeshTriangle& tri = _triangles[seed];
+        for (unsigned int e=0; e<3; ++e)
+        {
+            int nb = tri.n[e];
+            if (nb!=NoTriangle && orient2d(point(tri.v[e]), point(tri.v[(e+1)%3]), pt)<=0.0)
+            {
+                _marks[nb] = _stamp;
+                _cavity.push_back(nb);
+            }
+        }
+        if (!collectBoundary(p, seed))
+        {
+            OSG_WARN << "DelaunayTriangulator: unable to insert point at " << pt.x() << " " << pt.y() << std::endl;
+            return;
+        }
+    }
+
+    for (std::vector<int>::const_iterator itr = _cavity.begin(); itr != _cavity.end(); ++itr)
+    {
+        deleteTriangle(*itr);
+    }
+
+    // fan of new triangles from p to the edges of the cavity, the i'th new triangle is a,b,p.
+    unsigned int numNew = _boundary.size();
+    std::vector<int> created(numNew);
+    for (unsigned int i=0; i<numNew; ++i)
+    {
+        const BoundaryEdge& edge = _boundary[i];
+        int t = createTriangle(edge.a, edge.b, p);
+        created[i] = t;
+        _triangles[t].n[0] = edge.outer;
+        if (edge.outer!=NoTriangle) _triangles[edge.outer].n[edge.outerEdge] = t;
+    }
+
+    // neighbouring triangles of the fan meet along the edges from p to the cavity's vertices.
+    for (unsigned int i=0; i<numNew; ++i)
+    {
+        MeshTriangle& tri = _triangles[created[i]];
+        for (unsigned int j=0; j<numNew; ++j)
+        {
+            if (_boundary[j].a==tri.v[1])
+            {
+                tri.n[1] = created[j];
+                _triangles[created[j]].n[2] = created[i];
+                break;
+            }
+        }
+    }
+
+    _last = created.back();
+}
+
+void TriangleMesh::triangulatePseudoPolygon(GLuint a, GLuint b, const GLuint* begin, const GLuint* end, std::vector<GLuint>& indices) const
+{
+    if (begin==end) return;
+
+    // choose the vertex c whose circle through a,b,c contains none of the others, splitting the polygon
+    // there leaves the triangles either side of the constraint constrained Delaunay.
+    const GLuint* c = begin;
+    for (const GLuint* itr = begin+1; itr != end; ++itr)
+    {
+        GLuint v0 = a, v1 = b, v2 = *c;
+        if (orient2d(point(v0), point(v1), point(v2))<0.0) std::swap(v0, v1);
+        if (incircle(point(v0), point(v1), point(v2), point(*itr))>0.0) c = itr;
+    }
+
+    triangulatePseudoPolygon(a, *c, begin, c, indices);
+    triangulatePseudoPolygon(*c, b, c+1, end, indices);
+
+    if (orient2d(point(a), point(b), point(*c))>=0.0)
+    {
+        indices.push_back(a); indices.push_back(b); indices.push_back(*c);
+    }
+    else
+    {
+        indices.push_back(b); indices.push_back(a); indices.push_back(*c);
+    }
+}
+
+void TriangleMesh::linkTriangles(const std::vector<GLuint>& indices, const EdgeMap& outerEdges)
+{
+    EdgeMap innerEdges;
+    for (unsigned int i=0; i+2<indices.size(); i+=3)
+    {
+        int t = createTriangle(indices[i], indices[i+1], indices[i+2]);
+        MeshTriangle& tri = _triangles[t];
+        for (int e=0; e<3; ++e)
+        {
+            DirectedEdge edge(tri.v[e], tri.v[(e+1)%3]);
+            EdgeMap::const_iterator outer = outerEdges.find(edge);
+            if (outer!=outerEdges.end())
+            {
+                tri.n[e] = outer->second.first;
+                if (outer->second.first!=NoTriangle) _triangles[outer->second.first].n[outer->second.second] = t;
+                continue;
+            }
+
+            EdgeMap::iterator twin = innerEdges.find(DirectedEdge(edge.second, edge.first));
+            if (twin!=innerEdges.end())
+            {
+                tri.n[e] = twin->second.first;
+                _triangles[twin->second.first].n[twin->second.second] = t;
+                innerEdges.erase(twin);
+            }
+            else
+            {
+                innerEdges[edge] = std::pair<int, int>(t, e);
+            }
+        }
+        _last = t;
+    }
+}
+
+bool TriangleMesh::insertConstraint(GLuint p1, GLuint p2)
+{
+    while (p1!=p2)
+    {
+        const osg::Vec3& pt1 = point(p1);
+        const osg::Vec3& pt2 = point(p2);
+
+        // turn around p1 to find either the edge p1-p2, a vertex lying on the line to p2, or the
+        // triangle that the line leaves p1 through.
+        int start = _vertexTriangles[p1];
+        if (start==NoTriangle) return false;
+
+        int t = start;
+        int k = 0;
+        GLuint next = p1;
+        bool found = false;
+        for (unsigned int count=0; count<_triangles.size(); ++count)
+        {
+            const MeshTriangle& tri = _triangles[t];
+            k = tri.v[0]==p1 ? 0 : (tri.v[1]==p1 ? 1 : 2);
+            GLuint a = tri.v[(k+1)%3];
+            GLuint b = tri.v[(k+2)%3];
+            if (a==p2 || b==p2) return true;
+
+            double oa = orient2d(pt1, pt2, point(a));
+            double ob = orient2d(pt1, pt2, point(b));
+            if (oa==0.0 && dot2d(pt1, point(a), pt2)>0.0 && dot2d(pt2, point(a), pt1)>0.0) { next = a; break; }
+            if (ob==0.0 && dot2d(pt1, point(b), pt2)>0.0 && dot2d(pt2, point(b), pt1)>0.0) { next = b; break; }
+            if (oa<0.0 && ob>0.0) { found = true; break; }
+
+            t = tri.n[(k+2)%3];
+            if (t==NoTriangle || t==start) break;
+        }
+
+        if (next!=p1)
+        {
+            // the edge to a vertex on the constraint line is already in place, carry on from there.
+            p1 = next;
+            continue;
+        }
+        if (!found) return false;
+
+        // walk along the line collecting the triangles it crosses and the vertices either side of it.
+        ++_stamp;
+        std::vector<int> crossed;
+        std::vector<GLuint> left, right;
+        crossed.push_back(t);
+        _marks[t] = _stamp;
+        right.push_back(_triangles[t].v[(k+1)%3]);
+        left.push_back(_triangles[t].v[(k+2)%3]);
+
+        int current = t;
+        int crossedEdge = (k+1)%3;
+        GLuint end = p2;
+        for (;;)
+        {
+            int nb = _triangles[current].n[crossedEdge];
+            if (nb==NoTriangle || _marks[nb]==_stamp) return false;
+
+            crossed.push_back(nb);
+            _marks[nb] = _stamp;
+
+            const MeshTriangle& ntri = _triangles[nb];
+            int j = edgeTo(nb, current);
+            GLuint c = ntri.v[(j+2)%3];
+            if (c==p2) break;
+
+            double oc = orient2d(pt1, pt2, point(c));
+            if (oc<0.0)
+            {
+                right.push_back(c);
+                crossedEdge = (j+2)%3;
+            }
+            else if (oc>0.0)
+            {
+                left.push_back(c);
+                crossedEdge = (j+1)%3;
+            }
+            else
+            {
+                // the line passes through c, constrain up to c and carry on from there.
+                end = c;
+                break;
+            }
+            current = nb;
+        }
+
+        // record the edges around the crossed triangles so the new triangles can be linked to them.
+        EdgeMap outerEdges;
+        for (std::vector<int>::const_iterator itr = crossed.begin(); itr != crossed.end(); ++itr)
+        {
+            const MeshTriangle& tri = _triangles[*itr];
+            for (int e=0; e<3; ++e)
+            {
+                int nb = tri.n[e];
+                if (nb!=NoTriangle && _marks[nb]==_stamp) continue;
+                outerEdges[DirectedEdge(tri.v[e], tri.v[(e+1)%3])] = std::pair<int, int>(nb, nb!=NoTriangle ? edgeTo(nb, *itr) : 0);
+            }
+        }
+
+        for (std::vector<int>::const_iterator itr = crossed.begin(); itr != crossed.end(); ++itr)
+        {
+            deleteTriangle(*itr);
+        }
+
+        std::vector<GLuint> indices;
+        indices.reserve(crossed.size()*3);
+        triangulatePseudoPolygon(p1, end, &left.front(), &left.front()+left.size(), indices);
+        triangulatePseudoPolygon(p1, end, &right.front(), &right.front()+right.size(), indices);
+        linkTriangles(indices, outerEdges);
+
+        p1 = end;
+    }
+    return true;
+}
+
+}
+
 bool DelaunayTriangulator::triangulate()
 {
     // check validity of input array
@@ -790,11 +1211,11 @@ bool DelaunayTriangulator::triangulate()
     _uniqueifyPoints();
 
 
-    // initialize storage structures
-    Triangle_list triangles;
-    Triangle_list discarded_tris;
-
     // GWM July 2005 add constraint vertices to terrain
+    // the terrain points are sorted and unique after _uniqueifyPoints, so they can be searched
+    // directly, the constraint vertices already added are held in a set.
+    GLuint num_terrain_points = points->size();
+    std::set< std::pair<float, float> > constraint_vertices;
     linelist::iterator linitr;
     for (linitr=constraint_lines.begin();linitr!=constraint_lines.end();linitr++)
     {
@@ -802,15 +1223,13 @@ bool DelaunayTriangulator::triangulate()
         const osg::Vec3Array* vercon= dynamic_cast<const osg::Vec3Array*>(dc->getVertexArray());
         if (vercon)
         {
-            int nadded=0;
             for (unsigned int icon=0;icon<vercon->size();icon++)
             {
                 osg::Vec3 p1=(*vercon)[icon];
-                int idx=getindex(p1,points_.get());
-                if (idx<0)
+                if (findSortedPoint(p1, points, num_terrain_points)<0 &&
+                    constraint_vertices.insert(std::pair<float, float>(p1.x(), p1.y())).second)
                 { // only unique vertices are permitted.
                     points_->push_back(p1); // add non-unique constraint points to triangulation
-                    nadded++;
                 }
                 else
                 {
@@ -818,7 +1237,6 @@ bool DelaunayTriangulator::triangulate()
                 }
             }
         }
-    //    OSG_WARN<< "constraint size "<<vercon->size()<<" " <<nadded<< std::endl;
     }
         // GWM July 2005 end
 
@@ -855,244 +1273,64 @@ bool DelaunayTriangulator::triangulate()
     // 16 Dec 2006 this increase in size encourages the supervertex triangles to be long and thin
     // thus ensuring that the convex hull of the terrain points are edges in the delaunay triangulation
     // the values do however result in a small loss of numerical resolution.
-    points_->push_back(osg::Vec3(minx - .10*(maxx - minx), miny - .10*(maxy - miny), 0));
-    points_->push_back(osg::Vec3(maxx + .10*(maxx - minx), miny - .10*(maxy - miny), 0));
-    points_->push_back(osg::Vec3(maxx + .10*(maxx - minx), maxy + .10*(maxy - miny), 0));
-    points_->push_back(osg::Vec3(minx - .10*(maxx - minx), maxy + .10*(maxy - miny), 0));
-
-    // add supertriangles to triangle list
-    triangles.push_back(Triangle(last_valid_index+1, last_valid_index+2, last_valid_index+3, points));
-    triangles.push_back(Triangle(last_valid_index+4, last_valid_index+1, last_valid_index+3, points));
-
+    // points all in a line would give a flat quad, so then use the length of the line in both directions.
+    float marginx = .10*(maxx - minx);
+    float marginy = .10*(maxy - miny);
+    if (marginx==0.0f) marginx = marginy;
+    if (marginy==0.0f) marginy = marginx;
+    if (marginx==0.0f) marginx = marginy = 1.0f;
+    points_->push_back(osg::Vec3(minx - marginx, miny - marginy, 0));
+    points_->push_back(osg::Vec3(maxx + marginx, miny - marginy, 0));
+    points_->push_back(osg::Vec3(maxx + marginx, maxy + marginy, 0));
+    points_->push_back(osg::Vec3(minx - marginx, maxy + marginy, 0));
+
+    // add supertriangles to the mesh
+    TriangleMesh mesh(points);
+    mesh.initialize(last_valid_index+1, last_valid_index+2, last_valid_index+3, last_valid_index+4);
 
     // begin triangulation
-    GLuint pidx = 0;
-    osg::Vec3Array::const_iterator i;
+    OSG_INFO << "DelaunayTriangulator: triangulating vertex grid (" << (last_valid_index+1) <<" points)\n";
 
-    OSG_INFO << "DelaunayTriangulator: triangulating vertex grid (" << (points->size()-3) <<" points)\n";
-
-    for (i=points->begin(); i!=points->end(); ++i, ++pidx)
+    std::vector<GLuint> insertion_order;
+    computeInsertionOrder(points, last_valid_index+1, insertion_order);
+    for (std::vector<GLuint>::const_iterator oitr=insertion_order.begin(); oitr!=insertion_order.end(); ++oitr)
     {
-
-        // don't process supertriangle vertices
-        if (pidx > last_valid_index) break;
-
-        Edge_set edges;
-
-        // iterate through triangles
-        Triangle_list::iterator j, next_j;
-        for (j=triangles.begin(); j!=triangles.end(); j = next_j)
-        {
-
-            next_j = j;
-            ++next_j;
-
-            // get the circumcircle (x,y centre & radius)
-            osg::Vec3 cc = j->get_circumcircle();
-
-            // OPTIMIZATION: since points are pre-sorted by the X component,
-            // check whether we can discard this triangle for future operations
-            float xdist = i->x() - cc.x();
-            // this is where the circumcircles radius rather than R^2 is faster.
-            // original code used r^2 and needed to test xdist*xdist>cc.z && i->x()>cc.x().
-            if ((xdist ) > cc.z() )
-            {
-                discarded_tris.push_back(*j); // these are not needed for further tests as no more
-                // points will ever lie inside this triangle.
-                triangles.erase(j);
-            }
-            else
-            {
-
-                // if the point lies in the triangle's circumcircle then add
-                // its edges to the edge list and remove the triangle
-                if (point_in_circle(*i, cc))
-                {
-                    for (int ei=0; ei<3; ++ei)
-                    {
-                        std::pair<Edge_set::iterator, bool> result = edges.insert(j->get_edge(ei));
-                        if (!result.second)
-                        {
-                            // cast away constness of a set element, which is
-                            // safe in this case since the set_duplicate is
-                            // not used as part of the Less operator.
-                            Edge& edge = const_cast<Edge&>(*(result.first));
-                            // not clear why this change is needed? But prevents removal of twice referenced edges??
-                      //      edge.set_duplicate(true);
-                            edge.set_duplicate(!edge.get_duplicate());
-                        }
-                    }
-                    triangles.erase(j);
-                }
-            }
-        }
-
-        // remove duplicate edges and add new triangles
-        Edge_set::iterator ci;
-        for (ci=edges.begin(); ci!=edges.end(); ++ci)
-        {
-            if (!ci->get_duplicate())
-            {
-                triangles.push_back(Triangle(pidx, ci->ib(), ci->ie(), points));
-            }
-        }
+        mesh.insertPoint(*oitr);
     }
     // dec 2006 we used to remove supertriangle vertices here, but then we cant strictly use the supertriangle
     // vertices to find intersections of constraints with terrain, so moved to later.
 
     OSG_INFO << "DelaunayTriangulator: finalizing and cleaning up structures\n";
 
-     // rejoin the two triangle lists
-    triangles.insert(triangles.begin(), discarded_tris.begin(), discarded_tris.end());
-
-        // GWM July 2005 eliminate any triangle with an edge crossing a constraint line
-    // http://www.geom.uiuc.edu/~samuelp/del_project.html
-    // we could also implement the sourcecode in http://gts.sourceforge.net/reference/gts-delaunay-and-constrained-delaunay-triangulations.html
-    // this uses the set of lines which are boundaries of the constraints, including points
-    // added to the contours by tessellation.
+    // GWM July 2005 force each edge of the constraint lines into the triangulation, the triangles crossed
+    // by an edge are removed and the holes either side of it refilled with constrained Delaunay triangles.
     for (linelist::iterator dcitr=constraint_lines.begin();dcitr!=constraint_lines.end();dcitr++)
     {
-        //DelaunayConstraint *dc=(*dcitr).get();
         const osg::Vec3Array* vercon = dynamic_cast<const osg::Vec3Array*>((*dcitr)->getVertexArray());
         if (vercon)
         {
             for (unsigned int ipr=0; ipr<(*dcitr)->getNumPrimitiveSets(); ipr++)
             {
                 const osg::PrimitiveSet* prset=(*dcitr)->getPrimitiveSet(ipr);
-                if (prset->getMode()==osg::PrimitiveSet::LINE_LOOP ||
-                    prset->getMode()==osg::PrimitiveSet::LINE_STRIP)
+                if ((prset->getMode()==osg::PrimitiveSet::LINE_LOOP ||
+                     prset->getMode()==osg::PrimitiveSet::LINE_STRIP) && prset->getNumIndices()>0)
                 {
                     // loops or strips
                     // start with the last point on the loop
-                    unsigned int ip1=getindex((*vercon)[prset->index (prset->getNumIndices()-1)],points_.get());
+                    int ip1=findSortedPoint((*vercon)[prset->index (prset->getNumIndices()-1)], points, last_valid_index+1);
                     for (unsigned int i=0; i<prset->getNumIndices(); i++)
                     {
-                        unsigned int ip2=getindex((*vercon)[prset->index(i)],points_.get());
-                        if (i>0 || prset->getMode()==osg::PrimitiveSet::LINE_LOOP)
+                        int ip2=findSortedPoint((*vercon)[prset->index(i)], points, last_valid_index+1);
+                        // dont check edge from end to start for strips
+                        if ((i>0 || prset->getMode()==osg::PrimitiveSet::LINE_LOOP) && ip1>=0 && ip2>=0)
                         {
-                            // dont check edge from end to start
-                            // for strips
-                            // 2 points on the constraint
-                            bool edgused=false;// first check for exact edge indices are used.
-                            Triangle_list::iterator titr;
-                            int it=0;
-                            for (titr=triangles.begin(); titr!=triangles.end() && !edgused; ++titr)
+                            if (!mesh.insertConstraint(ip1, ip2))
                             {
-                                //check that the edge ip1-ip2 is not already part of the triangulation.
-                                if (titr->isedge(ip1,ip2)) edgused=true;
-                                if (titr->isedge(ip2,ip1)) edgused=true;
-                                //        if (edgused) OSG_WARN << "Edge used in triangle " << it << " " <<
-                                //            titr->a()<<","<< titr->b()<<","<< titr->c()<<  std::endl;
-                                it++;
+                                OSG_WARN << "DelaunayTriangulator: unable to insert constraint edge from " <<
+                                    (*points)[ip1].x() << " " << (*points)[ip1].y() << " to " <<
+                                    (*points)[ip2].x() << " " << (*points)[ip2].y() << std::endl;
                             }
-                            if (!edgused)
-                            {
-                                // then check for intermediate triangles, erase them and replace with constrained triangles.
-                                // find triangle with point ip1 where the 2 edges from ip1 contain the line p1-p2.
-                                osg::Vec2 p1((*points_)[ip1].x(),(*points_)[ip1].y()); // a constraint line joins p1-p2
-                                osg::Vec2 p2((*points_)[ip2].x(),(*points_)[ip2].y());
-                                int ntr=0;
-                                std::vector<const Triangle *> trisToDelete; // array of triangles to delete from terrain.
-                                // form 2 lists of vertices for the edges of the hole created.
-                                // The hole joins vertex ip1 to ip2, and one list of edges lies to the left
-                                // of the line ip1-ip2m the other to the right.
-                                // a list of vertices forming 2 halves of the removed triangles.
-                                // which in turn are filled in with the tessellator.
-                                for (titr=triangles.begin(); titr!=triangles.end(); )
-                                {
-                                    int icut=titr->lineBisects(points_.get(),ip1,p2);
-                                    //    OSG_WARN << "Testing triangle " << ntr << " "<< ip1 << " ti " <<
-                                    //        titr->a()<< ","<<titr->b() <<"," <<titr->c() << std::endl;
-                                    if (icut>0)
-                                    {
-                                        // triangle titr starts the constraint edge
-                                        std::vector<unsigned int> edgeRight, edgeLeft;
-                                        edgeRight.push_back(ip1);
-                                        edgeLeft.push_back(ip1);
-                                        //        OSG_WARN << "hole first " << edgeLeft.back()<<  " rt " << edgeRight.back()<< std::endl;
-                                        trisToDelete.push_back(&(*titr));
-                                        // now find the unique triangle that shares the defined edge
-                                        unsigned int e1, e2; // indices of ends of test triangle titr
-                                        if    (icut==1)
-                                        {
-                                            // icut=1 implies vertex a is not involved
-                                            e1=titr->b(); e2=titr->c();
-                                        }
-                                        else if (icut==2)
-                                        {
-                                            e1=titr->c(); e2=titr->a();
-                                        }
-                                        else if (icut==3)
-                                        {
-                                            e1=titr->a(); e2=titr->b();
-                                        }
-                                        edgeRight.push_back(e2);
-                                        edgeLeft.push_back(e1);
-                                        //        OSG_WARN << icut << "hole edges " << edgeLeft.back()<<  " rt " << edgeRight.back()<< std::endl;
-                                        const Triangle *tradj=getTriangleWithEdge(e2,e1, &triangles);
-                                        if (tradj)
-                                        {
-                                            while (tradj && !tradj->usesVertex(ip2) && trisToDelete.size()<999)
-                                            {
-                                                trisToDelete.push_back(tradj);
-                                                icut=tradj->whichEdge(points_.get(),p1,p2,e1,e2);
-                                                //    OSG_WARN  << ntr << " cur triedge " << icut << " " << ip1 <<
-                                                //        " to " << ip2 << " tadj " << tradj->a()<< ","<<tradj->b() <<","
-                                                //        <<tradj->c() <<std::endl;
-                                                if        (icut==1) {e1=tradj->b(); e2=tradj->c();} // icut=1 implies vertex a is not involved
-                                                else if (icut==2) {e1=tradj->c(); e2=tradj->a();}
-                                                else if (icut==3) {e1=tradj->a(); e2=tradj->b();}
-                                                if (edgeLeft.back()!=e1 && edgeRight.back()==e2 && e1!=ip2) {
-                                                    edgeLeft.push_back(e1);
-                                                } else if(edgeRight.back()!=e2 && edgeLeft.back()==e1 && e2!=ip2) {
-                                                    edgeRight.push_back(e2);
-                                                } else {
-                                                    if (!tradj->usesVertex(ip2)) OSG_WARN << "tradj error " << tradj->a()<<  " , " << tradj->b()<<  " , " << tradj->c()<< std::endl;
-                                                }
-                                                const Triangle *previousTradj = tradj;
-                                                tradj=getTriangleWithEdge(e2,e1, &triangles);
-                                                if (tradj == previousTradj) {
-                                                    tradj = 0;
-                                                }
-                                            }
-                                            if (trisToDelete.size()>=900) {
-                                                OSG_WARN << " found " << trisToDelete.size() << " adjacent tris " <<std::endl;
-                                            }
-                                        }
-
-                                        // both lines end at ip2 point.
-                                        edgeLeft.push_back(ip2);
-                                        edgeRight.push_back(ip2);
-                                        if (tradj) trisToDelete.push_back(tradj);
-                                        //        OSG_WARN << icut << "hole last " << edgeLeft.back()<<  " rt " << edgeRight.back()<< std::endl;
-                                        Triangle_list constrainedtris=fillHole(points_.get(),edgeLeft);
-                                        triangles.insert(triangles.begin(), constrainedtris.begin(), constrainedtris.end());
-                                        constrainedtris=fillHole(points_.get(),edgeRight);
-                                        triangles.insert(triangles.begin(), constrainedtris.begin(), constrainedtris.end());
-
-                                    }
-                                    ++titr;
-                                    ntr++;
-                                }
-                                // remove the triangles list
-                                Triangle_list::iterator tri; // counts through triangles
-                                for (tri=triangles.begin(); tri!=triangles.end(); )
-                                {
-                                    bool deleted=false;
-                                    for (std::vector<const Triangle *>::iterator deleteTri=trisToDelete.begin();
-                                    deleteTri!=trisToDelete.end(); )
-                                    {
-                                        if (&(*tri)==*deleteTri)
-                                        {
-                                            deleted=true;
-                                            tri=triangles.erase(tri);
-                                            deleteTri=trisToDelete.erase(deleteTri); // 24.12.06 remove from delete list.
-                                        } else {deleteTri++; }
-                                    }
-                                    if (!deleted) ++tri;
-                                }
-                            }
-                        } // strip test
+                        }
 
                         ip1=ip2; // next edge of line
                     }
@@ -1101,64 +1339,40 @@ bool DelaunayTriangulator::triangulate()
         }
     }
     // GWM Sept 2005 end
-    // dec 2006 remove supertriangle vertices - IF we have added some internal vertices (see fillholes)
-    // then these may not be the last vertices in the list.
-//    } else { // remove 3 super-triangle vertices more completely, moving any reference indices down.
-    Triangle_list::iterator tri;
-    GLuint supertriend = last_valid_index+4;
-    for (tri=triangles.begin(); tri!=triangles.end();)
-    { // look for triangles using the supertriangle indices or >super indices and move down by 3.
-        if ((tri->a() > last_valid_index && tri->a() <= supertriend) ||
-            (tri->b() > last_valid_index && tri->b() <= supertriend ) ||
-            (tri->c() > last_valid_index && tri->c() <= supertriend )) {
-            tri=triangles.erase(tri);
-        } else { // move down by 3 tests
-            if (tri->a() > last_valid_index) { // move index down 4
-                tri->incrementa(-4);
-            }
-            if (tri->b() > last_valid_index) { // move down 4
-                tri->incrementb(-4);
-            }
-            if (tri->c() > last_valid_index) { // move down 4 -- correction 21.12.06- was b() should test index c()
-                tri->incrementc(-4);
-            }
-            ++tri; // only increment tri here as the other path increments tri when tri=triangles.erase.
-        }
-    }
-        // remove 3 supertriangle vertices from points. They may not be the last vertices in points if
-        // extra points have been inserted by the constraint re-triangulation.
-    points->erase(points->begin()+last_valid_index+1,points->begin()+last_valid_index+5);
-    //last_valid_index = points->size()-1; // the last valid vertex is last point.
-    // end of dec 2006 changes.
 
     // initialize index storage vector
+    const TriangleMesh::MeshTriangles& triangles = mesh.getTriangles();
     std::vector<GLuint> pt_indices;
     pt_indices.reserve(triangles.size() * 3);
 
     // build osg primitive
     OSG_INFO << "DelaunayTriangulator: building primitive(s)\n";
-    Triangle_list::const_iterator ti;
-    for (ti=triangles.begin(); ti!=triangles.end(); ++ti)
+    for (TriangleMesh::MeshTriangles::const_iterator ti=triangles.begin(); ti!=triangles.end(); ++ti)
     {
+        // don't add this triangle to the primitive if it shares any vertex with the supertriangle,
+        // or if it's degenerate (zero area).
+        if (ti->v[0]==DeletedVertex ||
+            ti->v[0]>last_valid_index || ti->v[1]>last_valid_index || ti->v[2]>last_valid_index) continue;
 
-        // don't add this triangle to the primitive if it shares any vertex with
-        // the supertriangle triangles have already been removed.
-        // Don't need this test: ti->a() <= last_valid_index && ti->b() <= last_valid_index && ti->c() <= last_valid_index &&
-          // Don't add degenerate (zero radius) triangles
-        if ( ti->get_circumcircle().z()>0.0)
-        {
+        const osg::Vec3& a = (*points)[ti->v[0]];
+        const osg::Vec3& b = (*points)[ti->v[1]];
+        const osg::Vec3& c = (*points)[ti->v[2]];
+        if (orient2d(a, b, c)<=0.0) continue;
 
-            if (normals_.valid())
-            {
-                (normals_.get())->push_back(ti->compute_normal(points));
-            }
-
-            pt_indices.push_back(ti->a());
-            pt_indices.push_back(ti->b());
-            pt_indices.push_back(ti->c());
+        if (normals_.valid())
+        {
+            osg::Vec3 N = (b - a) ^ (c - a);
+            (normals_.get())->push_back(N / N.length());
         }
+
+        pt_indices.push_back(ti->v[0]);
+        pt_indices.push_back(ti->v[1]);
+        pt_indices.push_back(ti->v[2]);
     }
 
+    // remove the 4 supertriangle vertices from points.
+    points->erase(points->begin()+last_valid_index+1,points->begin()+last_valid_index+5);
+
     // LF August 2011 fix crash when no triangle is created
     if (!pt_indices.size())
     {
@@ -19,6 +19,7 @@
 #include <osg/Depth>
 #include <osg/ColorMask>
 #include <osg/ApplicationUsage>
+#include <osg/TraceRecorder>
 
 #include <OpenThreads/ScopedLock>
 
@@ -381,6 +382,8 @@ bool IncrementalCompileOperation::CompileList::compile(CompileInfo& compileInfo)
 //
 void IncrementalCompileOperation::CompileSet::buildCompileMap(ContextSet& contexts, StateToCompile& stc)
 {
+    OSG_TRACE_ZONE("osgUtil", "IncrementalCompileOperation::CompileSet::buildCompileMap");
+
     if (contexts.empty() || stc.empty()) return;
 
     if (stc.empty()) return;
@@ -630,6 +633,8 @@ void IncrementalCompileOperation::remove(CompileSet* compileSet)
 
 void IncrementalCompileOperation::mergeCompiledSubgraphs(const osg::FrameStamp* frameStamp)
 {
+    OSG_TRACE_ZONE("osgUtil", "IncrementalCompileOperation::mergeCompiledSubgraphs");
+
     // OSG_INFO<<"IncrementalCompileOperation::mergeCompiledSubgraphs()"<<std::endl;
 
     OpenThreads::ScopedLock<OpenThreads::Mutex>  compilded_lock(_compiledMutex);
@@ -654,6 +659,8 @@ void IncrementalCompileOperation::mergeCompiledSubgraphs(const osg::FrameStamp*
 
 void IncrementalCompileOperation::operator () (osg::GraphicsContext* context)
 {
+    OSG_TRACE_ZONE("osgUtil", "IncrementalCompileOperation::operator()");
+
     osg::NotifySeverity level = osg::INFO;
 
     //glFinish();
@@ -726,6 +733,8 @@ void IncrementalCompileOperation::operator () (osg::GraphicsContext* context)
 
 void IncrementalCompileOperation::compileSets(CompileSets& toCompile, CompileInfo& compileInfo)
 {
+    OSG_TRACE_ZONE("osgUtil", "IncrementalCompileOperation::compileSets");
+
     osg::NotifySeverity level = osg::INFO;
 
     for(CompileSets::iterator itr = toCompile.begin();
@@ -19,6 +19,7 @@
 #include <osg/io_utils>
 #include <osg/TriangleFunctor>
 #include <osg/KdTree>
+#include <osg/Shape>
 #include <osg/Timer>
 #include <osg/TexMat>
 
@@ -307,6 +308,206 @@ void LineSegmentIntersector::leave()
     // do nothing
 }
 
+namespace LineSegmentIntersectorUtils
+{
+    struct HeightFieldIntersection
+    {
+        double          ratio;
+        unsigned int    primitiveIndex;
+        osg::Vec3       normal;
+        unsigned int    index[3];
+        float           r[3];
+    };
+
+    typedef std::vector<HeightFieldIntersection> HeightFieldIntersections;
+
+    /** Intersect a line segment with a HeightField by walking the grid cells that the segment passes over in order,
+      * a 2D DDA, testing just the two triangles of each cell. Cells are split along the diagonal from (c,r) to (c+1,r+1)
+      * to match the triangles generated by ShapeDrawable. Returns intersections ordered along the segment.*/
+    class HeightFieldIntersector
+    {
+        public:
+
+            HeightFieldIntersector(const osg::HeightField& hf):
+                _hf(hf),
+                _numColumns(hf.getNumColumns()),
+                _numRows(hf.getNumRows()),
+                _dx(hf.getXInterval()),
+                _dy(hf.getYInterval()) {}
+
+            bool intersect(const osg::Vec3d& start, const osg::Vec3d& end, bool limitOne, HeightFieldIntersections& intersections)
+            {
+                if (_numColumns<2 || _numRows<2 || _dx==0.0 || _dy==0.0) return false;
+
+                // move the segment into grid coordinates, where cell (c,r) spans [c,c+1]x[r,r+1] and z is the height.
+                osg::Vec3d s = start - _hf.getOrigin();
+                osg::Vec3d e = end - _hf.getOrigin();
+                if (!_hf.zeroRotation())
+                {
+                    osg::Matrixd inverseRotation = osg::Matrixd::inverse(osg::Matrixd(_hf.computeRotationMatrix()));
+                    s = s * inverseRotation;
+                    e = e * inverseRotation;
+                }
+                s.x() /= _dx; s.y() /= _dy;
+                e.x() /= _dx; e.y() /= _dy;
+
+                _s = s;
+                _d = e - s;
+
+                // clip the segment to the extents of the grid.
+                double tmin = 0.0, tmax = 1.0;
+                if (!clip(_s.x(), _d.x(), double(_numColumns-1), tmin, tmax) ||
+                    !clip(_s.y(), _d.y(), double(_numRows-1), tmin, tmax)) return false;
+
+                osg::Vec3d p = _s + _d*tmin;
+                int c = osg::clampBetween(int(floor(p.x())), 0, int(_numColumns)-2);
+                int r = osg::clampBetween(int(floor(p.y())), 0, int(_numRows)-2);
+
+                int stepX = _d.x()>0.0 ? 1 : (_d.x()<0.0 ? -1 : 0);
+                int stepY = _d.y()>0.0 ? 1 : (_d.y()<0.0 ? -1 : 0);
+                double tDeltaX = stepX!=0 ? fabs(1.0/_d.x()) : DBL_MAX;
+                double tDeltaY = stepY!=0 ? fabs(1.0/_d.y()) : DBL_MAX;
+                double tMaxX = stepX>0 ? (double(c+1)-_s.x())/_d.x() : (stepX<0 ? (double(c)-_s.x())/_d.x() : DBL_MAX);
+                double tMaxY = stepY>0 ? (double(r+1)-_s.y())/_d.y() : (stepY<0 ? (double(r)-_s.y())/_d.y() : DBL_MAX);
+
+                unsigned int numBefore = intersections.size();
+                for(;;)
+                {
+                    unsigned int numInCell = intersections.size();
+                    intersectCell(c, r, intersections);
+
+                    if (intersections.size()>numInCell)
+                    {
+                        // the two triangles of a cell can be hit in either order.
+                        if (intersections.size()-numInCell==2 && intersections[numInCell+1].ratio<intersections[numInCell].ratio)
+                        {
+                            std::swap(intersections[numInCell], intersections[numInCell+1]);
+                        }
+                        if (limitOne)
+                        {
+                            intersections.resize(numInCell+1);
+                            break;
+                        }
+                    }
+
+                    if (tMaxX<tMaxY)
+                    {
+                        if (tMaxX>tmax) break;
+                        c += stepX;
+                        tMaxX += tDeltaX;
+                        if (c<0 || c>int(_numColumns)-2) break;
+                    }
+                    else
+                    {
+                        if (tMaxY>tmax) break;
+                        r += stepY;
+                        tMaxY += tDeltaY;
+                        if (r<0 || r>int(_numRows)-2) break;
+                    }
+                }
+
+                return intersections.size()>numBefore;
+            }
+
+        protected:
+
+            HeightFieldIntersector& operator = (const HeightFieldIntersector&) { return *this; }
+
+            static bool clip(double s, double d, double maximum, double& tmin, double& tmax)
+            {
+                if (d==0.0) return s>=0.0 && s<=maximum;
+
+                double t0 = (0.0-s)/d;
+                double t1 = (maximum-s)/d;
+                if (t0>t1) std::swap(t0,t1);
+
+                tmin = osg::maximum(tmin, t0);
+                tmax = osg::minimum(tmax, t1);
+                return tmin<=tmax;
+            }
+
+            inline osg::Vec3d vertex(unsigned int c, unsigned int r) const
+            {
+                return osg::Vec3d(double(c), double(r), _hf.getHeight(c,r));
+            }
+
+            void intersectCell(unsigned int c, unsigned int r, HeightFieldIntersections& intersections)
+            {
+                unsigned int i00 = c + r*_numColumns;
+                unsigned int i10 = i00 + 1;
+                unsigned int i01 = i00 + _numColumns;
+                unsigned int i11 = i01 + 1;
+
+                osg::Vec3d v00 = vertex(c, r);
+                osg::Vec3d v10 = vertex(c+1, r);
+                osg::Vec3d v01 = vertex(c, r+1);
+                osg::Vec3d v11 = vertex(c+1, r+1);
+
+                unsigned int primitiveIndex = 2*(c + r*(_numColumns-1));
+
+                // skip the cell if the segment stays above or below all of its corners.
+                double t0 = 0.0, t1 = 1.0;
+                clip(_s.x()-double(c), _d.x(), 1.0, t0, t1);
+                clip(_s.y()-double(r), _d.y(), 1.0, t0, t1);
+                double z0 = _s.z() + _d.z()*t0;
+                double z1 = _s.z() + _d.z()*t1;
+                double zmin = osg::minimum(osg::minimum(v00.z(), v10.z()), osg::minimum(v01.z(), v11.z()));
+                double zmax = osg::maximum(osg::maximum(v00.z(), v10.z()), osg::maximum(v01.z(), v11.z()));
+                if ((z0>zmax && z1>zmax) || (z0<zmin && z1<zmin)) return;
+
+                intersectTriangle(v01, v00, v11, i01, i00, i11, primitiveIndex, intersections);
+                intersectTriangle(v00, v10, v11, i00, i10, i11, primitiveIndex+1, intersections);
+            }
+
+            void intersectTriangle(const osg::Vec3d& v0, const osg::Vec3d& v1, const osg::Vec3d& v2,
+                                   unsigned int i0, unsigned int i1, unsigned int i2,
+                                   unsigned int primitiveIndex, HeightFieldIntersections& intersections)
+            {
+                osg::Vec3d e1 = v1-v0;
+                osg::Vec3d e2 = v2-v0;
+                osg::Vec3d p = _d ^ e2;
+                double det = e1 * p;
+                if (det==0.0) return;
+
+                double inv_det = 1.0/det;
+                osg::Vec3d t = _s - v0;
+                double u = (t * p) * inv_det;
+                if (u<0.0 || u>1.0) return;
+
+                osg::Vec3d q = t ^ e1;
+                double v = (_d * q) * inv_det;
+                if (v<0.0 || u+v>1.0) return;
+
+                double ratio = (e2 * q) * inv_det;
+                if (ratio<0.0 || ratio>1.0) return;
+
+                HeightFieldIntersection hit;
+                hit.ratio = ratio;
+                hit.primitiveIndex = primitiveIndex;
+
+                // the normal is computed from the edges scaled back from grid to heightfield coordinates.
+                osg::Vec3d n = osg::Vec3d(e1.x()*_dx, e1.y()*_dy, e1.z()) ^ osg::Vec3d(e2.x()*_dx, e2.y()*_dy, e2.z());
+                n.normalize();
+                if (!_hf.zeroRotation()) n = _hf.getRotation() * n;
+                hit.normal = n;
+
+                hit.index[0] = i0; hit.r[0] = float(1.0-u-v);
+                hit.index[1] = i1; hit.r[1] = float(u);
+                hit.index[2] = i2; hit.r[2] = float(v);
+
+                intersections.push_back(hit);
+            }
+
+            const osg::HeightField& _hf;
+            unsigned int            _numColumns;
+            unsigned int            _numRows;
+            double                  _dx;
+            double                  _dy;
+            osg::Vec3d              _s;
+            osg::Vec3d              _d;
+    };
+}
+
 void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable)
 {
     if (reachedLimit()) return;
@@ -383,6 +584,58 @@ void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Dr
         return;
     }
 
+    osg::HeightField* heightField = dynamic_cast<osg::HeightField*>(drawable->getShape());
+    if (heightField)
+    {
+        LineSegmentIntersectorUtils::HeightFieldIntersections intersections;
+        LineSegmentIntersectorUtils::HeightFieldIntersector hfi(*heightField);
+        if (hfi.intersect(s, e, _intersectionLimit != NO_LIMIT, intersections))
+        {
+            for(LineSegmentIntersectorUtils::HeightFieldIntersections::iterator itr = intersections.begin();
+                itr != intersections.end();
+                ++itr)
+            {
+                // remap ratio into _start, _end range
+                double remap_ratio = ((s-_start).length() + itr->ratio * (e-s).length() )/(_end-_start).length();
+
+                if ( _intersectionLimit == LIMIT_NEAREST && !getIntersections().empty() )
+                {
+                    if (remap_ratio >= getIntersections().begin()->ratio )
+                        break;
+                    else
+                        getIntersections().clear();
+                }
+
+                Intersection hit;
+                hit.ratio = remap_ratio;
+                hit.matrix = iv.getModelMatrix();
+                hit.nodePath = iv.getNodePath();
+                hit.drawable = drawable;
+                hit.primitiveIndex = itr->primitiveIndex;
+
+                hit.localIntersectionPoint = _start*(1.0-remap_ratio) + _end*remap_ratio;
+
+                hit.localIntersectionNormal = itr->normal;
+
+                // vertex indices are those of the heightfield grid, column + row*numColumns.
+                hit.indexList.reserve(3);
+                hit.ratioList.reserve(3);
+                for(unsigned int i=0; i<3; ++i)
+                {
+                    if (itr->r[i]!=0.0f)
+                    {
+                        hit.indexList.push_back(itr->index[i]);
+                        hit.ratioList.push_back(itr->r[i]);
+                    }
+                }
+
+                insertIntersection(hit);
+            }
+        }
+
+        return;
+    }
+
     LineSegmentIntersectorUtils::TriangleIntersections intersections;
 
     if (getPrecisionHint()==USE_DOUBLE_CALCULATIONS)
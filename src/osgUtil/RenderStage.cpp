@@ -21,6 +21,7 @@
 #include <osg/TextureCubeMap>
 #include <osg/GLExtensions>
 #include <osg/GLU>
+#include <osg/TraceRecorder>
 
 #include <osgUtil/Statistics>
 
@@ -153,6 +154,8 @@ void RenderStage::reset()
 
 void RenderStage::sort()
 {
+    OSG_TRACE_ZONE("osgUtil", "RenderStage::sort");
+
     for(RenderStageList::iterator pre_itr = _preRenderList.begin();
         pre_itr != _preRenderList.end();
         ++pre_itr)
@@ -223,6 +226,8 @@ void RenderStage::drawPreRenderStages(osg::RenderInfo& renderInfo,RenderLeaf*& p
 
 void RenderStage::runCameraSetUp(osg::RenderInfo& renderInfo)
 {
+    OSG_TRACE_ZONE("osgUtil", "RenderStage::runCameraSetUp");
+
     _cameraRequiresSetUp = false;
 
     if (!_camera) return;
@@ -805,6 +810,8 @@ void RenderStage::runCameraSetUp(osg::RenderInfo& renderInfo)
 
 void RenderStage::copyTexture(osg::RenderInfo& renderInfo)
 {
+    OSG_TRACE_ZONE("osgUtil", "RenderStage::copyTexture");
+
     osg::State& state = *renderInfo.getState();
 
     if ( _readBufferApplyMask )
@@ -880,6 +887,8 @@ void RenderStage::copyTexture(osg::RenderInfo& renderInfo)
 
 void RenderStage::drawInner(osg::RenderInfo& renderInfo,RenderLeaf*& previous, bool& doCopyTexture)
 {
+    OSG_TRACE_ZONE("osgUtil", "RenderStage::drawInner");
+
     struct SubFunc
     {
         static void applyReadFBO(bool& apply_read_fbo,
@@ -1137,6 +1146,8 @@ struct DrawInnerOperation : public osg::Operation
 
 void RenderStage::draw(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
+    OSG_TRACE_ZONE("osgUtil", "RenderStage::draw");
+
     if (_stageDrawnThisFrame) return;
 
     if(_initialViewMatrix.valid()) renderInfo.getState()->setInitialViewMatrix(_initialViewMatrix.get());
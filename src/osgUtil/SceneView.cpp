@@ -24,6 +24,7 @@
 #include <osg/ColorMatrix>
 #include <osg/LightModel>
 #include <osg/CollectOccludersVisitor>
+#include <osg/TraceRecorder>
 
 #include <osg/GLU>
 
@@ -786,6 +787,7 @@ void SceneView::cull()
 
 bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& modelview,osgUtil::CullVisitor* cullVisitor, osgUtil::StateGraph* rendergraph, osgUtil::RenderStage* renderStage, osg::Viewport *viewport)
 {
+    OSG_TRACE_ZONE("osgUtil", "SceneView::cullStage");
 
     if (!_camera || !viewport) return false;
 
@@ -860,7 +862,10 @@ bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& mod
     // use clean of the rendergraph rather than reset, as it is able to
     // reuse the structure on the rendergraph in the next frame. This
     // achieves a certain amount of frame cohereancy of memory allocation.
-    rendergraph->clean();
+    {
+        OSG_TRACE_ZONE("osgUtil", "StateGraph::clean");
+        rendergraph->clean();
+    }
 
     renderStage->setInitialViewMatrix(mv.get());
     renderStage->setViewport(viewport);
@@ -925,7 +930,10 @@ bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& mod
     // reset at the start of each frame (see top of this method) but
     // a clean has been used instead to try to minimize the amount of
     // allocation and deleteing of the StateGraph nodes.
-    rendergraph->prune();
+    {
+        OSG_TRACE_ZONE("osgUtil", "StateGraph::prune");
+        rendergraph->prune();
+    }
 
     // set the number of dynamic objects in the scene.
     _dynamicObjectCount += renderStage->computeNumberOfDynamicRenderLeaves();
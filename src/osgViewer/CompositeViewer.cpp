@@ -18,10 +18,13 @@
 #include <osgGA/TrackballManipulator>
 #include <osgViewer/CompositeViewer>
 #include <osgViewer/Renderer>
+
+#include "StatsAttributeIDs.h"
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
 
 #include <osg/io_utils>
+#include <osg/TraceRecorder>
 
 using namespace osgViewer;
 
@@ -693,11 +696,11 @@ void CompositeViewer::advance(double simulationTime)
     {
         // update previous frame stats
         double deltaFrameTime = _frameStamp->getReferenceTime() - previousReferenceTime;
-        getViewerStats()->setAttribute(previousFrameNumber, "Frame duration", deltaFrameTime);
-        getViewerStats()->setAttribute(previousFrameNumber, "Frame rate", 1.0/deltaFrameTime);
+        getViewerStats()->setAttribute(previousFrameNumber, getStatsAttributeIDs().frameDuration, deltaFrameTime);
+        getViewerStats()->setAttribute(previousFrameNumber, getStatsAttributeIDs().frameRate, 1.0/deltaFrameTime);
 
         // update current frames stats
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Reference time", _frameStamp->getReferenceTime());
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().referenceTime, _frameStamp->getReferenceTime());
     }
 
 }
@@ -924,6 +927,8 @@ struct SortEvents
 
 void CompositeViewer::eventTraversal()
 {
+    OSG_TRACE_ZONE("osgViewer", "CompositeViewer::eventTraversal");
+
     if (_done) return;
 
     if (_views.empty()) return;
@@ -1249,14 +1254,16 @@ void CompositeViewer::eventTraversal()
         double endEventTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
 
         // update current frames stats
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Event traversal begin time", beginEventTraversal);
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Event traversal end time", endEventTraversal);
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Event traversal time taken", endEventTraversal-beginEventTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().eventTraversalBeginTime, beginEventTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().eventTraversalEndTime, endEventTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().eventTraversalTimeTaken, endEventTraversal-beginEventTraversal);
     }
 }
 
 void CompositeViewer::updateTraversal()
 {
+    OSG_TRACE_ZONE("osgViewer", "CompositeViewer::updateTraversal");
+
     if (_done) return;
 
     double beginUpdateTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
@@ -1351,9 +1358,11 @@ void CompositeViewer::updateTraversal()
         double endUpdateTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
 
         // update current frames stats
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal begin time", beginUpdateTraversal);
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal end time", endUpdateTraversal);
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal time taken", endUpdateTraversal-beginUpdateTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().updateTraversalBeginTime, beginUpdateTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().updateTraversalEndTime, endUpdateTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().updateTraversalTimeTaken, endUpdateTraversal-beginUpdateTraversal);
+
+        collectDatabasePagerStats(_frameStamp->getFrameNumber());
     }
 
 }
@@ -23,10 +23,13 @@
 #include <osgViewer/Renderer>
 #include <osgViewer/View>
 
+#include "StatsAttributeIDs.h"
+
 #include <osgDB/DatabasePager>
 #include <osgDB/ImagePager>
 
 #include <osg/io_utils>
+#include <osg/TraceRecorder>
 
 #include <sstream>
 
@@ -85,9 +88,9 @@ void EXTQuerySupport::checkQuery(osg::Stats* stats, osg::State* /*state*/,
             double estimatedEndTime = (_previousQueryTime + currentTime) * 0.5;
             double estimatedBeginTime = estimatedEndTime - timeElapsedSeconds;
 
-            stats->setAttribute(itr->second, "GPU draw begin time", estimatedBeginTime);
-            stats->setAttribute(itr->second, "GPU draw end time", estimatedEndTime);
-            stats->setAttribute(itr->second, "GPU draw time taken", timeElapsedSeconds);
+            stats->setAttribute(itr->second, getStatsAttributeIDs().gpuDrawBeginTime, estimatedBeginTime);
+            stats->setAttribute(itr->second, getStatsAttributeIDs().gpuDrawEndTime, estimatedEndTime);
+            stats->setAttribute(itr->second, getStatsAttributeIDs().gpuDrawTimeTaken, timeElapsedSeconds);
 
 
             itr = _queryFrameNumberList.erase(itr);
@@ -268,10 +271,10 @@ void ARBQuerySupport::checkQuery(osg::Stats* stats, osg::State* state,
             else
                 endTime = gpuTick
                     - double(gpuTimestamp - endTimestamp) * 1e-9;
-            stats->setAttribute(itr->frameNumber, "GPU draw begin time",
+            stats->setAttribute(itr->frameNumber, getStatsAttributeIDs().gpuDrawBeginTime,
                                 beginTime);
-            stats->setAttribute(itr->frameNumber, "GPU draw end time", endTime);
-            stats->setAttribute(itr->frameNumber, "GPU draw time taken",
+            stats->setAttribute(itr->frameNumber, getStatsAttributeIDs().gpuDrawEndTime, endTime);
+            stats->setAttribute(itr->frameNumber, getStatsAttributeIDs().gpuDrawTimeTaken,
                                 timeElapsedSeconds);
             itr = _queryFrameList.erase(itr);
             _availableQueryObjects.push_back(queries);
@@ -571,15 +574,17 @@ static void collectSceneViewStats(unsigned int frameNumber, osgUtil::SceneView*
     osgUtil::Statistics sceneStats;
     sceneView->getStats(sceneStats);
 
-    stats->setAttribute(frameNumber, "Visible vertex count", static_cast<double>(sceneStats._vertexCount));
-    stats->setAttribute(frameNumber, "Visible number of drawables", static_cast<double>(sceneStats.numDrawables));
-    stats->setAttribute(frameNumber, "Visible number of fast drawables", static_cast<double>(sceneStats.numFastDrawables));
-    stats->setAttribute(frameNumber, "Visible number of lights", static_cast<double>(sceneStats.nlights));
-    stats->setAttribute(frameNumber, "Visible number of render bins", static_cast<double>(sceneStats.nbins));
-    stats->setAttribute(frameNumber, "Visible depth", static_cast<double>(sceneStats.depth));
-    stats->setAttribute(frameNumber, "Number of StateGraphs", static_cast<double>(sceneStats.numStateGraphs));
-    stats->setAttribute(frameNumber, "Visible number of impostors", static_cast<double>(sceneStats.nimpostor));
-    stats->setAttribute(frameNumber, "Number of ordered leaves", static_cast<double>(sceneStats.numOrderedLeaves));
+    const StatsAttributeIDs& ids = getStatsAttributeIDs();
+
+    stats->setAttribute(frameNumber, ids.visibleVertexCount, static_cast<double>(sceneStats._vertexCount));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfDrawables, static_cast<double>(sceneStats.numDrawables));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfFastDrawables, static_cast<double>(sceneStats.numFastDrawables));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfLights, static_cast<double>(sceneStats.nlights));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfRenderBins, static_cast<double>(sceneStats.nbins));
+    stats->setAttribute(frameNumber, ids.visibleDepth, static_cast<double>(sceneStats.depth));
+    stats->setAttribute(frameNumber, ids.numberOfStateGraphs, static_cast<double>(sceneStats.numStateGraphs));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfImpostors, static_cast<double>(sceneStats.nimpostor));
+    stats->setAttribute(frameNumber, ids.numberOfOrderedLeaves, static_cast<double>(sceneStats.numOrderedLeaves));
 
     unsigned int totalNumPrimitiveSets = 0;
     const osgUtil::Statistics::PrimitiveValueMap& pvm = sceneStats.getPrimitiveValueMap();
@@ -589,23 +594,25 @@ static void collectSceneViewStats(unsigned int frameNumber, osgUtil::SceneView*
     {
         totalNumPrimitiveSets += pvm_itr->second.first;
     }
-    stats->setAttribute(frameNumber, "Visible number of PrimitiveSets", static_cast<double>(totalNumPrimitiveSets));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfPrimitiveSets, static_cast<double>(totalNumPrimitiveSets));
 
     osgUtil::Statistics::PrimitiveCountMap& pcm = sceneStats.getPrimitiveCountMap();
-    stats->setAttribute(frameNumber, "Visible number of GL_POINTS", static_cast<double>(pcm[GL_POINTS]));
-    stats->setAttribute(frameNumber, "Visible number of GL_LINES", static_cast<double>(pcm[GL_LINES]));
-    stats->setAttribute(frameNumber, "Visible number of GL_LINE_STRIP", static_cast<double>(pcm[GL_LINE_STRIP]));
-    stats->setAttribute(frameNumber, "Visible number of GL_LINE_LOOP", static_cast<double>(pcm[GL_LINE_LOOP]));
-    stats->setAttribute(frameNumber, "Visible number of GL_TRIANGLES", static_cast<double>(pcm[GL_TRIANGLES]));
-    stats->setAttribute(frameNumber, "Visible number of GL_TRIANGLE_STRIP", static_cast<double>(pcm[GL_TRIANGLE_STRIP]));
-    stats->setAttribute(frameNumber, "Visible number of GL_TRIANGLE_FAN", static_cast<double>(pcm[GL_TRIANGLE_FAN]));
-    stats->setAttribute(frameNumber, "Visible number of GL_QUADS", static_cast<double>(pcm[GL_QUADS]));
-    stats->setAttribute(frameNumber, "Visible number of GL_QUAD_STRIP", static_cast<double>(pcm[GL_QUAD_STRIP]));
-    stats->setAttribute(frameNumber, "Visible number of GL_POLYGON", static_cast<double>(pcm[GL_POLYGON]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfPoints, static_cast<double>(pcm[GL_POINTS]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfLines, static_cast<double>(pcm[GL_LINES]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfLineStrips, static_cast<double>(pcm[GL_LINE_STRIP]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfLineLoops, static_cast<double>(pcm[GL_LINE_LOOP]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfTriangles, static_cast<double>(pcm[GL_TRIANGLES]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfTriangleStrips, static_cast<double>(pcm[GL_TRIANGLE_STRIP]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfTriangleFans, static_cast<double>(pcm[GL_TRIANGLE_FAN]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfQuads, static_cast<double>(pcm[GL_QUADS]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfQuadStrips, static_cast<double>(pcm[GL_QUAD_STRIP]));
+    stats->setAttribute(frameNumber, ids.visibleNumberOfPolygons, static_cast<double>(pcm[GL_POLYGON]));
 }
 
 void Renderer::cull()
 {
+    OSG_TRACE_ZONE("osgViewer", "Renderer::cull");
+
     DEBUG_MESSAGE<<"cull()"<<std::endl;
 
     if (_done || _graphicsThreadDoesCull) return;
@@ -649,9 +656,9 @@ void Renderer::cull()
         {
             DEBUG_MESSAGE<<"Collecting rendering stats"<<std::endl;
 
-            stats->setAttribute(frameNumber, "Cull traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
-            stats->setAttribute(frameNumber, "Cull traversal end time", osg::Timer::instance()->delta_s(_startTick, afterCullTick));
-            stats->setAttribute(frameNumber, "Cull traversal time taken", osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
+            stats->setAttribute(frameNumber, getStatsAttributeIDs().cullTraversalBeginTime, osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
+            stats->setAttribute(frameNumber, getStatsAttributeIDs().cullTraversalEndTime, osg::Timer::instance()->delta_s(_startTick, afterCullTick));
+            stats->setAttribute(frameNumber, getStatsAttributeIDs().cullTraversalTimeTaken, osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
         }
 
         if (stats && stats->collectStats("scene"))
@@ -668,6 +675,8 @@ void Renderer::cull()
 
 void Renderer::draw()
 {
+    OSG_TRACE_ZONE("osgViewer", "Renderer::draw");
+
     DEBUG_MESSAGE<<"draw() "<<this<<std::endl;
 
     // osg::Timer_t startDrawTick = osg::Timer::instance()->tick();
@@ -767,9 +776,9 @@ void Renderer::draw()
 
         if (stats && stats->collectStats("rendering"))
         {
-            stats->setAttribute(frameNumber, "Draw traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
-            stats->setAttribute(frameNumber, "Draw traversal end time", osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
-            stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
+            stats->setAttribute(frameNumber, getStatsAttributeIDs().drawTraversalBeginTime, osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
+            stats->setAttribute(frameNumber, getStatsAttributeIDs().drawTraversalEndTime, osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
+            stats->setAttribute(frameNumber, getStatsAttributeIDs().drawTraversalTimeTaken, osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
         }
 
         sceneView->clearReferencesToDependentCameras();
@@ -780,6 +789,8 @@ void Renderer::draw()
 
 void Renderer::cull_draw()
 {
+    OSG_TRACE_ZONE("osgViewer", "Renderer::cull_draw");
+
     DEBUG_MESSAGE<<"cull_draw() "<<this<<std::endl;
 
     osgUtil::SceneView* sceneView = _sceneView[0].get();
@@ -877,13 +888,13 @@ void Renderer::cull_draw()
     {
         DEBUG_MESSAGE<<"Collecting rendering stats"<<std::endl;
 
-        stats->setAttribute(frameNumber, "Cull traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
-        stats->setAttribute(frameNumber, "Cull traversal end time", osg::Timer::instance()->delta_s(_startTick, afterCullTick));
-        stats->setAttribute(frameNumber, "Cull traversal time taken", osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
+        stats->setAttribute(frameNumber, getStatsAttributeIDs().cullTraversalBeginTime, osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
+        stats->setAttribute(frameNumber, getStatsAttributeIDs().cullTraversalEndTime, osg::Timer::instance()->delta_s(_startTick, afterCullTick));
+        stats->setAttribute(frameNumber, getStatsAttributeIDs().cullTraversalTimeTaken, osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
 
-        stats->setAttribute(frameNumber, "Draw traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
-        stats->setAttribute(frameNumber, "Draw traversal end time", osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
-        stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
+        stats->setAttribute(frameNumber, getStatsAttributeIDs().drawTraversalBeginTime, osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
+        stats->setAttribute(frameNumber, getStatsAttributeIDs().drawTraversalEndTime, osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
+        stats->setAttribute(frameNumber, getStatsAttributeIDs().drawTraversalTimeTaken, osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
     }
 
     DEBUG_MESSAGE<<"end cull_draw() "<<this<<std::endl;
@@ -0,0 +1,68 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include "StatsAttributeIDs.h"
+
+using namespace osgViewer;
+
+StatsAttributeIDs::StatsAttributeIDs():
+    frameDuration(osg::Stats::getAttributeID("Frame duration")),
+    frameRate(osg::Stats::getAttributeID("Frame rate")),
+    referenceTime(osg::Stats::getAttributeID("Reference time")),
+    eventTraversalBeginTime(osg::Stats::getAttributeID("Event traversal begin time")),
+    eventTraversalEndTime(osg::Stats::getAttributeID("Event traversal end time")),
+    eventTraversalTimeTaken(osg::Stats::getAttributeID("Event traversal time taken")),
+    updateTraversalBeginTime(osg::Stats::getAttributeID("Update traversal begin time")),
+    updateTraversalEndTime(osg::Stats::getAttributeID("Update traversal end time")),
+    updateTraversalTimeTaken(osg::Stats::getAttributeID("Update traversal time taken")),
+    renderingTraversalsBeginTime(osg::Stats::getAttributeID("Rendering traversals begin time ")),
+    renderingTraversalsEndTime(osg::Stats::getAttributeID("Rendering traversals end time ")),
+    renderingTraversalsTimeTaken(osg::Stats::getAttributeID("Rendering traversals time taken")),
+    bytesPendingRelease(osg::Stats::getAttributeID("Number of bytes pending release")),
+    gpuDrawBeginTime(osg::Stats::getAttributeID("GPU draw begin time")),
+    gpuDrawEndTime(osg::Stats::getAttributeID("GPU draw end time")),
+    gpuDrawTimeTaken(osg::Stats::getAttributeID("GPU draw time taken")),
+    cullTraversalBeginTime(osg::Stats::getAttributeID("Cull traversal begin time")),
+    cullTraversalEndTime(osg::Stats::getAttributeID("Cull traversal end time")),
+    cullTraversalTimeTaken(osg::Stats::getAttributeID("Cull traversal time taken")),
+    drawTraversalBeginTime(osg::Stats::getAttributeID("Draw traversal begin time")),
+    drawTraversalEndTime(osg::Stats::getAttributeID("Draw traversal end time")),
+    drawTraversalTimeTaken(osg::Stats::getAttributeID("Draw traversal time taken")),
+    visibleVertexCount(osg::Stats::getAttributeID("Visible vertex count")),
+    visibleNumberOfDrawables(osg::Stats::getAttributeID("Visible number of drawables")),
+    visibleNumberOfFastDrawables(osg::Stats::getAttributeID("Visible number of fast drawables")),
+    visibleNumberOfLights(osg::Stats::getAttributeID("Visible number of lights")),
+    visibleNumberOfRenderBins(osg::Stats::getAttributeID("Visible number of render bins")),
+    visibleDepth(osg::Stats::getAttributeID("Visible depth")),
+    numberOfStateGraphs(osg::Stats::getAttributeID("Number of StateGraphs")),
+    visibleNumberOfImpostors(osg::Stats::getAttributeID("Visible number of impostors")),
+    numberOfOrderedLeaves(osg::Stats::getAttributeID("Number of ordered leaves")),
+    visibleNumberOfPrimitiveSets(osg::Stats::getAttributeID("Visible number of PrimitiveSets")),
+    visibleNumberOfPoints(osg::Stats::getAttributeID("Visible number of GL_POINTS")),
+    visibleNumberOfLines(osg::Stats::getAttributeID("Visible number of GL_LINES")),
+    visibleNumberOfLineStrips(osg::Stats::getAttributeID("Visible number of GL_LINE_STRIP")),
+    visibleNumberOfLineLoops(osg::Stats::getAttributeID("Visible number of GL_LINE_LOOP")),
+    visibleNumberOfTriangles(osg::Stats::getAttributeID("Visible number of GL_TRIANGLES")),
+    visibleNumberOfTriangleStrips(osg::Stats::getAttributeID("Visible number of GL_TRIANGLE_STRIP")),
+    visibleNumberOfTriangleFans(osg::Stats::getAttributeID("Visible number of GL_TRIANGLE_FAN")),
+    visibleNumberOfQuads(osg::Stats::getAttributeID("Visible number of GL_QUADS")),
+    visibleNumberOfQuadStrips(osg::Stats::getAttributeID("Visible number of GL_QUAD_STRIP")),
+    visibleNumberOfPolygons(osg::Stats::getAttributeID("Visible number of GL_POLYGON"))
+{
+}
+
+const StatsAttributeIDs& osgViewer::getStatsAttributeIDs()
+{
+    static StatsAttributeIDs s_statsAttributeIDs;
+    return s_statsAttributeIDs;
+}
@@ -0,0 +1,81 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef OSGVIEWER_STATSATTRIBUTEIDS_H
+#define OSGVIEWER_STATSATTRIBUTEIDS_H 1
+
+#include <osg/Stats>
+
+namespace osgViewer {
+
+/** IDs of the osg::Stats attributes recorded by the viewer classes each frame,
+  * looked up once so that recording them doesn't require the attribute name lookup.*/
+struct StatsAttributeIDs
+{
+    StatsAttributeIDs();
+
+    // viewer stats
+    unsigned int frameDuration;
+    unsigned int frameRate;
+    unsigned int referenceTime;
+    unsigned int eventTraversalBeginTime;
+    unsigned int eventTraversalEndTime;
+    unsigned int eventTraversalTimeTaken;
+    unsigned int updateTraversalBeginTime;
+    unsigned int updateTraversalEndTime;
+    unsigned int updateTraversalTimeTaken;
+    unsigned int renderingTraversalsBeginTime;
+    unsigned int renderingTraversalsEndTime;
+    unsigned int renderingTraversalsTimeTaken;
+    unsigned int bytesPendingRelease;
+
+    // camera stats
+    unsigned int gpuDrawBeginTime;
+    unsigned int gpuDrawEndTime;
+    unsigned int gpuDrawTimeTaken;
+    unsigned int cullTraversalBeginTime;
+    unsigned int cullTraversalEndTime;
+    unsigned int cullTraversalTimeTaken;
+    unsigned int drawTraversalBeginTime;
+    unsigned int drawTraversalEndTime;
+    unsigned int drawTraversalTimeTaken;
+
+    // camera scene stats
+    unsigned int visibleVertexCount;
+    unsigned int visibleNumberOfDrawables;
+    unsigned int visibleNumberOfFastDrawables;
+    unsigned int visibleNumberOfLights;
+    unsigned int visibleNumberOfRenderBins;
+    unsigned int visibleDepth;
+    unsigned int numberOfStateGraphs;
+    unsigned int visibleNumberOfImpostors;
+    unsigned int numberOfOrderedLeaves;
+    unsigned int visibleNumberOfPrimitiveSets;
+    unsigned int visibleNumberOfPoints;
+    unsigned int visibleNumberOfLines;
+    unsigned int visibleNumberOfLineStrips;
+    unsigned int visibleNumberOfLineLoops;
+    unsigned int visibleNumberOfTriangles;
+    unsigned int visibleNumberOfTriangleStrips;
+    unsigned int visibleNumberOfTriangleFans;
+    unsigned int visibleNumberOfQuads;
+    unsigned int visibleNumberOfQuadStrips;
+    unsigned int visibleNumberOfPolygons;
+};
+
+/** Get the IDs of the attributes recorded by the viewer classes, initialized on first use.*/
+const StatsAttributeIDs& getStatsAttributeIDs();
+
+}
+
+#endif
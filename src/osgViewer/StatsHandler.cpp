@@ -22,6 +22,8 @@
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Renderer>
 
+#include "StatsAttributeIDs.h"
+
 #include <osg/PolygonMode>
 #include <osg/Geometry>
 
@@ -32,6 +34,8 @@ namespace osgViewer
 StatsHandler::StatsHandler():
     _keyEventTogglesOnScreenStats('s'),
     _keyEventPrintsOutStats('S'),
+    _keyEventWritesOutStatsTrace('T'),
+    _statsTraceFileName("osgstats_trace.json"),
     _statsType(NO_STATS),
     _initialized(false),
     _threadingModel(ViewerBase::SingleThreaded),
@@ -234,6 +238,39 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                 }
                 return true;
             }
+            if (ea.getKey()==_keyEventWritesOutStatsTrace)
+            {
+                if (viewer->getViewerStats())
+                {
+                    osg::StatsTraceWriter traceWriter;
+                    traceWriter.addStats(viewer->getViewerStats());
+
+                    osgViewer::ViewerBase::Contexts contexts;
+                    viewer->getContexts(contexts);
+                    for(osgViewer::ViewerBase::Contexts::iterator gcitr = contexts.begin();
+                        gcitr != contexts.end();
+                        ++gcitr)
+                    {
+                        osg::GraphicsContext::Cameras& cameras = (*gcitr)->getCameras();
+                        for(osg::GraphicsContext::Cameras::iterator itr = cameras.begin();
+                            itr != cameras.end();
+                            ++itr)
+                        {
+                            traceWriter.addStats((*itr)->getStats());
+                        }
+                    }
+
+                    if (traceWriter.write(_statsTraceFileName))
+                    {
+                        OSG_NOTICE<<"Stats trace written to "<<_statsTraceFileName<<std::endl;
+                    }
+                    else
+                    {
+                        OSG_NOTICE<<"Warning: unable to write stats trace to "<<_statsTraceFileName<<std::endl;
+                    }
+                }
+                return true;
+            }
         }
         case(osgGA::GUIEventAdapter::RESIZE):
             setWindowSize(ea.getWindowWidth(), ea.getWindowHeight());
@@ -353,7 +390,7 @@ struct AveragedValueTextDrawCallback : public virtual osg::Drawable::DrawCallbac
 {
     AveragedValueTextDrawCallback(osg::Stats* stats, const std::string& name, int frameDelta, bool averageInInverseSpace, double multiplier):
         _stats(stats),
-        _attributeName(name),
+        _attributeID(osg::Stats::getAttributeID(name)),
         _frameDelta(frameDelta),
         _averageInInverseSpace(averageInInverseSpace),
         _multiplier(multiplier),
@@ -373,7 +410,7 @@ struct AveragedValueTextDrawCallback : public virtual osg::Drawable::DrawCallbac
         {
             _tickLastUpdated = tick;
             double value;
-            if (_stats->getAveragedAttribute( _attributeName, value, _averageInInverseSpace))
+            if (_stats->getAveragedAttribute( _attributeID, value, _averageInInverseSpace))
             {
                 char tmpText[128];
                 sprintf(tmpText,"%4.2f",value * _multiplier);
@@ -388,7 +425,7 @@ struct AveragedValueTextDrawCallback : public virtual osg::Drawable::DrawCallbac
     }
 
     osg::ref_ptr<osg::Stats>    _stats;
-    std::string                 _attributeName;
+    unsigned int                _attributeID;
     int                         _frameDelta;
     bool                        _averageInInverseSpace;
     double                      _multiplier;
@@ -400,7 +437,7 @@ struct RawValueTextDrawCallback : public virtual osg::Drawable::DrawCallback
 {
     RawValueTextDrawCallback(osg::Stats* stats, const std::string& name, int frameDelta, double multiplier):
         _stats(stats),
-        _attributeName(name),
+        _attributeID(osg::Stats::getAttributeID(name)),
         _frameDelta(frameDelta),
         _multiplier(multiplier),
         _tickLastUpdated(0)
@@ -421,7 +458,7 @@ struct RawValueTextDrawCallback : public virtual osg::Drawable::DrawCallback
 
             unsigned int frameNumber = renderInfo.getState()->getFrameStamp()->getFrameNumber();
             double value;
-            if (_stats->getAttribute(frameNumber, _attributeName, value))
+            if (_stats->getAttribute(frameNumber, _attributeID, value))
             {
                 char tmpText[128];
                 sprintf(tmpText,"%4.2f",value * _multiplier);
@@ -436,7 +473,7 @@ struct RawValueTextDrawCallback : public virtual osg::Drawable::DrawCallback
     }
 
     osg::ref_ptr<osg::Stats>    _stats;
-    std::string                 _attributeName;
+    unsigned int                _attributeID;
     int                         _frameDelta;
     double                      _multiplier;
     mutable osg::Timer_t        _tickLastUpdated;
@@ -630,8 +667,8 @@ struct BlockDrawCallback : public virtual osg::Drawable::DrawCallback
         _xPos(xPos),
         _viewerStats(viewerStats),
         _stats(stats),
-        _beginName(beginName),
-        _endName(endName),
+        _beginID(osg::Stats::getAttributeID(beginName)),
+        _endID(osg::Stats::getAttributeID(endName)),
         _frameDelta(frameDelta),
         _numFrames(numFrames) {}
 
@@ -645,7 +682,7 @@ struct BlockDrawCallback : public virtual osg::Drawable::DrawCallback
         int startFrame = frameNumber + _frameDelta - _numFrames + 1;
         int endFrame = frameNumber + _frameDelta;
         double referenceTime;
-        if (!_viewerStats->getAttribute( startFrame, "Reference time", referenceTime))
+        if (!_viewerStats->getAttribute( startFrame, getStatsAttributeIDs().referenceTime, referenceTime))
         {
             return;
         }
@@ -654,8 +691,8 @@ struct BlockDrawCallback : public virtual osg::Drawable::DrawCallback
         double beginValue, endValue;
         for(int i = startFrame; i <= endFrame; ++i)
         {
-            if (_stats->getAttribute( i, _beginName, beginValue) &&
-                _stats->getAttribute( i, _endName, endValue) )
+            if (_stats->getAttribute( i, _beginID, beginValue) &&
+                _stats->getAttribute( i, _endID, endValue) )
             {
                 (*vertices)[vi++].x() = _xPos + (beginValue - referenceTime) * _statsHandler->getBlockMultiplier();
                 (*vertices)[vi++].x() = _xPos + (beginValue - referenceTime) * _statsHandler->getBlockMultiplier();
@@ -674,8 +711,8 @@ struct BlockDrawCallback : public virtual osg::Drawable::DrawCallback
     float                       _xPos;
     osg::ref_ptr<osg::Stats>    _viewerStats;
     osg::ref_ptr<osg::Stats>    _stats;
-    std::string                 _beginName;
-    std::string                 _endName;
+    unsigned int                _beginID;
+    unsigned int                _endID;
     int                         _frameDelta;
     int                         _numFrames;
 };
@@ -758,7 +795,10 @@ protected:
         GraphUpdateCallback(const osg::Vec3& pos, float width, float height, osg::Stats* viewerStats, osg::Stats* stats,
                             float max, const std::string& nameBegin, const std::string& nameEnd = "")
             : _pos(pos), _width((unsigned int)width), _height((unsigned int)height), _curX(0),
-              _viewerStats(viewerStats), _stats(stats), _max(max), _nameBegin(nameBegin), _nameEnd(nameEnd)
+              _viewerStats(viewerStats), _stats(stats), _max(max),
+              _beginID(osg::Stats::getAttributeID(nameBegin)),
+              _hasEnd(!nameEnd.empty()),
+              _endID(_hasEnd ? osg::Stats::getAttributeID(nameEnd) : 0)
         {
         }
 
@@ -773,9 +813,9 @@ protected:
 
             // Get stats
             double value;
-            if (_nameEnd.empty())
+            if (!_hasEnd)
             {
-                if (!_stats->getAveragedAttribute( _nameBegin, value, true ))
+                if (!_stats->getAveragedAttribute( _beginID, value, true ))
                 {
                     value = 0.0;
                 }
@@ -783,8 +823,8 @@ protected:
             else
             {
                 double beginValue, endValue;
-                if (_stats->getAttribute( frameNumber, _nameBegin, beginValue) &&
-                    _stats->getAttribute( frameNumber, _nameEnd, endValue) )
+                if (_stats->getAttribute( frameNumber, _beginID, beginValue) &&
+                    _stats->getAttribute( frameNumber, _endID, endValue) )
                 {
                     value = endValue - beginValue;
                 }
@@ -849,8 +889,9 @@ protected:
         osg::Stats*             _viewerStats;
         osg::Stats*             _stats;
         const float             _max;
-        const std::string       _nameBegin;
-        const std::string       _nameEnd;
+        const unsigned int      _beginID;
+        const bool              _hasEnd;
+        const unsigned int      _endID;
         static unsigned int     _frameNumber;
     };
 };
@@ -906,7 +947,7 @@ struct FrameMarkerDrawCallback : public virtual osg::Drawable::DrawCallback
         int startFrame = frameNumber + _frameDelta - _numFrames + 1;
         int endFrame = frameNumber + _frameDelta;
         double referenceTime;
-        if (!_viewerStats->getAttribute( startFrame, "Reference time", referenceTime))
+        if (!_viewerStats->getAttribute( startFrame, getStatsAttributeIDs().referenceTime, referenceTime))
         {
             return;
         }
@@ -915,7 +956,7 @@ struct FrameMarkerDrawCallback : public virtual osg::Drawable::DrawCallback
         double currentReferenceTime;
         for(int i = startFrame; i <= endFrame; ++i)
         {
-            if (_viewerStats->getAttribute( i, "Reference time", currentReferenceTime))
+            if (_viewerStats->getAttribute( i, getStatsAttributeIDs().referenceTime, currentReferenceTime))
             {
                 (*vertices)[vi++].x() = _xPos + (currentReferenceTime - referenceTime) * _statsHandler->getBlockMultiplier();
                 (*vertices)[vi++].x() = _xPos + (currentReferenceTime - referenceTime) * _statsHandler->getBlockMultiplier();
@@ -1704,6 +1745,7 @@ void StatsHandler::getUsage(osg::ApplicationUsage& usage) const
 {
     usage.addKeyboardMouseBinding(_keyEventTogglesOnScreenStats,"On screen stats.");
     usage.addKeyboardMouseBinding(_keyEventPrintsOutStats,"Output stats to console.");
+    usage.addKeyboardMouseBinding(_keyEventWritesOutStatsTrace,"Write stats frame timeline to Chrome trace file.");
 }
 
 }
@@ -18,6 +18,7 @@
 #include <osg/io_utils>
 #include <osg/TextureRectangle>
 #include <osg/TextureCubeMap>
+#include <osg/TraceRecorder>
 
 #include <osgUtil/RayIntersector>
 
@@ -34,6 +35,8 @@
 #include <osgViewer/config/PanoramicSphericalDisplay>
 #include <osgViewer/config/WoWVxDisplay>
 
+#include "StatsAttributeIDs.h"
+
 #include <sstream>
 #include <string.h>
 
@@ -645,11 +648,11 @@ void Viewer::advance(double simulationTime)
     {
         // update previous frame stats
         double deltaFrameTime = _frameStamp->getReferenceTime() - previousReferenceTime;
-        getViewerStats()->setAttribute(previousFrameNumber, "Frame duration", deltaFrameTime);
-        getViewerStats()->setAttribute(previousFrameNumber, "Frame rate", 1.0/deltaFrameTime);
+        getViewerStats()->setAttribute(previousFrameNumber, getStatsAttributeIDs().frameDuration, deltaFrameTime);
+        getViewerStats()->setAttribute(previousFrameNumber, getStatsAttributeIDs().frameRate, 1.0/deltaFrameTime);
 
         // update current frames stats
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Reference time", _frameStamp->getReferenceTime());
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().referenceTime, _frameStamp->getReferenceTime());
     }
 
 
@@ -845,6 +848,8 @@ void Viewer::reprojectPointerData(osgGA::GUIEventAdapter& source_event, osgGA::G
 
 void Viewer::eventTraversal()
 {
+    OSG_TRACE_ZONE("osgViewer", "Viewer::eventTraversal");
+
     if (_done) return;
 
     double cutOffTime = _frameStamp->getReferenceTime();
@@ -1098,15 +1103,17 @@ void Viewer::eventTraversal()
         double endEventTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
 
         // update current frames stats
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Event traversal begin time", beginEventTraversal);
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Event traversal end time", endEventTraversal);
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Event traversal time taken", endEventTraversal-beginEventTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().eventTraversalBeginTime, beginEventTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().eventTraversalEndTime, endEventTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().eventTraversalTimeTaken, endEventTraversal-beginEventTraversal);
     }
 
 }
 
 void Viewer::updateTraversal()
 {
+    OSG_TRACE_ZONE("osgViewer", "Viewer::updateTraversal");
+
     if (_done) return;
 
     double beginUpdateTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
@@ -1186,9 +1193,11 @@ void Viewer::updateTraversal()
         double endUpdateTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
 
         // update current frames stats
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal begin time", beginUpdateTraversal);
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal end time", endUpdateTraversal);
-        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal time taken", endUpdateTraversal-beginUpdateTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().updateTraversalBeginTime, beginUpdateTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().updateTraversalEndTime, endUpdateTraversal);
+        getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), getStatsAttributeIDs().updateTraversalTimeTaken, endUpdateTraversal-beginUpdateTraversal);
+
+        collectDatabasePagerStats(_frameStamp->getFrameNumber());
     }
 }
 
@@ -18,17 +18,23 @@
 #include <osgViewer/View>
 #include <osgViewer/Renderer>
 
+#include "StatsAttributeIDs.h"
+
 #include <osg/io_utils>
 
 #include <osg/TextureCubeMap>
 #include <osg/TextureRectangle>
 #include <osg/TexMat>
 #include <osg/DeleteHandler>
+#include <osg/BackgroundReleaseThread>
+#include <osg/TraceRecorder>
 
 #include <osgUtil/Optimizer>
 #include <osgUtil/IntersectionVisitor>
 #include <osgUtil/Statistics>
 
+#include <set>
+
 static osg::ApplicationUsageProxy ViewerBase_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_CONFIG_FILE <filename>","Specify a viewer configuration file to load by default.");
 static osg::ApplicationUsageProxy ViewerBase_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_THREADING <value>","Set the threading model using by Viewer, <value> can be SingleThreaded, CullDrawThreadPerContext, DrawThreadPerContext or CullThreadPerCameraDrawThreadPerContext.");
 static osg::ApplicationUsageProxy ViewerBase_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_SCREEN <value>","Set the default screen that windows should open up on.");
@@ -38,6 +44,32 @@ static osg::ApplicationUsageProxy ViewerBase_e5(osg::ApplicationUsage::ENVIRONME
 
 using namespace osgViewer;
 
+void ViewerBase::collectDatabasePagerStats(unsigned int frameNumber)
+{
+    // several pagers may share a release thread, so only count each one once.
+    typedef std::set<osg::BackgroundReleaseThread*> ReleaseThreads;
+    ReleaseThreads releaseThreads;
+
+    Scenes scenes;
+    getScenes(scenes);
+    for(Scenes::iterator itr = scenes.begin(); itr != scenes.end(); ++itr)
+    {
+        osgDB::DatabasePager* dp = (*itr)->getDatabasePager();
+        osg::BackgroundReleaseThread* releaseThread = dp ? dp->getActiveBackgroundReleaseThread() : 0;
+        if (releaseThread) releaseThreads.insert(releaseThread);
+    }
+
+    if (releaseThreads.empty()) return;
+
+    double numBytesPending = 0.0;
+    for(ReleaseThreads::iterator itr = releaseThreads.begin(); itr != releaseThreads.end(); ++itr)
+    {
+        numBytesPending += (*itr)->getNumBytesPending();
+    }
+
+    getViewerStats()->setAttribute(frameNumber, getStatsAttributeIDs().bytesPendingRelease, numBytesPending);
+}
+
 ViewerBase::ViewerBase():
     osg::Object(true)
 {
@@ -635,6 +667,8 @@ int ViewerBase::run()
 
 void ViewerBase::frame(double simulationTime)
 {
+    OSG_TRACE_ZONE("osgViewer", "ViewerBase::frame");
+
     if (_done) return;
 
     // OSG_NOTICE<<std::endl<<"CompositeViewer::frame()"<<std::endl<<std::endl;
@@ -660,6 +694,8 @@ void ViewerBase::frame(double simulationTime)
 
 void ViewerBase::renderingTraversals()
 {
+    OSG_TRACE_ZONE("osgViewer", "ViewerBase::renderingTraversals");
+
     bool _outputMasterCameraLocation = false;
     if (_outputMasterCameraLocation)
     {
@@ -867,9 +903,9 @@ void ViewerBase::renderingTraversals()
         double endRenderingTraversals = elapsedTime();
 
         // update current frames stats
-        getViewerStats()->setAttribute(frameStamp->getFrameNumber(), "Rendering traversals begin time ", beginRenderingTraversals);
-        getViewerStats()->setAttribute(frameStamp->getFrameNumber(), "Rendering traversals end time ", endRenderingTraversals);
-        getViewerStats()->setAttribute(frameStamp->getFrameNumber(), "Rendering traversals time taken", endRenderingTraversals-beginRenderingTraversals);
+        getViewerStats()->setAttribute(frameStamp->getFrameNumber(), getStatsAttributeIDs().renderingTraversalsBeginTime, beginRenderingTraversals);
+        getViewerStats()->setAttribute(frameStamp->getFrameNumber(), getStatsAttributeIDs().renderingTraversalsEndTime, endRenderingTraversals);
+        getViewerStats()->setAttribute(frameStamp->getFrameNumber(), getStatsAttributeIDs().renderingTraversalsTimeTaken, endRenderingTraversals-beginRenderingTraversals);
     }
 
     _requestRedraw = false;
@@ -0,0 +1,11 @@
+#include <osgTerrain/HeightFieldTechnique>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+REGISTER_OBJECT_WRAPPER( osgTerrain_HeightFieldTechnique,
+                         new osgTerrain::HeightFieldTechnique,
+                         osgTerrain::HeightFieldTechnique,
+                         "osg::Object osgTerrain::TerrainTechnique osgTerrain::GeometryTechnique osgTerrain::HeightFieldTechnique" )
+{
+}
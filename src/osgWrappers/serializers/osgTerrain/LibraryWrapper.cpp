@@ -4,6 +4,7 @@ USE_SERIALIZER_WRAPPER(osgTerrain_CompositeLayer)
 USE_SERIALIZER_WRAPPER(osgTerrain_ContourLayer)
 USE_SERIALIZER_WRAPPER(osgTerrain_GeometryTechnique)
 USE_SERIALIZER_WRAPPER(osgTerrain_HeightFieldLayer)
+USE_SERIALIZER_WRAPPER(osgTerrain_HeightFieldTechnique)
 USE_SERIALIZER_WRAPPER(osgTerrain_ImageLayer)
 USE_SERIALIZER_WRAPPER(osgTerrain_Layer)
 USE_SERIALIZER_WRAPPER(osgTerrain_Locator)